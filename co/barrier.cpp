@@ -32,9 +32,14 @@
 #include "barrierCommand.h"
 #include "exception.h"
 
+#include <lunchbox/clock.h>
 #include <lunchbox/monitor.h>
+#include <lunchbox/scopedMutex.h>
 #include <lunchbox/stdExt.h>
 
+#include <algorithm>
+#include <map>
+
 namespace co
 {
 namespace
@@ -47,10 +52,68 @@ struct Request
     uint32_t timeout;
     uint32_t incarnation;
     Nodes nodes;
+    std::vector< float > times; //!< arrival time of each node
 };
 
 typedef stde::hash_map< uint128_t, Request > RequestMap;
 typedef RequestMap::iterator RequestMapIter;
+
+/** The received signals per version and incarnation|signal. */
+typedef std::pair< uint128_t, uint64_t > SignalKey;
+typedef std::map< SignalKey, uint32_t > Signals;
+typedef Signals::iterator SignalsIter;
+
+/** The signals of the tree algorithm, the others are dissemination rounds. */
+static const uint32_t SIGNAL_ARRIVE = LB_UNDEFINED_UINT32 - 1;
+static const uint32_t SIGNAL_RELEASE = LB_UNDEFINED_UINT32 - 2;
+/** Sent by the master to all participants when a node enters through it. */
+static const uint32_t SIGNAL_RESET = LB_UNDEFINED_UINT32 - 3;
+
+/** The interval (ms) to check the peers of a blocked participant. */
+static const uint32_t _staleCheckTime = 100;
+
+/** The arity of the tree of participants. */
+static const uint32_t _fanout = 4;
+
+/** The number of latency histogram buckets, the last one is open-ended. */
+static const size_t _nBuckets = 32;
+
+typedef std::map< NodeID, co::Barrier::Participant > ParticipantMap;
+typedef ParticipantMap::const_iterator ParticipantMapCIter;
+
+bool _isSlower( const co::Barrier::Participant& lhs,
+                const co::Barrier::Participant& rhs )
+{
+    return lhs.waitTime > rhs.waitTime;
+}
+
+/** Busy-wait up to time ms until the monitor is (not) equal to value. */
+bool _spin( const lunchbox::Monitor< uint32_t >& monitor,
+            const uint32_t value, const bool equal, const float time )
+{
+    if( time <= 0.f )
+        return false;
+
+    const lunchbox::Clock clock;
+    while( clock.getTimef() < time )
+        if( ( monitor.get() == value ) == equal )
+            return true;
+    return false;
+}
+
+SignalKey _makeKey( const uint128_t& version, const uint32_t incarnation,
+                    const uint32_t signal )
+{
+    return SignalKey( version, ( uint64_t( incarnation ) << 32 ) | signal );
+}
+
+/** Compute the [first,last) children of a node in the participant tree. */
+void _getChildren( const uint32_t index, const uint32_t size,
+                   uint32_t& first, uint32_t& last )
+{
+    first = index * _fanout + 1;
+    last = LB_MIN( first + _fanout, size );
+}
 }
 
 namespace detail
@@ -58,19 +121,75 @@ namespace detail
 class Barrier
 {
 public:
-    Barrier() : height( 0 ) {}
+    Barrier()
+        : height( 0 )
+        , algorithm( co::Barrier::CENTRAL )
+        , releaseIndex( 0 )
+        , rank( LB_UNDEFINED_UINT32 )
+        , epoch( 0 )
+        , histogram( _nBuckets, 0 )
+        , averageTime( 0.f )
+    {}
+
     Barrier( NodePtr m, const uint32_t h )
         : masterID( m ? m->getNodeID() : NodeID( ))
         , height( h )
+        , algorithm( co::Barrier::CENTRAL )
         , master( m )
+        , releaseIndex( 0 )
+        , rank( LB_UNDEFINED_UINT32 )
+        , epoch( 0 )
+        , histogram( _nBuckets, 0 )
+        , averageTime( 0.f )
     {}
 
+    /**
+     * @return the time to busy-wait before blocking. Spins for about twice the
+     *         average enter time, unless it exceeds the maximum spin time.
+     */
+    float getSpinTime() const
+    {
+        const float maxTime = float( Global::getIAttribute(
+                                     Global::IATTR_BARRIER_SPIN_TIME_US )) /
+                              1000.f;
+        lunchbox::ScopedMutex<> mutex( lock );
+        return averageTime < maxTime ? LB_MIN( maxTime, 2.f * averageTime ) :
+                                       0.f;
+    }
+
+    /** Add the time of one enter() to the histogram and average. */
+    void addTime( const float time )
+    {
+        const uint64_t us = uint64_t( time * 1000.f );
+        size_t bucket = 0;
+        while( bucket < _nBuckets - 1 && ( us >> ( bucket + 1 )) > 0 )
+            ++bucket;
+
+        lunchbox::ScopedMutex<> mutex( lock );
+        ++histogram[ bucket ];
+        averageTime = ( 7.f * averageTime + time ) / 8.f;
+    }
+
+    /** Drop the participants of the given version. */
+    void resetParticipants( const uint128_t& version )
+    {
+        lunchbox::ScopedMutex<> mutex( lock );
+        if( participantsVersion != version || participants.empty( ))
+            return;
+
+        participants.clear();
+        ++epoch;
+    }
+
     /** The master barrier node. */
     NodeID   masterID;
 
     /** The height of the barrier, only set on the master. */
     uint32_t height;
 
+    /** The synchronization algorithm. */
+    co::Barrier::Algorithm algorithm;
+
     /** The local, connected instantiation of the master node. */
     NodePtr master;
 
@@ -79,9 +198,54 @@ public:
 
     /** The monitor used for barrier leave notification. */
     lunchbox::Monitor< uint32_t > leaveNotify;
+
+    /** Protects the release, participants and signals. */
+    mutable lunchbox::Lock lock;
+
+    /** The last release received by the command thread, to be forwarded. */
+    NodeIDs release;
+    uint32_t releaseIndex; //!< position in the tree, undefined for multicast
+    uint128_t releaseVersion;
+
+    /** The participants of the last release, the root first. */
+    NodeIDs participants;
+    uint128_t participantsVersion;
+    uint32_t rank; //!< the position of the local node in participants
+    uint32_t epoch; //!< incremented each time the participants change
+
+    /** The participants released last by the master, reset on a new entry. */
+    NodeIDs released;
+    uint128_t releasedVersion;
+
+    /** Signals received from other participants. */
+    Signals signals;
+
+    /** Incremented for each signal received. */
+    lunchbox::Monitor< uint32_t > signaled;
+
+    /** Durations of enter(), see co::Barrier::getLatencyHistogram(). */
+    std::vector< uint64_t > histogram;
+
+    /** Running average of the enter() time in ms. */
+    float averageTime;
+
+    /** Entry statistics per node on the master, and the clock for them. */
+    ParticipantMap participantStats;
+    lunchbox::Clock clock;
 };
 }
 
+/** The state of one enter() synchronizing directly between participants. */
+struct Barrier::Round
+{
+    NodeIDs nodes; //!< the participants, the root first
+    uint32_t rank; //!< the position of the local node in nodes
+    uint32_t epoch; //!< the generation of the participants
+    uint32_t incarnation;
+    uint32_t timeout;
+    Nodes peers; //!< the participants signaling the local node
+};
+
 typedef CommandFunc<Barrier> CmdFunc;
 
 Barrier::Barrier( NodePtr master, const uint32_t height )
@@ -99,25 +263,29 @@ Barrier::~Barrier()
 void Barrier::getInstanceData( DataOStream& os )
 {
     LBASSERT( _impl->masterID != NodeID( ));
-    os << _impl->height << _impl->masterID;
+    os << _impl->height << _impl->masterID << uint32_t( _impl->algorithm );
     _impl->leaveNotify = 0;
 }
 
 void Barrier::applyInstanceData( DataIStream& is )
 {
-    is >> _impl->height >> _impl->masterID;
+    uint32_t algorithm = 0;
+    is >> _impl->height >> _impl->masterID >> algorithm;
+    _impl->algorithm = Algorithm( algorithm );
     _impl->leaveNotify = 0;
 }
 
 void Barrier::pack( DataOStream& os )
 {
-    os << _impl->height;
+    os << _impl->height << uint32_t( _impl->algorithm );
     _impl->leaveNotify = 0;
 }
 
 void Barrier::unpack( DataIStream& is )
 {
-    is >> _impl->height;
+    uint32_t algorithm = 0;
+    is >> _impl->height >> algorithm;
+    _impl->algorithm = Algorithm( algorithm );
     _impl->leaveNotify = 0;
 }
 
@@ -137,6 +305,45 @@ uint32_t Barrier::getHeight() const
     return _impl->height;
 }
 
+void Barrier::setAlgorithm( const Algorithm algorithm )
+{
+    _impl->algorithm = algorithm;
+}
+
+Barrier::Algorithm Barrier::getAlgorithm() const
+{
+    return _impl->algorithm;
+}
+
+std::vector< uint64_t > Barrier::getLatencyHistogram() const
+{
+    lunchbox::ScopedMutex<> mutex( _impl->lock );
+    return _impl->histogram;
+}
+
+Barrier::Participants Barrier::getParticipants() const
+{
+    Participants participants;
+    {
+        lunchbox::ScopedMutex<> mutex( _impl->lock );
+        participants.reserve( _impl->participantStats.size( ));
+        for( ParticipantMapCIter i = _impl->participantStats.begin();
+             i != _impl->participantStats.end(); ++i )
+        {
+            participants.push_back( i->second );
+        }
+    }
+    std::sort( participants.begin(), participants.end(), _isSlower );
+    return participants;
+}
+
+void Barrier::resetStatistics()
+{
+    lunchbox::ScopedMutex<> mutex( _impl->lock );
+    _impl->histogram.assign( _nBuckets, 0 );
+    _impl->participantStats.clear();
+}
+
 void Barrier::attach( const UUID& id, const uint32_t instanceID )
 {
     Object::attach( id, instanceID );
@@ -148,6 +355,10 @@ void Barrier::attach( const UUID& id, const uint32_t instanceID )
                      CmdFunc( this, &Barrier::_cmdEnter ), queue );
     registerCommand( CMD_BARRIER_ENTER_REPLY,
                      CmdFunc( this, &Barrier::_cmdEnterReply ), queue );
+    registerCommand( CMD_BARRIER_RELEASE,
+                     CmdFunc( this, &Barrier::_cmdRelease ), queue );
+    registerCommand( CMD_BARRIER_SIGNAL,
+                     CmdFunc( this, &Barrier::_cmdSignal ), queue );
 
     if( _impl->masterID == NodeID( ))
         _impl->masterID = node->getNodeID();
@@ -161,6 +372,13 @@ void Barrier::enter( const uint32_t timeout )
     if( _impl->height == 1 ) // trivial ;)
         return;
 
+    const lunchbox::Clock clock;
+    if( _hasParticipants() && _enterParticipants( timeout ))
+    {
+        _impl->addTime( clock.getTimef( ));
+        return;
+    }
+
     if( !_impl->master )
     {
         LocalNodePtr localNode = getLocalNode();
@@ -184,13 +402,24 @@ void Barrier::enter( const uint32_t timeout )
     send( _impl->master, CMD_BARRIER_ENTER )
         << getVersion() << _impl->leaveNotify.get() << timeout;
 
+    _wait( leaveVal, timeout );
+    _forward();
+    _impl->addTime( clock.getTimef( ));
+
+    LBLOG( LOG_BARRIER ) << "left barrier " << getID() << " v" << getVersion()
+                         << ", height " << _impl->height << std::endl;
+}
+
+void Barrier::_wait( const uint32_t leaveVal, const uint32_t timeout )
+{
+    // Spin first, the release often follows shortly after the last entry
+    if( _spin( _impl->leaveNotify, leaveVal, true, _impl->getSpinTime( )))
+        return;
+
     if( timeout == LB_TIMEOUT_INDEFINITE )
         _impl->leaveNotify.waitEQ( leaveVal );
     else if( !_impl->leaveNotify.timedWaitEQ( leaveVal, timeout ))
         throw Exception( Exception::TIMEOUT_BARRIER );
-
-    LBLOG( LOG_BARRIER ) << "left barrier " << getID() << " v" << getVersion()
-                         << ", height " << _impl->height << std::endl;
 }
 
 bool Barrier::_cmdEnter( ICommand& cmd )
@@ -235,11 +464,13 @@ bool Barrier::_cmdEnter( ICommand& cmd )
         else if( request.incarnation != incarnation )
         {
             request.nodes.clear();
+            request.times.clear();
             request.incarnation = incarnation;
             request.timeout = timeout;
         }
     }
     request.nodes.push_back( command.getNode( ));
+    request.times.push_back( _impl->clock.getTimef( ));
 
     // clean older data which was not removed during older synchronization
     if( request.timeout != LB_TIMEOUT_INDEFINITE )
@@ -264,6 +495,7 @@ bool Barrier::_cmdEnter( ICommand& cmd )
     }
 
     LBASSERT( version == getVersion( ));
+    _resetParticipants( version );
 
     Nodes& nodes = request.nodes;
     if( nodes.size() < _impl->height )
@@ -272,10 +504,29 @@ bool Barrier::_cmdEnter( ICommand& cmd )
     LBASSERT( nodes.size() == _impl->height );
     LBLOG( LOG_BARRIER ) << "Barrier reached" << std::endl;
 
+    {
+        lunchbox::ScopedMutex<> mutex( _impl->lock );
+        const std::vector< float >& times = request.times;
+        for( size_t i = 0; i < nodes.size(); ++i )
+        {
+            const NodeID& nodeID = nodes[ i ]->getNodeID();
+            Participant& participant = _impl->participantStats[ nodeID ];
+            participant.id = nodeID;
+            ++participant.nEntries;
+            participant.waitTime += times[ i ] - times.front();
+        }
+        ++_impl->participantStats[ nodes.back()->getNodeID() ].nLast;
+    }
+
     stde::usort( nodes );
 
-    for( NodesIter i = nodes.begin(); i != nodes.end(); ++i )
-        _sendNotify( version, *i );
+    if( _impl->algorithm == CENTRAL )
+    {
+        for( NodesIter i = nodes.begin(); i != nodes.end(); ++i )
+            _sendNotify( version, *i );
+    }
+    else
+        _release( version, nodes );
 
     // delete node vector for version
     RequestMapIter i = _impl->enteredNodes.find( version );
@@ -305,6 +556,376 @@ void Barrier::_sendNotify( const uint128_t& version, NodePtr node )
     }
 }
 
+void Barrier::_release( const uint128_t& version, Nodes& nodes )
+{
+    LB_TS_THREAD( _thread );
+
+    // The local node is the root of the release tree. Multicast is used if all
+    // remote nodes are reached through the same multicast connection.
+    NodeIDs nodeIDs;
+    nodeIDs.reserve( nodes.size( ));
+    bool hasLocal = false;
+    bool useMulticast = _impl->algorithm == MULTICAST;
+    ConnectionPtr multicast;
+
+    for( NodesIter i = nodes.begin(); i != nodes.end(); ++i )
+    {
+        NodePtr node = *i;
+        if( node->isLocal( ))
+        {
+            nodeIDs.insert( nodeIDs.begin(), node->getNodeID( ));
+            hasLocal = true;
+            continue;
+        }
+
+        nodeIDs.push_back( node->getNodeID( ));
+        if( !useMulticast )
+            continue;
+
+        ConnectionPtr connection = node->getConnection( true );
+        if( connection == node->getConnection() ||
+            ( multicast && connection != multicast ))
+        {
+            useMulticast = false;
+        }
+        else
+            multicast = connection;
+    }
+
+    if( _impl->algorithm == TREE || _impl->algorithm == DISSEMINATION )
+    {
+        lunchbox::ScopedMutex<> mutex( _impl->lock );
+        _impl->released = nodeIDs;
+        _impl->releasedVersion = version;
+    }
+
+    if( useMulticast && multicast )
+    {
+        LBLOG( LOG_BARRIER ) << "Unlock " << nodes.size() << " nodes using "
+                             << multicast << std::endl;
+        ObjectOCommand( Connections( 1, multicast ), CMD_BARRIER_RELEASE,
+                        COMMANDTYPE_OBJECT, getID(), EQ_INSTANCE_ALL )
+            << version << nodeIDs << LB_UNDEFINED_UINT32;
+        if( hasLocal )
+            _setRelease( version, nodeIDs, LB_UNDEFINED_UINT32 );
+    }
+    else if( hasLocal ) // local application thread forwards to the children
+        _setRelease( version, nodeIDs, 0 );
+    else
+    {
+        LBLOG( LOG_BARRIER ) << "Unlock " << nodes.front() << std::endl;
+        send( nodes.front(), CMD_BARRIER_RELEASE ) << version << nodeIDs << 0u;
+    }
+}
+
+void Barrier::_setRelease( const uint128_t& version, const NodeIDs& nodes,
+                           const uint32_t index )
+{
+    LB_TS_THREAD( _thread );
+    if( version != getVersion( ))
+    {
+        LBWARN << "Ignore barrier release for v" << version << ", have v"
+               << getVersion() << std::endl;
+        return;
+    }
+
+    {
+        lunchbox::ScopedMutex<> mutex( _impl->lock );
+        _impl->release = nodes;
+        _impl->releaseIndex = index;
+        _impl->releaseVersion = version;
+    }
+    ++_impl->leaveNotify;
+}
+
+void Barrier::_forward()
+{
+    NodeIDs nodes;
+    uint32_t index = 0;
+    uint128_t version;
+    {
+        lunchbox::ScopedMutex<> mutex( _impl->lock );
+        if( _impl->release.empty( )) // central release or already forwarded
+            return;
+
+        nodes.swap( _impl->release );
+        index = _impl->releaseIndex;
+        version = _impl->releaseVersion;
+
+        NodeIDs::const_iterator i = std::find( nodes.begin(), nodes.end(),
+                                               getLocalNode()->getNodeID( ));
+        _impl->participants = nodes;
+        _impl->participantsVersion = version;
+        ++_impl->epoch;
+        _impl->rank = i == nodes.end() ? LB_UNDEFINED_UINT32 :
+                                         uint32_t( i - nodes.begin( ));
+    }
+
+    if( index == LB_UNDEFINED_UINT32 ) // multicast release
+        return;
+
+    uint32_t first, last;
+    _getChildren( index, uint32_t( nodes.size( )), first, last );
+    for( uint32_t i = first; i < last; ++i )
+    {
+        NodePtr node = _getNode( nodes[ i ] );
+        if( node )
+            send( node, CMD_BARRIER_RELEASE ) << version << nodes << i;
+    }
+}
+
+bool Barrier::_hasParticipants() const
+{
+    if( _impl->algorithm != TREE && _impl->algorithm != DISSEMINATION )
+        return false;
+
+    lunchbox::ScopedMutex<> mutex( _impl->lock );
+    return _impl->participantsVersion == getVersion() &&
+           _impl->participants.size() == _impl->height &&
+           _impl->rank != LB_UNDEFINED_UINT32;
+}
+
+bool Barrier::_enterParticipants( const uint32_t timeout )
+{
+    const uint128_t& version = getVersion();
+    Round round;
+    {
+        lunchbox::ScopedMutex<> mutex( _impl->lock );
+        if( _impl->participants.empty( )) // reset since _hasParticipants()
+            return false;
+        round.nodes = _impl->participants;
+        round.rank = _impl->rank;
+        round.epoch = _impl->epoch;
+    }
+    round.incarnation = _impl->leaveNotify.get();
+    round.timeout = timeout;
+
+    LBLOG( LOG_BARRIER ) << "enter barrier " << getID() << " v" << version
+                         << " as participant " << round.rank << " of "
+                         << _impl->height << std::endl;
+    bool reached = false;
+    try
+    {
+        if( _impl->algorithm == TREE )
+            reached = _combine( round );
+        else
+            reached = _disseminate( round );
+    }
+    catch( const Exception& )
+    {
+        // participants are out of sync, re-enter through the master next time
+        _impl->resetParticipants( version );
+        throw;
+    }
+
+    if( !reached )
+    {
+        LBLOG( LOG_BARRIER ) << "participants of barrier " << getID() << " v"
+                             << version << " changed, enter through master"
+                             << std::endl;
+        _impl->resetParticipants( version );
+        return false;
+    }
+
+    ++_impl->leaveNotify;
+
+    // drop signals of timed out and older synchronizations
+    lunchbox::ScopedMutex<> mutex( _impl->lock );
+    for( SignalsIter i = _impl->signals.begin(); i != _impl->signals.end(); )
+    {
+        const SignalKey& key = i->first;
+        if( key.first < version ||
+            ( key.first == version &&
+              ( key.second >> 32 ) < round.incarnation ))
+        {
+            _impl->signals.erase( i++ );
+        }
+        else
+            ++i;
+    }
+
+    LBLOG( LOG_BARRIER ) << "left barrier " << getID() << " v" << version
+                         << ", height " << _impl->height << std::endl;
+    return true;
+}
+
+bool Barrier::_combine( Round& round )
+{
+    const NodeIDs& nodes = round.nodes;
+    const uint32_t rank = round.rank;
+    uint32_t first, last;
+    _getChildren( rank, uint32_t( nodes.size( )), first, last );
+
+    const uint32_t parent = rank > 0 ? ( rank - 1 ) / _fanout : 0;
+    NodeIDs peers( nodes.begin() + first, nodes.begin() + last );
+    if( rank > 0 )
+        peers.push_back( nodes[ parent ] );
+
+    for( NodeIDs::const_iterator i = peers.begin(); i != peers.end(); ++i )
+    {
+        NodePtr peer = _getNode( *i );
+        if( !peer )
+            return false;
+        round.peers.push_back( peer );
+    }
+
+    if( first < last &&
+        !_waitSignal( round, SIGNAL_ARRIVE, last - first ))
+    {
+        return false;
+    }
+
+    if( rank > 0 )
+    {
+        _signal( nodes[ parent ], round.incarnation, SIGNAL_ARRIVE );
+        if( !_waitSignal( round, SIGNAL_RELEASE, 1 ))
+            return false;
+    }
+
+    for( uint32_t i = first; i < last; ++i )
+        _signal( nodes[ i ], round.incarnation, SIGNAL_RELEASE );
+    return true;
+}
+
+bool Barrier::_disseminate( Round& round )
+{
+    const NodeIDs& nodes = round.nodes;
+    const uint32_t size = uint32_t( nodes.size( ));
+
+    for( uint32_t distance = 1; distance < size; distance <<= 1 )
+    {
+        NodePtr peer = _getNode( nodes[ ( round.rank + size - distance ) %
+                                        size ] );
+        if( !peer )
+            return false;
+        round.peers.push_back( peer );
+    }
+
+    uint32_t signal = 0;
+    for( uint32_t distance = 1; distance < size; distance <<= 1, ++signal )
+    {
+        _signal( nodes[ ( round.rank + distance ) % size ], round.incarnation,
+                 signal );
+        if( !_waitSignal( round, signal, 1 ))
+            return false;
+    }
+    return true;
+}
+
+void Barrier::_signal( const NodeID& nodeID, const uint32_t incarnation,
+                       const uint32_t signal )
+{
+    NodePtr node = _getNode( nodeID );
+    if( node )
+        send( node, CMD_BARRIER_SIGNAL ) << getVersion() << incarnation
+                                         << signal;
+}
+
+bool Barrier::_waitSignal( const Round& round, const uint32_t signal,
+                           const uint32_t count )
+{
+    const SignalKey key = _makeKey( getVersion(), round.incarnation, signal );
+    const float spinTime = _impl->getSpinTime();
+    const lunchbox::Clock clock;
+    while( true )
+    {
+        const uint32_t signaled = _impl->signaled.get();
+        {
+            lunchbox::ScopedMutex<> mutex( _impl->lock );
+            if( _impl->epoch != round.epoch ) // reset by the master
+                return false;
+
+            SignalsIter i = _impl->signals.find( key );
+            if( i != _impl->signals.end() && i->second >= count )
+            {
+                _impl->signals.erase( i );
+                return true;
+            }
+        }
+
+        if( _spin( _impl->signaled, signaled, false, spinTime ))
+            continue;
+
+        // Block in slices to notice peers leaving, which never signal
+        uint32_t time = _staleCheckTime;
+        if( round.timeout != LB_TIMEOUT_INDEFINITE )
+        {
+            const float left = float( round.timeout ) - clock.getTimef();
+            if( left <= 0.f )
+                throw Exception( Exception::TIMEOUT_BARRIER );
+            time = LB_MIN( time, uint32_t( left ) + 1 );
+        }
+        if( !_impl->signaled.timedWaitNE( signaled, time ) &&
+            _isStale( round ))
+        {
+            return false;
+        }
+    }
+}
+
+bool Barrier::_isStale( const Round& round ) const
+{
+    for( NodesCIter i = round.peers.begin(); i != round.peers.end(); ++i )
+    {
+        if( !(*i)->isReachable( ))
+        {
+            LBINFO << "Barrier participant " << (*i)->getNodeID()
+                   << " left barrier " << getID() << std::endl;
+            return true;
+        }
+    }
+    return false;
+}
+
+void Barrier::_resetParticipants( const uint128_t& version )
+{
+    LB_TS_THREAD( _thread );
+
+    NodeIDs nodes;
+    {
+        lunchbox::ScopedMutex<> mutex( _impl->lock );
+        if( _impl->releasedVersion != version )
+            return;
+        nodes.swap( _impl->released );
+    }
+    if( nodes.empty( ))
+        return;
+
+    // A node entering through the master after a release means the set of
+    // participants changed. Let them all enter through the master again.
+    LBLOG( LOG_BARRIER ) << "Reset " << nodes.size() << " participants of v"
+                         << version << std::endl;
+    const NodeID& localID = getLocalNode()->getNodeID();
+    for( NodeIDs::const_iterator i = nodes.begin(); i != nodes.end(); ++i )
+    {
+        if( *i == localID )
+        {
+            _impl->resetParticipants( version );
+            ++_impl->signaled;
+            continue;
+        }
+
+        NodePtr node = _getNode( *i );
+        if( node )
+            send( node, CMD_BARRIER_SIGNAL ) << version << 0u << SIGNAL_RESET;
+    }
+}
+
+NodePtr Barrier::_getNode( const NodeID& nodeID )
+{
+    LocalNodePtr localNode = getLocalNode();
+    NodePtr node = localNode->getNode( nodeID );
+    if( !node || !node->isReachable( ))
+        node = localNode->connect( nodeID );
+
+    if( !node || !node->isReachable( ))
+    {
+        LBWARN << "Can't connect barrier participant " << nodeID << std::endl;
+        return 0;
+    }
+    return node;
+}
+
 void Barrier::_cleanup( const uint64_t time )
 {
     LB_TS_THREAD( _thread );
@@ -347,4 +968,42 @@ bool Barrier::_cmdEnterReply( ICommand& cmd )
     return true;
 }
 
+bool Barrier::_cmdRelease( ICommand& cmd )
+{
+    ObjectICommand command( cmd );
+    LB_TS_THREAD( _thread );
+    const uint128_t version = command.get< uint128_t >();
+    const NodeIDs nodes = command.get< NodeIDs >();
+    const uint32_t index = command.get< uint32_t >();
+
+    // multicast releases also reach nodes not entering the barrier
+    const NodeID& nodeID = getLocalNode()->getNodeID();
+    if( std::find( nodes.begin(), nodes.end(), nodeID ) == nodes.end( ))
+        return true;
+
+    LBLOG( LOG_BARRIER ) << "Got release, unlock local user(s)" << std::endl;
+    _setRelease( version, nodes, index );
+    return true;
+}
+
+bool Barrier::_cmdSignal( ICommand& cmd )
+{
+    ObjectICommand command( cmd );
+    const uint128_t version = command.get< uint128_t >();
+    const uint32_t incarnation = command.get< uint32_t >();
+    const uint32_t signal = command.get< uint32_t >();
+
+    LBLOG( LOG_BARRIER ) << "Got signal " << signal << " for v" << version
+                         << " incarnation " << incarnation << std::endl;
+    if( signal == SIGNAL_RESET )
+        _impl->resetParticipants( version );
+    else
+    {
+        lunchbox::ScopedMutex<> mutex( _impl->lock );
+        ++_impl->signals[ _makeKey( version, incarnation, signal ) ];
+    }
+    ++_impl->signaled;
+    return true;
+}
+
 }
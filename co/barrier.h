@@ -32,6 +32,27 @@ namespace detail { class Barrier; }
     class Barrier : public Object
     {
     public:
+        /**
+         * The synchronization algorithm of a barrier.
+         *
+         * All algorithms enter through the barrier's master node until the
+         * participants are known. The tree and dissemination algorithms then
+         * synchronize directly between the participants, as long as the same
+         * nodes enter each time, with one thread per node. A new version of the
+         * barrier restarts with an entry through the master node. So does a
+         * node entering through the master, which resets the participants of
+         * the other nodes, and a participant losing the connection to one of
+         * its peers.
+         * @version 1.0
+         */
+        enum Algorithm
+        {
+            CENTRAL,      //!< all nodes enter and are released by the master
+            TREE,         //!< enter and release through a tree of the nodes
+            DISSEMINATION, //!< log2(n) rounds of pairwise signals, no master
+            MULTICAST     //!< release all nodes with one multicast command
+        };
+
         /**
          * Construct a new barrier.
          *
@@ -68,6 +89,53 @@ namespace detail { class Barrier; }
 
         /** @return the number of participants. @version 1.0 */
         CO_API uint32_t getHeight() const;
+
+        /**
+         * Set the synchronization algorithm, CENTRAL by default.
+         *
+         * The MULTICAST algorithm uses the TREE algorithm if the master node
+         * does not reach all participants through one multicast connection.
+         * @version 1.0
+         */
+        CO_API void setAlgorithm( const Algorithm algorithm );
+
+        /** @return the synchronization algorithm. @version 1.0 */
+        CO_API Algorithm getAlgorithm() const;
+        //@}
+
+        /** @name Statistics */
+        //@{
+        /**
+         * The entry statistics of one node, gathered by the master node.
+         * @version 1.0
+         */
+        struct Participant
+        {
+            Participant() : nEntries( 0 ), nLast( 0 ), waitTime( 0.f ) {}
+
+            NodeID id;         //!< the identifier of the node
+            uint32_t nEntries; //!< the number of entries
+            uint32_t nLast;    //!< the number of times it was the last entry
+            float waitTime;    //!< total time (ms) after the first entry
+        };
+        typedef std::vector< Participant > Participants;
+
+        /**
+         * @return the histogram of the time spent in enter(), where bucket i
+         *         counts durations of [2^i, 2^(i+1)) microseconds.
+         * @version 1.0
+         */
+        CO_API std::vector< uint64_t > getLatencyHistogram() const;
+
+        /**
+         * @return the statistics of all nodes which entered through this
+         *         master instance, sorted by total wait time, slowest first.
+         * @version 1.0
+         */
+        CO_API Participants getParticipants() const;
+
+        /** Reset the latency histogram and participant statistics. */
+        CO_API void resetStatistics();
         //@}
 
         /** @name Operations */
@@ -101,10 +169,30 @@ namespace detail { class Barrier; }
 
         void _cleanup( const uint64_t time );
         void _sendNotify( const uint128_t& version, NodePtr node );
+        void _release( const uint128_t& version, Nodes& nodes );
+        void _setRelease( const uint128_t& version, const NodeIDs& nodes,
+                          const uint32_t index );
+        void _forward();
+        void _wait( const uint32_t leaveVal, const uint32_t timeout );
+        struct Round;
+
+        bool _hasParticipants() const;
+        bool _enterParticipants( const uint32_t timeout );
+        bool _combine( Round& round );
+        bool _disseminate( Round& round );
+        void _signal( const NodeID& nodeID, const uint32_t incarnation,
+                      const uint32_t signal );
+        bool _waitSignal( const Round& round, const uint32_t signal,
+                          const uint32_t count );
+        bool _isStale( const Round& round ) const;
+        void _resetParticipants( const uint128_t& version );
+        NodePtr _getNode( const NodeID& nodeID );
 
         /* The command handlers. */
         bool _cmdEnter( ICommand& command );
         bool _cmdEnterReply( ICommand& command );
+        bool _cmdRelease( ICommand& command );
+        bool _cmdSignal( ICommand& command );
 
         LB_TS_VAR( _thread );
     };
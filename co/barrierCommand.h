@@ -27,7 +27,9 @@ namespace co
     enum BarrierCommand
     {
         CMD_BARRIER_ENTER = CMD_OBJECT_CUSTOM,
-        CMD_BARRIER_ENTER_REPLY
+        CMD_BARRIER_ENTER_REPLY,
+        CMD_BARRIER_RELEASE,
+        CMD_BARRIER_SIGNAL
     };
 }
 
@@ -0,0 +1,273 @@
+
+/* Copyright (c) 2013, Stefan Eilemann <eile@equalizergraphics.com>
+ *
+ * This file is part of Collage <https://github.com/Eyescale/Collage>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 2.1 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "binaryDiff.h"
+
+#include "array.h"
+#include "dataIStream.h"
+#include "dataOStream.h"
+#include "log.h"
+
+#include <cstring>
+#include <limits>
+
+namespace co
+{
+namespace binaryDiff
+{
+namespace
+{
+/** The matching granularity, smaller blocks find more but cost more ops. */
+static const uint64_t _blockSize = 64;
+
+/** The serialized size of an operation, without literal data. */
+static const uint64_t _opSize = sizeof( uint8_t ) + 2 * sizeof( uint64_t );
+static const uint64_t _literalOpSize = sizeof( uint8_t ) + sizeof( uint64_t );
+
+static const uint64_t _noBlock = std::numeric_limits< uint64_t >::max();
+
+/** Adler-style checksum of a block, which can be rolled by one byte. */
+class Checksum
+{
+public:
+    void init( const uint8_t* data )
+    {
+        _a = 0;
+        _b = 0;
+        for( uint64_t i = 0; i < _blockSize; ++i )
+        {
+            _a += data[ i ];
+            _b += _a;
+        }
+    }
+
+    void roll( const uint8_t out, const uint8_t in )
+    {
+        _a += in - out;
+        _b += _a - uint32_t( _blockSize ) * out;
+    }
+
+    uint32_t get() const { return ( _b << 16 ) ^ _a; }
+
+private:
+    uint32_t _a;
+    uint32_t _b;
+};
+
+/** FNV-1a hash identifying the data a diff is based on. */
+uint64_t _hash( const lunchbox::Bufferb& data )
+{
+    uint64_t hash = 14695981039346656037ull;
+    const uint8_t* bytes = data.getData();
+    for( uint64_t i = 0; i < data.getSize(); ++i )
+    {
+        hash ^= bytes[ i ];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+void _addLiteral( Ops& ops, const uint64_t start, const uint64_t end )
+{
+    if( end > start )
+        ops.push_back( Op( false, start, end - start ));
+}
+
+void _addCopy( Ops& ops, const uint64_t offset, const uint64_t size )
+{
+    if( !ops.empty( ))
+    {
+        Op& last = ops.back();
+        if( last.copy && last.offset + last.size == offset )
+        {
+            last.size += size;
+            return;
+        }
+    }
+    ops.push_back( Op( true, offset, size ));
+}
+}
+
+uint64_t compute( const lunchbox::Bufferb& previous,
+                  const lunchbox::Bufferb& current, Ops& ops )
+{
+    ops.clear();
+    const uint8_t* prev = previous.getData();
+    const uint8_t* cur = current.getData();
+    const uint64_t prevSize = previous.getSize();
+    const uint64_t curSize = current.getSize();
+
+    // index the blocks of the previous data by checksum, last one wins
+    const uint64_t nBlocks = prevSize / _blockSize;
+    uint64_t tableSize = 1;
+    while( tableSize < nBlocks * 2 )
+        tableSize <<= 1;
+    const uint64_t mask = tableSize - 1;
+    std::vector< uint64_t > table( tableSize, _noBlock );
+
+    Checksum checksum;
+    for( uint64_t i = 0; i < nBlocks; ++i )
+    {
+        checksum.init( prev + i * _blockSize );
+        table[ checksum.get() & mask ] = i;
+    }
+
+    uint64_t pos = 0;
+    uint64_t literal = 0;
+    bool valid = false;
+    while( pos + _blockSize <= curSize )
+    {
+        // unchanged data at the same offset is the common case
+        uint64_t match = _noBlock;
+        if( pos + _blockSize <= prevSize &&
+            ::memcmp( cur + pos, prev + pos, _blockSize ) == 0 )
+        {
+            match = pos;
+        }
+        else if( nBlocks > 0 )
+        {
+            if( !valid )
+            {
+                checksum.init( cur + pos );
+                valid = true;
+            }
+            const uint64_t block = table[ checksum.get() & mask ];
+            if( block != _noBlock &&
+                ::memcmp( cur + pos, prev + block * _blockSize,
+                          _blockSize ) == 0 )
+            {
+                match = block * _blockSize;
+            }
+        }
+
+        if( match == _noBlock )
+        {
+            if( valid && pos + _blockSize < curSize )
+                checksum.roll( cur[ pos ], cur[ pos + _blockSize ] );
+            else
+                valid = false;
+            ++pos;
+            continue;
+        }
+
+        // extend the match blockwise, then bytewise
+        uint64_t size = _blockSize;
+        while( pos + size + _blockSize <= curSize &&
+               match + size + _blockSize <= prevSize &&
+               ::memcmp( cur + pos + size, prev + match + size,
+                         _blockSize ) == 0 )
+        {
+            size += _blockSize;
+        }
+        while( pos + size < curSize && match + size < prevSize &&
+               cur[ pos + size ] == prev[ match + size ] )
+        {
+            ++size;
+        }
+
+        _addLiteral( ops, literal, pos );
+        _addCopy( ops, match, size );
+        pos += size;
+        literal = pos;
+        valid = false;
+    }
+    _addLiteral( ops, literal, curSize );
+
+    uint64_t size = 3 * sizeof( uint64_t );
+    for( Ops::const_iterator i = ops.begin(); i != ops.end(); ++i )
+        size += i->copy ? _opSize : _literalOpSize + i->size;
+    return size;
+}
+
+void write( DataOStream& os, const Ops& ops, const lunchbox::Bufferb& previous,
+            const lunchbox::Bufferb& current )
+{
+    os << _hash( previous ) << current.getSize() << uint64_t( ops.size( ));
+    for( Ops::const_iterator i = ops.begin(); i != ops.end(); ++i )
+    {
+        const Op& op = *i;
+        os << uint8_t( op.copy );
+        if( op.copy )
+            os << op.offset << op.size;
+        else
+            os << op.size << Array< const uint8_t >( current.getData() +
+                                                     op.offset, op.size );
+    }
+}
+
+bool apply( DataIStream& is, const lunchbox::Bufferb& previous,
+            lunchbox::Bufferb& result )
+{
+    uint64_t base = 0;
+    uint64_t size = 0;
+    uint64_t nOps = 0;
+    is >> base >> size >> nOps;
+    if( base != _hash( previous ))
+    {
+        LBWARN << "Binary diff is based on different previous data"
+               << std::endl;
+        return false;
+    }
+    result.reset( size );
+
+    uint64_t pos = 0;
+    for( uint64_t i = 0; i < nOps; ++i )
+    {
+        uint8_t copy = 0;
+        is >> copy;
+        if( copy )
+        {
+            uint64_t offset = 0;
+            uint64_t nBytes = 0;
+            is >> offset >> nBytes;
+            if( offset + nBytes > previous.getSize() || pos + nBytes > size )
+            {
+                LBWARN << "Binary diff does not match previous data"
+                       << std::endl;
+                return false;
+            }
+            ::memcpy( result.getData() + pos, previous.getData() + offset,
+                      nBytes );
+            pos += nBytes;
+        }
+        else
+        {
+            uint64_t nBytes = 0;
+            is >> nBytes;
+            if( pos + nBytes > size )
+            {
+                LBWARN << "Binary diff exceeds its data size" << std::endl;
+                return false;
+            }
+            is >> Array< uint8_t >( result.getData() + pos, nBytes );
+            pos += nBytes;
+        }
+    }
+
+    if( pos != size )
+    {
+        LBWARN << "Binary diff is incomplete, got " << pos << " of " << size
+               << " bytes" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+}
+}
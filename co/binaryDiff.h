@@ -0,0 +1,78 @@
+
+/* Copyright (c) 2013, Stefan Eilemann <eile@equalizergraphics.com>
+ *
+ * This file is part of Collage <https://github.com/Eyescale/Collage>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 2.1 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef CO_BINARYDIFF_H
+#define CO_BINARYDIFF_H
+
+#include <co/api.h>
+#include <co/types.h>
+
+#include <lunchbox/buffer.h> // used inline
+
+namespace co
+{
+    /**
+     * @internal
+     * Binary differences between two versions of serialized instance data.
+     *
+     * A diff is a list of operations rebuilding the new data, either by
+     * copying a range of the previous data or by inserting literal bytes.
+     * Equal ranges are found using a rolling checksum over fixed-size blocks
+     * of the previous data, which also detects moved data. A diff carries a
+     * checksum of the previous data it is based on, and can only be applied
+     * to the same data.
+     */
+    namespace binaryDiff
+    {
+        /** One operation of a diff. */
+        struct Op
+        {
+            Op( const bool copy_, const uint64_t offset_, const uint64_t size_ )
+                    : copy( copy_ ), offset( offset_ ), size( size_ ) {}
+
+            bool copy;       //!< copy from previous data, or literal data
+            uint64_t offset; //!< offset in the previous or new data
+            uint64_t size;   //!< the number of bytes
+        };
+        typedef std::vector< Op > Ops;
+
+        /**
+         * Compute the operations creating the current from the previous data.
+         *
+         * @return the number of bytes written by write() for the operations.
+         */
+        CO_API uint64_t compute( const lunchbox::Bufferb& previous,
+                                 const lunchbox::Bufferb& current, Ops& ops );
+
+        /** Serialize the operations, including the literal data. */
+        CO_API void write( DataOStream& os, const Ops& ops,
+                           const lunchbox::Bufferb& previous,
+                           const lunchbox::Bufferb& current );
+
+        /**
+         * Read a diff and apply it to the previous data.
+         *
+         * @return false if the diff is not based on the previous data.
+         */
+        CO_API bool apply( DataIStream& is, const lunchbox::Bufferb& previous,
+                           lunchbox::Bufferb& result );
+    }
+}
+
+#endif // CO_BINARYDIFF_H
@@ -0,0 +1,151 @@
+
+/* Copyright (c) 2013, Stefan Eilemann <eile@equalizergraphics.com>
+ *
+ * This file is part of Collage <https://github.com/Eyescale/Collage>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 2.1 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "blockStore.h"
+
+#include <lunchbox/debug.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace co
+{
+namespace
+{
+/** The block size, small enough to isolate typical local changes. */
+static const uint64_t _blockSize = 4096;
+
+/** FNV-1a over 64 bit words, collisions are resolved by comparing data. */
+uint64_t _hash( const uint8_t* data, const uint64_t size )
+{
+    const uint64_t prime = 1099511628211ull;
+    uint64_t hash = 14695981039346656037ull;
+    const uint64_t nWords = size / sizeof( uint64_t );
+
+    for( uint64_t i = 0; i < nWords; ++i )
+    {
+        uint64_t word;
+        ::memcpy( &word, data + i * sizeof( uint64_t ), sizeof( uint64_t ));
+        hash = ( hash ^ word ) * prime;
+    }
+    for( uint64_t i = nWords * sizeof( uint64_t ); i < size; ++i )
+        hash = ( hash ^ data[ i ] ) * prime;
+    return hash;
+}
+}
+
+struct BlockStore::Block
+{
+    Block( const uint64_t hash_, const uint8_t* data_, const uint64_t size )
+        : hash( hash_ ), nRefs( 0 )
+    {
+        data.replace( data_, size );
+    }
+
+    const uint64_t hash;
+    lunchbox::Bufferb data;
+    uint32_t nRefs;
+};
+
+BlockStore::BlockStore()
+        : _size( 0 )
+{}
+
+BlockStore::~BlockStore()
+{
+    LBASSERTINFO( _blocks.empty(), _blocks.size() << " blocks referenced" );
+    for( BlockHash::const_iterator i = _blocks.begin(); i != _blocks.end(); ++i)
+    {
+        const Blocks& blocks = i->second;
+        for( Blocks::const_iterator j = blocks.begin(); j != blocks.end(); ++j )
+            delete *j;
+    }
+}
+
+void BlockStore::add( const uint8_t* data, const uint64_t size,
+                      Blocks& blocks )
+{
+    LBASSERT( blocks.empty( ));
+    blocks.reserve( ( size + _blockSize - 1 ) / _blockSize );
+
+    for( uint64_t offset = 0; offset < size; offset += _blockSize )
+    {
+        const uint8_t* ptr = data + offset;
+        const uint64_t blockSize = LB_MIN( _blockSize, size - offset );
+        const uint64_t hash = _hash( ptr, blockSize );
+        Blocks& candidates = _blocks[ hash ];
+
+        Block* block = 0;
+        for( Blocks::const_iterator i = candidates.begin();
+             i != candidates.end(); ++i )
+        {
+            Block* candidate = *i;
+            if( candidate->data.getSize() == blockSize &&
+                ::memcmp( candidate->data.getData(), ptr, blockSize ) == 0 )
+            {
+                block = candidate;
+                break;
+            }
+        }
+
+        if( !block )
+        {
+            block = new Block( hash, ptr, blockSize );
+            candidates.push_back( block );
+            _size += blockSize;
+        }
+
+        ++block->nRefs;
+        blocks.push_back( block );
+    }
+}
+
+void BlockStore::release( Blocks& blocks )
+{
+    for( Blocks::const_iterator i = blocks.begin(); i != blocks.end(); ++i )
+    {
+        Block* block = *i;
+        LBASSERT( block->nRefs > 0 );
+        if( --block->nRefs > 0 )
+            continue;
+
+        BlockHash::iterator j = _blocks.find( block->hash );
+        LBASSERT( j != _blocks.end( ));
+        Blocks& candidates = j->second;
+        candidates.erase( std::find( candidates.begin(), candidates.end(),
+                                     block ));
+        if( candidates.empty( ))
+            _blocks.erase( j );
+
+        _size -= block->data.getSize();
+        delete block;
+    }
+    blocks.clear();
+}
+
+void BlockStore::copy( const Blocks& blocks, lunchbox::Bufferb& buffer )
+{
+    for( Blocks::const_iterator i = blocks.begin(); i != blocks.end(); ++i )
+    {
+        const Block* block = *i;
+        buffer.append( block->data.getData(), block->data.getSize( ));
+    }
+}
+
+}
@@ -0,0 +1,73 @@
+
+/* Copyright (c) 2013, Stefan Eilemann <eile@equalizergraphics.com>
+ *
+ * This file is part of Collage <https://github.com/Eyescale/Collage>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 2.1 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef CO_BLOCKSTORE_H
+#define CO_BLOCKSTORE_H
+
+#include <co/types.h>
+
+#include <lunchbox/buffer.h>      // used inline
+#include <lunchbox/nonCopyable.h> // base class
+#include <lunchbox/stdExt.h>      // member
+
+namespace co
+{
+    /**
+     * @internal
+     * A reference-counted store of data blocks, sharing identical blocks.
+     *
+     * Data is split into fixed-size blocks, which are identified by a hash of
+     * their content. Buffered change managers use it to retain old versions
+     * with a memory footprint proportional to the data changed between them.
+     * Blocks start at fixed offsets, so data inserted or removed in the middle
+     * of a version shifts all following blocks, which are then not shared.
+     * Not thread safe.
+     */
+    class BlockStore : public lunchbox::NonCopyable
+    {
+    public:
+        struct Block;
+        typedef std::vector< Block* > Blocks;
+
+        BlockStore();
+        ~BlockStore();
+
+        /** Split data into blocks, referencing equal blocks already stored. */
+        void add( const uint8_t* data, const uint64_t size, Blocks& blocks );
+
+        /** Unreference and clear the given blocks. */
+        void release( Blocks& blocks );
+
+        /** Append the data of the given blocks to the buffer. */
+        static void copy( const Blocks& blocks, lunchbox::Bufferb& buffer );
+
+        /** @return the number of bytes held by all stored blocks. */
+        uint64_t getSize() const { return _size; }
+
+    private:
+        typedef stde::hash_map< uint64_t, Blocks > BlockHash;
+
+        /** All stored blocks, by content hash. */
+        BlockHash _blocks;
+
+        uint64_t _size;
+    };
+}
+
+#endif // CO_BLOCKSTORE_H
@@ -36,6 +36,7 @@ public:
 BufferConnection::BufferConnection()
         : _impl( new detail::BufferConnection )
 {
+    _setBuffered();
     _setState( STATE_CONNECTED );
     LBVERB << "New BufferConnection @" << (void*)this << std::endl;
 }
@@ -76,6 +76,8 @@
 #include <co/dataIStream.h>
 #include <co/dataOStreamArchive.h>
 #include <co/dataOStream.h>
+#include <co/dirtyBitSet.h>
+#include <co/dirtyVector.h>
 #include <co/global.h>
 #include <co/iCommand.h>
 #include <co/init.h>
@@ -87,6 +89,8 @@
 #include <co/oCommand.h>
 #include <co/sendToken.h>
 #include <co/serializable.h>
+#include <co/statistics.h>
+#include <co/trace.h>
 #include <co/zeroconf.h>
 #include <lunchbox/lunchbox.h>
 
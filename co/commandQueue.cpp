@@ -22,6 +22,8 @@
 #include "iCommand.h"
 #include "exception.h"
 #include "node.h"
+#include "statistics.h"
+#include "trace.h"
 
 #include <lunchbox/mtQueue.h>
 
@@ -39,6 +41,16 @@ public:
 };
 }
 
+namespace
+{
+void _traceQueueWait( const ICommand& command )
+{
+    const int64_t queued = command.getQueueTime();
+    if( queued != 0 && Trace::isEnabled( ))
+        Trace::add( Trace::QUEUE_WAIT, queued, Trace::getTime( ));
+}
+}
+
 CommandQueue::CommandQueue( const size_t maxSize )
     : _impl( new detail::CommandQueue( maxSize ))
 {
@@ -70,13 +82,29 @@ size_t CommandQueue::getSize() const
 
 void CommandQueue::push( const ICommand& command )
 {
-    _impl->commands.push( command );
+    if( Trace::isEnabled( ))
+    {
+        ICommand queued( command );
+        queued.setQueueTime( Trace::getTime( ));
+        _impl->commands.push( queued );
+    }
+    else
+        _impl->commands.push( command );
+    Statistics::getHistogram( Statistics::QUEUE_DEPTH ).add( getSize( ));
 }
 
 void CommandQueue::pushFront( const ICommand& command )
 {
     LBASSERT( command.isValid( ));
-    _impl->commands.pushFront( command );
+    if( Trace::isEnabled( ))
+    {
+        ICommand queued( command );
+        queued.setQueueTime( Trace::getTime( ));
+        _impl->commands.pushFront( queued );
+    }
+    else
+        _impl->commands.pushFront( command );
+    Statistics::getHistogram( Statistics::QUEUE_DEPTH ).add( getSize( ));
 }
 
 ICommand CommandQueue::pop( const uint32_t timeout )
@@ -87,6 +115,7 @@ ICommand CommandQueue::pop( const uint32_t timeout )
     if( !_impl->commands.timedPop( timeout, command ))
         throw Exception( Exception::TIMEOUT_COMMANDQUEUE );
 
+    _traceQueueWait( command );
     return command;
 }
 
@@ -96,6 +125,9 @@ ICommands CommandQueue::popAll( const uint32_t timeout )
 
     if( result.empty( ))
         throw Exception( Exception::TIMEOUT_COMMANDQUEUE );
+
+    for( ICommandsCIter i = result.begin(); i != result.end(); ++i )
+        _traceQueueWait( *i );
     return result;
 }
 
@@ -103,7 +135,8 @@ ICommand CommandQueue::tryPop()
 {
     LB_TS_THREAD( _thread );
     ICommand command;
-    _impl->commands.tryPop( command );
+    if( _impl->commands.tryPop( command ))
+        _traceQueueWait( command );
     return command;
 }
 
@@ -61,7 +61,7 @@ if(APPLE)
 endif(APPLE)
 
 if(CMAKE_SYSTEM_NAME MATCHES "Linux")
-  list(APPEND COLLAGE_DEFINES Linux)
+  list(APPEND COLLAGE_DEFINES Linux CO_USE_SHM)
   set(ARCH Linux)
 endif(CMAKE_SYSTEM_NAME MATCHES "Linux")
 
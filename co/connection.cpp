@@ -23,10 +23,12 @@
 #include "buffer.h"
 #include "connectionDescription.h"
 #include "connectionListener.h"
+#include "global.h"
 #include "log.h"
 #include "pipeConnection.h"
 #include "socketConnection.h"
 #include "rspConnection.h"
+#include "statistics.h"
 
 #include <lunchbox/types.h>
 
@@ -45,38 +47,163 @@
 #ifdef CO_USE_UDT
 #  include "udtConnection.h"
 #endif
+#ifdef CO_USE_SHM
+#  include "shmConnection.h"
+#endif
 
+#include <lunchbox/atomic.h>
+#include <lunchbox/clock.h>
+#include <lunchbox/monitor.h>
+#include <lunchbox/mtQueue.h>
 #include <lunchbox/scopedMutex.h>
+#include <lunchbox/sleep.h>
 #include <lunchbox/stdExt.h>
+#include <lunchbox/thread.h>
 
-//#define STATISTICS
-#ifdef STATISTICS
-typedef std::map< uint64_t, size_t > Histogram;
-typedef Histogram::const_iterator HistogramCIter;
-lunchbox::Lockable< Histogram, lunchbox::SpinLock > _histogram;
-
-#  define ADD_STATISTIC( x )                            \
-    {                                                   \
-        lunchbox::ScopedFastWrite mutex( _histogram );  \
-        ++(*_histogram)[ x ];                           \
-    }
-#  define DUMP_STATISTIC                                                \
-    {                                                                   \
-        lunchbox::ScopedFastRead mutex( _histogram );                   \
-        LBINFO << lunchbox::disableFlush << lunchbox::disableHeader;    \
-        for( HistogramCIter i=_histogram->begin(); i!=_histogram->end(); ++i) \
-            LBINFO << i->first << ", " << i->second << std::endl;       \
-        LBINFO << lunchbox::enableHeader << lunchbox::enableFlush <<std::endl; \
-    }
-#else
-#  define ADD_STATISTIC( x )
-#  define DUMP_STATISTIC
+#include <cstring>
+#include <limits>
+#ifndef _WIN32
+#  include <unistd.h>
 #endif
 
+
 namespace co
 {
 namespace detail
 {
+/**
+ * Delivers the sends of one connection after the emulated link delay, see
+ * Global::IATTR_LINK_LATENCY_US.
+ *
+ * Data is serialized onto the link at its bandwidth and arrives one latency
+ * later, so consecutive sends pipeline. Stream connections can't drop data,
+ * instead evenly spread sends pay a retransmission timeout, delaying all data
+ * after them. Senders block once more than the bandwidth-delay product is
+ * queued, like on a full socket buffer. As for a real socket, this happens
+ * with the send lock held, which serializes the other senders behind it.
+ */
+class LinkEmulator : public lunchbox::Thread
+{
+public:
+    explicit LinkEmulator( co::Connection& connection )
+        : _connection( connection )
+        , _pushed( 0 )
+        , _written( 0 )
+        , _departure( 0. )
+        , _due( 0. )
+        , _nSends( 0 )
+        , _closed( 0 )
+    {}
+
+    ~LinkEmulator()
+    {
+        Packet* packet = 0;
+        while( _packets.tryPop( packet ))
+            delete packet;
+    }
+
+    bool isClosed() const { return _closed != 0; }
+
+    /**
+     * Queue data for delayed delivery, called with the send lock set.
+     * Blocks while the link window is full, until the data ahead is delivered
+     * or the emulator is closed.
+     */
+    bool push( const void* buffer, const uint64_t bytes,
+               const int32_t latency, const int32_t bandwidth,
+               const int32_t loss )
+    {
+        if( bandwidth > 0 )
+        {
+            const uint64_t window = LB_64KB + uint64_t( bandwidth ) * 1024u *
+                                    uint64_t( LB_MAX( latency, 0 )) / 1000000u;
+            if( _pushed > window )
+                _written.waitGE( _pushed - window );
+        }
+        if( isClosed( ))
+            return false;
+
+        const double now = _clock.getTimed();
+        _departure = LB_MAX( _departure, now );
+        if( bandwidth > 0 ) // ms to put the data on the link
+            _departure += double( bytes ) / ( double( bandwidth ) * 1.024 );
+
+        double due = _departure + double( LB_MAX( latency, 0 )) / 1000.;
+        if( loss > 0 && ( ++_nSends * loss ) % 100 < uint64_t( loss ))
+            due += 200.; // minimum TCP retransmission timeout
+        _due = LB_MAX( _due, due ); // stream data is delivered in order
+
+        Packet* packet = new Packet;
+        packet->data.append( static_cast< const uint8_t* >( buffer ), bytes );
+        packet->due = _due;
+        _pushed += bytes;
+        _packets.push( packet );
+        return true;
+    }
+
+    /** Drop all queued data and stop, called when the connection closes. */
+    void close()
+    {
+        if( ++_closed == 1 ) // closed by the app, receiver or emulator thread
+        {
+            _written = std::numeric_limits< uint64_t >::max(); // unblock push
+            _packets.push( 0 );
+        }
+        if( !isCurrent( ))
+            join();
+    }
+
+protected:
+    virtual void run()
+    {
+        while( true )
+        {
+            Packet* packet = _packets.pop();
+            if( !packet )
+            {
+                _written = std::numeric_limits< uint64_t >::max();
+                return;
+            }
+
+            const double wait = packet->due - _clock.getTimed();
+            if( !isClosed() && wait > 0. )
+            {
+#ifdef _WIN32
+                lunchbox::sleep( uint32_t( wait ));
+#else
+                ::usleep( useconds_t( wait * 1000. ));
+#endif
+            }
+
+            const uint64_t size = packet->data.getSize();
+            if( !isClosed() &&
+                _connection._write( packet->data.getData(), size, false ))
+            {
+                _written = _written.get() + size;
+            }
+            delete packet;
+        }
+    }
+
+private:
+    struct Packet
+    {
+        lunchbox::Bufferb data;
+        double due; //!< delivery time in ms of _clock
+    };
+
+    co::Connection& _connection;
+    lunchbox::MTQueue< Packet* > _packets;
+    const lunchbox::Clock _clock;
+
+    uint64_t _pushed; //!< bytes queued in total
+    lunchbox::Monitor< uint64_t > _written; //!< bytes delivered in total
+    double _departure; //!< time when the link is free for the next send
+    double _due; //!< delivery time of the last send
+    uint64_t _nSends;
+    lunchbox::a_int32_t _closed; //!< number of close() calls
+};
+
 class Connection
 {
 public:
@@ -89,8 +216,15 @@ public:
     BufferPtr buffer; //!< Current async read buffer
     uint64_t bytes; //!< Current read request size
 
+    lunchbox::Bufferb readAhead; //!< Data received beyond the current request
+    uint64_t readAheadPos; //!< Consumed bytes in readAhead
+
     lunchbox::a_int32_t _currentlyRead;
 
+    ConnectionStatistics statistics; //!< Traffic counters
+    LinkEmulator* emulator; //!< Delays sends on emulated links, created lazily
+    bool buffered; //!< A BufferConnection, sent later on a real connection
+
     /** The listeners on state changes */
     ConnectionListeners listeners;
 
@@ -98,13 +232,18 @@ public:
             : state( co::Connection::STATE_CLOSED )
             , description( new ConnectionDescription )
             , bytes( 0 )
+            , readAheadPos( 0 )
             , _currentlyRead( 0 )
+            , emulator( 0 )
+            , buffered( false )
     {
         description->type = CONNECTIONTYPE_NONE;
     }
 
     ~Connection()
     {
+        closeEmulator();
+        delete emulator;
         LBASSERT( state == co::Connection::STATE_CLOSED );
         state = co::Connection::STATE_CLOSED;
         description = 0;
@@ -113,6 +252,12 @@ public:
                       "Pending read operation during connection destruction" );
     }
 
+    void closeEmulator()
+    {
+        if( emulator )
+            emulator->close();
+    }
+
     void fireStateChanged( co::Connection* connection )
     {
         for( ConnectionListeners::const_iterator i= listeners.begin();
@@ -134,7 +279,6 @@ Connection::~Connection()
 {
     delete _impl;
     LBVERB << "Delete Connection @" << (void*)this << std::endl;
-    DUMP_STATISTIC;
 }
 
 bool Connection::operator == ( const Connection& rhs ) const
@@ -186,6 +330,11 @@ ConnectionPtr Connection::create( ConnectionDescriptionPtr description )
             connection = new UDTConnection;
             break;
 #endif
+#ifdef CO_USE_SHM
+        case CONNECTIONTYPE_SHM:
+            connection = new ShmConnection;
+            break;
+#endif
 
         default:
             LBWARN << "Connection type " << description->type
@@ -218,6 +367,8 @@ void Connection::_setState( const State state )
 {
     if( _impl->state == state )
         return;
+    if( state == STATE_CLOSING || state == STATE_CLOSED )
+        _impl->closeEmulator();
     _impl->state = state;
     _impl->fireStateChanged( this );
 }
@@ -279,6 +430,16 @@ bool Connection::recvSync( BufferPtr& outBuffer, const bool block )
     LBASSERTINFO( bytes < LB_BIT48,
                   "Out-of-sync network stream: read size " << bytes << "?" );
 
+    if( _impl->readAhead.getMaxSize() > 0 )
+    {
+        if( _recvBuffered( outBuffer, bytes, block ))
+            return true;
+        if( !_impl->buffer )
+            return false;
+        outBuffer = 0; // fluke notification, AIO operation was restored
+        return true;
+    }
+
     // 'Iterators' for receive loop
     uint8_t* ptr = outBuffer->getData() + outBuffer->getSize();
     uint64_t bytesLeft = bytes;
@@ -361,24 +522,123 @@ bool Connection::recvSync( BufferPtr& outBuffer, const bool block )
     return true;
 }
 
+bool Connection::_recvBuffered( BufferPtr buffer, const uint64_t bytes,
+                               const bool block )
+{
+    lunchbox::Bufferb& readAhead = _impl->readAhead;
+    uint8_t* ptr = buffer->getData() + buffer->getSize();
+    uint64_t bytesLeft = bytes;
+
+    while( true )
+    {
+        const uint64_t available = readAhead.getSize() - _impl->readAheadPos;
+        const uint64_t copied = LB_MIN( available, bytesLeft );
+        if( copied > 0 )
+        {
+            ::memcpy( ptr, readAhead.getData() + _impl->readAheadPos, copied );
+            _impl->readAheadPos += copied;
+            ptr += copied;
+            bytesLeft -= copied;
+        }
+        if( bytesLeft == 0 )
+        {
+            buffer->resize( buffer->getSize() + bytes );
+            return true;
+        }
+
+        // read-ahead buffer is empty: large requests bypass it
+        readAhead.setSize( 0 );
+        _impl->readAheadPos = 0;
+        const bool direct = bytesLeft >= readAhead.getMaxSize();
+        uint8_t* target = direct ? ptr : readAhead.getData();
+        const uint64_t size = direct ? bytesLeft : readAhead.getMaxSize();
+
+        readNB( target, size );
+        const int64_t got = readSync( target, size, block );
+
+        if( got == READ_TIMEOUT && bytesLeft == bytes )
+        {
+            // fluke notification, see recvSync(): restore the AIO operation
+            _impl->buffer = buffer;
+            _impl->bytes = bytes;
+            return false;
+        }
+        if( got < 0 )
+        {
+            const uint64_t read = bytes - bytesLeft;
+            buffer->resize( buffer->getSize() + read );
+            if( read == 0 )
+                LBINFO << "Read on dead connection" << std::endl;
+            else
+                LBERROR << "Error during read after " << read << " bytes on "
+                        << _impl->description << std::endl;
+            return false;
+        }
+        if( got == 0 )
+        {
+            // ConnectionSet::select may report data on an 'empty' connection
+            if( bytesLeft == bytes )
+                return false;
+            LBVERB << "Zero bytes read" << std::endl;
+            continue;
+        }
+
+        if( direct )
+        {
+            ptr += got;
+            bytesLeft -= got;
+        }
+        else
+            readAhead.setSize( got );
+    }
+}
+
 BufferPtr Connection::resetRecvData()
 {
     BufferPtr buffer = _impl->buffer;
     _impl->buffer = 0;
     _impl->bytes = 0;
+    _impl->readAhead.setSize( 0 );
+    _impl->readAheadPos = 0;
     return buffer;
 }
 
+void Connection::setReadAheadSize( const uint64_t bytes )
+{
+    LBASSERT( !hasBufferedData( ));
+    _impl->readAhead.clear();
+    _impl->readAheadPos = 0;
+    if( bytes > 0 )
+        _impl->readAhead.reserve( bytes );
+}
+
+bool Connection::hasBufferedData() const
+{
+    return _impl->readAhead.getSize() > _impl->readAheadPos;
+}
+
 //----------------------------------------------------------------------
 // write
 //----------------------------------------------------------------------
 bool Connection::send( const void* buffer, const uint64_t bytes,
                        const bool isLocked )
 {
-    ADD_STATISTIC( bytes );
+    return _send( buffer, bytes, isLocked, false );
+}
+
+bool Connection::sendZeroCopy( const void* buffer, const uint64_t bytes,
+                               const bool isLocked )
+{
+    return _send( buffer, bytes, isLocked, true );
+}
+
+bool Connection::_send( const void* buffer, const uint64_t bytes,
+                        const bool isLocked, const bool zeroCopy )
+{
     LBASSERT( bytes > 0 );
     if( bytes == 0 )
         return true;
+    _addSendStatistics( bytes );
 
     const uint8_t* ptr = static_cast< const uint8_t* >( buffer );
 
@@ -408,12 +668,23 @@ bool Connection::send( const void* buffer, const uint64_t bytes,
     }
 #endif
 
+    if( _isEmulated( ))
+        return _emulateLink( ptr, bytes );
+    return _write( ptr, bytes, zeroCopy );
+}
+
+bool Connection::_write( const void* buffer, const uint64_t bytes,
+                         const bool zeroCopy )
+{
+    const uint8_t* ptr = static_cast< const uint8_t* >( buffer );
     uint64_t bytesLeft = bytes;
     while( bytesLeft )
     {
         try
         {
-            const int64_t wrote = this->write( ptr, bytesLeft );
+            const int64_t wrote = zeroCopy ?
+                                      writeZeroCopy( ptr, bytesLeft ) :
+                                      this->write( ptr, bytesLeft );
             if( wrote == -1 ) // error
             {
                 LBERROR << "Error during write after " << bytes - bytesLeft
@@ -439,6 +710,140 @@ bool Connection::send( const void* buffer, const uint64_t bytes,
     return true;
 }
 
+#ifndef _WIN32
+bool Connection::sendFile( const int fd, const uint64_t offset,
+                           const uint64_t bytes, const bool isLocked )
+{
+    LBASSERT( bytes > 0 );
+    if( bytes == 0 )
+        return true;
+    _addSendStatistics( bytes );
+
+    lunchbox::ScopedMutex<> mutex( isLocked ? 0 : &_impl->sendLock );
+    if( _isEmulated( ))
+    {
+        lunchbox::Bufferb data;
+        data.resize( bytes );
+        for( uint64_t pos = 0; pos < bytes; )
+        {
+            const ssize_t nRead = ::pread( fd, data.getData() + pos,
+                                           bytes - pos, off_t( offset + pos ));
+            if( nRead <= 0 )
+            {
+                LBWARN << "Can't read file data at " << offset + pos << ": "
+                       << lunchbox::sysError << std::endl;
+                return false;
+            }
+            pos += nRead;
+        }
+        return _emulateLink( data.getData(), bytes );
+    }
+
+    uint64_t bytesLeft = bytes;
+    while( bytesLeft )
+    {
+        try
+        {
+            const int64_t wrote = writeFile( fd, offset + bytes - bytesLeft,
+                                             bytesLeft );
+            if( wrote == -1 ) // error
+            {
+                LBERROR << "Error during file write after "
+                        << bytes - bytesLeft << " bytes, closing connection"
+                        << std::endl;
+                close();
+                return false;
+            }
+            bytesLeft -= wrote;
+        }
+        catch( const co::Exception& e )
+        {
+            LBERROR << e.what() << " after " << bytes - bytesLeft
+                    << " bytes, closing connection" << std::endl;
+            close();
+            return false;
+        }
+    }
+    return true;
+}
+
+int64_t Connection::writeFile( const int fd, const uint64_t offset,
+                               const uint64_t bytes )
+{
+    uint8_t buffer[ 65536 ];
+    const ssize_t nRead = ::pread( fd, buffer, LB_MIN( bytes, sizeof( buffer )),
+                                   off_t( offset ));
+    if( nRead <= 0 )
+    {
+        LBWARN << "Can't read file data at " << offset << ": "
+               << lunchbox::sysError << std::endl;
+        return -1;
+    }
+    return write( buffer, nRead );
+}
+#endif
+
+void Connection::_addSendStatistics( const uint64_t bytes )
+{
+    _impl->statistics.bytesSent.add( int64_t( bytes ));
+
+    // counted when the buffered data is sent to the real connection
+    if( _impl->buffered )
+        return;
+    Statistics::getCounter( Statistics::BYTES_SENT ).add( int64_t( bytes ));
+    Statistics::getHistogram( Statistics::SEND_SIZE ).add( bytes );
+}
+
+bool Connection::_isEmulated() const
+{
+    if( Global::getIAttribute( Global::IATTR_LINK_LATENCY_US ) <= 0 &&
+        Global::getIAttribute( Global::IATTR_LINK_BANDWIDTH_KBS ) <= 0 &&
+        Global::getIAttribute( Global::IATTR_LINK_LOSS_PERCENT ) <= 0 )
+    {
+        return false;
+    }
+
+    // process-internal, or staging for another connection
+    return _impl->description->type != CONNECTIONTYPE_PIPE &&
+           !_impl->buffered;
+}
+
+void Connection::_setBuffered()
+{
+    _impl->buffered = true;
+}
+
+bool Connection::_emulateLink( const void* buffer, const uint64_t bytes )
+{
+    if( _impl->emulator && _impl->emulator->isClosed( ))
+    {
+        _impl->emulator->close();
+        delete _impl->emulator;
+        _impl->emulator = 0;
+    }
+    if( !_impl->emulator )
+    {
+        if( !isConnected( ))
+            return false;
+        _impl->emulator = new detail::LinkEmulator( *this );
+        if( !_impl->emulator->start( ))
+        {
+            LBWARN << "Can't start link emulation" << std::endl;
+            delete _impl->emulator;
+            _impl->emulator = 0;
+            return _write( buffer, bytes, false );
+        }
+    }
+
+    const int32_t latency =
+        Global::getIAttribute( Global::IATTR_LINK_LATENCY_US );
+    const int32_t bandwidth =
+        Global::getIAttribute( Global::IATTR_LINK_BANDWIDTH_KBS );
+    const int32_t loss =
+        Global::getIAttribute( Global::IATTR_LINK_LOSS_PERCENT );
+    return _impl->emulator->push( buffer, bytes, latency, bandwidth, loss );
+}
+
 bool Connection::isMulticast() const
 {
     return getDescription()->type >= CONNECTIONTYPE_MULTICAST;
@@ -449,6 +854,16 @@ ConstConnectionDescriptionPtr Connection::getDescription() const
     return _impl->description;
 }
 
+const ConnectionStatistics& Connection::getStatistics() const
+{
+    return _impl->statistics;
+}
+
+ConnectionStatistics& Connection::getStatistics()
+{
+    return _impl->statistics;
+}
+
 ConnectionDescriptionPtr Connection::_getDescription()
 {
     return _impl->description;
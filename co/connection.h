@@ -38,7 +38,7 @@
 
 namespace co
 {
-namespace detail { class Connection; }
+namespace detail { class Connection; class LinkEmulator; }
 
     /**
      * An interface definition for communication between hosts.
@@ -104,6 +104,12 @@ namespace detail { class Connection; }
         /** @return the description for this connection. @version 1.0 */
         CO_API ConstConnectionDescriptionPtr getDescription() const;
 
+        /** @return the traffic counters of this connection. @version 1.0 */
+        CO_API const ConnectionStatistics& getStatistics() const;
+
+        /** @internal @return the traffic counters for updating. */
+        CO_API ConnectionStatistics& getStatistics();
+
         /** @internal */
         bool operator == ( const Connection& rhs ) const;
         //@}
@@ -204,6 +210,19 @@ namespace detail { class Connection; }
         CO_API bool recvSync( BufferPtr& buffer, const bool block = true );
 
         BufferPtr resetRecvData(); //!< @internal
+
+        /**
+         * @internal Buffer incoming data in blocks of the given size.
+         *
+         * recvSync() then reads as much data as available into an internal
+         * buffer with one read operation, and serves subsequent requests from
+         * it. Only applicable to stream connections which may return partial
+         * reads. 0 disables read-ahead.
+         */
+        void setReadAheadSize( const uint64_t bytes );
+
+        /** @internal @return true if read-ahead data is pending. */
+        bool hasBufferedData() const;
         //@}
 
         /** @name Synchronous write to the connection */
@@ -226,6 +245,43 @@ namespace detail { class Connection; }
         CO_API bool send( const void* buffer, const uint64_t bytes,
                           const bool isLocked = false );
 
+        /**
+         * @internal
+         * Send data without copying it, if supported by the connection.
+         *
+         * Connections with zero-copy sends return before large buffers have
+         * been transmitted. The data has to stay unmodified until waitSent()
+         * returned for the getSendMark() taken after this call. Otherwise the
+         * same as send().
+         */
+        CO_API bool sendZeroCopy( const void* buffer, const uint64_t bytes,
+                                  const bool isLocked = false );
+
+        /** @internal @return the position after the last zero-copy send. */
+        virtual uint32_t getSendMark() const { return 0; }
+
+        /** @internal Wait for the zero-copy sends up to the given mark. */
+        virtual void waitSent( const uint32_t ) {}
+
+#ifndef _WIN32
+        /**
+         * @internal
+         * Send a region of a file using the connection.
+         *
+         * Stream connections transmit the data directly from the file, without
+         * copying it through user space. Locking is the same as for send().
+         *
+         * @param fd the file descriptor of the file.
+         * @param offset the start of the region in the file.
+         * @param bytes the number of bytes to send.
+         * @param isLocked true if the connection is locked externally.
+         * @return true if all data has been sent, false if not.
+         */
+        CO_API bool sendFile( const int fd, const uint64_t offset,
+                              const uint64_t bytes,
+                              const bool isLocked = false );
+#endif
+
         /** Lock the connection, no other thread can send data. @version 1.0 */
         CO_API void lockSend() const;
 
@@ -234,6 +290,15 @@ namespace detail { class Connection; }
 
         /** @internal Finish all pending send operations. */
         virtual void finish() {}
+
+        /**
+         * @internal
+         * Consume notifications signaled like errors on the notifier, e.g.,
+         * zero-copy send completions.
+         *
+         * @return true if the error event was only caused by notifications.
+         */
+        virtual bool handleNotifications() { return false; }
         //@}
 
         /**
@@ -310,6 +375,31 @@ namespace detail { class Connection; }
          * @return the number of bytes written, or -1 upon error.
          */
         virtual int64_t write( const void* buffer, const uint64_t bytes ) = 0;
+
+        /**
+         * Write data which stays unmodified until waitSent(), see
+         * sendZeroCopy(). The default implementation uses write().
+         */
+        virtual int64_t writeZeroCopy( const void* buffer,
+                                       const uint64_t bytes )
+            { return write( buffer, bytes ); }
+
+#ifndef _WIN32
+        /**
+         * Write a region of a file to the connection.
+         *
+         * This method is the low-level counterpart used by sendFile(). The
+         * default implementation reads a part of the region and write()s
+         * it. It may return with a partial write.
+         *
+         * @param fd the file descriptor of the file.
+         * @param offset the start of the region in the file.
+         * @param bytes the number of bytes to write.
+         * @return the number of bytes written, or -1 upon error.
+         */
+        virtual int64_t writeFile( const int fd, const uint64_t offset,
+                                   const uint64_t bytes );
+#endif
         //@}
 
         /** @internal @name State Changes */
@@ -325,6 +415,20 @@ namespace detail { class Connection; }
 
     private:
         detail::Connection* const _impl;
+
+        bool _recvBuffered( BufferPtr buffer, const uint64_t bytes,
+                            const bool block );
+        bool _send( const void* buffer, const uint64_t bytes,
+                    const bool isLocked, const bool zeroCopy );
+        bool _write( const void* buffer, const uint64_t bytes,
+                     const bool zeroCopy );
+        void _addSendStatistics( const uint64_t bytes );
+        bool _isEmulated() const;
+        bool _emulateLink( const void* buffer, const uint64_t bytes );
+
+        friend class detail::LinkEmulator;
+        friend class BufferConnection;
+        void _setBuffered(); //!< Stages data for another connection
     };
 
     CO_API std::ostream& operator << ( std::ostream&, const Connection& );
@@ -47,7 +47,7 @@ namespace co
         /** The host name of the interface (multicast). @version 1.0 */
         std::string interfacename;
 
-        /** The filename used for named pipes. @version 1.0 */
+        /** The filename used for named pipes and shared memory. @version 1.0 */
         std::string filename;
 
         /** Construct a new, default description. @version 1.0 */
@@ -82,10 +82,10 @@ namespace co
          * formats are recognized, a human-readable and a machine-readable. The
          * human-readable version has the format
          * <code>hostname[:port][:type]</code> or
-         * <code>filename:PIPE</code>. The <code>type</code> parameter can be
-         * TCPIP, SDP, IB, MCIP, UDT or RSP. The machine-readable format
-         * contains all connection description parameters, is not documented and
-         * subject to change.
+         * <code>filename:PIPE</code> or <code>filename:SHM</code>. The
+         * <code>type</code> parameter can be TCPIP, SDP, IB, MCIP, UDT, RSP or
+         * SHM. The machine-readable format contains all connection description
+         * parameters, is not documented and subject to change.
          *
          * @param data the string containing the connection description.
          * @return true if the information was read correctly, false if not.
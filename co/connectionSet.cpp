@@ -23,8 +23,10 @@
 #include "connection.h"
 #include "connectionListener.h"
 #include "eventConnection.h"
+#include "global.h"
 
 #include <lunchbox/buffer.h>
+#include <lunchbox/clock.h>
 #include <lunchbox/os.h>
 #include <lunchbox/scopedMutex.h>
 #include <lunchbox/stdExt.h>
@@ -44,6 +46,11 @@
 #  define SELECT_ERROR   -1
 #  define MAX_CONNECTIONS LB_100KB  // Arbitrary
 #endif
+#ifdef __linux__
+#  include <sys/epoll.h>
+#  include <unistd.h>
+#  define CO_USE_EPOLL // one-shot readiness, re-armed without interrupt
+#endif
 
 namespace co
 {
@@ -126,6 +133,11 @@ public:
 #endif
     lunchbox::Buffer< Result > fdSetResult;
 
+#ifdef CO_USE_EPOLL
+    int epollFD; //!< one-shot registration of all idle connections
+    epoll_event epollEvent; //!< result of the last epoll_wait
+#endif
+
     /** The connection to reset a running select, see constructor. */
     lunchbox::RefPtr< EventConnection > selfConnection;
 
@@ -149,6 +161,9 @@ public:
 
     ConnectionSet()
            : selfConnection( new EventConnection )
+#ifdef CO_USE_EPOLL
+           , epollFD( -1 )
+#endif
 #ifdef _WIN32
            , thread( 0 )
 #endif
@@ -166,6 +181,10 @@ public:
          connection = 0;
          selfConnection->close();
          selfConnection = 0;
+#ifdef CO_USE_EPOLL
+         if( epollFD >= 0 )
+             ::close( epollFD );
+#endif
      }
 
     void setDirty()
@@ -180,8 +199,64 @@ public:
 
     void interrupt() { selfConnection->set(); }
 
+#ifndef _WIN32
+    /** Wait for an event, busy-waiting first in low-latency mode. */
+    int wait( const int timeout )
+    {
+        const int32_t spinTime =
+            Global::getIAttribute( Global::IATTR_RECV_SPIN_TIME_US );
+        if( spinTime > 0 && timeout != 0 )
+        {
+            lunchbox::Clock clock;
+            const double time = double( spinTime ) / 1000.;
+            do
+            {
+                const int ret = _wait( 0 );
+                if( ret != SELECT_TIMEOUT )
+                    return ret;
+            }
+            while( clock.getTimed() < time );
+        }
+        return _wait( timeout );
+    }
+#endif
+
+#ifdef CO_USE_EPOLL
+    /** Enable the next event on the connection. Caller holds the lock. */
+    void arm( co::Connection* conn )
+    {
+        LBASSERT( epollFD >= 0 );
+        epoll_event event;
+        event.events = EPOLLIN | EPOLLONESHOT;
+        event.data.ptr = conn;
+
+        const int fd = conn->getNotifier();
+        if( ::epoll_ctl( epollFD, EPOLL_CTL_MOD, fd, &event ) == 0 )
+            return;
+        if( errno == ENOENT &&
+            ::epoll_ctl( epollFD, EPOLL_CTL_ADD, fd, &event ) == 0 )
+        {
+            return;
+        }
+        LBWARN << "Can't enable connection " << conn << " for select: "
+               << lunchbox::sysError << std::endl;
+        setDirty();
+    }
+#endif
+
 private:
     virtual void notifyStateChanged( co::Connection* ) { setDirty(); }
+
+#ifndef _WIN32
+    int _wait( const int timeout )
+    {
+#  ifdef CO_USE_EPOLL
+        return epoll_wait( epollFD, &epollEvent, 1, timeout );
+#  else
+        return poll( fdSet.getData(), fdSet.getSize(), timeout );
+#  endif
+    }
+#endif
 };
 }
 
@@ -234,6 +309,23 @@ void ConnectionSet::interrupt()
     _impl->interrupt();
 }
 
+void ConnectionSet::rearm( ConnectionPtr connection )
+{
+#ifdef CO_USE_EPOLL
+    lunchbox::ScopedWrite mutex( _impl->lock );
+    if( _impl->dirty || // rebuild of the set adds it
+        stde::find( _impl->allConnections, connection ) ==
+        _impl->allConnections.end( ))
+    {
+        return;
+    }
+    _impl->arm( connection.get( ));
+#else
+    // the next select rebuilds the set including the connection
+    _impl->interrupt();
+#endif
+}
+
 
 #ifdef _WIN32
 
@@ -403,6 +495,11 @@ bool ConnectionSet::removeConnection( ConnectionPtr connection )
 #else
         connection->removeListener( _impl );
 #endif
+#ifdef CO_USE_EPOLL
+        if( _impl->epollFD >= 0 ) // no more events for a destroyed connection
+            ::epoll_ctl( _impl->epollFD, EPOLL_CTL_DEL,
+                         connection->getNotifier(), 0 );
+#endif
 
         _impl->allConnections.erase( i );
     }
@@ -445,6 +542,18 @@ void ConnectionSet::_clear()
 ConnectionSet::Event ConnectionSet::select( const uint32_t timeout )
 {
     LB_TS_SCOPED( _selectThread );
+#ifdef CO_USE_EPOLL
+    {
+        // Re-enable the connection of the last event, unless its reader
+        // re-arms it using rearm()
+        lunchbox::ScopedWrite mutex( _impl->lock );
+        if( _impl->connection && !_impl->dirty &&
+            !_impl->connection->isRead( ))
+        {
+            _impl->arm( _impl->connection.get( ));
+        }
+    }
+#endif
     while( true )
     {
         _impl->connection = 0;
@@ -469,8 +578,7 @@ ConnectionSet::Event ConnectionSet::select( const uint32_t timeout )
 #else
         const int pollTimeout = timeout == LB_TIMEOUT_INDEFINITE ?
                                 -1 : int( timeout );
-        const int ret = poll( _impl->fdSet.getData(), _impl->fdSet.getSize(),
-                              pollTimeout );
+        const int ret = _impl->wait( pollTimeout );
 #endif
         switch( ret )
         {
@@ -517,7 +625,9 @@ ConnectionSet::Event ConnectionSet::select( const uint32_t timeout )
                     if ( _isThreadMode && _needRebalance )
                         _rebalanceThreads();
 #endif
+#ifndef CO_USE_EPOLL
                     _rotateFDSet();
+#endif
                     return event;
                 }
         }
@@ -554,6 +664,47 @@ ConnectionSet::Event ConnectionSet::_getSelectResult( const uint32_t index )
               _impl->connection->isClosed( ));
     return EVENT_DATA;
 }
+#elif defined CO_USE_EPOLL
+ConnectionSet::Event ConnectionSet::_getSelectResult( const uint32_t )
+{
+    {
+        lunchbox::ScopedWrite mutex( _impl->lock );
+        if( _impl->dirty ) // event might be from a removed connection
+            return EVENT_NONE;
+        _impl->connection =
+            static_cast< Connection* >( _impl->epollEvent.data.ptr );
+    }
+    LBASSERT( _impl->connection.isValid( ));
+    LBVERB << "Got event on connection @" << (void*)_impl->connection.get()
+           << std::endl;
+
+    const uint32_t events = _impl->epollEvent.events;
+    if(( events & EPOLLERR ) && !_impl->connection->handleNotifications( ))
+    {
+        LBINFO << "Error during epoll_wait(): " << lunchbox::sysError
+               << std::endl;
+        return EVENT_ERROR;
+    }
+
+    // see poll() implementation below for the order of HUP and IN
+    if( events & EPOLLHUP )
+        return EVENT_DISCONNECT;
+
+    if( events & ( EPOLLIN | EPOLLPRI ))
+        return EVENT_DATA;
+
+    if( events & EPOLLERR ) // notifications consumed, wait for next event
+    {
+        lunchbox::ScopedWrite mutex( _impl->lock );
+        if( !_impl->dirty )
+            _impl->arm( _impl->connection.get( ));
+        return EVENT_NONE;
+    }
+
+    LBERROR << "Unhandled epoll event(s): " << events << std::endl;
+    ::abort();
+    return EVENT_NONE;
+}
 #else // _WIN32
 ConnectionSet::Event ConnectionSet::_getSelectResult( const uint32_t )
 {
@@ -573,7 +724,8 @@ ConnectionSet::Event ConnectionSet::_getSelectResult( const uint32_t )
         LBVERB << "Got event on connection @" << (void*)_impl->connection.get()
                << std::endl;
 
-        if( pollEvents & POLLERR )
+        if(( pollEvents & POLLERR ) &&
+            !_impl->connection->handleNotifications( ))
         {
             LBINFO << "Error during poll(): " << lunchbox::sysError
                    << std::endl;
@@ -591,6 +743,9 @@ ConnectionSet::Event ConnectionSet::_getSelectResult( const uint32_t )
         if( pollEvents & POLLIN || pollEvents & POLLPRI )
             return EVENT_DATA;
 
+        if( pollEvents & POLLERR ) // notifications consumed
+            continue;
+
         LBERROR << "Unhandled poll event(s): " << pollEvents << std::endl;
         ::abort();
     }
@@ -630,6 +785,10 @@ bool ConnectionSet::_setupFDSet()
 //#endif
 //        return true;
 //    }
+#ifdef CO_USE_EPOLL
+    if( !_impl->dirty ) // registrations persist between selects
+        return true;
+#endif
 
     _impl->dirty = false;
     _impl->fdSet.setSize( 0 );
@@ -684,6 +843,42 @@ bool ConnectionSet::_setupFDSet()
         _impl->fdSetResult.append( result );
     }
     _impl->lock.unset();
+#elif defined CO_USE_EPOLL
+    lunchbox::ScopedWrite mutex( _impl->lock );
+    if( _impl->epollFD >= 0 )
+        ::close( _impl->epollFD );
+    _impl->epollFD = epoll_create( int( _impl->allConnections.size() + 1 ));
+    if( _impl->epollFD < 0 )
+    {
+        LBWARN << "epoll_create failed: " << lunchbox::sysError << std::endl;
+        return false;
+    }
+
+    // add self connection, level-triggered to stay signaled until reset
+    epoll_event event;
+    event.events = EPOLLIN;
+    event.data.ptr = _impl->selfConnection.get();
+    LBCHECK( ::epoll_ctl( _impl->epollFD, EPOLL_CTL_ADD,
+                          _impl->selfConnection->getNotifier(), &event ) == 0 );
+
+    // add regular connections, re-armed after each event
+    for( ConnectionsCIter i = _impl->allConnections.begin();
+         i != _impl->allConnections.end(); ++i )
+    {
+        ConnectionPtr connection = *i;
+        if ( connection->isRead() )
+            continue;
+
+        if( connection->getNotifier() <= 0 )
+        {
+            LBINFO << "Cannot select connection " << connection
+                   << ", connection " << typeid( *connection.get( )).name()
+                   << " doesn't have a file descriptor" << std::endl;
+            _impl->connection = connection;
+            return false;
+        }
+        _impl->arm( connection.get( ));
+    }
 #else // _WIN32
     pollfd fd;
     fd.events = POLLIN; // | POLLPRI;
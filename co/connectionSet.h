@@ -91,6 +91,16 @@ namespace detail { class ConnectionSet; }
         /** Interrupt the current or next select call. @version 1.0 */
         CO_API void interrupt();
 
+        /**
+         * @internal Include a connection again in select(), after it was
+         * excluded while being read.
+         *
+         * On Linux, this re-enables the one-shot event registration of the
+         * connection without waking up a running select. Elsewhere, it
+         * interrupts the select to rebuild the set. Thread-safe.
+         */
+        void rearm( ConnectionPtr connection );
+
         /**
          * @return the error code when the last select() returned EVENT_ERROR.
          * @version 1.0
@@ -36,6 +36,7 @@ namespace co
         CONNECTIONTYPE_IB,        //!< Infiniband RDMA (old, Windows XP only)
         CONNECTIONTYPE_RDMA,      //!< Infiniband RDMA CM
         CONNECTIONTYPE_UDT,       //!< UDT connection
+        CONNECTIONTYPE_SHM,       //!< Shared memory, same host only
         CONNECTIONTYPE_MULTICAST = 0x100, //!< @internal MC types after this:
         CONNECTIONTYPE_RSP        //!< UDP-based reliable stream protocol
     };
@@ -55,6 +56,7 @@ namespace co
             case CONNECTIONTYPE_NONE: return os << "NONE";
             case CONNECTIONTYPE_RDMA: return os << "RDMA";
             case CONNECTIONTYPE_UDT: return os << "UDT";
+            case CONNECTIONTYPE_SHM: return os << "SHM";
 
             default:
                 LBASSERTINFO( false, "Not implemented" );
@@ -29,6 +29,7 @@
 #include <lunchbox/decompressor.h>
 #include <lunchbox/plugins/compressor.h>
 
+#include <fstream>
 #include <string.h>
 
 namespace co
@@ -145,6 +146,84 @@ uint64_t DataIStream::getRemainingBufferSize()
     return _impl->inputSize - _impl->position;
 }
 
+bool DataIStream::readFile( const std::string& filename, const uint64_t offset )
+{
+    uint64_t size = 0;
+    *this >> size;
+
+    std::fstream file( filename.c_str(),
+                       std::ios::in | std::ios::out | std::ios::binary );
+    if( !file.is_open( ))
+        file.open( filename.c_str(), std::ios::out | std::ios::binary );
+    if( file.is_open( ))
+        file.seekp( offset );
+
+    bool ok = file.good();
+    if( !ok )
+        LBWARN << "Can't write " << size << " bytes at " << offset << " to "
+               << filename << std::endl;
+
+    // consume the whole region even on error to stay in sync with the stream
+    while( size > 0 )
+    {
+        uint64_t nBytes = size;
+        const uint8_t* data = _readPart( nBytes );
+        if( !data )
+            return false;
+
+        if( ok )
+        {
+            file.write( reinterpret_cast< const char* >( data ),
+                        std::streamsize( nBytes ));
+            ok = file.good();
+            if( !ok )
+                LBWARN << "Error writing " << filename << std::endl;
+        }
+        size -= nBytes;
+    }
+    return ok;
+}
+
+uint64_t DataIStream::readRegion( void* data, const uint64_t maxSize )
+{
+    uint64_t size = 0;
+    *this >> size;
+    if( size > maxSize )
+        LBERROR << "Region of " << size << " bytes exceeds " << maxSize
+                << " bytes of memory" << std::endl;
+
+    uint8_t* out = static_cast< uint8_t* >( data );
+    for( uint64_t left = size; left > 0; )
+    {
+        uint64_t nBytes = left;
+        const uint8_t* part = _readPart( nBytes );
+        if( !part )
+            break;
+
+        if( size <= maxSize )
+        {
+            memcpy( out, part, nBytes );
+            out += nBytes;
+        }
+        left -= nBytes;
+    }
+    return size;
+}
+
+const uint8_t* DataIStream::_readPart( uint64_t& size )
+{
+    if( !_checkBuffer( ))
+    {
+        LBERROR << "No more input data" << std::endl;
+        return 0;
+    }
+
+    size = LB_MIN( size, _impl->inputSize - _impl->position );
+    const uint8_t* data = _impl->input + _impl->position;
+    _impl->position += size;
+    return data;
+}
+
 bool DataIStream::wasUsed() const
 {
     return _impl->input != 0;
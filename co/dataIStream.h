@@ -30,6 +30,7 @@
 
 #include <map>
 #include <set>
+#include <string>
 #include <vector>
 
 namespace co
@@ -81,6 +82,32 @@ public:
     /** Read a stde::hash_set of serializable items. @version 1.0 */
     template< class T > DataIStream& operator >> ( stde::hash_set< T >& );
 
+    /**
+     * Read a region written by DataOStream::writeFile() or writeRegion() into
+     * a file.
+     *
+     * The data is written directly from the received buffers. The file is
+     * created if it does not exist, and is not truncated.
+     *
+     * @param filename the name of the file.
+     * @param offset the position of the region in the file.
+     * @return false if the file could not be written.
+     * @version 1.0
+     */
+    CO_API bool readFile( const std::string& filename,
+                          const uint64_t offset = 0 );
+
+    /**
+     * Read a region written by DataOStream::writeFile() or writeRegion() into
+     * memory, e.g., of a mapped file.
+     *
+     * @param data the memory receiving the region.
+     * @param maxSize the size of the memory.
+     * @return the size of the region. Nothing is copied if it exceeds maxSize.
+     * @version 1.0
+     */
+    CO_API uint64_t readRegion( void* data, const uint64_t maxSize );
+
     /**
      * @define CO_IGNORE_BYTESWAP: If set, no byteswapping of transmitted data
      * is performed. Enable when you get unresolved symbols for
@@ -170,6 +197,12 @@ private:
     CO_API bool _checkBuffer();
     CO_API void _reset();
 
+    /**
+     * Advance over the next part of a region of at most size bytes.
+     * @return the data of the part, its size in size, or 0 if no data is left.
+     */
+    const uint8_t* _readPart( uint64_t& size );
+
     const uint8_t* _decompress( const void* data, const uint32_t name,
                                 const uint32_t nChunks,
                                 const uint64_t dataSize );
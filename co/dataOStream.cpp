@@ -28,25 +28,23 @@
 #include "global.h"
 #include "log.h"
 #include "node.h"
+#include "statistics.h"
 #include "types.h"
 
 #include <lunchbox/compressor.h>
 #include <lunchbox/plugins/compressor.h>
 
+#include <fstream>
+#ifndef _WIN32
+#  include <fcntl.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
+
 namespace co
 {
 namespace
 {
-//#define EQ_INSTRUMENT_DATAOSTREAM
-#ifdef EQ_INSTRUMENT_DATAOSTREAM
-lunchbox::a_int32_t nBytes;
-lunchbox::a_int32_t nBytesIn;
-lunchbox::a_int32_t nBytesOut;
-CO_API lunchbox::a_int32_t nBytesSaved;
-CO_API lunchbox::a_int32_t nBytesSent;
-lunchbox::a_int32_t compressionTime;
-#endif
-
 enum CompressorState
 {
     STATE_UNCOMPRESSED,
@@ -90,6 +88,26 @@ public:
     /** Save all sent data */
     bool save;
 
+    /** The memory region currently sent directly, if any */
+    const void* region;
+
+    /** The file currently sent directly, or -1 */
+    int regionFD;
+
+    /** The start of the directly sent region in regionFD */
+    uint64_t regionOffset;
+
+    /** The previous buffer, reused once its zero-copy sends completed */
+    lunchbox::Bufferb spare;
+
+    /** Connections and send marks of pending zero-copy sends from buffer */
+    Connections sent;
+    std::vector< uint32_t > marks;
+
+    /** Connections and send marks of pending zero-copy sends from spare */
+    Connections spareSent;
+    std::vector< uint32_t > spareMarks;
+
     DataOStream()
             : state( STATE_UNCOMPRESSED )
             , bufferStart( 0 )
@@ -97,6 +115,9 @@ public:
             , enabled( false )
             , dataSent( false )
             , save( false )
+            , region( 0 )
+            , regionFD( -1 )
+            , regionOffset( 0 )
         {}
 
     DataOStream( const DataOStream& rhs )
@@ -106,8 +127,44 @@ public:
         , enabled( rhs.enabled )
         , dataSent( rhs.dataSent )
         , save( rhs.save )
+        , region( 0 )
+        , regionFD( -1 )
+        , regionOffset( 0 )
     {}
 
+    static void waitSent( Connections& connections,
+                          std::vector< uint32_t >& sendMarks )
+    {
+        for( size_t i = 0; i < connections.size(); ++i )
+            connections[i]->waitSent( sendMarks[i] );
+        connections.clear();
+        sendMarks.clear();
+    }
+
+    /** Wait for all zero-copy sends referencing our memory. */
+    void waitSent()
+    {
+        waitSent( sent, marks );
+        waitSent( spareSent, spareMarks );
+    }
+
+    /**
+     * Empty the buffer for new data. A buffer with pending zero-copy sends is
+     * swapped with the spare one, whose sends are waited for, which keeps one
+     * flush in flight.
+     */
+    void retireBuffer()
+    {
+        if( !sent.empty( ))
+        {
+            waitSent( spareSent, spareMarks );
+            buffer.swap( spare );
+            sent.swap( spareSent );
+            marks.swap( spareMarks );
+        }
+        buffer.setSize( 0 );
+    }
+
     uint32_t getCompressor() const
     {
         if( state == STATE_UNCOMPRESSED || state == STATE_UNCOMPRESSIBLE )
@@ -128,9 +185,6 @@ public:
     {
         if( state == result || state == STATE_UNCOMPRESSIBLE )
             return;
-#ifdef EQ_INSTRUMENT_DATAOSTREAM
-        nBytesIn += size;
-#endif
         const uint64_t threshold =
            uint64_t( Global::getIAttribute( Global::IATTR_OBJECT_COMPRESSION ));
 
@@ -141,14 +195,7 @@ public:
         }
 
         const uint64_t inDims[2] = { 0, size };
-
-#ifdef EQ_INSTRUMENT_DATAOSTREAM
-        lunchbox::Clock clock;
-#endif
         compressor.compress( src, inDims );
-#ifdef EQ_INSTRUMENT_DATAOSTREAM
-        compressionTime += uint32_t( clock.getTimef() * 1000.f );
-#endif
 
         const uint32_t nChunks = compressor.getNumResults();
         compressedDataSize = 0;
@@ -162,9 +209,10 @@ public:
             compressor.getResult( i, &chunk, &chunkSize );
             compressedDataSize += chunkSize;
         }
-#ifdef EQ_INSTRUMENT_DATAOSTREAM
-        nBytesOut += compressedDataSize;
-#endif
+        Statistics::getCounter( Statistics::COMPRESSION_IN ).add(
+            int64_t( size ));
+        Statistics::getCounter( Statistics::COMPRESSION_OUT ).add(
+            int64_t( compressedDataSize ));
 
         if( compressedDataSize >= size )
         {
@@ -198,6 +246,7 @@ DataOStream::DataOStream( DataOStream& rhs )
     : lunchbox::NonCopyable()
     , _impl( new detail::DataOStream( *rhs._impl ))
 {
+    rhs._impl->waitSent();
     _setupConnections( rhs.getConnections( ));
     getBuffer().swap( rhs.getBuffer( ));
 
@@ -267,6 +316,24 @@ void DataOStream::_resend()
     sendData( _impl->buffer.getData(), _impl->dataSize, true );
 }
 
+void DataOStream::_releaseSaved( const bool keepCompressed )
+{
+    LBASSERT( !_impl->enabled );
+    _impl->buffer.clear();
+    if( keepCompressed && _impl->state == STATE_COMPLETE )
+        return;
+
+    if( _impl->state != STATE_UNCOMPRESSIBLE )
+        _impl->state = STATE_UNCOMPRESSED;
+    if( _impl->compressor.isGood( ))
+        _impl->compressor.realloc();
+}
+
+bool DataOStream::_hasCompressedData() const
+{
+    return _impl->state == STATE_COMPLETE;
+}
+
 void DataOStream::_clearConnections()
 {
     _impl->connections.clear();
@@ -278,7 +345,7 @@ void DataOStream::disable()
         return;
 
     _impl->dataSize = _impl->buffer.getSize();
-    _impl->dataSent = _impl->dataSize > 0;
+    _impl->dataSent = _impl->dataSent || _impl->dataSize > 0;
 
     if( _impl->dataSent && !_impl->connections.empty( ))
     {
@@ -303,6 +370,7 @@ void DataOStream::disable()
 
         sendData( ptr, size, true ); // always send to finalize istream
     }
+    _impl->waitSent();
 
 #ifndef CO_AGGRESSIVE_CACHING
     if( !_impl->save )
@@ -333,15 +401,14 @@ bool DataOStream::hasSentData() const
     return _impl->dataSent;
 }
 
+uint64_t DataOStream::getDataSize() const
+{
+    return _impl->dataSize;
+}
+
 void DataOStream::_write( const void* data, uint64_t size )
 {
     LBASSERT( _impl->enabled );
-#ifdef EQ_INSTRUMENT_DATAOSTREAM
-    nBytes += size;
-    if( compressionTime > 100000 )
-        LBWARN << *this << std::endl;
-#endif
-
     if( _impl->buffer.getSize() - _impl->bufferStart >
         Global::getObjectBufferSize( ))
     {
@@ -350,6 +417,100 @@ void DataOStream::_write( const void* data, uint64_t size )
     _impl->buffer.append( static_cast< const uint8_t* >( data ), size );
 }
 
+bool DataOStream::writeFile( const std::string& filename,
+                             const uint64_t offset, const uint64_t size )
+{
+#ifndef _WIN32
+    if( _isDirect( size ))
+    {
+        const int fd = ::open( filename.c_str(), O_RDONLY );
+        struct stat info;
+        if( fd < 0 || ::fstat( fd, &info ) != 0 ||
+            uint64_t( info.st_size ) < offset + size )
+        {
+            LBWARN << "Can't read " << size << " bytes at " << offset
+                   << " from " << filename << ": " << lunchbox::sysError
+                   << std::endl;
+            if( fd >= 0 )
+                ::close( fd );
+            *this << uint64_t( 0 );
+            return false;
+        }
+
+        *this << size;
+        _sendRegion( 0, fd, offset, size );
+        ::close( fd );
+        return true;
+    }
+#endif
+
+    // read the whole region first, nothing is written if reading fails
+    std::vector< char > data( size_t( size ));
+    std::ifstream file( filename.c_str(), std::ios::binary );
+    file.seekg( 0, std::ios::end );
+    bool ok = file && uint64_t( file.tellg( )) >= offset + size;
+    if( ok && size > 0 )
+    {
+        file.seekg( offset );
+        file.read( &data.front(), std::streamsize( size ));
+        ok = file && uint64_t( file.gcount( )) == size;
+    }
+    if( !ok )
+    {
+        LBWARN << "Can't read " << size << " bytes at " << offset << " from "
+               << filename << std::endl;
+        *this << uint64_t( 0 );
+        return false;
+    }
+
+    *this << size;
+    if( size > 0 )
+        _write( &data.front(), size );
+    return true;
+}
+
+void DataOStream::writeRegion( const void* data, const uint64_t size )
+{
+    *this << size;
+    if( !_isDirect( size ))
+    {
+        _write( data, size );
+        return;
+    }
+
+    _sendRegion( data, -1, 0, size );
+}
+
+bool DataOStream::_isDirect( const uint64_t size ) const
+{
+    return _impl->enabled && !_impl->save &&
+           size > uint64_t( Global::getObjectBufferSize( ));
+}
+
+void DataOStream::_sendRegion( const void* data, const int fd,
+                               const uint64_t offset, const uint64_t size )
+{
+    LBASSERT( _impl->enabled );
+    LBASSERT( !_impl->save );
+
+    if( _impl->buffer.getSize() > _impl->bufferStart )
+        flush( false );
+
+    if( !_impl->connections.empty( ))
+    {
+        // sendData( connection, size ) picks up the region
+        _impl->state = STATE_UNCOMPRESSED;
+        _impl->region = data;
+        _impl->regionFD = fd;
+        _impl->regionOffset = offset;
+        sendData( data, size, false );
+        _impl->region = 0;
+        _impl->regionFD = -1;
+        _impl->waitSent(); // the region is owned by the caller
+    }
+    _impl->dataSent = true;
+}
+
 void DataOStream::flush( const bool last )
 {
     LBASSERT( _impl->enabled );
@@ -368,6 +529,7 @@ void DataOStream::flush( const bool last )
 
 void DataOStream::reset()
 {
+    _impl->waitSent();
     _resetBuffer();
     _impl->enabled = false;
     _impl->connections.clear();
@@ -386,7 +548,7 @@ void DataOStream::_resetBuffer()
     else
     {
         _impl->bufferStart = 0;
-        _impl->buffer.setSize( 0 );
+        _impl->retireBuffer();
     }
 }
 
@@ -423,30 +585,49 @@ DataOStream& DataOStream::streamDataHeader( DataOStream& os )
 
 void DataOStream::sendData( ConnectionPtr connection, const uint64_t dataSize )
 {
+    if( _impl->region )
+    {
+        LBCHECK( connection->sendZeroCopy( _impl->region, dataSize, true ));
+        _impl->sent.push_back( connection );
+        _impl->marks.push_back( connection->getSendMark( ));
+        return;
+    }
+#ifndef _WIN32
+    if( _impl->regionFD >= 0 )
+    {
+        LBCHECK( connection->sendFile( _impl->regionFD, _impl->regionOffset,
+                                       dataSize, true ));
+        return;
+    }
+#endif
+
     const uint32_t compressor = _impl->getCompressor();
     if( compressor == EQ_COMPRESSOR_NONE )
     {
-        if( dataSize > 0 )
+        if( dataSize == 0 )
+            return;
+        if( _impl->save )
+        {
             LBCHECK( connection->send( _impl->buffer.getData(), dataSize,
                                        true ));
+            return;
+        }
+
+        // kept alive until waitSent(), see retireBuffer()
+        LBCHECK( connection->sendZeroCopy( _impl->buffer.getData(), dataSize,
+                                           true ));
+        _impl->sent.push_back( connection );
+        _impl->marks.push_back( connection->getSendMark( ));
         return;
     }
 
-#ifdef EQ_INSTRUMENT_DATAOSTREAM
-    nBytesSent += _impl->buffer.getSize();
-#endif
     const uint32_t nChunks = _impl->compressor.getNumResults();
     uint64_t* chunkSizes =static_cast< uint64_t* >
                                ( alloca (nChunks * sizeof( uint64_t )));
     void** chunks = static_cast< void ** >
                                   ( alloca( nChunks * sizeof( void* )));
 
-#ifdef EQ_INSTRUMENT_DATAOSTREAM
-    const uint64_t compressedSize = _getCompressedData( chunks, chunkSizes );
-    nBytesSaved += _impl->buffer.getSize() - compressedSize;
-#else
     _getCompressedData( chunks, chunkSizes );
-#endif
 
     for( size_t j = 0; j < nChunks; ++j )
     {
@@ -465,21 +646,7 @@ uint64_t DataOStream::getCompressedDataSize() const
 
 std::ostream& operator << ( std::ostream& os, const DataOStream& dataOStream )
 {
-    os << "DataOStream "
-#ifdef EQ_INSTRUMENT_DATAOSTREAM
-       << "compressed " << nBytesIn << " -> " << nBytesOut << " of " << nBytes
-       << " in " << compressionTime/1000 << "ms, saved " << nBytesSaved
-       << " of " << nBytesSent << " brutto sent";
-
-    nBytes = 0;
-    nBytesIn = 0;
-    nBytesOut = 0;
-    nBytesSaved = 0;
-    nBytesSent = 0;
-    compressionTime = 0;
-#else
-       << "@" << (void*)&dataOStream;
-#endif
+    os << "DataOStream @" << (void*)&dataOStream;
     return os;
 }
 
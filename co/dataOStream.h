@@ -30,6 +30,7 @@
 
 #include <map>
 #include <set>
+#include <string>
 #include <vector>
 
 namespace co
@@ -60,6 +61,9 @@ namespace DataStreamTest { class Sender; }
         /** @internal @return if data was sent since the last enable() */
         CO_API bool hasSentData() const;
 
+        /** @internal @return the size of the data written since enable(). */
+        CO_API uint64_t getDataSize() const;
+
         /** @internal */
         CO_API const Connections& getConnections() const;
 
@@ -107,6 +111,37 @@ namespace DataStreamTest { class Sender; }
         template< class T >
         DataOStream& operator << ( const stde::hash_set< T >& value );
 
+        /**
+         * Write a region of a file.
+         *
+         * Large regions are not copied into the stream buffer, but sent in a
+         * separate command directly from the file. Stream connections use
+         * sendfile() for this, which does not pass the data through user
+         * space. The data of small regions and of saved streams, e.g., instance
+         * data retained for later mapping, is copied.
+         *
+         * The region is read using DataIStream::readFile() or
+         * DataIStream::readRegion().
+         *
+         * @param filename the name of the file.
+         * @param offset the start of the region in the file.
+         * @param size the size of the region.
+         * @return false if the file could not be read, in which case an empty
+         *         region is written.
+         * @version 1.0
+         */
+        CO_API bool writeFile( const std::string& filename,
+                               const uint64_t offset, const uint64_t size );
+
+        /**
+         * Write a large memory region, e.g., of a mapped file.
+         *
+         * Like writeFile(), the region is sent from the given memory instead of
+         * being copied into the stream buffer when possible.
+         * @version 1.0
+         */
+        CO_API void writeRegion( const void* data, const uint64_t size );
+
         /** @internal
          * Serialize child objects.
          *
@@ -152,6 +187,15 @@ namespace DataStreamTest { class Sender; }
         /** @internal Resend the saved buffer to all enabled connections. */
         void _resend();
 
+        /**
+         * @internal Release the saved buffer after it has been stored
+         * elsewhere, optionally keeping the compressed data for resending.
+         */
+        void _releaseSaved( const bool keepCompressed );
+
+        /** @internal @return true if the saved data is held compressed. */
+        bool _hasCompressedData() const;
+
         void _clearConnections(); //!< @internal
 
         /** @internal @name Data sending, used by the subclasses */
@@ -177,6 +221,13 @@ namespace DataStreamTest { class Sender; }
         /** Helper function preparing data for sendData() as needed. */
         void _sendData( const void* data, const uint64_t size );
 
+        /** @return true if a region is sent without copying it. */
+        bool _isDirect( const uint64_t size ) const;
+
+        /** Send a memory or file region in its own command. */
+        void _sendRegion( const void* data, const int fd,
+                          const uint64_t offset, const uint64_t size );
+
         /** Reset after sending a buffer. */
         void _resetBuffer();
 
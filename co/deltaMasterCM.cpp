@@ -30,49 +30,63 @@ namespace co
 
 DeltaMasterCM::DeltaMasterCM( Object* object )
         : FullMasterCM( object )
-#pragma warning(push)
-#pragma warning(disable : 4355)
-        , _deltaData( this )
-#pragma warning(pop)
+        , _deltaSize( 0 )
+        , _instanceSize( 0 )
 {}
 
 DeltaMasterCM::~DeltaMasterCM()
 {}
 
+void DeltaMasterCM::init()
+{
+    FullMasterCM::init();
+    _instanceSize = _instanceDatas.back()->os.getDataSize();
+    _deltaSize = 0;
+}
+
 void DeltaMasterCM::_commit()
 {
-    if( !_slaves->empty( ))
+    InstanceData* instanceData = _newInstanceData();
+    if( !instanceData->delta )
+        instanceData->delta = new ObjectDeltaDataOStream( this );
+
+    ObjectDeltaDataOStream& delta = *instanceData->delta;
+    delta.reset();
+    delta.enableSave();
+    delta.enableCommit( _version + 1, _getCommitReceivers( _version + 1 ));
+    _object->pack( delta );
+    delta.disable();
+
+    if( !delta.hasSentData( ))
     {
-        _deltaData.reset();
-        _deltaData.enableCommit( _version + 1, *_slaves );
-        _object->pack( _deltaData );
-        _deltaData.disable();
+        _releaseInstanceData( instanceData );
+        return;
     }
 
-    if( _slaves->empty() || _deltaData.hasSentData( ))
+    ++_version;
+    LBASSERT( _version != VERSION_NONE );
+
+    // Only retain the delta, unless the deltas since the last full version
+    // outgrow it. New slaves receive the last full version and the deltas.
+    _deltaSize += delta.getDataSize();
+    if( _deltaSize >= _instanceSize )
     {
-        // save instance data
-        InstanceData* instanceData = _newInstanceData();
+        delete instanceData->delta;
+        instanceData->delta = 0;
 
-        instanceData->os.enableCommit( _version + 1, Nodes( ));
+        instanceData->os.enableCommit( _version, Nodes( ));
         _object->getInstanceData( instanceData->os );
         instanceData->os.disable();
 
-        if( _deltaData.hasSentData() || instanceData->os.hasSentData( ))
-        {
-            ++_version;
-            LBASSERT( _version != VERSION_NONE );
-
-            _addInstanceData( instanceData );
-        }
-        else
-            _releaseInstanceData( instanceData );
+        _instanceSize = instanceData->os.getDataSize();
+        _deltaSize = 0;
+    }
 
+    _addInstanceData( instanceData );
 #if 0
-        LBLOG( LOG_OBJECTS ) << "Committed v" << _version << " " << *_object
-                             << std::endl;
+    LBLOG( LOG_OBJECTS ) << "Committed v" << _version << " " << *_object
+                         << std::endl;
 #endif
-    }
 }
 
 }
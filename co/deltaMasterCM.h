@@ -22,13 +22,16 @@
 #define CO_DELTAMASTERCM_H
 
 #include "fullMasterCM.h"              // base class
-#include "objectDeltaDataOStream.h"
 
 namespace co
 {
     /**
      * An object change manager handling full versions and deltas for the master
      * instance.
+     *
+     * Commits only serialize the delta. Full instance data is serialized when
+     * the retained deltas grow larger than the last full version, or when a
+     * push needs the head version.
      * @internal
      */
     class DeltaMasterCM : public FullMasterCM
@@ -37,15 +40,20 @@ namespace co
         DeltaMasterCM( Object* object );
         virtual ~DeltaMasterCM();
 
+        virtual void init();
+
     protected:
         virtual void _commit();
 
     private:
+        /** The size of the deltas since the last full version. */
+        uint64_t _deltaSize;
+
+        /** The size of the last full version. */
+        uint64_t _instanceSize;
+
         /* The command handlers. */
         bool _cmdCommit( ICommand& pkg );
-
-        typedef ObjectDeltaDataOStream DeltaData;
-        DeltaData _deltaData;
     };
 }
 
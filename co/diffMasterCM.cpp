@@ -0,0 +1,128 @@
+
+/* Copyright (c) 2013, Stefan Eilemann <eile@equalizergraphics.com>
+ *
+ * This file is part of Collage <https://github.com/Eyescale/Collage>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 2.1 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "diffMasterCM.h"
+
+#include "binaryDiff.h"
+#include "log.h"
+#include "object.h"
+#include "objectICommand.h"
+#include "objectOCommand.h"
+
+namespace co
+{
+typedef CommandFunc< DiffMasterCM > CmdFunc;
+
+DiffMasterCM::DiffMasterCM( Object* object )
+        : FullMasterCM( object )
+#pragma warning(push)
+#pragma warning(disable: 4355)
+        , _diffData( this )
+#pragma warning(pop)
+        , _sendFull( true )
+        , _sentSize( 0 )
+        , _fullSize( 0 )
+{
+    object->registerCommand( CMD_OBJECT_RESYNC,
+                             CmdFunc( this, &DiffMasterCM::_cmdResync ), 0 );
+}
+
+DiffMasterCM::~DiffMasterCM()
+{}
+
+void DiffMasterCM::init()
+{
+    FullMasterCM::init();
+    _sendFull = true; // the initial version is not kept raw
+}
+
+void DiffMasterCM::_commit()
+{
+    InstanceData* instanceData = _newInstanceData();
+    instanceData->os.enableCommit( _version + 1, Nodes( ));
+    _object->getInstanceData( instanceData->os );
+    instanceData->os.disable();
+
+    if( !instanceData->os.hasSentData( ))
+    {
+        _releaseInstanceData( instanceData );
+        return;
+    }
+
+    ++_version;
+    LBASSERT( _version != VERSION_NONE );
+
+    const lunchbox::Bufferb& data = instanceData->os.getSavedData();
+    const uint64_t size = data.getSize();
+    const Nodes receivers = _getCommitReceivers( _version );
+
+    binaryDiff::Ops ops;
+    const uint64_t diffSize = _sendFull ? size :
+                              binaryDiff::compute( _previous, data, ops );
+    const bool sendDiff = diffSize < size;
+    if( sendDiff )
+    {
+        _diffData.reset();
+        _diffData.enableCommit( _version, receivers );
+        binaryDiff::write( _diffData, ops, _previous, data );
+        _diffData.disable();
+    }
+
+    // sending the full data may compress and release the saved data
+    _previous.replace( data.getData(), size );
+    instanceData->os.store( _blockStore );
+    if( !sendDiff )
+        instanceData->os.sendCommit( receivers );
+
+    _sentSize += sendDiff ? diffSize : size;
+    _fullSize += size;
+    _sendFull = false;
+
+    _addInstanceData( instanceData );
+#if 0
+    LBLOG( LOG_OBJECTS ) << "Committed v" << _version << " " << *_object
+                         << ", " << ( sendDiff ? diffSize : size ) << " of "
+                         << size << " bytes" << std::endl;
+#endif
+}
+
+bool DiffMasterCM::_cmdResync( ICommand& cmd )
+{
+    ObjectICommand command( cmd );
+    const uint32_t instanceID = command.get< uint32_t >();
+
+    // _previous is the data of the head version, which contains the version
+    // the slave failed to apply
+    Mutex mutex( _slaves );
+    const uint64_t size = _previous.getSize();
+    _object->send( command.getNode(), CMD_OBJECT_RESYNC_DATA, instanceID )
+        << _version << size << Array< const uint8_t >( _previous.getData(),
+                                                       size );
+    return true;
+}
+
+void DiffMasterCM::printMemoryUsage( std::ostream& os ) const
+{
+    FullMasterCM::printMemoryUsage( os );
+
+    Mutex mutex( _slaves );
+    os << ", commits sent " << _sentSize << " of " << _fullSize << " bytes";
+}
+
+}
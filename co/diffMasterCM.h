@@ -0,0 +1,71 @@
+
+/* Copyright (c) 2013, Stefan Eilemann <eile@equalizergraphics.com>
+ *
+ * This file is part of Collage <https://github.com/Eyescale/Collage>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 2.1 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef CO_DIFFMASTERCM_H
+#define CO_DIFFMASTERCM_H
+
+#include "fullMasterCM.h"              // base class
+#include "objectDeltaDataOStream.h"    // member
+
+namespace co
+{
+    /**
+     * An object change manager sending binary diffs of the instance data for
+     * the master instance.
+     *
+     * Commits serialize the full instance data, which is retained like by the
+     * FullMasterCM. Slaves only receive the difference to the previous
+     * version, unless it is not smaller than the full data or a slave has no
+     * previous version. A slave which could not apply a diff receives the
+     * data of the head version directly.
+     * @internal
+     */
+    class DiffMasterCM : public FullMasterCM
+    {
+    public:
+        DiffMasterCM( Object* object );
+        virtual ~DiffMasterCM();
+
+        virtual void init();
+        virtual void printMemoryUsage( std::ostream& os ) const;
+
+    protected:
+        virtual void _commit();
+        virtual void _notifyEmptySlave() { _sendFull = true; }
+
+    private:
+        /** The instance data of the head version, the base for the diff. */
+        lunchbox::Bufferb _previous;
+
+        /** The output stream for diffs. */
+        ObjectDeltaDataOStream _diffData;
+
+        /** Send the next commit in full, a slave has no previous version. */
+        bool _sendFull;
+
+        /** The number of bytes sent by commits, and without diffing them. */
+        uint64_t _sentSize;
+        uint64_t _fullSize;
+
+        /* The command handlers. */
+        bool _cmdResync( ICommand& command );
+    };
+}
+
+#endif // CO_DIFFMASTERCM_H
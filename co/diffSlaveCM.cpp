@@ -0,0 +1,165 @@
+
+/* Copyright (c) 2013, Stefan Eilemann <eile@equalizergraphics.com>
+ *
+ * This file is part of Collage <https://github.com/Eyescale/Collage>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 2.1 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "diffSlaveCM.h"
+
+#include "binaryDiff.h"
+#include "global.h"
+#include "log.h"
+#include "object.h"
+#include "objectDataIStream.h"
+#include "objectICommand.h"
+#include "objectOCommand.h"
+
+#include <lunchbox/plugins/compressor.h>
+
+namespace co
+{
+namespace
+{
+/** Reads the instance data of one version from memory. */
+class BufferIStream : public DataIStream
+{
+public:
+    BufferIStream( const lunchbox::Bufferb& data, ObjectDataIStream& is )
+            : DataIStream( is.isSwapping( ))
+            , _data( data )
+            , _is( is )
+            , _read( false )
+    {}
+
+    virtual size_t nRemainingBuffers() const { return _read ? 0 : 1; }
+    virtual uint128_t getVersion() const { return _is.getVersion(); }
+    virtual NodePtr getMaster() { return _is.getMaster(); }
+
+protected:
+    virtual bool getNextBuffer( uint32_t& compressor, uint32_t& nChunks,
+                                const void** chunkData, uint64_t& size )
+    {
+        if( _read || _data.isEmpty( ))
+            return false;
+
+        _read = true;
+        compressor = EQ_COMPRESSOR_NONE;
+        nChunks = 1;
+        *chunkData = _data.getData();
+        size = _data.getSize();
+        return true;
+    }
+
+private:
+    const lunchbox::Bufferb& _data;
+    ObjectDataIStream& _is;
+    bool _read;
+};
+}
+
+typedef CommandFunc< DiffSlaveCM > CmdFunc;
+
+DiffSlaveCM::DiffSlaveCM( Object* object, uint32_t masterInstanceID )
+        : VersionedSlaveCM( object, masterInstanceID )
+        , _resyncVersion( VERSION_NONE )
+        , _resyncDataVersion( VERSION_NONE )
+        , _resynced( false )
+{
+    object->registerCommand( CMD_OBJECT_RESYNC_DATA,
+                             CmdFunc( this, &DiffSlaveCM::_cmdResyncData ), 0 );
+}
+
+DiffSlaveCM::~DiffSlaveCM()
+{}
+
+void DiffSlaveCM::_apply( ObjectDataIStream* is )
+{
+    const uint128_t& version = is->getVersion();
+    if( is->hasInstanceData( ))
+    {
+        _data.clear();
+        while( is->hasData( ))
+        {
+            const uint64_t size = is->getRemainingBufferSize();
+            _data.append( static_cast< const uint8_t* >(
+                              is->getRemainingBuffer( size )), size );
+        }
+    }
+    else if( version <= _resyncVersion ) // already part of the resync data
+    {
+        _skip( *is );
+        return;
+    }
+    else if( !_data.isEmpty() && binaryDiff::apply( *is, _data, _result ))
+        _data.swap( _result );
+    else
+    {
+        _skip( *is );
+        LBERROR << "Can't apply diff for version " << version << " of "
+                << lunchbox::className( _object )
+                << ", requesting full instance data" << std::endl;
+        if( !_resync( ))
+            return;
+    }
+
+    BufferIStream data( _data, *is );
+    _object->applyInstanceData( data );
+    LBASSERTINFO( !data.hasData(), lunchbox::className( _object ) <<
+                  " did not unpack all data" );
+}
+
+void DiffSlaveCM::_skip( ObjectDataIStream& is )
+{
+    while( is.hasData( )) // skip the remainder of an unusable diff
+        is.getRemainingBuffer( is.getRemainingBufferSize( ));
+}
+
+bool DiffSlaveCM::_resync()
+{
+    // The object diverged from the master. The master replies with its head
+    // version, which is applied before this version is considered synced.
+    NodePtr master = getMasterNode();
+    if( !master || !master->isReachable( ))
+        return false;
+
+    _resynced = false;
+    _object->send( master, CMD_OBJECT_RESYNC, getMasterInstanceID( ))
+        << _object->getInstanceID();
+    if( !_resynced.timedWaitEQ( true, Global::getTimeout( )))
+    {
+        LBERROR << "Timeout waiting for full instance data of "
+                << lunchbox::className( _object ) << std::endl;
+        return false;
+    }
+
+    _data.swap( _resyncData );
+    _resyncData.clear();
+    _resyncVersion = _resyncDataVersion;
+    return true;
+}
+
+bool DiffSlaveCM::_cmdResyncData( ICommand& cmd )
+{
+    ObjectICommand command( cmd );
+    _resyncDataVersion = command.get< uint128_t >();
+    const uint64_t size = command.get< uint64_t >();
+    _resyncData.reset( size );
+    command >> Array< uint8_t >( _resyncData.getData(), size );
+    _resynced = true;
+    return true;
+}
+
+}
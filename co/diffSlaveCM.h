@@ -0,0 +1,71 @@
+
+/* Copyright (c) 2013, Stefan Eilemann <eile@equalizergraphics.com>
+ *
+ * This file is part of Collage <https://github.com/Eyescale/Collage>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 2.1 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef CO_DIFFSLAVECM_H
+#define CO_DIFFSLAVECM_H
+
+#include "versionedSlaveCM.h"  // base class
+
+#include <lunchbox/buffer.h>   // member
+#include <lunchbox/monitor.h>  // member
+
+namespace co
+{
+    /**
+     * An object change manager handling binary diffs for slave instances.
+     *
+     * Keeps the instance data of the current version, which is patched with
+     * the diffs sent by a DiffMasterCM and then applied to the object.
+     * @internal
+     */
+    class DiffSlaveCM : public VersionedSlaveCM
+    {
+    public:
+        DiffSlaveCM( Object* object, uint32_t masterInstanceID );
+        virtual ~DiffSlaveCM();
+
+    protected:
+        virtual void _apply( ObjectDataIStream* is );
+
+    private:
+        /** The instance data of the current version. */
+        lunchbox::Bufferb _data;
+
+        /** The diffed instance data, swapped with _data after applying. */
+        lunchbox::Bufferb _result;
+
+        /** The version of the applied resync data, later diffs are skipped. */
+        uint128_t _resyncVersion;
+
+        /** The full head version sent by the master after a failed diff. */
+        lunchbox::Bufferb _resyncData;
+        uint128_t _resyncDataVersion;
+        lunchbox::Monitor< bool > _resynced;
+
+        void _skip( ObjectDataIStream& is );
+
+        /** Replace the data with the one of the master, blocks the sync. */
+        bool _resync();
+
+        /* The command handlers. */
+        bool _cmdResyncData( ICommand& command );
+    };
+}
+
+#endif // CO_DIFFSLAVECM_H
@@ -0,0 +1,160 @@
+
+/* Copyright (c) 2013, Stefan Eilemann <eile@equalizergraphics.com>
+ *
+ * This file is part of Collage <https://github.com/Eyescale/Collage>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 2.1 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "dirtyBitSet.h"
+
+#include "dataIStream.h"
+#include "dataOStream.h"
+
+namespace co
+{
+namespace
+{
+typedef std::vector< uint64_t > Words;
+
+size_t _getNumWords( const size_t size ) { return ( size + 63 ) >> 6; }
+
+/** Write the summary level recursively, followed by the non-zero words. */
+void _write( DataOStream& os, const Words& words )
+{
+    if( words.size() <= 1 )
+    {
+        if( !words.empty( ))
+            os << words.front();
+        return;
+    }
+
+    Words summary( _getNumWords( words.size( )), 0 );
+    for( size_t i = 0; i < words.size(); ++i )
+        if( words[i] )
+            summary[ i >> 6 ] |= 1ull << ( i & 63 );
+
+    _write( os, summary );
+    for( size_t i = 0; i < words.size(); ++i )
+        if( words[i] )
+            os << words[i];
+}
+
+void _read( DataIStream& is, Words& words )
+{
+    if( words.size() <= 1 )
+    {
+        if( !words.empty( ))
+            is >> words.front();
+        return;
+    }
+
+    Words summary( _getNumWords( words.size( )), 0 );
+    _read( is, summary );
+    for( size_t i = 0; i < words.size(); ++i )
+    {
+        if( summary[ i >> 6 ] & ( 1ull << ( i & 63 )))
+            is >> words[i];
+        else
+            words[i] = 0;
+    }
+}
+}
+
+DirtyBitSet::DirtyBitSet( const size_t size )
+    : _words( _getNumWords( size ), 0 )
+    , _size( size )
+{}
+
+void DirtyBitSet::resize( const size_t size )
+{
+    if( size < _size && ( size & 63 ))
+        // clear bits beyond the new size in the last word
+        _words[ size >> 6 ] &= ( 1ull << ( size & 63 )) - 1;
+
+    _words.resize( _getNumWords( size ), 0 );
+    _size = size;
+}
+
+void DirtyBitSet::setAll()
+{
+    std::fill( _words.begin(), _words.end(), ~0ull );
+    if( _size & 63 )
+        _words.back() = ( 1ull << ( _size & 63 )) - 1;
+}
+
+void DirtyBitSet::clear()
+{
+    std::fill( _words.begin(), _words.end(), 0ull );
+}
+
+bool DirtyBitSet::isEmpty() const
+{
+    for( Words::const_iterator i = _words.begin(); i != _words.end(); ++i )
+        if( *i )
+            return false;
+    return true;
+}
+
+size_t DirtyBitSet::findNext( size_t index ) const
+{
+    while( index < _size )
+    {
+        const uint64_t word = _words[ index >> 6 ] >> ( index & 63 );
+        if( word == 0 ) // skip to next word
+        {
+            index = ( index | 63 ) + 1;
+            continue;
+        }
+        if( word & 1 )
+            return index;
+        ++index;
+    }
+    return _size;
+}
+
+size_t DirtyBitSet::findNextClean( size_t index ) const
+{
+    while( index < _size )
+    {
+        const uint64_t word = _words[ index >> 6 ] >> ( index & 63 );
+        const uint64_t ones = ( index & 63 ) ? ~0ull >> ( index & 63 ) : ~0ull;
+        if( word == ones ) // skip to next word
+        {
+            index = ( index | 63 ) + 1;
+            continue;
+        }
+        if( !( word & 1 ))
+            return index;
+        ++index;
+    }
+    return _size;
+}
+
+void DirtyBitSet::serialize( DataOStream& os ) const
+{
+    os << uint64_t( _size );
+    _write( os, _words );
+}
+
+void DirtyBitSet::deserialize( DataIStream& is )
+{
+    uint64_t size = 0;
+    is >> size;
+    _size = size_t( size );
+    _words.resize( _getNumWords( _size ));
+    _read( is, _words );
+}
+
+}
@@ -0,0 +1,123 @@
+
+/* Copyright (c) 2013, Stefan Eilemann <eile@equalizergraphics.com>
+ *
+ * This file is part of Collage <https://github.com/Eyescale/Collage>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 2.1 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef CO_DIRTYBITSET_H
+#define CO_DIRTYBITSET_H
+
+#include <co/api.h>
+#include <co/types.h>
+#include <lunchbox/debug.h>
+
+namespace co
+{
+/**
+ * A set of dirty bits of arbitrary width.
+ *
+ * Used by Serializable subclasses with more fields than fit into the 64 dirty
+ * bits passed to Serializable::serialize(). One of these bits typically
+ * signals that the bit set itself is streamed, followed by the fields it
+ * marks.
+ *
+ * The set is encoded hierarchically: each level has one bit per non-zero
+ * 64-bit word of the level below, and only non-zero words are written. A
+ * sparse set of a million bits is thus transmitted in a few words.
+ */
+class DirtyBitSet
+{
+public:
+    /** Construct a new, clean bit set of the given size. @version 1.0 */
+    CO_API explicit DirtyBitSet( const size_t size = 0 );
+
+    /** Change the number of bits, new bits are clean. @version 1.0 */
+    CO_API void resize( const size_t size );
+
+    /** @return the number of bits. @version 1.0 */
+    size_t getSize() const { return _size; }
+
+    /** Mark the given bit dirty. @version 1.0 */
+    void set( const size_t index )
+    {
+        LBASSERTINFO( index < _size, index << " >= " << _size );
+        _words[ index >> 6 ] |= 1ull << ( index & 63 );
+    }
+
+    /** Mark the given bit clean. @version 1.0 */
+    void unset( const size_t index )
+    {
+        LBASSERTINFO( index < _size, index << " >= " << _size );
+        _words[ index >> 6 ] &= ~( 1ull << ( index & 63 ));
+    }
+
+    /** @return true if the given bit is dirty. @version 1.0 */
+    bool test( const size_t index ) const
+    {
+        LBASSERTINFO( index < _size, index << " >= " << _size );
+        return ( _words[ index >> 6 ] & ( 1ull << ( index & 63 ))) != 0;
+    }
+
+    /** Mark all bits dirty. @version 1.0 */
+    CO_API void setAll();
+
+    /** Mark all bits clean. @version 1.0 */
+    CO_API void clear();
+
+    /** @return true if no bit is dirty. @version 1.0 */
+    CO_API bool isEmpty() const;
+
+    /**
+     * @return the index of the first dirty bit at or after the given index,
+     *         or getSize() if there is none.
+     * @version 1.0
+     */
+    CO_API size_t findNext( const size_t index ) const;
+
+    /**
+     * @return the index of the first clean bit at or after the given index,
+     *         or getSize() if there is none.
+     * @version 1.0
+     */
+    CO_API size_t findNextClean( const size_t index ) const;
+
+    /** Write the bit set in its compact encoding. @version 1.0 */
+    CO_API void serialize( DataOStream& os ) const;
+
+    /** Read a bit set written by serialize(). @version 1.0 */
+    CO_API void deserialize( DataIStream& is );
+
+private:
+    std::vector< uint64_t > _words;
+    size_t _size;
+};
+
+/** Stream the bit set in its compact encoding. @version 1.0 */
+inline DataOStream& operator << ( DataOStream& os, const DirtyBitSet& bits )
+{
+    bits.serialize( os );
+    return os;
+}
+
+/** Read a bit set streamed using operator <<. @version 1.0 */
+inline DataIStream& operator >> ( DataIStream& is, DirtyBitSet& bits )
+{
+    bits.deserialize( is );
+    return is;
+}
+}
+
+#endif // CO_DIRTYBITSET_H
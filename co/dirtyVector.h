@@ -0,0 +1,146 @@
+
+/* Copyright (c) 2013, Stefan Eilemann <eile@equalizergraphics.com>
+ *
+ * This file is part of Collage <https://github.com/Eyescale/Collage>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 2.1 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef CO_DIRTYVECTOR_H
+#define CO_DIRTYVECTOR_H
+
+#include <co/dataIStream.h>
+#include <co/dataOStream.h>
+#include <co/dirtyBitSet.h>
+
+namespace co
+{
+/**
+ * A vector of POD elements tracking modifications per element.
+ *
+ * serialize() transmits only the runs of modified elements, which keeps the
+ * delta of a Serializable small when few elements of a large array change.
+ * All modifications have to go through set() or modify().
+ */
+template< class T > class DirtyVector
+{
+public:
+    /** Construct a new vector of the given size. @version 1.0 */
+    explicit DirtyVector( const size_t size = 0 )
+        : _data( size ), _dirty( size ), _sizeChanged( false ) {}
+
+    /** @return the number of elements. @version 1.0 */
+    size_t size() const { return _data.size(); }
+
+    /** Resize the vector, marking new elements dirty. @version 1.0 */
+    void resize( const size_t size )
+    {
+        const size_t oldSize = _data.size();
+        _data.resize( size );
+        _dirty.resize( size );
+        for( size_t i = oldSize; i < size; ++i )
+            _dirty.set( i );
+        _sizeChanged = _sizeChanged || oldSize != size;
+    }
+
+    /** @return the element at the given index. @version 1.0 */
+    const T& operator[]( const size_t index ) const { return _data[ index ]; }
+
+    /** Set and mark dirty the element at the given index. @version 1.0 */
+    void set( const size_t index, const T& value )
+    {
+        _data[ index ] = value;
+        _dirty.set( index );
+    }
+
+    /** @return the element at the given index, marked dirty. @version 1.0 */
+    T& modify( const size_t index )
+    {
+        _dirty.set( index );
+        return _data[ index ];
+    }
+
+    /** @return the underlying data. @version 1.0 */
+    const std::vector< T >& getData() const { return _data; }
+
+    /** @return true if any element has been modified. @version 1.0 */
+    bool isDirty() const { return _sizeChanged || !_dirty.isEmpty(); }
+
+    /** @return true if the given element has been modified. @version 1.0 */
+    bool isDirty( const size_t index ) const { return _dirty.test( index ); }
+
+    /**
+     * Write the modified elements and reset the dirty state.
+     *
+     * The size is followed by (start, count, elements) runs, terminated by a
+     * zero count.
+     * @version 1.0
+     */
+    void serialize( DataOStream& os )
+    {
+        const size_t nElems = _data.size();
+        os << uint64_t( nElems );
+
+        size_t start = _dirty.findNext( 0 );
+        while( start < nElems )
+        {
+            const size_t end = _dirty.findNextClean( start );
+            os << uint64_t( start ) << uint64_t( end - start )
+               << Array< const T >( &_data[ start ], end - start );
+            start = _dirty.findNext( end );
+        }
+        os << uint64_t( 0 ) << uint64_t( 0 );
+        _dirty.clear();
+        _sizeChanged = false;
+    }
+
+    /** Read the elements written by serialize(). @version 1.0 */
+    void deserialize( DataIStream& is )
+    {
+        uint64_t nElems = 0;
+        is >> nElems;
+        _data.resize( nElems );
+        _dirty.resize( nElems );
+
+        uint64_t start = 0;
+        uint64_t count = 0;
+        is >> start >> count;
+        while( count > 0 )
+        {
+            LBASSERTINFO( start + count <= nElems,
+                          start << "+" << count << " > " << nElems );
+            is >> Array< T >( &_data[ start ], count );
+            is >> start >> count;
+        }
+    }
+
+    /** Write all elements without changing the dirty state. @version 1.0 */
+    void serializeAll( DataOStream& os ) const { os << _data; }
+
+    /** Read all elements written by serializeAll(). @version 1.0 */
+    void deserializeAll( DataIStream& is )
+    {
+        is >> _data;
+        _dirty.resize( _data.size( ));
+        _dirty.clear();
+    }
+
+private:
+    std::vector< T > _data;
+    DirtyBitSet _dirty;
+    bool _sizeChanged;
+};
+}
+
+#endif // CO_DIRTYVECTOR_H
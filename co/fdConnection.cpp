@@ -26,10 +26,14 @@
 #include "global.h"
 #include "log.h"
 
+#include <lunchbox/clock.h>
 #include <lunchbox/os.h>
 
 #include <errno.h>
 #include <poll.h>
+#ifdef __linux__
+#  include <sys/sendfile.h>
+#endif
 
 namespace co
 {
@@ -47,11 +51,37 @@ int FDConnection::_getTimeOut()
 //----------------------------------------------------------------------
 // read
 //----------------------------------------------------------------------
+namespace
+{
+/** Busy-wait until the descriptor is readable or the given time elapsed. */
+void _spinForData( const int fd, const int32_t timeUS )
+{
+    struct pollfd fds[1];
+    fds[0].fd = fd;
+    fds[0].events = POLLIN;
+
+    lunchbox::Clock clock;
+    const double time = double( timeUS ) / 1000.;
+    do
+    {
+        fds[0].revents = 0;
+        if( poll( fds, 1, 0 ) != 0 )
+            return;
+    }
+    while( clock.getTimed() < time );
+}
+}
+
 int64_t FDConnection::readSync( void* buffer, const uint64_t bytes, const bool )
 {
     if( _readFD < 1 )
         return -1;
 
+    const int32_t spinTime =
+        Global::getIAttribute( Global::IATTR_RECV_SPIN_TIME_US );
+    if( spinTime > 0 )
+        _spinForData( _readFD, spinTime );
+
     ssize_t bytesRead = ::read( _readFD, buffer, bytes );
     if( bytesRead > 0 )
         return bytesRead;
@@ -142,5 +172,34 @@ int64_t FDConnection::write( const void* buffer, const uint64_t bytes )
 
     return bytesWritten;
 }
+
+#ifdef __linux__
+int64_t FDConnection::writeFile( const int fd, const uint64_t offset,
+                                 const uint64_t bytes )
+{
+    if( !isConnected() || _writeFD < 1 )
+        return -1;
+
+    off_t position = off_t( offset );
+    const ssize_t bytesWritten = ::sendfile( _writeFD, fd, &position,
+                                             size_t( bytes ));
+    if( bytesWritten > 0 )
+        return bytesWritten;
+
+    if( bytesWritten == 0 )
+    {
+        LBWARN << "Unexpected end of file at " << offset << std::endl;
+        return -1;
+    }
+
+    if( errno == EINTR ) // if interrupted, try again
+        return 0;
+    if( errno == EINVAL || errno == ENOSYS ) // not supported for these fds
+        return Connection::writeFile( fd, offset, bytes );
+
+    LBWARN << "Error during sendfile: " << lunchbox::sysError << std::endl;
+    return -1;
+}
+#endif
 }
 #endif
@@ -42,16 +42,19 @@ namespace co
         virtual int64_t readSync( void* buffer, const uint64_t bytes,
                                   const bool ignored );
         virtual int64_t write( const void* buffer, const uint64_t bytes );
+#ifdef __linux__
+        virtual int64_t writeFile( const int fd, const uint64_t offset,
+                                   const uint64_t bytes );
+#endif
 
         int   _readFD;     //!< The read file descriptor.
         int   _writeFD;    //!< The write file descriptor.
 
+        int _getTimeOut();
+
         friend inline std::ostream& operator << ( std::ostream& os,
                                                const FDConnection* connection );
 
-    private:
-        int _getTimeOut();
-
     };
 
     inline std::ostream& operator << ( std::ostream& os,
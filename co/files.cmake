@@ -30,6 +30,8 @@ set(CO_PUBLIC_HEADERS
   dataOStreamArchive.ipp
   dataStreamArchiveException.h
   defines.h
+  dirtyBitSet.h
+  dirtyVector.h
   dispatcher.h
   exception.h
   global.h
@@ -52,6 +54,8 @@ set(CO_PUBLIC_HEADERS
   queueSlave.h
   sendToken.h
   serializable.h
+  statistics.h
+  trace.h
   types.h
   worker.h
   worker.ipp
@@ -60,14 +64,19 @@ set(CO_PUBLIC_HEADERS
 
 set(CO_HEADERS
   barrierCommand.h
+  binaryDiff.h
+  blockStore.h
   bufferCache.h
   connectionListener.h
   dataStreamArchive.h
   dataIStreamQueue.h
   deltaMasterCM.h
+  diffMasterCM.h
+  diffSlaveCM.h
   eventConnection.h
   fullMasterCM.h
   instanceCache.h
+  loopbackConnection.h
   masterCMCommand.h
   nodeCommand.h
   nullCM.h
@@ -82,6 +91,7 @@ set(CO_HEADERS
   objectStore.h
   pipeConnection.h
   queueCommand.h
+  relayTree.h
   rspConnection.h
   socketConnection.h
   staticMasterCM.h
@@ -93,6 +103,8 @@ set(CO_HEADERS
 
 set(CO_SOURCES
   barrier.cpp
+  binaryDiff.cpp
+  blockStore.cpp
   buffer.cpp
   bufferCache.cpp
   bufferConnection.cpp
@@ -105,7 +117,10 @@ set(CO_SOURCES
   dataIStream.cpp
   dataIStreamQueue.cpp
   dataOStream.cpp
+  dirtyBitSet.cpp
   deltaMasterCM.cpp
+  diffMasterCM.cpp
+  diffSlaveCM.cpp
   dispatcher.cpp
   eventConnection.cpp
   fullMasterCM.cpp
@@ -114,6 +129,7 @@ set(CO_SOURCES
   init.cpp
   instanceCache.cpp
   localNode.cpp
+  loopbackConnection.cpp
   masterCMCommand.cpp
   node.cpp
   oCommand.cpp
@@ -140,6 +156,8 @@ set(CO_SOURCES
   serializable.cpp
   socketConnection.cpp
   staticSlaveCM.cpp
+  statistics.cpp
+  trace.cpp
   unbufferedMasterCM.cpp
   version.cpp
   versionedMasterCM.cpp
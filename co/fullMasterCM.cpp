@@ -24,6 +24,7 @@
 #include "node.h"
 #include "object.h"
 #include "objectDataIStream.h"
+#include "statistics.h"
 
 //#define EQ_INSTRUMENT
 
@@ -67,7 +68,8 @@ void FullMasterCM::sendInstanceData( Nodes& nodes )
         return;
 
     InstanceData* data = _instanceDatas.back();
-    data->os.sendInstanceData( nodes );
+    if( !data->delta ) // speculative, slaves still get deltas during mapping
+        data->os.sendInstanceData( nodes );
 }
 
 void FullMasterCM::init()
@@ -80,6 +82,8 @@ void FullMasterCM::init()
     data->os.enableCommit( VERSION_FIRST, *_slaves );
     _object->getInstanceData( data->os );
     data->os.disable();
+    data->os.store( _blockStore );
+    data->os.compact( true /* keepCompressed */ );
 
     _instanceDatas.push_back( data );
     ++_version;
@@ -120,7 +124,7 @@ void FullMasterCM::_updateCommitCount( const uint32_t incarnation )
             break;
 
 #ifdef EQ_INSTRUMENT
-        _bytesBuffered -= data->os.getSaveBuffer().getSize();
+        _bytesBuffered -= data->os.getDataSize();
         LBINFO << _bytesBuffered << " bytes used" << std::endl;
 #endif
         _releaseInstanceData( data );
@@ -132,7 +136,7 @@ void FullMasterCM::_updateCommitCount( const uint32_t incarnation )
     {
         // tweak commitCount of minimum retained version for correct obsoletion
         data->commitCount = 0;
-        _version = data->os.getVersion();
+        _version = data->getVersion();
     }
 }
 
@@ -141,23 +145,35 @@ void FullMasterCM::_obsolete()
     LBASSERT( !_instanceDatas.empty( ));
     while( _instanceDatas.size() > 1 && _commitCount > _nVersions )
     {
-        InstanceData* data = _instanceDatas.front();
-        if( data->commitCount >= (_commitCount - _nVersions))
+        // deltas need their full base version, obsolete up to the next one
+        InstanceDataDeque::iterator next = _instanceDatas.begin() + 1;
+        while( next != _instanceDatas.end() && (*next)->delta )
+            ++next;
+        if( next == _instanceDatas.end( ))
             break;
 
+        const InstanceData* last = *(next - 1);
+        if( last->commitCount >= (_commitCount - _nVersions))
+            break;
+
+        for( InstanceDataDeque::iterator i = _instanceDatas.begin();
+             i != next; ++i )
+        {
+            InstanceData* data = *i;
 #ifdef EQ_INSTRUMENT
-        _bytesBuffered -= data->os.getSaveBuffer().getSize();
-        LBINFO << _bytesBuffered << " bytes used" << std::endl;
+            _bytesBuffered -= data->os.getDataSize();
+            LBINFO << _bytesBuffered << " bytes used" << std::endl;
 #endif
 #if 0
-        LBINFO
-            << "Remove v" << data->os.getVersion() << " c" << data->commitCount
-            << "@" << _commitCount << "/" << _nVersions << " from "
-            << lunchbox::className( _object ) << " " << ObjectVersion( _object )
-            << std::endl;
+            LBINFO
+                << "Remove v" << data->getVersion() << " c"
+                << data->commitCount << "@" << _commitCount << "/"
+                << _nVersions << " from " << lunchbox::className( _object )
+                << " " << ObjectVersion( _object ) << std::endl;
 #endif
-        _releaseInstanceData( data );
-        _instanceDatas.pop_front();
+            _releaseInstanceData( data );
+        }
+        _instanceDatas.erase( _instanceDatas.begin(), next );
     }
     _checkConsistency();
 }
@@ -170,7 +186,7 @@ void FullMasterCM::_initSlave( MasterCMCommand command,
 
     const uint128_t& version = command.getRequestedVersion();
 
-    const uint128_t oldest = _instanceDatas.front()->os.getVersion();
+    const uint128_t oldest = _getOldestVersion();
     uint128_t start = (version == VERSION_OLDEST || version < oldest ) ?
                           oldest : version;
     uint128_t end = _version;
@@ -186,22 +202,22 @@ void FullMasterCM::_initSlave( MasterCMCommand command,
     const uint128_t& minCachedVersion = command.getMinCachedVersion();
     const uint128_t& maxCachedVersion = command.getMaxCachedVersion();
     const uint128_t replyVersion = start;
+    bool needsBase = true;
     if( replyUseCache )
     {
         if( minCachedVersion <= start &&
             maxCachedVersion >= start )
         {
-#ifdef EQ_INSTRUMENT_MULTICAST
-            _hit += maxCachedVersion + 1 - start;
-#endif
+            Statistics::getCounter( Statistics::MAP_CACHE_HIT ).add(
+                int64_t( maxCachedVersion.low() + 1 - start.low( )));
             start = maxCachedVersion + 1;
+            needsBase = false; // deltas apply to the cached head version
         }
         else if( maxCachedVersion == end )
         {
             end = LB_MAX( start, minCachedVersion - 1 );
-#ifdef EQ_INSTRUMENT_MULTICAST
-            _hit += _version - end;
-#endif
+            Statistics::getCounter( Statistics::MAP_CACHE_HIT ).add(
+                int64_t( _version.low() - end.low( )));
         }
         // TODO else cached block in the middle, send head and tail elements
     }
@@ -218,26 +234,45 @@ void FullMasterCM::_initSlave( MasterCMCommand command,
 
     bool dataSent = false;
 
-    // send all instance datas from start..end
+    // send all instance datas from start..end, a delta preceded by its base
     InstanceDataDeque::iterator i = _instanceDatas.begin();
-    while( i != _instanceDatas.end() && (*i)->os.getVersion() < start )
+    while( i != _instanceDatas.end() && (*i)->getVersion() < start )
         ++i;
+    while( needsBase && i != _instanceDatas.end() && (*i)->delta )
+    {
+        LBASSERT( i != _instanceDatas.begin( ));
+        --i;
+    }
 
-    for( ; i != _instanceDatas.end() && (*i)->os.getVersion() <= end; ++i )
+    // Deltas are object commands, keep all map data on one connection
+    bool useMulticast = true;
+    InstanceDataDeque::iterator last = i;
+    for( ; last != _instanceDatas.end() && (*last)->getVersion() <= end; ++last)
+        if( (*last)->delta )
+            useMulticast = false;
+
+    for( ; i != last; ++i )
     {
         if( !dataSent )
         {
-            _sendMapSuccess( command, true );
+            _sendMapSuccess( command, useMulticast );
             dataSent = true;
         }
 
         InstanceData* data = *i;
         LBASSERT( data );
-        data->os.sendMapData( command.getNode(), command.getInstanceID( ));
+        if( data->delta )
+            data->delta->sendMapData( command.getNode(),
+                                      command.getInstanceID( ));
+        else
+        {
+            data->os.sendMapData( command.getNode(), command.getInstanceID(),
+                                  useMulticast );
+            if( data != _instanceDatas.back( ))
+                data->os.compact( false /* keepCompressed */ );
+        }
 
-#ifdef EQ_INSTRUMENT_MULTICAST
-        ++_miss;
-#endif
+        ++Statistics::getCounter( Statistics::MAP_CACHE_MISS );
     }
 
     if( !dataSent )
@@ -246,13 +281,9 @@ void FullMasterCM::_initSlave( MasterCMCommand command,
         _sendMapReply( command, replyVersion, true, replyUseCache, false );
     }
     else
-        _sendMapReply( command, replyVersion, true, replyUseCache, true );
+        _sendMapReply( command, replyVersion, true, replyUseCache,
+                       useMulticast );
 
-#ifdef EQ_INSTRUMENT_MULTICAST
-    if( _miss % 100 == 0 )
-        LBINFO << "Cached " << _hit << "/" << _hit + _miss
-               << " instance data transmissions" << std::endl;
-#endif
 }
 
 void FullMasterCM::_checkConsistency() const
@@ -264,15 +295,17 @@ void FullMasterCM::_checkConsistency() const
     if( _version == VERSION_NONE )
         return;
 
+    LBASSERT( !_instanceDatas.front()->delta );
+    const uint128_t oldest = _getOldestVersion();
     uint128_t version = _version;
     for( InstanceDataDeque::const_reverse_iterator i = _instanceDatas.rbegin();
          i != _instanceDatas.rend(); ++i )
     {
         const InstanceData* data = *i;
-        LBASSERT( data->os.getVersion() != VERSION_NONE );
-        LBASSERTINFO( data->os.getVersion() == version,
-                      data->os.getVersion() << " != " << version );
-        if( data != _instanceDatas.front( ))
+        LBASSERT( data->getVersion() != VERSION_NONE );
+        LBASSERTINFO( data->getVersion() == version,
+                      data->getVersion() << " != " << version );
+        if( data != _instanceDatas.front() && version > oldest )
         {
             LBASSERTINFO( data->commitCount + _nVersions >= _commitCount,
                           data->commitCount << ", " << _commitCount << " [" <<
@@ -283,6 +316,47 @@ void FullMasterCM::_checkConsistency() const
 #endif
 }
 
+uint128_t FullMasterCM::_getOldestVersion() const
+{
+    // obsolete versions are retained while later deltas are based on them
+    for( InstanceDataDeque::const_iterator i = _instanceDatas.begin();
+         i != _instanceDatas.end(); ++i )
+    {
+        const InstanceData* data = *i;
+        if( data->commitCount + _nVersions >= _commitCount )
+            return data->getVersion();
+    }
+    return _instanceDatas.back()->getVersion();
+}
+
+void FullMasterCM::printMemoryUsage( std::ostream& os ) const
+{
+    Mutex mutex( _slaves );
+    uint64_t size = 0;
+    uint64_t retained = _blockStore.getSize();
+    size_t nDeltas = 0;
+
+    for( InstanceDataDeque::const_iterator i = _instanceDatas.begin();
+         i != _instanceDatas.end(); ++i )
+    {
+        const InstanceData* data = *i;
+        if( data->delta )
+        {
+            size += data->delta->getDataSize();
+            retained += data->delta->getDataSize();
+            ++nDeltas;
+            continue;
+        }
+
+        size += data->os.getDataSize();
+        if( !data->os.isStored( ))
+            retained += data->os.getDataSize();
+    }
+
+    os << _instanceDatas.size() << " versions (" << nDeltas << " deltas) of "
+       << size << " bytes use " << retained << " bytes";
+}
+
 //---------------------------------------------------------------------------
 // cache handling
 //---------------------------------------------------------------------------
@@ -306,16 +380,36 @@ FullMasterCM::InstanceData* FullMasterCM::_newInstanceData()
 
 void FullMasterCM::_addInstanceData( InstanceData* data )
 {
-    LBASSERT( data->os.getVersion() != VERSION_NONE );
-    LBASSERT( data->os.getVersion() != VERSION_INVALID );
+    LBASSERT( data->getVersion() != VERSION_NONE );
+    LBASSERT( data->getVersion() != VERSION_INVALID );
+
+    // Only the head version keeps its compressed data for fast resending
+    if( !_instanceDatas.empty( ))
+        _instanceDatas.back()->os.compact( false /* keepCompressed */ );
+    if( !data->delta )
+    {
+        data->os.store( _blockStore );
+        data->os.compact( true /* keepCompressed */ );
+    }
 
     _instanceDatas.push_back( data );
 #ifdef EQ_INSTRUMENT
-    _bytesBuffered += data->os.getSaveBuffer().getSize();
+    _bytesBuffered += data->os.getDataSize();
     LBINFO << _bytesBuffered << " bytes used" << std::endl;
 #endif
 }
 
+FullMasterCM::InstanceData* FullMasterCM::_newHeadInstanceData()
+{
+    // The head version is only retained as a delta, serialize the current
+    // object data like an unbuffered object does.
+    InstanceData* instanceData = _newInstanceData();
+    instanceData->os.enableCommit( _version, Nodes( ));
+    _object->getInstanceData( instanceData->os );
+    instanceData->os.disable();
+    return instanceData;
+}
+
 void FullMasterCM::_releaseInstanceData( InstanceData* data )
 {
 #ifdef CO_AGGRESSIVE_CACHING
@@ -352,7 +446,8 @@ uint128_t FullMasterCM::commit( const uint32_t incarnation )
 void FullMasterCM::_commit()
 {
     InstanceData* instanceData = _newInstanceData();
-    instanceData->os.enableCommit( _version + 1, *_slaves );
+    instanceData->os.enableCommit( _version + 1,
+                                   _getCommitReceivers( _version + 1 ));
     _object->getInstanceData( instanceData->os );
     instanceData->os.disable();
 
@@ -375,7 +470,13 @@ void FullMasterCM::push( const uint128_t& groupID, const uint128_t& typeID,
 {
     Mutex mutex( _slaves );
     InstanceData* instanceData = _instanceDatas.back();
+    const bool isDelta = instanceData->delta != 0;
+    if( isDelta )
+        instanceData = _newHeadInstanceData();
+
     instanceData->os.push( nodes, _object->getID(), groupID, typeID );
+    if( isDelta )
+        _releaseInstanceData( instanceData );
 }
 
 void FullMasterCM::pushMap( const uint128_t& groupID, const uint128_t& typeID,
@@ -383,9 +484,15 @@ void FullMasterCM::pushMap( const uint128_t& groupID, const uint128_t& typeID,
 {
     Mutex mutex( _slaves );
     InstanceData* instanceData = _instanceDatas.back();
+    const bool isDelta = instanceData->delta != 0;
+    if( isDelta )
+        instanceData = _newHeadInstanceData();
+
     instanceData->os.pushMap( nodes, _object->getID(), groupID, typeID,
                               getVersion(), _object->getInstanceID(), 
                               _object->getChangeType() );
+    if( isDelta )
+        _releaseInstanceData( instanceData );
 }
 
 }
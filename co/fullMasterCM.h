@@ -22,6 +22,8 @@
 #define CO_FULLMASTERCM_H
 
 #include "versionedMasterCM.h"        // base class
+#include "blockStore.h"                // member
+#include "objectDeltaDataOStream.h"    // member
 #include "objectInstanceDataOStream.h" // member
 
 #include <deque>
@@ -58,21 +60,44 @@ namespace co
         /** Speculatively send instance data to all nodes. */
         virtual void sendInstanceData( Nodes& nodes );
 
+        virtual void printMemoryUsage( std::ostream& os ) const;
+
     protected:
+        /** The full instance data or the delta of one committed version. */
         struct InstanceData
         {
             InstanceData( const VersionedMasterCM* cm )
-                    : os( cm ), commitCount( 0 ) {}
+                    : os( cm ), delta( 0 ), commitCount( 0 ) {}
+            ~InstanceData() { delete delta; }
+
+            uint128_t getVersion() const
+                { return delta ? delta->getVersion() : os.getVersion(); }
 
             ObjectInstanceDataOStream os;
+            ObjectDeltaDataOStream* delta; //!< saved delta, 0 if full data
             uint32_t commitCount;
         };
 
+        typedef std::deque< InstanceData* > InstanceDataDeque;
+
+        /**
+         * The list of committed versions, head version last.
+         *
+         * The front entry always holds full instance data. Later entries hold
+         * a delta to their predecessor if they were committed by a
+         * DeltaMasterCM without a snapshot.
+         */
+        InstanceDataDeque _instanceDatas;
+
+        /** The data blocks shared by the retained full versions. */
+        BlockStore _blockStore;
+
         virtual void _initSlave( MasterCMCommand command,
                                  const uint128_t& replyVersion,
                                  bool replyUseCache );
 
         InstanceData* _newInstanceData();
+        InstanceData* _newHeadInstanceData();
         void _addInstanceData( InstanceData* data );
         void _releaseInstanceData( InstanceData* data );
 
@@ -80,6 +105,9 @@ namespace co
         void _obsolete();
         void _checkConsistency() const;
 
+        /** @return the oldest version which may be mapped by slaves. */
+        uint128_t _getOldestVersion() const;
+
         virtual bool isBuffered() const{ return true; }
         virtual void _commit();
 
@@ -90,11 +118,7 @@ namespace co
         /** The number of old versions to retain. */
         uint32_t _nVersions;
 
-        typedef std::deque< InstanceData* > InstanceDataDeque;
         typedef std::vector< InstanceData* > InstanceDatas;
-
-        /** The list of full instance datas, head version last. */
-        InstanceDataDeque _instanceDatas;
         InstanceDatas _instanceDataCache;
 
         /* The command handlers. */
@@ -101,11 +101,22 @@ int32_t     _iAttributes[Global::IATTR_ALL] =
     4,      // IATTR_READ_THREAD_COUNT
 #ifdef _WIN32
     65536,  // IATTR_TCP_RECV_BUFFER_SIZE
-    131072  // IATTR_TCP_SEND_BUFFER_SIZE
+    131072, // IATTR_TCP_SEND_BUFFER_SIZE
 #else
     0,      // IATTR_TCP_RECV_BUFFER_SIZE
-    0       // IATTR_TCP_SEND_BUFFER_SIZE
+    0,      // IATTR_TCP_SEND_BUFFER_SIZE
 #endif
+    0,      // IATTR_OBJECT_RELAY_FANOUT
+    0,      // IATTR_SHM_RING_BUFFER_SIZE_MB
+    100,    // IATTR_BARRIER_SPIN_TIME_US
+    0,      // IATTR_COMMIT_THREAD_COUNT
+    262144, // IATTR_READ_AHEAD_SIZE
+    0,      // IATTR_TCP_BUSY_POLL_US
+    0,      // IATTR_RECV_SPIN_TIME_US
+    0,      // IATTR_TCP_ZEROCOPY_SIZE
+    0,      // IATTR_LINK_LATENCY_US
+    0,      // IATTR_LINK_BANDWIDTH_KBS
+    0       // IATTR_LINK_LOSS_PERCENT
 };
 }
 
@@ -108,6 +108,17 @@ namespace co
             IATTR_READ_THREAD_COUNT,     //!< @internal number of read threads
             IATTR_TCP_RECV_BUFFER_SIZE,//!< @internal socketopt recv buffer size
             IATTR_TCP_SEND_BUFFER_SIZE,//!< @internal socketopt send buffer size
+            IATTR_OBJECT_RELAY_FANOUT,   //!< @internal commit relay tree arity
+            IATTR_SHM_RING_BUFFER_SIZE_MB, //!< @internal 0: no same-host shm
+            IATTR_BARRIER_SPIN_TIME_US,  //!< @internal max busy wait in enter
+            IATTR_COMMIT_THREAD_COUNT,   //!< @internal 0: sequential commit
+            IATTR_READ_AHEAD_SIZE,       //!< @internal recv buffer, 0: off
+            IATTR_TCP_BUSY_POLL_US,      //!< @internal SO_BUSY_POLL, 0: off
+            IATTR_RECV_SPIN_TIME_US,     //!< @internal busy wait for data
+            IATTR_TCP_ZEROCOPY_SIZE,     //!< @internal min size, 0: off
+            IATTR_LINK_LATENCY_US,       //!< @internal emulated delay, 0: off
+            IATTR_LINK_BANDWIDTH_KBS,    //!< @internal emulated rate, 0: off
+            IATTR_LINK_LOSS_PERCENT,     //!< @internal emulated loss, 0: off
             IATTR_ALL
         };
 
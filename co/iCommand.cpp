@@ -40,6 +40,7 @@ public:
         , cmd( CMD_INVALID )
         , consumed( false )
         , connection()
+        , queued( 0 )
     {}
 
     ICommand( LocalNodePtr local_, NodePtr remote_, ConstBufferPtr buffer_ )
@@ -52,6 +53,7 @@ public:
         , cmd( CMD_INVALID )
         , consumed( false )
         , connection()
+        , queued( 0 )
     {}
 
     ~ICommand()
@@ -82,6 +84,7 @@ public:
     uint32_t cmd;
     bool consumed;
     co::ConnectionPtr connection;
+    int64_t queued; //!< Trace time of the push to a CommandQueue
 };
 } // detail namespace
 
@@ -163,6 +166,16 @@ void ICommand::setCommand( const uint32_t cmd )
     _impl->cmd = cmd;
 }
 
+void ICommand::setQueueTime( const int64_t time )
+{
+    _impl->queued = time;
+}
+
+int64_t ICommand::getQueueTime() const
+{
+    return _impl->queued;
+}
+
 void ICommand::setDispatchFunction( const Dispatcher::Func& func )
 {
     _impl->func = func;
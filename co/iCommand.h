@@ -100,6 +100,12 @@ namespace detail { class ICommand; }
         /** @internal Invoke and clear the command function. */
         CO_API bool operator()();
 
+        /** @internal Set the trace time of the push to a CommandQueue. */
+        void setQueueTime( const int64_t time );
+
+        /** @internal @return the trace time of the last queue push. */
+        int64_t getQueueTime() const;
+
         void setConnection( co::ConnectionPtr connection );
         co::ConnectionPtr getConnection();
         //@}
@@ -23,6 +23,7 @@
 #include "objectDataICommand.h"
 #include "objectDataIStream.h"
 #include "objectVersion.h"
+#include "statistics.h"
 
 #include <lunchbox/debug.h>
 #include <lunchbox/scopedMutex.h>
@@ -33,8 +34,6 @@ namespace co
 #ifdef EQ_INSTRUMENT_CACHE
 namespace
 {
-lunchbox::a_int32_t nRead;
-lunchbox::a_int32_t nReadHit;
 lunchbox::a_int32_t nWrite;
 lunchbox::a_int32_t nWriteHit;
 lunchbox::a_int32_t nWriteMiss;
@@ -214,9 +213,7 @@ void InstanceCache::remove( const NodeID& nodeID )
 
 const InstanceCache::Data& InstanceCache::operator[]( const UUID& id )
 {
-#ifdef EQ_INSTRUMENT_CACHE
-    ++nRead;
-#endif
+    ++Statistics::getCounter( Statistics::INSTANCE_CACHE_READ );
 
     lunchbox::ScopedMutex<> mutex( _items );
     ItemHash::iterator i = _items->find( id );
@@ -228,9 +225,7 @@ const InstanceCache::Data& InstanceCache::operator[]( const UUID& id )
     ++item.access;
     ++item.used;
 
-#ifdef EQ_INSTRUMENT_CACHE
-    ++nReadHit;
-#endif
+    ++Statistics::getCounter( Statistics::INSTANCE_CACHE_HIT );
     return item.data;
 }
 
@@ -418,7 +413,9 @@ std::ostream& operator << ( std::ostream& os,
     os << "InstanceCache " << instanceCache.getSize() / 1048576 << "/"
        << instanceCache.getMaxSize() / 1048576 << " MB"
 #ifdef EQ_INSTRUMENT_CACHE
-       << ", " << nReadHit << "/" << nRead << " reads, " << nWriteHit
+       << ", " << Statistics::getCounter( Statistics::INSTANCE_CACHE_HIT ).get()
+       << "/" << Statistics::getCounter( Statistics::INSTANCE_CACHE_READ ).get()
+       << " reads, " << nWriteHit
        << "/" << nWrite << " writes (" << nWriteMiss << " misses, " << nWriteOld
        << " old, " << nWriteReady << " dups) " << nUsedRelease << " used, "
        << nUnusedRelease << " unused releases"
@@ -31,20 +31,28 @@
 #include "exception.h"
 #include "global.h"
 #include "iCommand.h"
+#include "loopbackConnection.h"
 #include "nodeCommand.h"
 #include "oCommand.h"
 #include "object.h"
 #include "objectICommand.h"
 #include "objectStore.h"
-#include "pipeConnection.h"
+#include "objectVersion.h"
 #include "sendToken.h"
+#include "statistics.h"
+#include "trace.h"
+#ifdef CO_USE_SHM
+#  include "shmConnection.h"
+#endif
 #include "worker.h"
 #include "zeroconf.h"
 
+#include <lunchbox/atomic.h>
 #include <lunchbox/clock.h>
 #include <lunchbox/hash.h>
 #include <lunchbox/lockable.h>
 #include <lunchbox/log.h>
+#include <lunchbox/monitor.h>
 #include <lunchbox/requestHandler.h>
 #include <lunchbox/rng.h>
 #include <lunchbox/scopedMutex.h>
@@ -59,6 +67,7 @@ namespace
 {
 typedef CommandFunc< LocalNode > CmdFunc;
 typedef std::list< ICommand > CommandList;
+typedef std::deque< BufferPtr > Buffers;
 typedef lunchbox::RefPtrHash< Connection, NodePtr > ConnectionNodeHash;
 typedef ConnectionNodeHash::const_iterator ConnectionNodeHashCIter;
 typedef ConnectionNodeHash::iterator ConnectionNodeHashIter;
@@ -74,6 +83,8 @@ typedef std::map<Connection*, uint16_t> ConnectionUsageMap;
 class ThreadSharedData
 {
 public:
+    ThreadSharedData() : _affinity( 0 ), _affinityVersion( 0 ) {}
+
     bool lock( co::ConnectionPtr conn )
     {
         lunchbox::ScopedFastWrite mutex( _map );
@@ -88,12 +99,103 @@ public:
         _usageMap[conn.get()] = 0;
     }
 
+    /** Set the affinity applied by all read workers before their next read */
+    void setAffinity( const int32_t affinity )
+    {
+        _affinity = affinity;
+        ++_affinityVersion;
+    }
+
+    /** Apply a changed affinity to the calling worker. */
+    void updateAffinity( int32_t& version ) const
+    {
+        if( version == _affinityVersion )
+            return;
+        version = _affinityVersion;
+        lunchbox::Thread::setAffinity( _affinity );
+    }
+
     lunchbox::MTQueue<co::ConnectionPtr> _workerQueue;
 private:
+    lunchbox::a_int32_t _affinity;
+    lunchbox::a_int32_t _affinityVersion;
     ConnectionUsageMap _usageMap;
     lunchbox::SpinLock _map;
 
 };
+
+/**
+ * Add a shared memory listener to nodes listening on TCP/IP, so that nodes on
+ * the same host connect through it.
+ */
+void _addSharedMemoryListener( LocalNode* node )
+{
+#ifdef CO_USE_SHM
+    if( Global::getIAttribute( Global::IATTR_SHM_RING_BUFFER_SIZE_MB ) <= 0 )
+        return;
+
+    bool hasTCP = false;
+    const ConnectionDescriptions& descriptions =
+        node->getConnectionDescriptions();
+    for( ConnectionDescriptionsCIter i = descriptions.begin();
+         i != descriptions.end(); ++i )
+    {
+        const ConnectionType type = (*i)->type;
+        if( type == CONNECTIONTYPE_SHM )
+            return;
+        if( type == CONNECTIONTYPE_TCPIP )
+            hasTCP = true;
+    }
+
+    if( hasTCP )
+    {
+        ConnectionDescriptionPtr description = new ConnectionDescription;
+        description->type = CONNECTIONTYPE_SHM;
+        node->addConnectionDescription( description );
+    }
+#endif
+}
+
+/** @return the descriptions to connect to the node, same-host ones first. */
+ConnectionDescriptions _getConnectDescriptions( NodePtr node )
+{
+    ConnectionDescriptions result;
+    const ConnectionDescriptions& descriptions =
+        node->getConnectionDescriptions();
+    for( ConnectionDescriptionsCIter i = descriptions.begin();
+         i != descriptions.end(); ++i )
+    {
+        ConnectionDescriptionPtr description = *i;
+        if( description->type >= CONNECTIONTYPE_MULTICAST )
+            continue; // Don't use multicast for primary connections
+
+        if( description->type != CONNECTIONTYPE_SHM )
+            result.push_back( description );
+#ifdef CO_USE_SHM
+        else if( ShmConnection::isLocal( description ))
+            result.insert( result.begin(), description );
+#endif
+    }
+    return result;
+}
+
+/** @return true if the connection may return partial stream reads. */
+bool _hasReadAhead( ConnectionPtr connection )
+{
+#ifdef _WIN32
+    return false; // overlapped IO reads exactly the requested size
+#else
+    switch( connection->getDescription()->type )
+    {
+      case CONNECTIONTYPE_TCPIP:
+      case CONNECTIONTYPE_SDP:
+      case CONNECTIONTYPE_PIPE:
+          return true;
+      default:
+          return false;
+    }
+#endif
+}
 }
 
 namespace detail
@@ -104,6 +206,7 @@ public:
     ReadWorkerThread( ThreadSharedData& data, co::LocalNode* localNode ) 
     : _data( data )
     , _localNode( localNode )
+    , _affinityVersion( 0 )
     {}
     virtual bool init()
     {
@@ -118,6 +221,7 @@ public:
             if ( !readConnection )
                 break;
 
+            _data.updateAffinity( _affinityVersion );
             _localNode->readAndHandleData( readConnection );
 
 
@@ -127,7 +231,51 @@ public:
 private:
     ThreadSharedData& _data;
     co::LocalNode* _localNode;
+    int32_t _affinityVersion;
+};
+
+/** One object commit executed by a CommitThread. */
+struct CommitTask
+{
+    CommitTask() : object( 0 ), incarnation( 0 ), version( 0 ), done( 0 ) {}
+
+    co::Object* object; //!< 0 stops the thread
+    uint32_t incarnation;
+    uint128_t* version;
+    lunchbox::Monitor< size_t >* done;
+};
+typedef lunchbox::MTQueue< CommitTask > CommitTasks;
+
+class CommitThread : public lunchbox::Thread
+{
+public:
+    CommitThread( CommitTasks& tasks ) : _tasks( tasks ) {}
+
+    virtual bool init()
+    {
+        setName( std::string( "CommitThread" ));
+        return true;
+    }
+
+    virtual void run()
+    {
+        while( true )
+        {
+            const CommitTask task = _tasks.pop();
+            if( !task.object )
+                break;
+
+            *task.version = task.object->commit( task.incarnation );
+            ++( *task.done );
+        }
+        exit();
+    }
+
+private:
+    CommitTasks& _tasks;
 };
+typedef std::vector< CommitThread* > CommitThreads;
+typedef CommitThreads::const_iterator CommitThreadsCIter;
 
 class ReceiverThread : public Worker
 {
@@ -161,6 +309,11 @@ public:
         _workerThreadData._workerQueue.push( connection );
     }
 
+    void setWorkerAffinity( const int32_t affinity )
+    {
+        _workerThreadData.setAffinity( affinity );
+    }
+
     void stopWorkerThreads()
     {
         for ( uint16_t i = 0; i < _workerThreads.size(); ++i )
@@ -209,7 +362,8 @@ class LocalNode
 {
 public:
     LocalNode()
-            : smallBuffers( 200 )
+            : loopbackScheduled( false )
+            , smallBuffers( 200 )
             , bigBuffers( 20 )
             , sendToken( true )
             , lastSendToken( 0 )
@@ -225,7 +379,9 @@ public:
             LBASSERT( incoming.isEmpty( ));
             LBASSERT( connectionNodes->empty( ));
             LBASSERT( pendingCommands.empty( ));
+            LBASSERT( loopback->empty( ));
             LBASSERT( nodes->empty( ));
+            LBASSERT( commitThreads.empty( ));
 
             delete objectStore;
             objectStore = 0;
@@ -240,9 +396,70 @@ public:
 
     bool inReceiverThread() const { return receiverThread->isCurrent(); }
 
+    /** Start the commit threads on first use, @return their number. */
+    size_t startCommitThreads()
+    {
+        lunchbox::ScopedMutex<> mutex( commitLock );
+        if( !commitThreads.empty( ))
+            return commitThreads.size();
+
+        const int32_t nThreads =
+                    Global::getIAttribute( Global::IATTR_COMMIT_THREAD_COUNT );
+        for( int32_t i = 0; i < nThreads; ++i )
+        {
+            CommitThread* thread = new CommitThread( commitTasks );
+            if( !thread->start( ))
+            {
+                LBWARN << "Commit thread not starting, committing "
+                       << "sequentially" << std::endl;
+                delete thread;
+                break;
+            }
+            commitThreads.push_back( thread );
+        }
+        return commitThreads.size();
+    }
+
+    /** @return true if called from one of the commit threads. */
+    bool inCommitThread() const
+    {
+        lunchbox::ScopedMutex<> mutex( commitLock );
+        for( CommitThreadsCIter i = commitThreads.begin();
+             i != commitThreads.end(); ++i )
+        {
+            if( (*i)->isCurrent( ))
+                return true;
+        }
+        return false;
+    }
+
+    void stopCommitThreads()
+    {
+        lunchbox::ScopedMutex<> mutex( commitLock );
+        for( size_t i = 0; i < commitThreads.size(); ++i )
+            commitTasks.push( CommitTask( ));
+        for( size_t i = 0; i < commitThreads.size(); ++i )
+        {
+            commitThreads[i]->join();
+            delete commitThreads[i];
+        }
+        commitThreads.clear();
+    }
+
+    /** Threads for commitObjects(), started on first use. */
+    mutable lunchbox::Lock commitLock;
+    CommitThreads commitThreads;
+    CommitTasks commitTasks;
+
     /** Commands re-scheduled for dispatch. */
     CommandList  pendingCommands;
 
+    /** Commands sent to this node, dispatched by a read worker thread. */
+    lunchbox::Lockable< Buffers, lunchbox::SpinLock > loopback;
+
+    /** A read worker has been asked to dispatch the loopback commands. */
+    bool loopbackScheduled;
+
     /** The command buffer 'allocator' for small packets */
     co::BufferCache smallBuffers;
 
@@ -421,7 +638,8 @@ bool LocalNode::listen()
     if( !isClosed() || !_connectSelf( ))
         return false;
 
-    const ConnectionDescriptions& descriptions = getConnectionDescriptions();
+    _addSharedMemoryListener( this );
+    const ConnectionDescriptions descriptions = getConnectionDescriptions();
     for( ConnectionDescriptionsCIter i = descriptions.begin();
          i != descriptions.end(); ++i )
     {
@@ -430,6 +648,14 @@ bool LocalNode::listen()
 
         if( !connection || !connection->listen( ))
         {
+            if( description->type == CONNECTIONTYPE_SHM )
+            {
+                // same-host nodes fall back to the other connections
+                LBINFO << "Can't create shared memory listener: "
+                       << description << std::endl;
+                removeConnectionDescription( description );
+                continue;
+            }
             LBWARN << "Can't create listener connection: " << description
                    << std::endl;
             return false;
@@ -469,6 +695,7 @@ bool LocalNode::close()
     if( !isListening() )
         return false;
 
+    _impl->stopCommitThreads();
     send( CMD_NODE_STOP_RCV );
 
     LBCHECK( _impl->receiverThread->join( ));
@@ -494,6 +721,7 @@ void LocalNode::setAffinity( const int32_t affinity )
 {
     send( CMD_NODE_SET_AFFINITY_RCV ) << affinity;
     send( CMD_NODE_SET_AFFINITY_CMD ) << affinity;
+    _impl->receiverThread->setWorkerAffinity( affinity );
 
     lunchbox::Thread::setAffinity( affinity );
 }
@@ -579,6 +807,10 @@ void LocalNode::_addConnection( ConnectionPtr connection )
     }
 
     _impl->incoming.addConnection( connection );
+    if( _hasReadAhead( connection ))
+        connection->setReadAheadSize(
+            Global::getIAttribute( Global::IATTR_READ_AHEAD_SIZE ));
+
     BufferPtr buffer = _impl->smallBuffers.alloc( COMMAND_ALLOCSIZE );
     connection->recvNB( buffer, COMMAND_MINSIZE );
 }
@@ -654,26 +886,13 @@ void LocalNode::_closeNode( NodePtr node )
 
 bool LocalNode::_connectSelf()
 {
-    // setup local connection to myself
-    PipeConnectionPtr connection = new PipeConnection;
-    if( !connection->connect( ))
-    {
-        LBERROR << "Could not create local connection to receiver thread."
-                << std::endl;
-        return false;
-    }
-
-    Node::_connect( connection->acceptSync( ));
+    // setup local connection to myself, commands written to it are queued
+    // with the ones sent using LocalNode::send()
+    ConnectionPtr connection = new LoopbackConnection( this );
+    Node::_connect( connection );
     _setClosed(); // reset state after _connect set it to connected
 
-    // add to connection set
-    LBASSERT( connection->getDescription().isValid( ));
-    LBASSERT( _impl->connectionNodes->find( connection ) ==
-              _impl->connectionNodes->end( ));
-
-    (*_impl->connectionNodes)[ connection ] = this;
     _impl->nodes.data[ getNodeID() ] = this;
-    _addConnection( connection );
 
     LBVERB << "Added node " << getNodeID() << " using " << connection
            << std::endl;
@@ -765,6 +984,41 @@ bool LocalNode::registerObject( Object* object )
     return _impl->objectStore->registerObject( object );
 }
 
+ObjectVersions LocalNode::commitObjects( const Objects& objects,
+                                        const uint32_t incarnation )
+{
+    ObjectVersions versions( objects.size( ));
+
+    // A nested commit, e.g., of an ObjectMap registered in an ObjectMap, must
+    // not wait for the threads busy with the outer commit
+    if( objects.size() < 2 || _impl->inCommitThread() ||
+        _impl->startCommitThreads() == 0 )
+    {
+        for( size_t i = 0; i < objects.size(); ++i )
+        {
+            Object* object = objects[i];
+            versions[i] = ObjectVersion( object->getID(),
+                                         object->commit( incarnation ));
+        }
+        return versions;
+    }
+
+    lunchbox::Monitor< size_t > done( 0 );
+    for( size_t i = 0; i < objects.size(); ++i )
+    {
+        CommitTask task;
+        task.object = objects[i];
+        task.incarnation = incarnation;
+        task.version = &versions[i].version;
+        task.done = &done;
+
+        versions[i].identifier = task.object->getID();
+        _impl->commitTasks.push( task );
+    }
+    done.waitEQ( objects.size( ));
+    return versions;
+}
+
 void LocalNode::deregisterObject( Object* object )
 {
     _impl->objectStore->deregisterObject( object );
@@ -1031,6 +1285,18 @@ NodePtr LocalNode::_connect( const NodeID& nodeID, NodePtr peer )
     return node->isReachable() ? node : 0;
 }
 
+NodePtr LocalNode::_connectVia( const NodeID& nodeID, NodePtr peer )
+{
+    LBASSERT( nodeID != 0 );
+    LBASSERT( isListening( ));
+
+    lunchbox::ScopedWrite mutex( _impl->connectLock );
+    NodePtr node = getNode( nodeID );
+    if( node && node->isReachable( ))
+        return node;
+    return _connect( nodeID, peer );
+}
+
 NodePtr LocalNode::_connectFromZeroconf( const NodeID& nodeID )
 {
     lunchbox::ScopedWrite mutex( _impl->service );
@@ -1095,14 +1361,11 @@ uint32_t LocalNode::_connect( NodePtr node )
     LBINFO << "Connecting " << node << std::endl;
 
     // try connecting using the given descriptions
-    const ConnectionDescriptions& cds = node->getConnectionDescriptions();
+    const ConnectionDescriptions cds = _getConnectDescriptions( node );
     for( ConnectionDescriptionsCIter i = cds.begin();
         i != cds.end(); ++i )
     {
         ConnectionDescriptionPtr description = *i;
-        if( description->type >= CONNECTIONTYPE_MULTICAST )
-            continue; // Don't use multicast for primary connections
-
         ConnectionPtr connection = Connection::create( description );
         if( !connection || !connection->connect( ))
             continue;
@@ -1192,6 +1455,32 @@ CommandQueue* LocalNode::getCommandThreadQueue()
     return _impl->commandThread->getWorkerQueue();
 }
 
+void LocalNode::printStatistics( std::ostream& os ) const
+{
+    Nodes nodes;
+    getNodes( nodes, false );
+
+    os << "{ \"node\": \"" << getNodeID() << "\", \"statistics\": ";
+    Statistics::toJSON( os );
+    os << ", \"connections\": [";
+
+    bool first = true;
+    for( NodesCIter i = nodes.begin(); i != nodes.end(); ++i )
+    {
+        NodePtr node = *i;
+        ConnectionPtr connection = node->getConnection();
+        if( !connection )
+            continue;
+
+        os << ( first ? " " : ", " ) << "{ \"node\": \"" << node->getNodeID()
+           << "\", \"statistics\": ";
+        Statistics::toJSON( os, connection->getStatistics( ));
+        os << " }";
+        first = false;
+    }
+    os << " ] }";
+}
+
 bool LocalNode::inCommandThread() const
 {
     return _impl->commandThread->isCurrent();
@@ -1207,6 +1496,51 @@ void LocalNode::flushCommands()
     _impl->incoming.interrupt();
 }
 
+OCommand LocalNode::send( const uint32_t cmd, const bool )
+{
+    return OCommand( this, cmd, COMMANDTYPE_NODE );
+}
+
+void LocalNode::queueLoopback( lunchbox::Bufferb& data )
+{
+    const uint64_t size = data.getSize();
+    LBASSERT( size >= OCommand::getSize( ));
+
+    // swap the command data, the allocated buffer is recycled by the stream
+    BufferPtr buffer = size > COMMAND_ALLOCSIZE ?
+        _impl->bigBuffers.alloc( size ) :
+        _impl->smallBuffers.alloc( COMMAND_ALLOCSIZE );
+    buffer->swap( data );
+    reinterpret_cast< uint64_t* >( buffer->getData( ))[ 0 ] = size;
+
+    bool schedule = false;
+    {
+        lunchbox::ScopedFastWrite mutex( _impl->loopback );
+        _impl->loopback->push_back( buffer );
+        schedule = !_impl->loopbackScheduled;
+        _impl->loopbackScheduled = true;
+    }
+
+    // One read worker at a time dispatches the commands in order, like the
+    // commands read from a connection
+    if( schedule )
+        _impl->receiverThread->addReadCommand( getConnection( ));
+}
+
+void LocalNode::sendMaxVersion( NodePtr master, const UUID& id,
+                                const uint32_t masterInstanceID,
+                                const uint64_t version,
+                                const uint32_t slaveInstanceID )
+{
+    _impl->objectStore->sendMaxVersion( master, id, masterInstanceID, version,
+                                        slaveInstanceID );
+}
+
+void LocalNode::flushMaxVersions()
+{
+    _impl->objectStore->flushMaxVersions();
+}
+
 //----------------------------------------------------------------------
 // receiver thread functions
 //----------------------------------------------------------------------
@@ -1282,19 +1616,22 @@ void LocalNode::_runReceiverThread()
     
     _impl->receiverThread->stopWorkerThreads();
 
-    LBCHECK( _impl->commandThread->join( ));
+    {
+        lunchbox::ScopedFastWrite mutex( _impl->loopback );
+        if( !_impl->loopback->empty( ))
+            LBWARN << _impl->loopback->size() << " local commands pending "
+                   << "while leaving command thread" << std::endl;
+        _impl->loopback->clear();
+        _impl->loopbackScheduled = false;
+    }
 
-    ConnectionPtr connection = getConnection();
-    PipeConnectionPtr pipe = LBSAFECAST( PipeConnection*, connection.get( ));
-    connection = pipe->acceptSync();
-    _removeConnection( connection );
-    _impl->connectionNodes->erase( connection );
+    LBCHECK( _impl->commandThread->join( ));
     _disconnect();
 
     const Connections& connections = _impl->incoming.getConnections();
     while( !connections.empty( ))
     {
-        connection = connections.back();
+        ConnectionPtr connection = connections.back();
         NodePtr node = (*_impl->connectionNodes)[ connection ];
 
         if( node )
@@ -1367,38 +1704,67 @@ bool LocalNode::_enqueueForRead()
 bool LocalNode::readAndHandleData( ConnectionPtr connection )
 {
     LBASSERT( connection );
+    if( connection == getConnection( )) // scheduled by queueLoopback()
+    {
+        _dispatchLoopback();
+        return true;
+    }
 
     BufferPtr buffer = _readHead( connection );
     if( !buffer ) // fluke signal
     {
         connection->setRead( false );
+        _impl->incoming.rearm( connection );
         return false;
     }
 
-    ICommand command = _setupCommand( connection, buffer );
-    const bool gotCommand = _readTail( command, buffer, connection );
-    LBASSERT( gotCommand );
+    // Handle all commands fetched by the read-ahead of the connection before
+    // waiting for the next network event
+    bool gotCommand = true;
+    while( buffer && gotCommand )
+    {
+        ICommand command = _setupCommand( connection, buffer );
+        gotCommand = _readTail( command, buffer, connection );
+        LBASSERT( gotCommand );
 
-    // start next receive
-    BufferPtr nextBuffer = _impl->smallBuffers.alloc( COMMAND_ALLOCSIZE );
-    connection->recvNB( nextBuffer, COMMAND_MINSIZE );
+        // start next receive
+        BufferPtr nextBuffer = _impl->smallBuffers.alloc( COMMAND_ALLOCSIZE );
+        connection->recvNB( nextBuffer, COMMAND_MINSIZE );
 
-    if( gotCommand )
-    {
-        command.setConnection( connection );
-        dispatchCommand( command );
+        if( gotCommand )
+        {
+            _addReceiveStatistics( connection, command );
+            command.setConnection( connection );
+            _impl->objectStore->relayCommand( command );
+            dispatchCommand( command );
+        }
+        else
+            LBERROR << "Incomplete command read: " << command << std::endl;
+
+        buffer = connection->hasBufferedData() ? _readHead( connection ) : 0;
     }
-    else
-        LBERROR << "Incomplete command read: " << command << std::endl;
 
     connection->setRead( false );
-
-    _impl->incoming.interrupt();
+    _impl->incoming.rearm( connection );
     return gotCommand;
 }
 
+void LocalNode::_addReceiveStatistics( ConnectionPtr connection,
+                                       const ICommand& command )
+{
+    const int64_t size = int64_t( command.getSize( ));
+    ConnectionStatistics& statistics = connection->getStatistics();
+    ++statistics.commandsReceived;
+    statistics.bytesReceived.add( size );
+    ++Statistics::getCounter( Statistics::COMMANDS_RECEIVED );
+    Statistics::getCounter( Statistics::BYTES_RECEIVED ).add( size );
+    Statistics::addCommand( Statistics::RECEIVED, command.getType(),
+                            command.getCommand(), size );
+}
+
 BufferPtr LocalNode::_readHead( ConnectionPtr connection )
 {
+    const TraceSpan span( Trace::READ_HEAD );
     BufferPtr buffer;
     const bool gotSize = connection->recvSync( buffer, false );
 
@@ -1482,6 +1848,7 @@ ICommand LocalNode::_setupCommand( ConnectionPtr connection,
 bool LocalNode::_readTail( ICommand& command, BufferPtr buffer,
                            ConnectionPtr connection )
 {
+    const TraceSpan span( Trace::READ_TAIL );
     const uint64_t needed = command.getSize();
     if( needed <= buffer->getSize( ))
         return true;
@@ -1528,6 +1895,7 @@ bool LocalNode::_dispatchCommand( ICommand& command )
 
 bool LocalNode::dispatchCommand( ICommand& command )
 {
+    const TraceSpan span( Trace::DISPATCH );
     LBVERB << "dispatch " << command << " by " << getNodeID() << std::endl;
     LBASSERTINFO( command.isValid(), command );
 
@@ -1551,6 +1919,30 @@ bool LocalNode::dispatchCommand( ICommand& command )
     }
 }
 
+void LocalNode::_dispatchLoopback()
+{
+    while( true )
+    {
+        Buffers buffers;
+        {
+            lunchbox::ScopedFastWrite mutex( _impl->loopback );
+            if( _impl->loopback->empty( ))
+            {
+                _impl->loopbackScheduled = false;
+                return;
+            }
+            buffers.swap( _impl->loopback.data );
+        }
+
+        for( Buffers::const_iterator i = buffers.begin(); i != buffers.end();
+             ++i )
+        {
+            ICommand command( this, this, *i, false );
+            dispatchCommand( command );
+        }
+    }
+}
+
 void LocalNode::_redispatchCommands()
 {
     bool changes = true;
@@ -254,6 +254,26 @@ namespace detail { class LocalNode; class ReceiverThread; class CommandThread; }
          */
         CO_API virtual void unmapObject( Object* object );
 
+        /**
+         * Commit a set of independent master objects concurrently.
+         *
+         * The objects are committed by Global::IATTR_COMMIT_THREAD_COUNT
+         * threads, or sequentially from the calling thread if it is zero. The
+         * objects must not share any data modified during their commit. Each
+         * command sent by a commit is written atomically to the connections,
+         * so concurrent commits can share connections. Calls from within a
+         * commit executed by this method commit sequentially.
+         *
+         * @param objects the master objects to commit.
+         * @param incarnation the commit incarnation for auto obsoletion,
+         *                    CO_COMMIT_NEXT by default.
+         * @return the new versions of the objects, in the given order.
+         * @sa Object::commit()
+         * @version 1.0
+         */
+        CO_API ObjectVersions commitObjects( const Objects& objects,
+                   const uint32_t incarnation = LB_UNDEFINED_UINT32 /* NEXT */);
+
         /** Disable the instance cache of a stopped local node. @version 1.0 */
         CO_API void disableInstanceCache();
 
@@ -378,6 +398,15 @@ namespace detail { class LocalNode; class ReceiverThread; class CommandThread; }
         /** Return the command queue to the command thread. @version 1.0 */
         CO_API CommandQueue* getCommandThreadQueue();
 
+        /**
+         * Write all statistics as a JSON object.
+         *
+         * Contains the process-wide Statistics and the counters of the
+         * connection to each connected node.
+         * @version 1.0
+         */
+        CO_API void printStatistics( std::ostream& os ) const;
+
         /**
          * @return true if executed from the command handler thread, false if
          *         not.
@@ -403,6 +432,19 @@ namespace detail { class LocalNode; class ReceiverThread; class CommandThread; }
         /** Remove listening connections from this listening node.*/
         CO_API void removeListeners( const Connections& connections );
 
+        using Node::send;
+
+        /** @internal
+         * Send a command to this node.
+         *
+         * The command is queued in memory without copying it, in order with
+         * the commands written to the connection to this node.
+         */
+        CO_API OCommand send( const uint32_t cmd, const bool multicast = false);
+
+        /** @internal Queue the data of a command sent to this node. */
+        CO_API void queueLoopback( lunchbox::Bufferb& data );
+
         /** @internal
          * Flush all pending commands on this listening node.
          *
@@ -414,6 +456,20 @@ namespace detail { class LocalNode; class ReceiverThread; class CommandThread; }
         /** @internal Allocate a command buffer from the receiver thread. */
         CO_API BufferPtr allocBuffer( const uint64_t size );
 
+        /** @internal
+         * Queue a max version update of a slave for its master object.
+         *
+         * Updates are batched per master node until flushMaxVersions() sends
+         * them using one command per master node.
+         */
+        void sendMaxVersion( NodePtr master, const UUID& id,
+                             const uint32_t masterInstanceID,
+                             const uint64_t version,
+                             const uint32_t slaveInstanceID );
+
+        /** @internal Send all queued max version updates. */
+        void flushMaxVersions();
+
         /**
          * Dispatches a command to the registered command queue.
          *
@@ -462,8 +518,12 @@ namespace detail { class LocalNode; class ReceiverThread; class CommandThread; }
         CO_API bool pingIdleNodes();
 
         /**
-         * Bind this, the receiver and the command thread to the given
-         * lunchbox::Thread affinity.
+         * Bind this, the receiver, the command and the read threads to the
+         * given lunchbox::Thread affinity.
+         *
+         * Together with Global::IATTR_TCP_BUSY_POLL_US and
+         * Global::IATTR_RECV_SPIN_TIME_US, this provides a low-latency mode
+         * trading CPU time for wake-up latency.
          */
         CO_API void setAffinity( const int32_t affinity );
 
@@ -516,6 +576,7 @@ namespace detail { class LocalNode; class ReceiverThread; class CommandThread; }
         void _removeConnection( ConnectionPtr connection );
 
         NodePtr _connect( const NodeID& nodeID, NodePtr peer );
+        NodePtr _connectVia( const NodeID& nodeID, NodePtr peer );
         NodePtr _connectFromZeroconf( const NodeID& nodeID );
         uint32_t _removeListenerNB( ConnectionPtr connection );
         uint32_t _connect( NodePtr node );
@@ -526,6 +587,7 @@ namespace detail { class LocalNode; class ReceiverThread; class CommandThread; }
         void   _handleDisconnect();
         bool   _enqueueForRead();
         BufferPtr _readHead( ConnectionPtr connection );
+        void _addReceiveStatistics( ConnectionPtr, const ICommand& );
         ICommand   _setupCommand( ConnectionPtr, ConstBufferPtr );
         bool      _readTail( ICommand&, BufferPtr, ConnectionPtr );
         void   _initService();
@@ -541,6 +603,7 @@ namespace detail { class LocalNode; class ReceiverThread; class CommandThread; }
 
         bool _dispatchCommand( ICommand& command );
         void   _redispatchCommands();
+        void   _dispatchLoopback();
         CO_API virtual bool defaultDispatch( ICommand& command );
         CommandQueue* _getReceiveThreadQueue();
 
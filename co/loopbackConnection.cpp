@@ -0,0 +1,89 @@
+/* Copyright (c) 2013, Stefan Eilemann <eile@equalizergraphics.com>
+ *
+ * This file is part of Collage <https://github.com/Eyescale/Collage>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 2.1 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "loopbackConnection.h"
+
+#include "commands.h"
+#include "connectionDescription.h"
+#include "localNode.h"
+
+namespace co
+{
+
+LoopbackConnection::LoopbackConnection( LocalNode* localNode )
+        : _localNode( localNode )
+        , _size( 0 )
+{
+    LBASSERT( localNode );
+    ConnectionDescriptionPtr description = _getDescription();
+    description->type = CONNECTIONTYPE_PIPE; // process-internal
+    description->bandwidth = 1024000;
+    _setState( STATE_CONNECTED );
+}
+
+LoopbackConnection::~LoopbackConnection()
+{
+    _setState( STATE_CLOSED );
+    if( !_command.isEmpty( ))
+        LBWARN << "Deleting LoopbackConnection with a partial command"
+               << std::endl;
+}
+
+int64_t LoopbackConnection::write( const void* buffer, const uint64_t bytes )
+{
+    // Called with the send lock held. Commands sent in parts, e.g., object
+    // data, are complete before another sender can write.
+    const uint8_t* data = static_cast< const uint8_t* >( buffer );
+    uint64_t left = bytes;
+    while( left > 0 )
+    {
+        if( _command.getSize() < sizeof( uint64_t ))
+        {
+            const uint64_t nBytes = LB_MIN( left, sizeof( uint64_t ) -
+                                                  _command.getSize( ));
+            _command.append( data, nBytes );
+            data += nBytes;
+            left -= nBytes;
+            if( _command.getSize() < sizeof( uint64_t ))
+                break;
+
+            const uint64_t size =
+                reinterpret_cast< const uint64_t* >( _command.getData( ))[0];
+            _size = LB_MAX( size, uint64_t( COMMAND_MINSIZE ));
+            _command.reserve( _size );
+        }
+
+        const uint64_t nBytes = LB_MIN( left, _size - _command.getSize( ));
+        _command.append( data, nBytes );
+        data += nBytes;
+        left -= nBytes;
+
+        if( _command.getSize() == _size )
+        {
+            // strip the padding of small commands
+            _command.setSize(
+                reinterpret_cast< const uint64_t* >( _command.getData( ))[0] );
+            _localNode->queueLoopback( _command ); // swaps in a spare buffer
+            _command.setSize( 0 );
+            _size = 0;
+        }
+    }
+    return bytes;
+}
+
+}
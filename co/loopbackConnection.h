@@ -0,0 +1,65 @@
+/* Copyright (c) 2013, Stefan Eilemann <eile@equalizergraphics.com>
+ *
+ * This file is part of Collage <https://github.com/Eyescale/Collage>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 2.1 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef CO_LOOPBACK_CONNECTION_H
+#define CO_LOOPBACK_CONNECTION_H
+
+#include <co/connection.h>   // base class
+
+#include <lunchbox/buffer.h> // member
+
+namespace co
+{
+    /**
+     * The connection of a local node to itself.
+     *
+     * Commands written to it are reassembled in memory and queued with
+     * LocalNode::queueLoopback(), in the same order as the commands sent with
+     * LocalNode::send(). Nothing can be read from it.
+     */
+    class LoopbackConnection : public Connection
+    {
+    public:
+        LoopbackConnection( LocalNode* localNode );
+        virtual ~LoopbackConnection();
+
+        /** @return 0, unlike a PipeConnection it has no sibling. */
+        virtual ConnectionPtr acceptSync() { return 0; }
+
+        virtual Notifier getNotifier() const { LBDONTCALL; return 0; }
+
+    protected:
+        virtual void readNB( void*, const uint64_t ) { LBDONTCALL; }
+        virtual int64_t readSync( void*, const uint64_t, const bool )
+            { LBDONTCALL; return -1; }
+        virtual int64_t write( const void* buffer, const uint64_t bytes );
+
+    private:
+        LocalNode* const _localNode;
+
+        /** The command being written, queued once complete. */
+        lunchbox::Bufferb _command;
+
+        /** The size of the command being written, including padding. */
+        uint64_t _size;
+    };
+
+    typedef lunchbox::RefPtr< LoopbackConnection > LoopbackConnectionPtr;
+}
+
+#endif //CO_LOOPBACK_CONNECTION_H
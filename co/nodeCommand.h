@@ -69,7 +69,10 @@ namespace co
         CMD_NODE_PING,
         CMD_NODE_PING_REPLY,
         CMD_NODE_ADD_CONNECTION,
-        CMD_NODE_OBJECT_PUSH_MAP
+        CMD_NODE_OBJECT_PUSH_MAP,
+        CMD_NODE_OBJECT_RELAY,
+        CMD_NODE_OBJECT_RELAY_CONNECT,
+        CMD_NODE_OBJECT_MAX_VERSIONS
         // check that not more than CMD_NODE_CUSTOM have been defined!
     };
 }
@@ -22,6 +22,7 @@
 
 #include "buffer.h"
 #include "iCommand.h"
+#include "statistics.h"
 
 namespace co
 {
@@ -63,6 +64,14 @@ OCommand::OCommand( Dispatcher* const dispatcher, LocalNodePtr localNode,
     _init( cmd, type );
 }
 
+OCommand::OCommand( LocalNodePtr localNode, const uint32_t cmd,
+                    const uint32_t type )
+    : DataOStream()
+    , _impl( new detail::OCommand( 0, localNode ))
+{
+    _init( cmd, type );
+}
+
 OCommand::OCommand( const OCommand& rhs )
     : DataOStream( const_cast< OCommand& >( rhs ))
     , _impl( new detail::OCommand( *rhs._impl ))
@@ -115,6 +124,11 @@ OCommand::~OCommand()
         ICommand cmd( _impl->localNode, _impl->localNode, buffer, false );
         _impl->dispatcher->dispatchCommand( cmd );
     }
+    else if( _impl->localNode )
+    {
+        LBASSERT( _impl->size == 0 );
+        _impl->localNode->queueLoopback( getBuffer( ));
+    }
 
     delete _impl;
 }
@@ -122,6 +136,7 @@ OCommand::~OCommand()
 void OCommand::sendHeader( const uint64_t additionalSize )
 {
     LBASSERT( !_impl->dispatcher );
+    LBASSERT( !_impl->localNode );
     LBASSERT( !_impl->isLocked );
     LBASSERT( additionalSize > 0 );
 
@@ -167,12 +182,19 @@ void OCommand::sendData( const void* buffer, const uint64_t size,
     reinterpret_cast< uint64_t* >( bytes )[ 0 ] = _impl->size + size;
     const uint64_t sendSize = _impl->isLocked ? size : LB_MAX( size,
                                                                COMMAND_MINSIZE);
+    const uint32_t* header = reinterpret_cast< const uint32_t* >( bytes + 8 );
     const Connections& connections = getConnections();
     for( ConnectionsCIter i = connections.begin(); i != connections.end(); ++i )
     {
         ConnectionPtr connection = *i;
         if ( connection.isValid() )
+        {
             connection->send( bytes, sendSize, _impl->isLocked );
+            ++connection->getStatistics().commandsSent;
+            ++Statistics::getCounter( Statistics::COMMANDS_SENT );
+            Statistics::addCommand( Statistics::SENT, header[0], header[1],
+                                    _impl->size + size );
+        }
         else
             LBERROR << "Can't send data, node has been closed" << std::endl;
     }
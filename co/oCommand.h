@@ -61,6 +61,17 @@ public:
     CO_API OCommand( Dispatcher* const dispatcher, LocalNodePtr localNode,
                      const uint32_t cmd, const uint32_t type=COMMANDTYPE_NODE );
 
+    /** @internal
+     * Construct a command which is queued for dispatch by the receiver thread
+     * of the given local node, bypassing its connection to itself.
+     *
+     * @param localNode the local node receiving the command.
+     * @param cmd the command.
+     * @param type the command type for dispatching.
+     */
+    CO_API OCommand( LocalNodePtr localNode, const uint32_t cmd,
+                     const uint32_t type = COMMANDTYPE_NODE );
+
     /** @internal */
     CO_API OCommand( const OCommand& rhs );
 
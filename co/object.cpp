@@ -23,6 +23,8 @@
 #include "dataIStream.h"
 #include "dataOStream.h"
 #include "deltaMasterCM.h"
+#include "diffMasterCM.h"
+#include "diffSlaveCM.h"
 #include "fullMasterCM.h"
 #include "global.h"
 #include "log.h"
@@ -32,6 +34,7 @@
 #include "objectOCommand.h"
 #include "staticMasterCM.h"
 #include "staticSlaveCM.h"
+#include "trace.h"
 #include "types.h"
 #include "unbufferedMasterCM.h"
 #include "versionedSlaveCM.h"
@@ -216,6 +219,7 @@ void Object::pushMap( const uint128_t& groupID, const uint128_t& typeID,
 
 uint128_t Object::commit( const uint32_t incarnation )
 {
+    const TraceSpan span( Trace::COMMIT );
     return impl_->cm->commit( incarnation );
 }
 
@@ -268,6 +272,14 @@ void Object::setupChangeManager( const Object::ChangeType type,
                                                          masterInstanceID ));
             break;
 
+        case Object::DIFF:
+            LBASSERT( impl_->localNode );
+            if( master )
+                _setChangeManager( new DiffMasterCM( this ));
+            else
+                _setChangeManager( new DiffSlaveCM( this, masterInstanceID ));
+            break;
+
         default: LBUNIMPLEMENTED;
     }
 }
@@ -331,10 +343,17 @@ uint32_t Object::getAutoObsolete() const
     return impl_->cm->getAutoObsolete();
 }
 
+void Object::printMemoryUsage( std::ostream& os ) const
+{
+    impl_->cm->printMemoryUsage( os );
+}
+
 uint128_t Object::sync( const uint128_t& version )
 {
     if( version == VERSION_NONE )
         return getVersion();
+
+    const TraceSpan span( Trace::SYNC );
     return impl_->cm->sync( version );
 }
 
@@ -385,7 +404,8 @@ std::ostream& operator << ( std::ostream& os,const Object::ChangeType& type )
                    type == Object::STATIC ? "static" :
                    type == Object::INSTANCE ? "instance" :
                    type == Object::DELTA ? "delta" :
-                   type == Object::UNBUFFERED ? "unbuffered" : "ERROR" );
+                   type == Object::UNBUFFERED ? "unbuffered" :
+                   type == Object::DIFF ? "diff" : "ERROR" );
 }
 
 }
@@ -52,7 +52,8 @@ public:
         STATIC,            //!< non-versioned, unbuffered, static object.
         INSTANCE,          //!< use only instance data
         DELTA,             //!< use pack/unpack delta
-        UNBUFFERED         //!< versioned, but don't retain versions
+        UNBUFFERED,        //!< versioned, but don't retain versions
+        DIFF               //!< use instance data, send binary diffs of it
     };
 
     /** Destruct the distributed object. @version 1.0 */
@@ -212,7 +213,7 @@ public:
      * Automatically obsolete old versions.
      *
      * The versions for the last count incarnations are retained for the
-     * buffered object types INSTANCE and DELTA.
+     * buffered object types INSTANCE, DELTA and DIFF.
      *
      * @param count the number of incarnations to retain.
      * @version 1.0
@@ -222,6 +223,17 @@ public:
     /** @return get the number of retained incarnations. @version 1.0 */
     CO_API uint32_t getAutoObsolete() const;
 
+    /**
+     * Print the memory used to retain versions of a buffered master object.
+     *
+     * Reports the number of retained versions, the size of their data and
+     * the memory used after sharing identical data between the versions.
+     *
+     * @param os the output stream.
+     * @version 1.0
+     */
+    CO_API void printMemoryUsage( std::ostream& os ) const;
+
     /**
      * Sync to a given version.
      *
@@ -27,14 +27,10 @@
 #include "objectDataICommand.h"
 #include "objectInstanceDataOStream.h"
 #include "objectDataOCommand.h"
+#include "statistics.h"
 
 co::ObjectCMPtr co::ObjectCM::ZERO = new co::NullCM;
 
-#ifdef EQ_INSTRUMENT_MULTICAST
-lunchbox::a_int32_t co::ObjectCM::_hit( 0 );
-lunchbox::a_int32_t co::ObjectCM::_miss( 0 );
-#endif
-
 namespace co
 {
 ObjectCM::ObjectCM( Object* object )
@@ -122,17 +118,13 @@ void ObjectCM::_initSlave( MasterCMCommand command,
         command.getMinCachedVersion() <= replyVersion &&
         command.getMaxCachedVersion() >= replyVersion )
     {
-#ifdef EQ_INSTRUMENT_MULTICAST
-        ++_hit;
-#endif
+        ++Statistics::getCounter( Statistics::MAP_CACHE_HIT );
         _sendMapSuccess( command, false );
         _sendMapReply( command, replyVersion, true, replyUseCache, false );
         return;
     }
 
-#ifdef EQ_INSTRUMENT_MULTICAST
-    ++_miss;
-#endif
+    ++Statistics::getCounter( Statistics::MAP_CACHE_MISS );
     replyUseCache = false;
 
     _sendMapSuccess( command, true );
@@ -26,11 +26,6 @@
 #include <co/objectVersion.h> // VERSION_FOO values
 #include <co/types.h>
 
-//#define EQ_INSTRUMENT_MULTICAST
-#ifdef EQ_INSTRUMENT_MULTICAST
-#  include <lunchbox/atomic.h>
-#endif
-
 namespace co
 {
 class ObjectCM;
@@ -103,6 +98,10 @@ public:
     /** @return if this object keeps instance data buffers. */
     virtual bool isBuffered() const{ return false; }
 
+    /** @sa Object::printMemoryUsage() */
+    virtual void printMemoryUsage( std::ostream& os ) const
+        { os << "no retained versions"; }
+
     /** @return if this instance is the master version. */
     virtual bool isMaster() const = 0;
 
@@ -138,6 +137,16 @@ public:
     /** @return the vector of current slave nodes. */
     virtual const Nodes getSlaveNodes() const { return Nodes(); }
 
+    /**
+     * Update the maximum version a slave allows the master to commit.
+     *
+     * @param node the slave node.
+     * @param instanceID the slave's instance identifier.
+     * @param version the new maximum version.
+     */
+    virtual void setSlaveMaxVersion( NodePtr node, const uint32_t instanceID,
+                                     const uint64_t version ) {}
+
     /** Apply the initial data after mapping. */
     virtual void applyMapData( const uint128_t& version )
         { LBUNIMPLEMENTED; }
@@ -167,11 +176,6 @@ protected:
     /** The managed object. */
     Object* _object;
 
-#ifdef EQ_INSTRUMENT_MULTICAST
-    static lunchbox::a_int32_t _hit;
-    static lunchbox::a_int32_t _miss;
-#endif
-
     void _addSlave( MasterCMCommand command, const uint128_t& version );
     virtual void _initSlave( MasterCMCommand command,
                              const uint128_t& replyVersion,
@@ -21,6 +21,7 @@
 
 #include "objectDeltaDataOStream.h"
 
+#include "node.h"
 #include "object.h"
 #include "objectICommand.h"
 #include "objectCM.h"
@@ -30,16 +31,28 @@ namespace co
 {
 ObjectDeltaDataOStream::ObjectDeltaDataOStream( const ObjectCM* cm )
         : ObjectDataOStream( cm )
+        , _instanceID( EQ_INSTANCE_ALL )
 {}
 
 ObjectDeltaDataOStream::~ObjectDeltaDataOStream()
 {}
 
+void ObjectDeltaDataOStream::sendMapData( NodePtr node,
+                                          const uint32_t instanceID )
+{
+    // Object commands are not filtered by node, never multicast them
+    _instanceID = instanceID;
+    _setupConnection( node, false /* useMulticast */ );
+    _resend();
+    _clearConnections();
+    _instanceID = EQ_INSTANCE_ALL;
+}
+
 void ObjectDeltaDataOStream::sendData( const void* buffer, const uint64_t size,
                                        const bool last )
 {
     ObjectDataOStream::send( CMD_OBJECT_DELTA, COMMANDTYPE_OBJECT,
-                             EQ_INSTANCE_ALL, size, last );
+                             _instanceID, size, last );
 }
 
 }
@@ -32,9 +32,15 @@ namespace co
         ObjectDeltaDataOStream( const ObjectCM* cm );
         virtual ~ObjectDeltaDataOStream();
 
+        /** Send a saved delta as mapping data to one slave instance. */
+        void sendMapData( NodePtr node, const uint32_t instanceID );
+
     protected:
         virtual void sendData( const void* buffer, const uint64_t size,
                                const bool last );
+
+    private:
+        uint32_t _instanceID;
     };
 }
 #endif //CO_OBJECTDELTADATAOSTREAM_H
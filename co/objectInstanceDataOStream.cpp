@@ -35,14 +35,21 @@ ObjectInstanceDataOStream::ObjectInstanceDataOStream( const ObjectCM* cm )
         : ObjectDataOStream( cm )
         , _instanceID( EQ_INSTANCE_ALL )
         , _command( 0 )
+        , _store( 0 )
 {}
 
 ObjectInstanceDataOStream::~ObjectInstanceDataOStream()
-{}
+{
+    if( _store )
+        _store->release( _blocks );
+}
 
 void ObjectInstanceDataOStream::reset()
 {
     ObjectDataOStream::reset();
+    if( _store )
+        _store->release( _blocks );
+    _store = 0;
     _nodeID = 0;
     _instanceID = EQ_INSTANCE_NONE;
     _command = 0;
@@ -76,7 +83,7 @@ void ObjectInstanceDataOStream::push( const Nodes& receivers,
     _instanceID = EQ_INSTANCE_NONE;
     _setupConnections( receivers );
 
-    _resend();
+    _resendStored();
     OCommand( getConnections(), CMD_NODE_OBJECT_PUSH )
         << objectID << groupID << typeID;
 
@@ -96,7 +103,7 @@ void ObjectInstanceDataOStream::pushMap( const Nodes& receivers,
     _instanceID = EQ_INSTANCE_NONE;
     _setupConnections( receivers );
 
-    _resend();
+    _resendStored();
     OCommand( getConnections(), CMD_NODE_OBJECT_PUSH_MAP )
         << objectID << groupID << typeID << version << instanceID << changeType;
 
@@ -109,21 +116,65 @@ void ObjectInstanceDataOStream::sendInstanceData( const Nodes& receivers )
     _nodeID = 0;
     _instanceID = EQ_INSTANCE_NONE;
     _setupConnections( receivers );
-    _resend();
+    _resendStored();
     _clearConnections();
 }
 
 void ObjectInstanceDataOStream::sendMapData( NodePtr node,
-                                             const uint32_t instanceID )
+                                             const uint32_t instanceID,
+                                             const bool useMulticast )
 {
     _command = CMD_NODE_OBJECT_INSTANCE_MAP;
     _nodeID = node->getNodeID();
     _instanceID = instanceID;
-    _setupConnection( node, true /* useMulticast */ );
-    _resend();
+    _setupConnection( node, useMulticast );
+    _resendStored();
+    _clearConnections();
+}
+
+void ObjectInstanceDataOStream::sendCommit( const Nodes& receivers )
+{
+    if( receivers.empty( ))
+        return;
+
+    _command = CMD_NODE_OBJECT_INSTANCE_COMMIT;
+    _nodeID = 0;
+    _instanceID = EQ_INSTANCE_NONE;
+    _setupConnections( receivers );
+    _resendStored();
     _clearConnections();
 }
 
+void ObjectInstanceDataOStream::store( BlockStore& store )
+{
+    LBASSERT( !_store || _store == &store );
+    lunchbox::Bufferb& buffer = getBuffer();
+    if( _store || buffer.getSize() != getDataSize( )) // stored or compressed
+        return;
+
+    _store = &store;
+    _store->add( buffer.getData(), buffer.getSize(), _blocks );
+}
+
+void ObjectInstanceDataOStream::compact( const bool keepCompressed )
+{
+    if( _store )
+        _releaseSaved( keepCompressed );
+}
+
+void ObjectInstanceDataOStream::_resendStored()
+{
+    lunchbox::Bufferb& buffer = getBuffer();
+    const bool restore = _store && buffer.isEmpty() && !_hasCompressedData();
+    if( restore )
+        BlockStore::copy( _blocks, buffer );
+
+    _resend();
+
+    if( restore )
+        _releaseSaved( true /* keepCompressed */ );
+}
+
 void ObjectInstanceDataOStream::enableMap( const uint128_t& version,
                                            NodePtr node,
                                            const uint32_t instanceID )
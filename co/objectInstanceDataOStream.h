@@ -22,6 +22,7 @@
 #define CO_OBJECTINSTANCEDATAOSTREAM_H
 
 #include "objectDataOStream.h"   // base class
+#include "blockStore.h"          // member
 
 namespace co
 {
@@ -58,8 +59,30 @@ namespace co
         /** Send-on-register instance data to all receivers. */
         void sendInstanceData( const Nodes& receivers );
 
-        /** Send mapping data to the node, using multicast if available. */
-        void sendMapData( NodePtr node, const uint32_t instanceID );
+        /** Send mapping data to the node, using multicast if requested. */
+        void sendMapData( NodePtr node, const uint32_t instanceID,
+                          const bool useMulticast );
+
+        /** Send the saved data of a commit to the receivers. */
+        void sendCommit( const Nodes& receivers );
+
+        /**
+         * Share the saved data with equal data of other versions.
+         *
+         * The saved data is kept in the given store until reset, and is
+         * restored from it when the data has to be resent. Data only held
+         * compressed after streaming is not stored.
+         */
+        void store( BlockStore& store );
+
+        /** Release the saved data of a stored stream. */
+        void compact( const bool keepCompressed );
+
+        /** @return the saved, uncompressed data of the last commit. */
+        const lunchbox::Bufferb& getSavedData() { return getBuffer(); }
+
+        /** @return true if the saved data is held by a block store. */
+        bool isStored() const { return _store != 0; }
 
     protected:
         virtual void sendData( const void* buffer, const uint64_t size,
@@ -69,6 +92,11 @@ namespace co
         NodeID _nodeID;
         uint32_t _instanceID;
         uint32_t _command;
+
+        BlockStore* _store;
+        BlockStore::Blocks _blocks;
+
+        void _resendStored();
     };
 }
 #endif //CO_OBJECTINSTANCEDATAOSTREAM_H
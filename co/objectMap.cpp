@@ -22,9 +22,13 @@
 
 #include "dataIStream.h"
 #include "dataOStream.h"
+#include "localNode.h"
 #include "objectFactory.h"
 
 #include <lunchbox/scopedMutex.h>
+#include <lunchbox/spinLock.h>
+
+#include <algorithm>
 
 namespace co
 {
@@ -32,14 +36,18 @@ namespace
 {
 struct Entry //!< One object map item
 {
-    Entry() : instance( 0 ), type( OBJECTTYPE_NONE ), own( false ) {}
+    Entry() : instance( 0 ), type( OBJECTTYPE_NONE ), own( false )
+            , master( false ), index( LB_UNDEFINED_UINT32 ) {}
     Entry( const uint128_t& v, Object* i, const uint32_t t )
-        : version( v ), instance( i ), type( t ), own( false ) {}
+        : version( v ), instance( i ), type( t ), own( false ), master( false )
+        , index( LB_UNDEFINED_UINT32 ) {}
 
     uint128_t version;  //!< The current version of the object
     Object* instance;   //!< The object instance, if attached
     uint32_t type;      //!< The object class id
     bool own;           //!< The object is created by us, delete it
+    bool master;        //!< The object is registered through this map
+    uint32_t index;     //!< Position in the untracked masters, if any
 };
 
 typedef stde::hash_map< uint128_t, Entry > Map;
@@ -48,6 +56,15 @@ typedef Map::const_iterator MapCIter;
 typedef std::vector< uint128_t > IDVector;
 typedef IDVector::iterator IDVectorIter;
 typedef IDVector::const_iterator IDVectorCIter;
+
+/** Number of independently locked parts of the map. */
+static const size_t _nShards = 16;
+
+struct Shard //!< One independently locked part of the map
+{
+    mutable lunchbox::SpinLock lock;
+    Map map;
+};
 }
 
 namespace detail
@@ -60,24 +77,39 @@ public:
 
     ~ObjectMap()
     {
-        LBASSERTINFO( masters.empty(), "Object map not cleared" );
-        LBASSERTINFO( map.empty(), "Object map not cleared" );
+        LBASSERTINFO( untracked.empty(), "Object map not cleared" );
+        for( size_t i = 0; i < _nShards; ++i )
+            LBASSERTINFO( shards[i].map.empty(), "Object map not cleared" );
     }
 
+    Shard& getShard( const uint128_t& id )
+        { return shards[ ( id.high() ^ id.low( )) % _nShards ]; }
+
     void clear()
     {
         lunchbox::ScopedFastWrite mutex( lock );
-        for( ObjectsCIter i = masters.begin(); i != masters.end(); ++i )
+        for( size_t i = 0; i < _nShards; ++i )
         {
-            co::Object* object = *i;
-            map.erase( object->getID( ));
-            handler.deregisterObject( object );
+            Shard& shard = shards[i];
+            lunchbox::ScopedFastWrite shardMutex( shard.lock );
+            for( MapIter j = shard.map.begin(); j != shard.map.end(); ++j )
+            {
+                Entry& entry = j->second;
+                if( entry.master )
+                {
+                    if( entry.index == LB_UNDEFINED_UINT32 )
+                        untrack( entry.instance );
+                    handler.deregisterObject( entry.instance );
+                }
+                else
+                    _removeObject( entry );
+            }
+            shard.map.clear();
         }
-        masters.clear();
+        untracked.clear();
 
-        for( MapIter i = map.begin(); i != map.end(); ++i )
-            _removeObject( i->second );
-        map.clear();
+        lunchbox::ScopedFastWrite dirtyMutex( dirtyLock );
+        dirty.clear();
     }
 
     void _removeObject( Entry& entry )
@@ -91,13 +123,48 @@ public:
         entry.instance = 0;
     }
 
+    /** Stop change notifications of a tracked master. */
+    void untrack( Object* object )
+    {
+        Serializable* serializable = dynamic_cast< Serializable* >( object );
+        LBASSERT( serializable );
+        serializable->_setObjectMap( 0 );
+
+        lunchbox::ScopedFastWrite mutex( dirtyLock );
+        dirty.erase( std::remove( dirty.begin(), dirty.end(), object ),
+                     dirty.end( ));
+    }
+
+    /** Remove a master without change tracking in O(1), needs lock. */
+    void removeUntracked( Entry& entry )
+    {
+        LBASSERT( entry.index < untracked.size( ));
+        Object* last = untracked.back();
+        if( last != entry.instance )
+        {
+            Shard& shard = getShard( last->getID( ));
+            lunchbox::ScopedFastWrite mutex( shard.lock );
+            shard.map[ last->getID() ].index = entry.index;
+            untracked[ entry.index ] = last;
+        }
+        untracked.pop_back();
+        entry.index = LB_UNDEFINED_UINT32;
+    }
+
     ObjectHandler& handler;
     ObjectFactory& factory; //!< The 'parent' user
 
+    /** Protects the masters and the changes since the last commit. */
     mutable lunchbox::SpinLock lock;
 
-    Map map; //!< the actual map
-    Objects masters; //!< Master objects registered with this instance
+    Shard shards[ _nShards ]; //!< the actual map
+
+    /** Masters without dirty tracking, checked for isDirty() on commit. */
+    Objects untracked;
+
+    /** Tracked masters which became dirty since the last commit. */
+    mutable lunchbox::SpinLock dirtyLock;
+    Objects dirty;
 
     /** Added master objects since the last commit. */
     IDVector added;
@@ -134,25 +201,72 @@ bool ObjectMap::isDirty() const
     if( Serializable::isDirty( ))
         return true;
 
+    {
+        lunchbox::ScopedFastRead mutex( _impl->dirtyLock );
+        if( !_impl->dirty.empty( ))
+            return true;
+    }
+
     lunchbox::ScopedFastRead mutex( _impl->lock );
-    for( ObjectsCIter i =_impl->masters.begin(); i !=_impl->masters.end(); ++i )
+    for( ObjectsCIter i = _impl->untracked.begin();
+         i != _impl->untracked.end(); ++i )
+    {
         if( (*i)->isDirty( ))
             return true;
+    }
     return false;
 }
 
+void ObjectMap::_notifyDirty( Object* object )
+{
+    lunchbox::ScopedFastWrite mutex( _impl->dirtyLock );
+    _impl->dirty.push_back( object );
+
+    // changes the serialized master versions on the next commit
+    setDirty( DIRTY_CHANGED );
+}
+
 void ObjectMap::_commitMasters( const uint32_t incarnation )
 {
-    lunchbox::ScopedFastWrite mutex( _impl->lock );
+    Objects objects;
+    {
+        lunchbox::ScopedFastWrite mutex( _impl->lock );
+        {
+            lunchbox::ScopedFastWrite dirtyMutex( _impl->dirtyLock );
+            objects.swap( _impl->dirty );
+        }
+        objects.insert( objects.end(), _impl->untracked.begin(),
+                        _impl->untracked.end( ));
+    }
 
-    for( ObjectsCIter i =_impl->masters.begin(); i !=_impl->masters.end(); ++i )
+    Objects dirty;
+    dirty.reserve( objects.size( ));
+    for( ObjectsCIter i = objects.begin(); i != objects.end(); ++i )
     {
         Object* object = *i;
-        if( !object->isDirty() || object->getChangeType() == Object::STATIC )
+        if( object->isDirty() && object->getChangeType() != Object::STATIC )
+            dirty.push_back( object );
+    }
+    // objects made dirty again after unsetDirty() may be listed twice
+    std::sort( dirty.begin(), dirty.end( ));
+    dirty.erase( std::unique( dirty.begin(), dirty.end( )), dirty.end( ));
+
+    // the map is not locked while the masters commit, which may take long
+    LBASSERT( getLocalNode( ));
+    const ObjectVersions versions =
+        getLocalNode()->commitObjects( dirty, incarnation );
+
+    lunchbox::ScopedFastWrite mutex( _impl->lock );
+    for( ObjectVersionsCIter i = versions.begin(); i != versions.end(); ++i )
+    {
+        const ObjectVersion& ov = *i;
+        Shard& shard = _impl->getShard( ov.identifier );
+        lunchbox::ScopedFastWrite shardMutex( shard.lock );
+        const MapIter j = shard.map.find( ov.identifier );
+        if( j == shard.map.end( )) // deregistered meanwhile
             continue;
 
-        const ObjectVersion ov( object->getID(), object->commit( incarnation ));
-        Entry& entry = _impl->map[ ov.identifier ];
+        Entry& entry = j->second;
         if( entry.version == ov.version )
             continue;
 
@@ -161,27 +275,36 @@ void ObjectMap::_commitMasters( const uint32_t incarnation )
     }
     if( !_impl->changed.empty( ))
         setDirty( DIRTY_CHANGED );
+    else // marked by _notifyDirty(), but no master has a new version
+        unsetDirty( DIRTY_CHANGED );
 }
 
 void ObjectMap::serialize( DataOStream& os, const uint64_t dirtyBits )
 {
     Serializable::serialize( os, dirtyBits );
-    lunchbox::ScopedFastWrite mutex( _impl->lock );
     if( dirtyBits == DIRTY_ALL )
     {
-        for( MapCIter i = _impl->map.begin(); i != _impl->map.end(); ++i )
-            os << i->first << i->second.version << i->second.type;
+        for( size_t i = 0; i < _nShards; ++i )
+        {
+            const Shard& shard = _impl->shards[i];
+            lunchbox::ScopedFastRead mutex( shard.lock );
+            for( MapCIter j = shard.map.begin(); j != shard.map.end(); ++j )
+                os << j->first << j->second.version << j->second.type;
+        }
         os << ObjectVersion();
         return;
     }
 
+    lunchbox::ScopedFastRead mutex( _impl->lock );
     if( dirtyBits & DIRTY_ADDED )
     {
         os << _impl->added;
         for( IDVectorCIter i = _impl->added.begin();
              i != _impl->added.end(); ++i )
         {
-            const Entry& entry = _impl->map[ *i ];
+            Shard& shard = _impl->getShard( *i );
+            lunchbox::ScopedFastRead shardMutex( shard.lock );
+            const Entry& entry = shard.map[ *i ];
             os << entry.version << entry.type;
         }
     }
@@ -194,17 +317,16 @@ void ObjectMap::serialize( DataOStream& os, const uint64_t dirtyBits )
 void ObjectMap::deserialize( DataIStream& is, const uint64_t dirtyBits )
 {
     Serializable::deserialize( is, dirtyBits );
-    lunchbox::ScopedFastWrite mutex( _impl->lock );
     if( dirtyBits == DIRTY_ALL )
     {
-        LBASSERT( _impl->map.empty( ));
-
         ObjectVersion ov;
         is >> ov;
         while( ov != ObjectVersion( ))
         {
-            LBASSERT( _impl->map.find( ov.identifier ) == _impl->map.end( ));
-            Entry& entry = _impl->map[ ov.identifier ];
+            Shard& shard = _impl->getShard( ov.identifier );
+            lunchbox::ScopedFastWrite mutex( shard.lock );
+            LBASSERT( shard.map.find( ov.identifier ) == shard.map.end( ));
+            Entry& entry = shard.map[ ov.identifier ];
             entry.version = ov.version;
             is >> entry.type >> ov;
         }
@@ -218,8 +340,10 @@ void ObjectMap::deserialize( DataIStream& is, const uint64_t dirtyBits )
 
         for( IDVectorCIter i = added.begin(); i != added.end(); ++i )
         {
-            LBASSERT( _impl->map.find( *i ) == _impl->map.end( ));
-            Entry& entry = _impl->map[ *i ];
+            Shard& shard = _impl->getShard( *i );
+            lunchbox::ScopedFastWrite mutex( shard.lock );
+            LBASSERT( shard.map.find( *i ) == shard.map.end( ));
+            Entry& entry = shard.map[ *i ];
             is >> entry.version >> entry.type;
         }
     }
@@ -230,10 +354,12 @@ void ObjectMap::deserialize( DataIStream& is, const uint64_t dirtyBits )
 
         for( IDVectorCIter i = removed.begin(); i != removed.end(); ++i )
         {
-            MapIter it = _impl->map.find( *i );
-            LBASSERT( it != _impl->map.end( ));
+            Shard& shard = _impl->getShard( *i );
+            lunchbox::ScopedFastWrite mutex( shard.lock );
+            MapIter it = shard.map.find( *i );
+            LBASSERT( it != shard.map.end( ));
             _impl->_removeObject( it->second );
-            _impl->map.erase( it );
+            shard.map.erase( it );
         }
     }
     if( dirtyBits & DIRTY_CHANGED )
@@ -244,9 +370,11 @@ void ObjectMap::deserialize( DataIStream& is, const uint64_t dirtyBits )
         for( ObjectVersionsCIter i = changed.begin(); i!=changed.end(); ++i)
         {
             const ObjectVersion& ov = *i;
-            LBASSERT( _impl->map.find( ov.identifier ) != _impl->map.end( ));
+            Shard& shard = _impl->getShard( ov.identifier );
+            lunchbox::ScopedFastWrite mutex( shard.lock );
+            LBASSERT( shard.map.find( ov.identifier ) != shard.map.end( ));
 
-            Entry& entry = _impl->map[ ov.identifier ];
+            Entry& entry = shard.map[ ov.identifier ];
             entry.version = ov.version;
             LBASSERT( !entry.instance || entry.instance->isAttached( ));
 
@@ -270,14 +398,31 @@ bool ObjectMap::register_( Object* object, const uint32_t type )
         return false;
 
     lunchbox::ScopedFastWrite mutex( _impl->lock );
-    MapIter it = _impl->map.find( object->getID( ));
-    if( it != _impl->map.end( ))
-        return false;
+    Shard& shard = _impl->getShard( object->getID( ));
+    {
+        lunchbox::ScopedFastWrite shardMutex( shard.lock );
+        MapIter it = shard.map.find( object->getID( ));
+        if( it != shard.map.end( ))
+            return false;
 
-    _impl->handler.registerObject( object );
-    const Entry entry( object->getVersion(), object, type );
-    _impl->map[ object->getID() ] = entry;
-    _impl->masters.push_back( object );
+        _impl->handler.registerObject( object );
+        Entry entry( object->getVersion(), object, type );
+        entry.master = true;
+
+        Serializable* serializable = dynamic_cast< Serializable* >( object );
+        if( serializable && serializable->_hasDirtyTracking( ))
+        {
+            serializable->_setObjectMap( this );
+            if( serializable->isDirty( ))
+                _notifyDirty( object );
+        }
+        else
+        {
+            entry.index = uint32_t( _impl->untracked.size( ));
+            _impl->untracked.push_back( object );
+        }
+        shard.map[ object->getID() ] = entry;
+    }
     _impl->added.push_back( object->getID( ));
     setDirty( DIRTY_ADDED );
     return true;
@@ -290,15 +435,25 @@ bool ObjectMap::deregister( Object* object )
         return false;
 
     lunchbox::ScopedFastWrite mutex( _impl->lock );
-    MapIter mapIt = _impl->map.find( object->getID( ));
-    ObjectsIter masterIt = std::find( _impl->masters.begin(),
-                                      _impl->masters.end(), object );
-    if( mapIt == _impl->map.end() || masterIt == _impl->masters.end( ))
-        return false;
+    Entry entry;
+    {
+        Shard& shard = _impl->getShard( object->getID( ));
+        lunchbox::ScopedFastWrite shardMutex( shard.lock );
+        MapIter mapIt = shard.map.find( object->getID( ));
+        if( mapIt == shard.map.end() || !mapIt->second.master ||
+            mapIt->second.instance != object )
+        {
+            return false;
+        }
+        entry = mapIt->second;
+        shard.map.erase( mapIt );
+    }
 
     _impl->handler.deregisterObject( object );
-    _impl->map.erase( mapIt );
-    _impl->masters.erase( masterIt );
+    if( entry.index == LB_UNDEFINED_UINT32 )
+        _impl->untrack( object );
+    else
+        _impl->removeUntracked( entry );
     _impl->removed.push_back( object->getID( ));
     setDirty( DIRTY_REMOVED );
     return true;
@@ -309,10 +464,22 @@ Object* ObjectMap::map( const uint128_t& identifier, Object* instance )
     if( identifier == 0 )
         return 0;
 
-    lunchbox::ScopedFastWrite mutex( _impl->lock );
-    MapIter i = _impl->map.find( identifier );
-    LBASSERT( i != _impl->map.end( ));
-    if( i == _impl->map.end( ))
+    Shard& shard = _impl->getShard( identifier );
+    {
+        // fast path for mapped objects, concurrent to other readers
+        lunchbox::ScopedFastRead mutex( shard.lock );
+        MapCIter i = shard.map.find( identifier );
+        if( i != shard.map.end() && i->second.instance &&
+            ( !instance || i->second.instance == instance ))
+        {
+            return i->second.instance;
+        }
+    }
+
+    lunchbox::ScopedFastWrite mutex( shard.lock );
+    MapIter i = shard.map.find( identifier );
+    LBASSERT( i != shard.map.end( ));
+    if( i == shard.map.end( ))
     {
         LBWARN << "Object mapping failed, no master registered" << std::endl;
         return 0;
@@ -359,9 +526,10 @@ bool ObjectMap::unmap( Object* object )
     if( !object )
         return false;
 
-    lunchbox::ScopedFastWrite mutex( _impl->lock );
-    MapIter it = _impl->map.find( object->getID( ));
-    if( it == _impl->map.end( ))
+    Shard& shard = _impl->getShard( object->getID( ));
+    lunchbox::ScopedFastWrite mutex( shard.lock );
+    MapIter it = shard.map.find( object->getID( ));
+    if( it == shard.map.end( ))
         return false;
 
     _impl->_removeObject( it->second );
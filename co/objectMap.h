@@ -63,6 +63,11 @@ public:
      * Upon registering using the map's object handler, this object will be
      * remembered for serialization on the next commit of this object map.
      *
+     * Serializable masters which called Serializable::enableDirtyTracking()
+     * are only committed by commit() after they have been marked dirty using
+     * Serializable::setDirty(). All other masters are checked for isDirty()
+     * on each commit.
+     *
      * @param object the new object to add and register
      * @param type unique object type to create object via slave factory
      * @return false on failed ObjectHandler::registerObject, true otherwise
@@ -117,7 +122,13 @@ public:
     /** Deregister or unmap all registered and mapped objects. @version 1.0 */
     CO_API void clear();
 
-    /** Commit all registered objects. @version 1.0 */
+    /**
+     * Commit all registered objects.
+     *
+     * The changed master objects are committed concurrently if
+     * Global::IATTR_COMMIT_THREAD_COUNT is set, see LocalNode::commitObjects().
+     * @version 1.0
+     */
     CO_API virtual uint128_t commit( const uint32_t incarnation =
                                      CO_COMMIT_NEXT );
 
@@ -144,9 +155,13 @@ protected:
 
 private:
     detail::ObjectMap* const _impl;
+    friend class Serializable;
 
     /** @internal Commit and note new master versions. */
     void _commitMasters( const uint32_t incarnation );
+
+    /** @internal A registered Serializable master became dirty. */
+    void _notifyDirty( Object* object );
 };
 }
 #endif // CO_OBJECTMAP_H
@@ -22,6 +22,7 @@
 #include "objectStore.h"
 
 #include "barrier.h"
+#include "buffer.h"
 #include "connection.h"
 #include "connectionDescription.h"
 #include "global.h"
@@ -34,6 +35,8 @@
 #include "objectDataIStream.h"
 #include "objectDataICommand.h"
 #include "objectICommand.h"
+#include "queueMaster.h"
+#include "relayTree.h"
 
 #include <lunchbox/scopedMutex.h>
 
@@ -95,6 +98,12 @@ ObjectStore::ObjectStore( LocalNode* localNode )
         CmdFunc( this, &ObjectStore::_cmdObjectPush ), queue );
     localNode->_registerCommand( CMD_NODE_OBJECT_PUSH_MAP,
         CmdFunc( this, &ObjectStore::_cmdObjectPushMap ), queue );
+    localNode->_registerCommand( CMD_NODE_OBJECT_RELAY,
+        CmdFunc( this, &ObjectStore::_cmdRelay ), 0 );
+    localNode->_registerCommand( CMD_NODE_OBJECT_RELAY_CONNECT,
+        CmdFunc( this, &ObjectStore::_cmdRelayConnect ), queue );
+    localNode->_registerCommand( CMD_NODE_OBJECT_MAX_VERSIONS,
+        CmdFunc( this, &ObjectStore::_cmdMaxVersions ), 0 );
 }
 
 ObjectStore::~ObjectStore()
@@ -137,6 +146,8 @@ void ObjectStore::clear( )
     LBASSERT( !_instanceCache || _instanceCache->isEmpty( ));
 
     _objects->clear();
+    _relays->clear();
+    _maxVersions->clear();
     _sendQueue.clear();
 }
 
@@ -673,6 +684,62 @@ void ObjectStore::removeNode( NodePtr node )
     _localNode->waitRequest( requestID );
 }
 
+void ObjectStore::sendMaxVersion( NodePtr master, const UUID& id,
+                                  const uint32_t masterInstanceID,
+                                  const uint64_t version,
+                                  const uint32_t slaveInstanceID )
+{
+    MaxVersion data;
+    data.id = id;
+    data.masterInstanceID = masterInstanceID;
+    data.slaveInstanceID = slaveInstanceID;
+    data.version = version;
+
+    lunchbox::ScopedFastWrite mutex( _maxVersions );
+    MaxVersionBatch& batch = _maxVersions.data[ master->getNodeID() ];
+    batch.first = master;
+
+    // acks of later versions of the same slave replace the queued one
+    MaxVersions& versions = batch.second;
+    MaxVersions::iterator i = versions.begin();
+    for( ; i != versions.end(); ++i )
+        if( i->id == id && i->slaveInstanceID == slaveInstanceID )
+            break;
+    if( i == versions.end( ))
+        versions.push_back( data );
+    else
+        i->version = std::max( i->version, version );
+}
+
+void ObjectStore::flushMaxVersions()
+{
+    MaxVersionHash maxVersions;
+    {
+        lunchbox::ScopedFastWrite mutex( _maxVersions );
+        if( _maxVersions->empty( ))
+            return;
+        maxVersions.swap( _maxVersions.data );
+    }
+
+    for( MaxVersionHash::const_iterator i = maxVersions.begin();
+         i != maxVersions.end(); ++i )
+    {
+        NodePtr node = i->second.first;
+        const MaxVersions& updates = i->second.second;
+        if( !node->isReachable( ))
+            continue;
+
+        OCommand command = node->send( CMD_NODE_OBJECT_MAX_VERSIONS );
+        command << uint64_t( updates.size( ));
+        for( MaxVersions::const_iterator j = updates.begin();
+             j != updates.end(); ++j )
+        {
+            command << j->id << j->masterInstanceID << j->version
+                    << j->slaveInstanceID;
+        }
+    }
+}
+
 //===========================================================================
 // ICommand handling
 //===========================================================================
@@ -720,6 +787,46 @@ bool ObjectStore::dispatchObjectCommand( ICommand& cmd )
     return true;
 }
 
+void ObjectStore::relayCommand( ICommand& command )
+{
+    const uint32_t type = command.getType();
+    const uint32_t cmd = command.getCommand();
+    if( command.isSwapping() ||
+        (( type != COMMANDTYPE_NODE || cmd != CMD_NODE_OBJECT_INSTANCE_COMMIT )&&
+         ( type != COMMANDTYPE_OBJECT || cmd != CMD_OBJECT_DELTA )))
+    {
+        return;
+    }
+
+    Nodes children;
+    {
+        lunchbox::ScopedFastWrite mutex( _relays );
+        if( _relays->empty( ))
+            return;
+
+        ObjectDataICommand data( command );
+        RelayHash::iterator i = _relays->find( data.getObjectID( ));
+        if( i == _relays->end() || i->second.version != data.getVersion( ))
+            return;
+
+        if( data.isLast( ))
+        {
+            children.swap( i->second.children );
+            _relays->erase( i );
+        }
+        else
+            children = i->second.children;
+    }
+
+    ConstBufferPtr buffer = command.getBuffer();
+    for( NodesCIter i = children.begin(); i != children.end(); ++i )
+    {
+        ConnectionPtr connection = (*i)->getConnection();
+        if( connection )
+            connection->send( buffer->getData(), buffer->getSize( ));
+    }
+}
+
 bool ObjectStore::_cmdFindMasterNodeID( ICommand& command )
 {
     LB_TS_THREAD( _commandThread );
@@ -1122,6 +1229,98 @@ bool ObjectStore::_cmdInstance( ICommand& inCommand )
     }
 }
 
+bool ObjectStore::_cmdRelay( ICommand& command )
+{
+    const UUID& id = command.get< UUID >();
+    const uint128_t& version = command.get< uint128_t >();
+    const uint32_t fanout = command.get< uint32_t >();
+    const NodeIDs nodeIDs = command.get< NodeIDs >();
+    LBASSERT( fanout > 0 );
+
+    // Announce the subtrees before any commit data arrives at our children.
+    // The children have been connected by CMD_NODE_OBJECT_RELAY_CONNECT before
+    // the master started to use this tree, never block the receiver thread.
+    Relay relay;
+    relay.version = version;
+    const size_t nChildren = std::min( size_t( fanout ), nodeIDs.size( ));
+    for( size_t i = 0; i < nChildren; ++i )
+    {
+        const NodeIDs subtree = relayTree::getSubtree( nodeIDs, i, fanout );
+        NodePtr child = _localNode->getNode( nodeIDs[ i ] );
+        if( !child )
+        {
+            LBWARN << "Relay node " << nodeIDs[ i ] << " not connected, "
+                   << subtree.size() + 1 << " nodes will miss " << id << " v"
+                   << version << std::endl;
+            continue;
+        }
+
+        if( !subtree.empty( ))
+            child->send( CMD_NODE_OBJECT_RELAY )
+                << id << version << fanout << subtree;
+        relay.children.push_back( child );
+    }
+
+    // replaces the announcement of an earlier commit which sent no data
+    lunchbox::ScopedFastWrite mutex( _relays );
+    _relays.data[ id ] = relay;
+    return true;
+}
+
+bool ObjectStore::_cmdRelayConnect( ICommand& command )
+{
+    LB_TS_THREAD( _commandThread );
+    NodePtr master = command.getNode();
+    const uint32_t requestID = command.get< uint32_t >();
+    const NodeIDs children = command.get< NodeIDs >();
+
+    // All children are slaves of the master, which therefore knows them. Other
+    // relay nodes might block their command thread in the same connect.
+    for( NodeIDs::const_iterator i = children.begin(); i != children.end();++i)
+        if( !_localNode->_connectVia( *i, master ))
+            LBWARN << "Can't connect relay node " << *i << std::endl;
+
+    master->send( CMD_NODE_ACK_REQUEST ) << requestID;
+    return true;
+}
+
+bool ObjectStore::_cmdMaxVersions( ICommand& command )
+{
+    NodePtr node = command.getNode();
+    const uint64_t size = command.get< uint64_t >();
+
+    for( uint64_t i = 0; i < size; ++i )
+    {
+        const UUID& id = command.get< UUID >();
+        const uint32_t masterInstanceID = command.get< uint32_t >();
+        const uint64_t version = command.get< uint64_t >();
+        const uint32_t slaveInstanceID = command.get< uint32_t >();
+
+        ObjectCMPtr cm;
+        {
+            lunchbox::ScopedFastRead mutex( _objects );
+            ObjectsHashCIter j = _objects->find( id );
+            if( j == _objects->end( ))
+                continue;
+
+            const Objects& objects = j->second;
+            for( ObjectsCIter k = objects.begin(); k != objects.end(); ++k )
+            {
+                Object* object = *k;
+                if( object->getInstanceID() == masterInstanceID )
+                {
+                    cm = object->_getChangeManager();
+                    break;
+                }
+            }
+        }
+
+        if( cm )
+            cm->setSlaveMaxVersion( node, slaveInstanceID, version );
+    }
+    return true;
+}
+
 bool ObjectStore::_cmdDisableSendOnRegister( ICommand& command )
 {
     LB_TS_THREAD( _commandThread );
@@ -1163,7 +1362,15 @@ bool ObjectStore::_cmdRemoveNode( ICommand& command )
     {
         const Objects& objects = i->second;
         for( ObjectsCIter j = objects.begin(); j != objects.end(); ++j )
-            (*j)->removeSlaves( node );
+        {
+            Object* object = *j;
+            object->removeSlaves( node );
+
+            // queue slaves hold back requests, see QueueMaster::_removeSlaves
+            QueueMaster* queue = dynamic_cast< QueueMaster* >( object );
+            if( queue )
+                queue->_removeSlaves( node );
+        }
     }
 
     if( requestID != LB_UNDEFINED_UINT32 )
@@ -60,6 +60,18 @@ namespace co
          * @return true if the command was dispatched, false otherwise.
          */
         bool dispatchObjectCommand( ICommand& command );
+
+        /**
+         * Forward received commit data to the children in the relay tree.
+         *
+         * Called by the receiving thread for each command read from the
+         * network. Commit data of the object version last announced by
+         * CMD_NODE_OBJECT_RELAY is forwarded unmodified to the announced
+         * children.
+         *
+         * @param command the received command.
+         */
+        void relayCommand( ICommand& command );
         //@}
 
         /** @name Object Registration */
@@ -172,6 +184,15 @@ namespace co
          * Remove a slave node in all objects
          */
         void removeNode( NodePtr node );
+
+        /** @sa LocalNode::sendMaxVersion() */
+        void sendMaxVersion( NodePtr master, const UUID& id,
+                             const uint32_t masterInstanceID,
+                             const uint64_t version,
+                             const uint32_t slaveInstanceID );
+
+        /** @sa LocalNode::flushMaxVersions() */
+        void flushMaxVersions();
         //@}
 
     private:
@@ -202,6 +223,30 @@ namespace co
 
         typedef std::deque< SendQueueItem > SendQueue;
 
+        struct Relay
+        {
+            uint128_t version;
+            Nodes children;
+        };
+        typedef stde::hash_map< uint128_t, Relay > RelayHash;
+
+        /** The relay children of the next commit per object, by read thread. */
+        lunchbox::Lockable< RelayHash, lunchbox::SpinLock > _relays;
+
+        struct MaxVersion
+        {
+            UUID id;
+            uint32_t masterInstanceID;
+            uint32_t slaveInstanceID;
+            uint64_t version;
+        };
+        typedef std::vector< MaxVersion > MaxVersions;
+        typedef std::pair< NodePtr, MaxVersions > MaxVersionBatch;
+        typedef stde::hash_map< uint128_t, MaxVersionBatch > MaxVersionHash;
+
+        /** Max version updates per master node, sent by the command thread. */
+        lunchbox::Lockable< MaxVersionHash, lunchbox::SpinLock > _maxVersions;
+
         SendQueue _sendQueue;          //!< Object data to broadcast when idle
         InstanceCache* _instanceCache; //!< cached object mapping data
         DataIStreamQueue _pushData;    //!< Object::push() queue
@@ -238,6 +283,9 @@ namespace co
         bool _cmdRemoveNode( ICommand& command );
         bool _cmdObjectPush( ICommand& command );
         bool _cmdObjectPushMap( ICommand& command );
+        bool _cmdRelay( ICommand& command );
+        bool _cmdRelayConnect( ICommand& command );
+        bool _cmdMaxVersions( ICommand& command );
 
         LB_TS_VAR( _receiverThread );
         LB_TS_VAR( _commandThread );
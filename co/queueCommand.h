@@ -29,7 +29,11 @@ namespace co
         CMD_QUEUE_GET_ITEM = CMD_OBJECT_CUSTOM, // 10
         CMD_QUEUE_EMPTY,
         CMD_QUEUE_ITEM,
-        CMD_QUEUE_CUSTOM = 15 //!< Commands for subclasses of queues start here
+        CMD_QUEUE_BATCH,
+        CMD_QUEUE_STEAL,
+        CMD_QUEUE_RETURN,
+        CMD_QUEUE_DETACH,
+        CMD_QUEUE_CUSTOM = 20 //!< Commands for subclasses of queues start here
     };
 }
 
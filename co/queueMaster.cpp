@@ -21,27 +21,35 @@
 
 #include "queueMaster.h"
 
+#include "bufferConnection.h"
 #include "dataOStream.h"
 #include "objectICommand.h"
 #include "objectOCommand.h"
 #include "queueCommand.h"
 #include "queueItem.h"
 
+#include <lunchbox/atomic.h>
 #include <lunchbox/mtQueue.h>
 
+#include <algorithm>
+#include <deque>
+
 namespace co
 {
 
 namespace detail
 {
 
+/** An immutable item, taking ownership of the serialized item data. */
 class ItemBuffer : public lunchbox::Bufferb, public lunchbox::Referenced
 {
 public:
     ItemBuffer( lunchbox::Bufferb& from )
-        : lunchbox::Bufferb( from )
+        : lunchbox::Bufferb()
         , lunchbox::Referenced()
-    {}
+    {
+        swap( from );
+    }
 
     ~ItemBuffer()
     {}
@@ -54,47 +62,273 @@ class QueueMaster : public co::Dispatcher
 public:
     QueueMaster( const co::QueueMaster& parent )
         : co::Dispatcher()
+        , stealing( 0 )
         , _parent( parent )
+        , _nReturns( 0 )
+        , _nStolen( 0 )
+        , _exhausted( false )
     {}
 
+    /** An item request from a slave. */
+    struct Request
+    {
+        NodePtr node;
+        uint32_t instanceID;
+        uint32_t amount;
+        int32_t id;
+        double time;
+    };
+    typedef std::deque< Request > Requests;
+
+    typedef std::vector< ItemBufferPtr > Items;
+
+    /** A slave which has requested items, i.e., may have some prefetched. */
+    struct Slave
+    {
+        Slave( NodePtr node_, const uint32_t instanceID_ )
+            : node( node_ ), instanceID( instanceID_ ), stealing( false ) {}
+
+        bool operator == ( const Slave& rhs ) const
+            { return node == rhs.node && instanceID == rhs.instanceID; }
+
+        NodePtr node;
+        uint32_t instanceID;
+        bool stealing; //!< asked to return items in the current steal round
+    };
+    typedef std::vector< Slave > Slaves;
+    typedef Slaves::iterator SlavesIter;
+
     /** The command handler functions. */
     bool cmdGetItem( co::ICommand& comd )
     {
         co::ObjectICommand command( comd );
 
-        const uint32_t itemsRequested = command.get< uint32_t >();
-        const uint32_t slaveInstanceID = command.get< uint32_t >();
-        const int32_t requestID = command.get< int32_t >();
+        Request request;
+        request.node = command.getNode();
+        request.amount = command.get< uint32_t >();
+        request.instanceID = command.get< uint32_t >();
+        request.id = command.get< int32_t >();
+        request.time = command.get< double >();
 
-        typedef std::vector< ItemBufferPtr > Items;
         Items items;
-        queue.tryPop( itemsRequested, items );
+        queue.tryPop( request.amount, items );
 
-        Connections connections( 1, command.getNode()->getConnection( ));
-        for( Items::const_iterator i = items.begin(); i != items.end(); ++i )
+        if( stealing )
         {
-            co::ObjectOCommand cmd( connections, CMD_QUEUE_ITEM,
-                                    COMMANDTYPE_OBJECT, _parent.getID(),
-                                    slaveInstanceID );
+            const Slave slave( request.node, request.instanceID );
+            if( std::find( _slaves.begin(), _slaves.end(), slave ) ==
+                _slaves.end( ))
+            {
+                _slaves.push_back( slave );
+            }
 
-            const ItemBufferPtr item = *i;
-            if( !item->isEmpty( ))
-                cmd << Array< const void >( item->getData(), item->getSize( ));
+            if( !items.empty( ))
+                _exhausted = false; // new items, slaves may prefetch again
+            else
+            {
+                if( _nReturns == 0 && !_exhausted )
+                    _steal( slave );
+                if( _nReturns > 0 )
+                {
+                    _requests.push_back( request );
+                    return true;
+                }
+            }
         }
 
-        if( itemsRequested > items.size( ))
-            co::ObjectOCommand( connections, CMD_QUEUE_EMPTY,
-                                COMMANDTYPE_OBJECT, command.getObjectID(),
-                                slaveInstanceID ) << requestID;
+        _reply( request, items, true );
+        return true;
+    }
+
+    bool cmdReturn( co::ICommand& comd )
+    {
+        co::ObjectICommand command( comd );
+
+        const uint32_t instanceID = command.get< uint32_t >();
+        const uint32_t nItems = command.get< uint32_t >();
+        Items items;
+        items.reserve( nItems );
+        for( uint32_t i = 0; i < nItems; ++i )
+        {
+            const uint64_t size = command.get< uint64_t >();
+            lunchbox::Bufferb buffer;
+            if( size > 0 )
+                buffer.append( static_cast< const uint8_t* >(
+                                   command.getRemainingBuffer( size )), size );
+            items.push_back( new ItemBuffer( buffer ));
+        }
+        // requeue at the front in the original order
+        for( Items::const_reverse_iterator i = items.rbegin();
+             i != items.rend(); ++i )
+        {
+            queue.pushFront( *i );
+        }
+        _nStolen += nItems;
+
+        // a slave which detached during the round is no longer waited for
+        const SlavesIter i = std::find( _slaves.begin(), _slaves.end(),
+                                        Slave( command.getNode(), instanceID ));
+        if( i != _slaves.end( ))
+            _returned( *i );
+
+        _flushRequests();
         return true;
     }
 
+    bool cmdDetach( co::ICommand& comd )
+    {
+        co::ObjectICommand command( comd );
+        _removeSlave( Slave( command.getNode(), command.get< uint32_t >( )));
+        return true;
+    }
+
+    void removeSlaves( NodePtr node )
+    {
+        for( size_t i = 0; i < _slaves.size(); )
+        {
+            const Slave slave = _slaves[ i ];
+            if( slave.node == node )
+                _removeSlave( slave );
+            else
+                ++i;
+        }
+    }
+
     typedef lunchbox::MTQueue< ItemBufferPtr > ItemQueue;
 
     ItemQueue queue;
+    lunchbox::a_int32_t stealing; //!< set by the app, read by the cmd thread
 
 private:
     const co::QueueMaster& _parent;
+
+    Slaves _slaves; //!< the mapped slaves which have requested items
+    Requests _requests; //!< held back until the slaves returned their items
+    uint32_t _nReturns; //!< outstanding replies to the last steal request
+    uint32_t _nStolen; //!< items returned during the last steal round
+    bool _exhausted; //!< the last steal round returned no items
+
+    /** Ask all other slaves to return some of their prefetched items. */
+    void _steal( const Slave& requester )
+    {
+        _nStolen = 0;
+        for( SlavesIter i = _slaves.begin(); i != _slaves.end(); ++i )
+        {
+            Slave& slave = *i;
+            if( slave == requester || !slave.node->isReachable( ))
+                continue;
+
+            Connections connections( 1, slave.node->getConnection( ));
+            co::ObjectOCommand( connections, CMD_QUEUE_STEAL,
+                                COMMANDTYPE_OBJECT, _parent.getID(),
+                                slave.instanceID );
+            slave.stealing = true;
+            ++_nReturns;
+        }
+        if( _nReturns == 0 )
+            _exhausted = true;
+    }
+
+    /** Forget an unmapped or disconnected slave and its held requests. */
+    void _removeSlave( const Slave& slave )
+    {
+        const SlavesIter i = std::find( _slaves.begin(), _slaves.end(),
+                                        slave );
+        if( i == _slaves.end( ))
+            return;
+
+        for( Requests::iterator j = _requests.begin(); j != _requests.end(); )
+        {
+            if( j->node == i->node && j->instanceID == i->instanceID )
+                j = _requests.erase( j );
+            else
+                ++j;
+        }
+
+        _returned( *i );
+        _slaves.erase( i );
+        _flushRequests();
+    }
+
+    /** Stop waiting for the slave in the current steal round. */
+    void _returned( Slave& slave )
+    {
+        if( !slave.stealing )
+            return;
+
+        slave.stealing = false;
+        LBASSERT( _nReturns > 0 );
+        if( --_nReturns == 0 )
+            _exhausted = _nStolen == 0;
+    }
+
+    /** Hand out returned items, close the requests once the round is over. */
+    void _flushRequests()
+    {
+        while( !_requests.empty( ))
+        {
+            const Request& request = _requests.front();
+            Items items;
+            queue.tryPop( request.amount, items );
+
+            const bool last = _nReturns == 0;
+            if( items.empty() && !last )
+                break;
+
+            _reply( request, items, last );
+            _requests.pop_front();
+        }
+    }
+
+    void _reply( const Request& request, const Items& items, const bool last )
+    {
+        ConnectionPtr connection = request.node->getConnection();
+        if( !connection )
+        {
+            LBWARN << "Can't send queue items, node " << request.node
+                   << " has been closed" << std::endl;
+            return;
+        }
+
+        // Accumulate small items of the refill and send them with one write,
+        // large items are sent directly from their buffer
+        BufferConnectionPtr buffered = new BufferConnection;
+        Connections connections( 1, buffered );
+        const Connections direct( 1, connection );
+        for( Items::const_iterator i = items.begin(); i != items.end(); ++i )
+        {
+            const ItemBufferPtr item = *i;
+            if( item->getSize() < COMMAND_ALLOCSIZE )
+            {
+                co::ObjectOCommand cmd( connections, CMD_QUEUE_ITEM,
+                                        COMMANDTYPE_OBJECT, _parent.getID(),
+                                        request.instanceID );
+                if( !item->isEmpty( ))
+                    cmd << Array< const void >( item->getData(),
+                                                item->getSize( ));
+                continue;
+            }
+
+            buffered->sendBuffer( connection ); // keep the item order
+            co::ObjectOCommand cmd( direct, CMD_QUEUE_ITEM, COMMANDTYPE_OBJECT,
+                                    _parent.getID(), request.instanceID );
+            cmd.sendHeader( item->getSize( ));
+            connection->send( item->getData(), item->getSize(), true );
+        }
+
+        // batch end before empty: the slave accounts the request before its
+        // application thread may see the empty reply
+        co::ObjectOCommand( connections, CMD_QUEUE_BATCH, COMMANDTYPE_OBJECT,
+                            _parent.getID(), request.instanceID )
+            << request.amount << request.time;
+
+        if( last && request.amount > items.size( ))
+            co::ObjectOCommand( connections, CMD_QUEUE_EMPTY,
+                                COMMANDTYPE_OBJECT, _parent.getID(),
+                                request.instanceID ) << request.id;
+
+        buffered->sendBuffer( connection );
+    }
 };
 }
 
@@ -120,6 +354,17 @@ void QueueMaster::attach( const UUID& id, const uint32_t instanceID )
     registerCommand( CMD_QUEUE_GET_ITEM,
                      CommandFunc< detail::QueueMaster >(
                          _impl, &detail::QueueMaster::cmdGetItem ), queue );
+    registerCommand( CMD_QUEUE_RETURN,
+                     CommandFunc< detail::QueueMaster >(
+                         _impl, &detail::QueueMaster::cmdReturn ), queue );
+    registerCommand( CMD_QUEUE_DETACH,
+                     CommandFunc< detail::QueueMaster >(
+                         _impl, &detail::QueueMaster::cmdDetach ), queue );
+}
+
+void QueueMaster::_removeSlaves( NodePtr node )
+{
+    _impl->removeSlaves( node );
 }
 
 void QueueMaster::clear()
@@ -127,6 +372,16 @@ void QueueMaster::clear()
     _impl->queue.clear();
 }
 
+void QueueMaster::setWorkStealing( const bool enable )
+{
+    _impl->stealing = enable ? 1 : 0;
+}
+
+bool QueueMaster::isWorkStealing() const
+{
+    return _impl->stealing != 0;
+}
+
 void QueueMaster::getInstanceData( co::DataOStream& os )
 {
     os << getInstanceID() << getLocalNode()->getNodeID();
@@ -139,6 +394,7 @@ QueueItem QueueMaster::push()
 
 void QueueMaster::_addItem( QueueItem& item )
 {
+    // takes over the serialized data, the item is not used afterwards
     detail::ItemBufferPtr newBuffer = new detail::ItemBuffer( item.getBuffer());
     _impl->queue.push( newBuffer );
 }
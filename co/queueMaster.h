@@ -60,6 +60,24 @@ public:
     /** Remove all enqueued items. @version 1.0 */
     CO_API void clear();
 
+    /**
+     * Enable or disable work stealing between the slaves.
+     *
+     * When enabled and the queue runs empty, requests are held back while the
+     * other slaves return half of their prefetched, unconsumed items, which are
+     * then handed out first. This balances the tail of a workload with slow
+     * consumers. Slaves which unmap or disconnect are not waited for, and no
+     * new steal round starts after one returned no items until the queue
+     * hands out new items. Disabled by default.
+     *
+     * @param enable true to enable work stealing, false to disable it.
+     * @version 1.0
+     */
+    CO_API void setWorkStealing( const bool enable );
+
+    /** @return true if work stealing is enabled. @version 1.0 */
+    CO_API bool isWorkStealing() const;
+
 private:
     detail::QueueMaster* const _impl;
 
@@ -71,6 +89,9 @@ private:
 
     friend class QueueItem;
     void _addItem( QueueItem& item );
+
+    friend class ObjectStore;
+    void _removeSlaves( NodePtr node ); //!< forget the slaves of a lost node
 };
 
 } // co
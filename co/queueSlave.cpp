@@ -22,7 +22,6 @@
 #include "queueSlave.h"
 
 #include "buffer.h"
-#include "commandQueue.h"
 #include "dataIStream.h"
 #include "global.h"
 #include "objectOCommand.h"
@@ -30,14 +29,34 @@
 #include "queueCommand.h"
 #include "exception.h"
 
+#include <lunchbox/clock.h>
+#include <lunchbox/lockable.h>
+#include <lunchbox/monitor.h>
+#include <lunchbox/scopedMutex.h>
+#include <lunchbox/spinLock.h>
+
+#include <algorithm>
+#include <cmath>
+#include <deque>
+
 namespace co
 {
 namespace detail
 {
-class QueueSlave
+namespace
+{
+/** Upper bound of the adaptive window, limits the imbalance between slaves */
+static const uint32_t _maxPrefetch = 256;
+
+typedef std::deque< co::ICommand > CommandDeque;
+typedef CommandDeque::const_iterator CommandDequeCIter;
+}
+
+class QueueSlave : public co::Dispatcher
 {
 public:
-    QueueSlave( const uint32_t mark, const uint32_t amount)
+    QueueSlave( co::QueueSlave& parent, const uint32_t mark,
+                const uint32_t amount )
         : masterInstanceID( EQ_INSTANCE_ALL )
         , prefetchMark( mark == LB_UNDEFINED_UINT32 ?
                     Global::getIAttribute( Global::IATTR_TILE_QUEUE_MIN_SIZE ) :
@@ -45,20 +64,205 @@ public:
         , prefetchAmount( amount == LB_UNDEFINED_UINT32 ?
                       Global::getIAttribute( Global::IATTR_TILE_QUEUE_REFILL ) :
                           amount )
+        , adaptive( mark == LB_UNDEFINED_UINT32 &&
+                    amount == LB_UNDEFINED_UINT32 )
+        , inFlight( 0 )
+        , request( 0 )
+        , rtt( 0. )
+        , interval( 0. )
+        , lastPop( 0. )
+        , _nCommands( 0 )
+        , _parent( parent )
     {}
 
-    co::CommandQueue queue;
+    /** Queue an item or empty reply, received in the receiver thread. */
+    bool cmdPush( co::ICommand& command )
+    {
+        lunchbox::ScopedFastWrite mutex( _commands );
+        _commands->push_back( command );
+        _nCommands = _commands->size();
+        return true;
+    }
+
+    /** @return the next item or empty reply. @throw Exception on timeout. */
+    co::ICommand popCommand( const uint32_t timeout )
+    {
+        while( true )
+        {
+            {
+                lunchbox::ScopedFastWrite mutex( _commands );
+                if( !_commands->empty( ))
+                {
+                    const co::ICommand command = _commands->front();
+                    _commands->pop_front();
+                    _nCommands = _commands->size();
+                    return command;
+                }
+            }
+            // woken up by a push, or retried after a steal took the items
+            if( !_nCommands.timedWaitNE( 0, timeout ))
+                throw Exception( Exception::TIMEOUT_COMMANDQUEUE );
+        }
+    }
+
+    /** @return the number of queued items and empty replies. */
+    size_t getSize() const
+    {
+        lunchbox::ScopedFastRead mutex( _commands );
+        return _commands->size();
+    }
+
+    /** Account the consumption time since the last item was handed out. */
+    void startPop()
+    {
+        if( !adaptive )
+            return;
+
+        lunchbox::ScopedFastWrite mutex( lock );
+        if( lastPop <= 0. )
+            return;
+
+        const double time = clock.getTimed() - lastPop;
+        interval = interval > 0. ? interval * .875 + time * .125 : time;
+    }
+
+    void endPop()
+    {
+        if( !adaptive )
+            return;
+
+        lunchbox::ScopedFastWrite mutex( lock );
+        lastPop = clock.getTimed();
+    }
+
+    /**
+     * Compute the prefetch window: items consumed during one round trip, but
+     * at least the configured mark and amount.
+     */
+    void getWindow( uint32_t& mark, uint32_t& amount )
+    {
+        mark = prefetchMark;
+        amount = prefetchAmount;
+        if( !adaptive )
+            return;
+
+        lunchbox::ScopedFastWrite mutex( lock );
+        if( rtt <= 0. )
+            return;
+
+        const double perRTT = interval > 0. ? std::ceil( rtt / interval ) :
+                                              double( _maxPrefetch );
+        const uint32_t window = uint32_t( std::min( perRTT,
+                                                    double( _maxPrefetch )));
+        mark = std::max( mark, window );
+        amount = std::max( amount, window );
+    }
+
+    /** Received in the receiver thread after the items of a request. */
+    bool cmdBatch( co::ICommand& comd )
+    {
+        co::ObjectICommand command( comd );
+        const uint32_t amount = command.get< uint32_t >();
+        const double requestTime = command.get< double >();
+
+        inFlight -= amount;
+        LBASSERT( inFlight >= 0 );
+        if( !adaptive )
+            return true;
+
+        const double time = clock.getTimed() - requestTime;
+        lunchbox::ScopedFastWrite mutex( lock );
+        rtt = rtt > 0. ? rtt * .875 + time * .125 : time;
+        return true;
+    }
+
+    /**
+     * Return half of the unconsumed items to the master for work stealing.
+     * The items at the back are taken while the application thread may pop
+     * the ones at the front.
+     */
+    bool cmdSteal( co::ICommand& )
+    {
+        CommandDeque stolen;
+        {
+            lunchbox::ScopedFastWrite mutex( _commands );
+            size_t nItems = 0;
+            for( CommandDequeCIter i = _commands->begin();
+                 i != _commands->end(); ++i )
+            {
+                if( i->getCommand() == CMD_QUEUE_ITEM )
+                    ++nItems;
+            }
+
+            size_t nKeep = nItems - nItems / 2;
+            CommandDeque kept;
+            for( CommandDequeCIter i = _commands->begin();
+                 i != _commands->end(); ++i )
+            {
+                if( i->getCommand() != CMD_QUEUE_ITEM )
+                    kept.push_back( *i );
+                else if( nKeep > 0 )
+                {
+                    kept.push_back( *i );
+                    --nKeep;
+                }
+                else
+                    stolen.push_back( *i );
+            }
+            _commands->swap( kept );
+            _nCommands = _commands->size();
+        }
+
+        ObjectOCommand reply = _parent.send( master, CMD_QUEUE_RETURN,
+                                             masterInstanceID );
+        reply << _parent.getInstanceID() << uint32_t( stolen.size( ));
+
+        for( CommandDequeCIter i = stolen.begin(); i != stolen.end(); ++i )
+        {
+            ObjectICommand item( *i );
+            const uint64_t remaining = item.getRemainingBufferSize();
+            const uint64_t used = item.getBuffer()->getSize() - remaining;
+            // commands may be padded, the header has the real size
+            const uint64_t size = std::min( remaining, item.getSize() - used );
+            reply << size;
+            if( size > 0 )
+                reply << Array< const void >( item.getRemainingBuffer( size ),
+                                              size );
+        }
+        return true;
+    }
+
     NodePtr master;
     uint32_t masterInstanceID;
 
     const uint32_t prefetchMark;
     const uint32_t prefetchAmount;
+    const bool adaptive;
+
+    lunchbox::a_int32_t inFlight; //!< items requested but not yet received
+    lunchbox::a_int32_t request; //!< the last request sent to the master
+
+    lunchbox::Clock clock;
+    lunchbox::SpinLock lock;
+    double rtt; //!< average request round trip time in ms
+    double interval; //!< average consumption time per item in ms
+    double lastPop; //!< time the last item was handed out
+
+private:
+    /** The received items and empty replies, see popCommand(). */
+    lunchbox::Lockable< CommandDeque, lunchbox::SpinLock > _commands;
+    lunchbox::Monitor< size_t > _nCommands;
+
+    co::QueueSlave& _parent;
 };
 }
 
 QueueSlave::QueueSlave( const uint32_t prefetchMark,
                         const uint32_t prefetchAmount )
-        : _impl( new detail::QueueSlave( prefetchMark, prefetchAmount ))
+#pragma warning(push)
+#pragma warning(disable: 4355)
+        : _impl( new detail::QueueSlave( *this, prefetchMark, prefetchAmount ))
+#pragma warning(pop)
 {}
 
 QueueSlave::~QueueSlave()
@@ -69,8 +273,28 @@ QueueSlave::~QueueSlave()
 void QueueSlave::attach( const UUID& id, const uint32_t instanceID )
 {
     Object::attach(id, instanceID);
-    registerCommand( CMD_QUEUE_ITEM, CommandFunc<Object>(0, 0), &_impl->queue );
-    registerCommand( CMD_QUEUE_EMPTY, CommandFunc<Object>(0, 0), &_impl->queue);
+    registerCommand( CMD_QUEUE_ITEM,
+                     CommandFunc< detail::QueueSlave >(
+                         _impl, &detail::QueueSlave::cmdPush ), 0 );
+    registerCommand( CMD_QUEUE_EMPTY,
+                     CommandFunc< detail::QueueSlave >(
+                         _impl, &detail::QueueSlave::cmdPush ), 0 );
+    registerCommand( CMD_QUEUE_BATCH,
+                     CommandFunc< detail::QueueSlave >(
+                         _impl, &detail::QueueSlave::cmdBatch ), 0 );
+    registerCommand( CMD_QUEUE_STEAL,
+                     CommandFunc< detail::QueueSlave >(
+                         _impl, &detail::QueueSlave::cmdSteal ), 0 );
+}
+
+void QueueSlave::notifyDetach()
+{
+    Object::notifyDetach();
+
+    // the master stops waiting for this slave during work stealing
+    if( _impl->master && _impl->master->isReachable( ))
+        send( _impl->master, CMD_QUEUE_DETACH, _impl->masterInstanceID )
+            << getInstanceID();
 }
 
 void QueueSlave::applyInstanceData( co::DataIStream& is )
@@ -87,31 +311,44 @@ void QueueSlave::applyInstanceData( co::DataIStream& is )
 ObjectICommand QueueSlave::pop( const uint32_t timeout )
 {
     static lunchbox::a_int32_t _request;
-    const int32_t request = ++_request;
+    _impl->startPop();
 
     while( true )
     {
-        const size_t queueSize = _impl->queue.getSize();
-        if( queueSize <= _impl->prefetchMark )
+        // Items in flight count as queued, which pipelines the requests
+        // instead of sending one per pop while waiting for a reply
+        uint32_t mark, amount;
+        _impl->getWindow( mark, amount );
+        const size_t queueSize = _impl->getSize() + _impl->inFlight;
+        if( queueSize <= mark )
         {
+            const int32_t request = ++_request;
+            _impl->request = request;
+            _impl->inFlight += amount;
             send( _impl->master, CMD_QUEUE_GET_ITEM, _impl->masterInstanceID )
-                    << _impl->prefetchAmount << getInstanceID() << request;
+                << amount << getInstanceID() << request
+                << _impl->clock.getTimed();
         }
 
         try
         {
-            ObjectICommand cmd( _impl->queue.pop( timeout ));
+            ObjectICommand cmd( _impl->popCommand( timeout ));
             switch( cmd.getCommand( ))
             {
             case CMD_QUEUE_ITEM:
+                _impl->endPop();
                 return ObjectICommand( cmd );
 
             default:
                 LBUNIMPLEMENTED;
             case CMD_QUEUE_EMPTY:
-                if( cmd.get< int32_t >() == request )
+                // The replies of all earlier requests precede the last one
+                if( cmd.get< int32_t >() == _impl->request )
+                {
+                    _impl->endPop();
                     return ObjectICommand( 0, 0, 0, false );
-                // else left-over or not our empty command, discard and retry
+                }
+                // else left-over empty command, discard and retry
                 break;
             }
         }
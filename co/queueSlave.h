@@ -48,6 +48,11 @@ public:
      * hides the network latency by pipelining the network communication with
      * the processing, but introduces some imbalance between queue slaves.
      *
+     * Items requested but not yet received count towards the prefetchMark,
+     * and all items of one refill are sent at once. If neither parameter is
+     * given, the window adapts to the number of items consumed during one
+     * round trip to the master, using the Global defaults as minimum.
+     *
      * @param prefetchMark the low-water mark for prefetching, or
      *                     LB_UNDEFINED_UINT32 to use the Global default.
      * @param prefetchAmount the refill quantity when prefetching, or
@@ -77,6 +82,7 @@ private:
     detail::QueueSlave* const _impl;
 
     CO_API virtual void attach( const UUID& id, const uint32_t instanceID );
+    CO_API virtual void notifyDetach();
 
     virtual ChangeType getChangeType() const { return STATIC; }
     virtual void getInstanceData( co::DataOStream& ) { LBDONTCALL }
@@ -0,0 +1,77 @@
+
+/* Copyright (c) 2013, Stefan Eilemann <eile@equalizergraphics.com>
+ *
+ * This file is part of Collage <https://github.com/Eyescale/Collage>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 2.1 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef CO_RELAYTREE_H
+#define CO_RELAYTREE_H
+
+#include <co/types.h>
+
+#include <algorithm>
+#include <deque>
+
+namespace co
+{
+    /**
+     * @internal
+     * The k-ary tree used to relay object commits to many slaves.
+     *
+     * The tree is stored in heap order without its root, which is the sending
+     * node. The root's children are the first 'fanout' entries, and the
+     * children of entry i are the entries [(i+1)*fanout, (i+2)*fanout). A
+     * subtree extracted in breadth-first order uses the same layout, so each
+     * relaying node applies the same rule to the list it receives.
+     */
+    namespace relayTree
+    {
+        /** @return the direct children of the given entry. */
+        inline NodeIDs getChildren( const NodeIDs& nodes, const size_t index,
+                                    const uint32_t fanout )
+        {
+            const size_t first = std::min( ( index + 1 ) * fanout,
+                                           nodes.size( ));
+            const size_t last = std::min( first + fanout, nodes.size( ));
+            return NodeIDs( nodes.begin() + first, nodes.begin() + last );
+        }
+
+        /** @return the nodes below the given entry, without the entry. */
+        inline NodeIDs getSubtree( const NodeIDs& nodes, const size_t index,
+                                   const uint32_t fanout )
+        {
+            NodeIDs subtree;
+            std::deque< size_t > queue;
+            queue.push_back( index );
+
+            while( !queue.empty( ))
+            {
+                const size_t first = ( queue.front() + 1 ) * fanout;
+                const size_t last = std::min( first + fanout, nodes.size( ));
+                queue.pop_front();
+
+                for( size_t i = first; i < last; ++i )
+                {
+                    subtree.push_back( nodes[ i ] );
+                    queue.push_back( i );
+                }
+            }
+            return subtree;
+        }
+    }
+}
+
+#endif // CO_RELAYTREE_H
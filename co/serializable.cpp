@@ -22,6 +22,7 @@
 
 #include "dataIStream.h"
 #include "dataOStream.h"
+#include "objectMap.h"
 
 namespace co
 {
@@ -30,11 +31,18 @@ namespace detail
 class Serializable
 {
 public:
-    Serializable() : dirty( co::Serializable::DIRTY_NONE ) {}
+    Serializable()
+        : dirty( co::Serializable::DIRTY_NONE ), map( 0 ), tracking( false ) {}
     ~Serializable() {}
 
     /** The current dirty bits. */
     uint64_t dirty;
+
+    /** The object map this master is registered with, if any. */
+    co::ObjectMap* map;
+
+    /** All changes are signalled through setDirty(). */
+    bool tracking;
 };
 }
 
@@ -76,7 +84,11 @@ uint128_t Serializable::commit( const uint32_t incarnation )
 
 void Serializable::setDirty( const uint64_t bits )
 {
+    const bool notify = _impl->map && _impl->dirty == DIRTY_NONE &&
+                        bits != DIRTY_NONE;
     _impl->dirty |= bits;
+    if( notify )
+        _impl->map->_notifyDirty( this );
 }
 
 void Serializable::unsetDirty( const uint64_t bits )
@@ -84,6 +96,22 @@ void Serializable::unsetDirty( const uint64_t bits )
     _impl->dirty &= ~bits;
 }
 
+void Serializable::enableDirtyTracking()
+{
+    LBASSERTINFO( !_impl->map, "Enable dirty tracking before registering" );
+    _impl->tracking = true;
+}
+
+void Serializable::_setObjectMap( ObjectMap* map )
+{
+    _impl->map = map;
+}
+
+bool Serializable::_hasDirtyTracking() const
+{
+    return _impl->tracking;
+}
+
 void Serializable::notifyAttached()
 {
     if( isMaster( ))
@@ -25,7 +25,7 @@
 
 namespace co
 {
-namespace detail { class Serializable; }
+namespace detail { class ObjectMap; class Serializable; }
 
 /**
  * Base class for distributed, inheritable objects.
@@ -73,6 +73,10 @@ protected:
      * the actual dirty bits from pack(), which also resets the dirty state
      * afterwards. The dirty bits are transmitted beforehand, and do not
      * need to be transmitted by the overriding method.
+     *
+     * Objects with more fields than dirty bits use one custom bit to mark a
+     * DirtyBitSet or DirtyVector, which is then streamed along with the
+     * fields it tracks.
      * @version 1.0
      */
     virtual void serialize( co::DataOStream&, const uint64_t ){}
@@ -108,6 +112,17 @@ protected:
     /** Remove dirty flags to clear data from distribution. @version 1.0 */
     CO_API virtual void unsetDirty( const uint64_t bits );
 
+    /**
+     * Declare that all changes of this master are signalled by setDirty().
+     *
+     * An ObjectMap then only commits this master after it became dirty,
+     * instead of calling isDirty() on each commit. Must not be used if
+     * isDirty() is overridden, and has to be called before registering the
+     * master with the map.
+     * @version 1.0
+     */
+    CO_API void enableDirtyTracking();
+
     /** @sa Object::getChangeType() */
     virtual ChangeType getChangeType() const { return DELTA; }
 
@@ -117,6 +132,14 @@ protected:
 private:
     detail::Serializable* const _impl;
     friend class detail::Serializable;
+    friend class ObjectMap;
+    friend class detail::ObjectMap;
+
+    /** @internal Notify the given map when this master becomes dirty. */
+    void _setObjectMap( ObjectMap* map );
+
+    /** @internal @return true if enableDirtyTracking() was called. */
+    bool _hasDirtyTracking() const;
 
     virtual void getInstanceData( co::DataOStream& os )
         { serialize( os, DIRTY_ALL ); }
@@ -0,0 +1,646 @@
+
+/* Copyright (c) 2013, Stefan Eilemann <eile@equalizergraphics.com>
+ *
+ * This file is part of Collage <https://github.com/Eyescale/Collage>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 2.1 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "shmConnection.h"
+
+#include "connectionDescription.h"
+#include "exception.h"
+#include "global.h"
+#include "log.h"
+
+#include <lunchbox/atomic.h>
+#include <lunchbox/os.h>
+
+#include <algorithm>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sstream>
+#include <stddef.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace co
+{
+/**
+ * The shared header of one ring buffer, followed by its data.
+ *
+ * The positions count all bytes ever written and read, and are only modified
+ * by the writer and the reader, respectively. The idle flags implement the
+ * wakeup protocol: a side sets its flag before sleeping on its eventfd and
+ * re-checks the ring, the other side clears the flag after updating its
+ * position and signals the eventfd if the flag was set.
+ */
+struct ShmConnection::Ring
+{
+    uint64_t writePos;
+    uint8_t pad0[ 56 ];   // keep reader and writer on separate cache lines
+    uint64_t readPos;
+    uint8_t pad1[ 56 ];
+    int32_t readerIdle;   //!< the reader drained the ring
+    int32_t writerIdle;   //!< the writer waits for space
+    int32_t closed;       //!< the writer has closed the connection
+    uint32_t pad2;
+    uint64_t size;        //!< the size of the ring data
+    uint8_t pad3[ 40 ];
+
+    uint8_t* getData() { return reinterpret_cast< uint8_t* >( this + 1 ); }
+};
+
+namespace
+{
+/** The shared memory and two eventfds per ring are passed on accept. */
+static const size_t _nFDs = 5;
+
+/** Ring size of explicit connections while same-host shm is disabled. */
+static const int32_t _defaultRingSizeMB = 4;
+
+lunchbox::a_int32_t _nNames;
+
+std::string _getLocalHostname()
+{
+    char name[ 256 ] = { 0 };
+    if( ::gethostname( name, sizeof( name ) - 1 ) != 0 )
+        return std::string();
+    return name;
+}
+
+std::string _getUniqueName( const char* prefix )
+{
+    std::ostringstream name;
+    name << prefix << "co-" << ::getpid() << "-" << ++_nNames;
+    return name.str();
+}
+
+bool _getAddress( const std::string& name, sockaddr_un& address,
+                  socklen_t& length )
+{
+    ::memset( &address, 0, sizeof( address ));
+    address.sun_family = AF_UNIX;
+
+    // abstract namespace, starts with a null byte and needs no cleanup
+    const std::string path = "collage/" + name;
+    if( path.size() + 1 > sizeof( address.sun_path ))
+    {
+        LBWARN << "Shared memory connection name too long: " << name
+               << std::endl;
+        return false;
+    }
+    ::memcpy( address.sun_path + 1, path.c_str(), path.size( ));
+    length = socklen_t( offsetof( sockaddr_un, sun_path ) + 1 + path.size( ));
+    return true;
+}
+
+bool _sendFDs( const int socket, const int* fds )
+{
+    union
+    {
+        cmsghdr header; // alignment
+        char data[ CMSG_SPACE( _nFDs * sizeof( int )) ];
+    } control;
+    ::memset( &control, 0, sizeof( control ));
+
+    char byte = 0;
+    iovec iov;
+    iov.iov_base = &byte;
+    iov.iov_len = 1;
+
+    msghdr message;
+    ::memset( &message, 0, sizeof( message ));
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+    message.msg_control = control.data;
+    message.msg_controllen = sizeof( control.data );
+
+    cmsghdr* header = CMSG_FIRSTHDR( &message );
+    header->cmsg_level = SOL_SOCKET;
+    header->cmsg_type = SCM_RIGHTS;
+    header->cmsg_len = CMSG_LEN( _nFDs * sizeof( int ));
+    ::memcpy( CMSG_DATA( header ), fds, _nFDs * sizeof( int ));
+
+    return ::sendmsg( socket, &message, MSG_NOSIGNAL ) == 1;
+}
+
+bool _receiveFDs( const int socket, int* fds )
+{
+    union
+    {
+        cmsghdr header; // alignment
+        char data[ CMSG_SPACE( _nFDs * sizeof( int )) ];
+    } control;
+    ::memset( &control, 0, sizeof( control ));
+
+    char byte = 0;
+    iovec iov;
+    iov.iov_base = &byte;
+    iov.iov_len = 1;
+
+    msghdr message;
+    ::memset( &message, 0, sizeof( message ));
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+    message.msg_control = control.data;
+    message.msg_controllen = sizeof( control.data );
+
+    if( ::recvmsg( socket, &message, MSG_CMSG_CLOEXEC ) != 1 )
+        return false;
+
+    cmsghdr* header = CMSG_FIRSTHDR( &message );
+    if( !header || header->cmsg_level != SOL_SOCKET ||
+        header->cmsg_type != SCM_RIGHTS ||
+        header->cmsg_len != CMSG_LEN( _nFDs * sizeof( int )))
+    {
+        LBWARN << "Got malformed shared memory connection setup" << std::endl;
+        return false;
+    }
+    ::memcpy( fds, CMSG_DATA( header ), _nFDs * sizeof( int ));
+    return true;
+}
+
+void _signal( const int fd )
+{
+    const uint64_t value = 1;
+    if( ::write( fd, &value, sizeof( value )) != sizeof( value ) &&
+        errno != EAGAIN )
+    {
+        LBWARN << "Can't signal shared memory connection: "
+               << lunchbox::sysError << std::endl;
+    }
+}
+
+void _clear( const int fd )
+{
+    uint64_t value;
+    while( ::read( fd, &value, sizeof( value )) < 0 && errno == EINTR )
+        ; // nonblocking, fails with EAGAIN if not signaled
+}
+
+void _closeFD( int& fd )
+{
+    if( fd >= 0 && ::close( fd ) != 0 )
+        LBWARN << "Could not close file descriptor: " << lunchbox::sysError
+               << std::endl;
+    fd = -1;
+}
+
+int _getTimeOut()
+{
+    const uint32_t timeout = Global::getTimeout();
+    return timeout == LB_TIMEOUT_INDEFINITE ? -1 : int( timeout );
+}
+}
+
+ShmConnection::ShmConnection()
+        : _socket( -1 )
+        , _notifier( -1 )
+        , _memory( 0 )
+        , _memorySize( 0 )
+        , _in( 0 )
+        , _out( 0 )
+        , _inData( -1 )
+        , _inSpace( -1 )
+        , _outData( -1 )
+        , _outSpace( -1 )
+{
+    ConnectionDescriptionPtr description = _getDescription();
+    description->type = CONNECTIONTYPE_SHM;
+    description->bandwidth = 1024000; // 1GB/s
+
+    LBVERB << "New ShmConnection @" << (void*)this << std::endl;
+}
+
+ShmConnection::~ShmConnection()
+{
+    _close();
+}
+
+bool ShmConnection::isLocal( ConstConnectionDescriptionPtr description )
+{
+    return description->type == CONNECTIONTYPE_SHM &&
+           description->getHostname() == _getLocalHostname();
+}
+
+//----------------------------------------------------------------------
+// connect
+//----------------------------------------------------------------------
+bool ShmConnection::connect()
+{
+    ConstConnectionDescriptionPtr description = getDescription();
+    LBASSERT( description->type == CONNECTIONTYPE_SHM );
+    if( !isClosed( ))
+        return false;
+
+    _setState( STATE_CONNECTING );
+
+    sockaddr_un address;
+    socklen_t length = 0;
+    if( !_getAddress( description->getFilename(), address, length ))
+    {
+        _close();
+        return false;
+    }
+
+    int fds[ _nFDs ];
+    _socket = ::socket( AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0 );
+    if( _socket < 0 ||
+        ::connect( _socket, (sockaddr*)&address, length ) != 0 ||
+        !_receiveFDs( _socket, fds ))
+    {
+        LBINFO << "Could not connect to '" << description->getFilename()
+               << "': " << lunchbox::sysError << std::endl;
+        _close();
+        return false;
+    }
+
+    // the listener writes to the first ring
+    _inData = fds[1];
+    _inSpace = fds[2];
+    _outData = fds[3];
+    _outSpace = fds[4];
+
+    struct stat info;
+    const bool mapped = ::fstat( fds[0], &info ) == 0 &&
+                        _map( fds[0], info.st_size, false );
+    _closeFD( fds[0] );
+
+    if( !mapped || !_setupNotifier( ))
+    {
+        LBWARN << "Could not set up shared memory connection to '"
+               << description->getFilename() << "': " << lunchbox::sysError
+               << std::endl;
+        _close();
+        return false;
+    }
+
+    _setState( STATE_CONNECTED );
+    LBINFO << "Connected " << description->toString() << std::endl;
+    return true;
+}
+
+//----------------------------------------------------------------------
+// listen
+//----------------------------------------------------------------------
+bool ShmConnection::listen()
+{
+    ConnectionDescriptionPtr description = _getDescription();
+    LBASSERT( description->type == CONNECTIONTYPE_SHM );
+    if( !isClosed( ))
+        return false;
+
+    _setState( STATE_CONNECTING );
+
+    if( description->getFilename().empty() ||
+        description->getFilename() == "default" )
+    {
+        description->setFilename( _getUniqueName( "" ));
+    }
+    if( description->getHostname().empty( ))
+        description->setHostname( _getLocalHostname( ));
+
+    sockaddr_un address;
+    socklen_t length = 0;
+    if( !_getAddress( description->getFilename(), address, length ))
+    {
+        _close();
+        return false;
+    }
+
+    _socket = ::socket( AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0 );
+    if( _socket < 0 ||
+        ::bind( _socket, (sockaddr*)&address, length ) != 0 ||
+        ::listen( _socket, SOMAXCONN ) != 0 )
+    {
+        LBWARN << "Could not listen on '" << description->getFilename()
+               << "': " << lunchbox::sysError << std::endl;
+        _close();
+        return false;
+    }
+
+    _notifier = _socket;
+    _setState( STATE_LISTENING );
+    LBINFO << "Listening on " << description->toString() << std::endl;
+    return true;
+}
+
+ConnectionPtr ShmConnection::acceptSync()
+{
+    if( !isListening( ))
+        return 0;
+
+    int fd = -1;
+    do
+        fd = ::accept4( _socket, 0, 0, SOCK_CLOEXEC );
+    while( fd < 0 && errno == EINTR );
+
+    if( fd < 0 )
+    {
+        LBWARN << "accept failed: " << lunchbox::sysError << std::endl;
+        return 0;
+    }
+
+    ConstConnectionDescriptionPtr description = getDescription();
+    ShmConnection* newConnection = new ShmConnection;
+    ConnectionPtr connection( newConnection ); // to keep ref-counting correct
+
+    ConnectionDescriptionPtr newDescription = newConnection->_getDescription();
+    newDescription->bandwidth = description->bandwidth;
+    newDescription->setHostname( description->getHostname( ));
+    newDescription->setFilename( description->getFilename( ));
+
+    if( !newConnection->_create( fd ))
+    {
+        newConnection->close();
+        return 0;
+    }
+    return connection;
+}
+
+bool ShmConnection::_create( const int socket )
+{
+    _socket = socket;
+
+    const int32_t ringSizeMB =
+        Global::getIAttribute( Global::IATTR_SHM_RING_BUFFER_SIZE_MB );
+    const uint64_t ringSize = uint64_t( ringSizeMB > 0 ? ringSizeMB :
+                                        _defaultRingSizeMB ) * LB_1MB;
+    const uint64_t size = 2 * ( sizeof( Ring ) + ringSize );
+
+    const std::string name = _getUniqueName( "/" );
+    int fds[ _nFDs ];
+    fds[0] = ::shm_open( name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600 );
+    if( fds[0] < 0 )
+    {
+        LBWARN << "Could not create shared memory " << name << ": "
+               << lunchbox::sysError << std::endl;
+        return false;
+    }
+    ::shm_unlink( name.c_str( )); // only accessible through the fd from here
+
+    for( size_t i = 1; i < _nFDs; ++i )
+        fds[i] = ::eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC );
+    _outData = fds[1];
+    _outSpace = fds[2];
+    _inData = fds[3];
+    _inSpace = fds[4];
+
+    const bool ok = _outData >= 0 && _outSpace >= 0 && _inData >= 0 &&
+                    _inSpace >= 0 && ::ftruncate( fds[0], size ) == 0 &&
+                    _map( fds[0], size, true ) && _sendFDs( _socket, fds ) &&
+                    _setupNotifier();
+    _closeFD( fds[0] );
+
+    if( !ok )
+    {
+        LBWARN << "Could not set up shared memory connection: "
+               << lunchbox::sysError << std::endl;
+        return false;
+    }
+
+    _setState( STATE_CONNECTED );
+    return true;
+}
+
+bool ShmConnection::_map( const int fd, const uint64_t size,
+                          const bool initialize )
+{
+    if( size < 2 * sizeof( Ring ))
+        return false;
+
+    _memory = ::mmap( 0, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+    if( _memory == MAP_FAILED )
+    {
+        _memory = 0;
+        return false;
+    }
+    _memorySize = size;
+
+    const uint64_t ringSize = size / 2 - sizeof( Ring );
+    Ring* first = static_cast< Ring* >( _memory );
+    Ring* second = reinterpret_cast< Ring* >( first->getData() + ringSize );
+
+    if( initialize ) // zero-filled by ftruncate
+    {
+        first->size = second->size = ringSize;
+        first->readerIdle = second->readerIdle = 1;
+    }
+    else if( first->size != ringSize || second->size != ringSize )
+    {
+        LBWARN << "Shared memory size mismatch" << std::endl;
+        return false;
+    }
+
+    _out = initialize ? first : second;
+    _in = initialize ? second : first;
+    return true;
+}
+
+bool ShmConnection::_setupNotifier()
+{
+    _notifier = ::epoll_create1( EPOLL_CLOEXEC );
+    if( _notifier < 0 )
+        return false;
+
+    epoll_event event;
+    ::memset( &event, 0, sizeof( event ));
+    event.events = EPOLLIN;
+    event.data.fd = _inData;
+    if( ::epoll_ctl( _notifier, EPOLL_CTL_ADD, _inData, &event ) != 0 )
+        return false;
+
+    // the peer never writes to the socket, it only becomes readable on close
+    event.events = EPOLLIN | EPOLLRDHUP;
+    event.data.fd = _socket;
+    return ::epoll_ctl( _notifier, EPOLL_CTL_ADD, _socket, &event ) == 0;
+}
+
+void ShmConnection::_close()
+{
+    if( isClosed() && _socket < 0 )
+        return;
+
+    if( _out )
+    {
+        __atomic_store_n( &_out->closed, 1, __ATOMIC_SEQ_CST );
+        _signal( _outData ); // wake up the peer's reader
+    }
+
+    if( _memory && ::munmap( _memory, _memorySize ) != 0 )
+        LBWARN << "Could not unmap shared memory: " << lunchbox::sysError
+               << std::endl;
+    _memory = 0;
+    _memorySize = 0;
+    _in = 0;
+    _out = 0;
+
+    if( _notifier == _socket )
+        _notifier = -1;
+    _closeFD( _notifier );
+    _closeFD( _socket );
+    _closeFD( _inData );
+    _closeFD( _inSpace );
+    _closeFD( _outData );
+    _closeFD( _outSpace );
+    _setState( STATE_CLOSED );
+}
+
+bool ShmConnection::_isHungUp() const
+{
+    pollfd fd;
+    fd.fd = _socket;
+    fd.events = POLLIN;
+    fd.revents = 0;
+    return ::poll( &fd, 1, 0 ) != 0;
+}
+
+void ShmConnection::_setIdle()
+{
+    _clear( _inData );
+    __atomic_store_n( &_in->readerIdle, 1, __ATOMIC_SEQ_CST );
+
+    // data written before the writer saw the flag keeps the notifier set
+    if( __atomic_load_n( &_in->writePos, __ATOMIC_SEQ_CST ) != _in->readPos &&
+        __atomic_exchange_n( &_in->readerIdle, 0, __ATOMIC_SEQ_CST ))
+    {
+        _signal( _inData );
+    }
+}
+
+bool ShmConnection::_wait( const int fd, const bool reading )
+{
+    pollfd fds[2];
+    fds[0].fd = fd;
+    fds[0].events = POLLIN;
+    fds[0].revents = 0;
+    fds[1].fd = _socket;
+    fds[1].events = POLLIN;
+    fds[1].revents = 0;
+
+    const int result = ::poll( fds, 2, _getTimeOut( ));
+    if( result == 0 )
+        throw Exception( reading ? Exception::TIMEOUT_READ :
+                                   Exception::TIMEOUT_WRITE );
+    if( result < 0 && errno != EINTR )
+    {
+        LBWARN << "Error during poll: " << lunchbox::sysError << std::endl;
+        return false;
+    }
+    return true;
+}
+
+//----------------------------------------------------------------------
+// read
+//----------------------------------------------------------------------
+int64_t ShmConnection::readSync( void* buffer, const uint64_t bytes,
+                                 const bool )
+{
+    if( !_in )
+        return -1;
+
+    Ring& ring = *_in;
+    while( true )
+    {
+        const uint64_t writePos = __atomic_load_n( &ring.writePos,
+                                                   __ATOMIC_SEQ_CST );
+        const uint64_t readPos = ring.readPos;
+        if( writePos != readPos )
+        {
+            const uint64_t size = std::min( bytes, writePos - readPos );
+            const uint64_t offset = readPos % ring.size;
+            const uint64_t first = std::min( size, ring.size - offset );
+            uint8_t* data = static_cast< uint8_t* >( buffer );
+
+            ::memcpy( data, ring.getData() + offset, first );
+            ::memcpy( data + first, ring.getData(), size - first );
+            __atomic_store_n( &ring.readPos, readPos + size,
+                              __ATOMIC_SEQ_CST );
+
+            if( __atomic_exchange_n( &ring.writerIdle, 0, __ATOMIC_SEQ_CST ))
+                _signal( _inSpace );
+            if( readPos + size == writePos )
+                _setIdle();
+            return size;
+        }
+
+        if( __atomic_load_n( &ring.closed, __ATOMIC_SEQ_CST ) || _isHungUp( ))
+        {
+            LBINFO << "Got EOF, closing " << getDescription()->toString()
+                   << std::endl;
+            close();
+            return -1;
+        }
+
+        _setIdle();
+        if( !_wait( _inData, true ))
+            return -1;
+    }
+}
+
+//----------------------------------------------------------------------
+// write
+//----------------------------------------------------------------------
+int64_t ShmConnection::write( const void* buffer, const uint64_t bytes )
+{
+    if( !isConnected() || !_out )
+        return -1;
+
+    Ring& ring = *_out;
+    while( true )
+    {
+        const uint64_t writePos = ring.writePos;
+        const uint64_t readPos = __atomic_load_n( &ring.readPos,
+                                                  __ATOMIC_SEQ_CST );
+        const uint64_t space = ring.size - ( writePos - readPos );
+        if( space > 0 )
+        {
+            const uint64_t size = std::min( bytes, space );
+            const uint64_t offset = writePos % ring.size;
+            const uint64_t first = std::min( size, ring.size - offset );
+            const uint8_t* data = static_cast< const uint8_t* >( buffer );
+
+            ::memcpy( ring.getData() + offset, data, first );
+            ::memcpy( ring.getData(), data + first, size - first );
+            __atomic_store_n( &ring.writePos, writePos + size,
+                              __ATOMIC_SEQ_CST );
+
+            if( __atomic_exchange_n( &ring.readerIdle, 0, __ATOMIC_SEQ_CST ))
+                _signal( _outData );
+            return size;
+        }
+
+        if( _isHungUp( ))
+            return -1;
+
+        // ring full, wait for the reader
+        _clear( _outSpace );
+        __atomic_store_n( &ring.writerIdle, 1, __ATOMIC_SEQ_CST );
+        if( __atomic_load_n( &ring.readPos, __ATOMIC_SEQ_CST ) == readPos &&
+            !_wait( _outSpace, false ))
+        {
+            return -1;
+        }
+    }
+}
+
+}
@@ -0,0 +1,94 @@
+
+/* Copyright (c) 2013, Stefan Eilemann <eile@equalizergraphics.com>
+ *
+ * This file is part of Collage <https://github.com/Eyescale/Collage>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 2.1 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef CO_SHMCONNECTION_H
+#define CO_SHMCONNECTION_H
+
+#include <co/connection.h> // base class
+
+namespace co
+{
+#ifndef CO_USE_SHM
+#  error ShmConnection is only supported on Linux
+#endif
+
+    /**
+     * A bi-directional connection between processes on the same host, using
+     * a pair of shared memory ring buffers.
+     *
+     * The listener binds an abstract unix domain socket named after the
+     * description's filename. On accept, it creates the shared memory and the
+     * eventfds for wakeup and passes them to the connecting process. The
+     * socket is kept open only to detect when the peer goes away.
+     *
+     * Each ring has a single writer and a single reader. The eventfd of a
+     * ring is only signaled when its reader has drained the ring, so
+     * continuous streaming does not make a system call per write.
+     */
+    class ShmConnection : public Connection
+    {
+    public:
+        ShmConnection();
+
+        virtual bool connect();
+        virtual bool listen();
+        virtual void acceptNB() { /* nop, the listening socket signals */ }
+        virtual ConnectionPtr acceptSync();
+        virtual void close() { _close(); }
+
+        /** @return an epoll set of the data eventfd and the socket. */
+        virtual Notifier getNotifier() const { return _notifier; }
+
+        /** @return true if the description is a listener on this host. */
+        static bool isLocal( ConstConnectionDescriptionPtr description );
+
+    protected:
+        virtual ~ShmConnection();
+
+        virtual void readNB( void*, const uint64_t ) { /* NOP */ }
+        virtual int64_t readSync( void* buffer, const uint64_t bytes,
+                                  const bool block );
+        virtual int64_t write( const void* buffer, const uint64_t bytes );
+
+    private:
+        struct Ring;
+
+        int _socket;   //!< listening socket, or hangup detection of the peer
+        int _notifier; //!< listening socket, or epoll set for reading
+        void* _memory;
+        uint64_t _memorySize;
+
+        Ring* _in;     //!< written by the peer
+        Ring* _out;    //!< written by this connection
+        int _inData;   //!< signaled by the peer after writing to the idle _in
+        int _inSpace;  //!< signaled to the peer after reading from a full _in
+        int _outData;  //!< signaled to the peer after writing to the idle _out
+        int _outSpace; //!< signaled by the peer after reading from a full _out
+
+        bool _create( const int socket );
+        bool _map( const int fd, const uint64_t size, const bool initialize );
+        bool _setupNotifier();
+        bool _isHungUp() const;
+        void _setIdle();
+        bool _wait( const int fd, const bool reading );
+        void _close();
+    };
+}
+
+#endif //CO_SHMCONNECTION_H
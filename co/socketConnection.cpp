@@ -26,6 +26,7 @@
 
 #include <lunchbox/os.h>
 #include <lunchbox/log.h>
+#include <lunchbox/scopedMutex.h>
 #include <lunchbox/sleep.h>
 #include <co/exception.h>
 
@@ -49,15 +50,48 @@
 #  ifndef AF_INET_SDP
 #    define AF_INET_SDP 27
 #  endif
+#  if defined( __linux__ ) && defined( SO_ZEROCOPY ) && defined( MSG_ZEROCOPY )
+#    include <linux/errqueue.h>
+#    include <poll.h>
+#    define CO_USE_ZEROCOPY
+#  endif
 #endif
 
 namespace co
 {
+#ifndef _WIN32
+namespace
+{
+/** @return true if zero-copy sends have been enabled on the socket. */
+#  ifdef CO_USE_ZEROCOPY
+bool _enableZeroCopy( const int fd )
+{
+    if( Global::getIAttribute( Global::IATTR_TCP_ZEROCOPY_SIZE ) <= 0 )
+        return false;
+
+    const int on = 1;
+    if( setsockopt( fd, SOL_SOCKET, SO_ZEROCOPY, &on, sizeof( on )) == 0 )
+        return true;
+    LBINFO << "Can't enable zero-copy send: " << lunchbox::sysError
+           << std::endl;
+    return false;
+}
+#  else
+bool _enableZeroCopy( const int ) { return false; }
+#  endif
+}
+#endif
+
 SocketConnection::SocketConnection( const ConnectionType type )
 #ifdef _WIN32
         : _overlappedAcceptData( 0 )
         , _overlappedSocket( INVALID_SOCKET )
         , _overlappedDone( 0 )
+#else
+        : _zeroCopy( false )
+        , _zeroCopySent( 0 )
+        , _zeroCopyDone( 0 )
+        , _zeroCopyCopied( false )
 #endif
 {
 #ifdef _WIN32
@@ -399,6 +433,7 @@ ConnectionPtr SocketConnection::acceptSync()
 
     newConnection->_readFD      = fd;
     newConnection->_writeFD     = fd;
+    newConnection->_zeroCopy    = _enableZeroCopy( fd );
     newConnection->_setState( STATE_CONNECTED );
     ConnectionDescriptionPtr newDescription = newConnection->_getDescription();
     newDescription->bandwidth = description->bandwidth;
@@ -411,6 +446,161 @@ ConnectionPtr SocketConnection::acceptSync()
     return newConnection;
 }
 
+//----------------------------------------------------------------------
+// write
+//----------------------------------------------------------------------
+int64_t SocketConnection::writeZeroCopy( const void* buffer,
+                                         const uint64_t bytes )
+{
+#ifdef CO_USE_ZEROCOPY
+    const int32_t minSize =
+        Global::getIAttribute( Global::IATTR_TCP_ZEROCOPY_SIZE );
+    if( !_zeroCopy || _zeroCopyCopied || minSize <= 0 ||
+        bytes < uint64_t( minSize ) || !isConnected( ))
+    {
+        return FDConnection::write( buffer, bytes );
+    }
+
+    const ssize_t sent = ::send( _writeFD, buffer, bytes, MSG_ZEROCOPY );
+    if( sent < 0 )
+    {
+        if( errno == ENOBUFS ) // out of pinned memory, copy this one
+            return FDConnection::write( buffer, bytes );
+        if( errno == EINTR )
+            return 0;
+        LBWARN << "Error during zero-copy send: " << lunchbox::sysError
+               << std::endl;
+        return -1;
+    }
+
+    // The kernel references the buffer until the data has been acknowledged.
+    // The caller keeps it alive until waitSent(), so only collect completions
+    // which are already queued.
+    ++_zeroCopySent;
+    if( _zeroCopyLock.trySet( ))
+    {
+        _readZeroCopyCompletions();
+        _zeroCopyLock.unset();
+    }
+
+    if( _zeroCopyCopied )
+        // e.g. loopback or a device without scatter-gather support
+        LBINFO << "Kernel copies zero-copy sends, disabling them on "
+               << getDescription() << std::endl;
+    return sent;
+#else
+    return FDConnection::write( buffer, bytes );
+#endif
+}
+
+void SocketConnection::waitSent( const uint32_t mark )
+{
+#ifdef CO_USE_ZEROCOPY
+    while( _zeroCopy && !_isSent( mark ))
+    {
+        if( _writeFD == INVALID_SOCKET ) // closed, nothing will complete
+            return;
+
+        // completions are queued on the error queue, signaled by POLLERR
+        struct pollfd fds[1];
+        fds[0].fd = _writeFD;
+        fds[0].events = 0;
+        fds[0].revents = 0;
+
+        const int32_t done = _zeroCopyDone;
+        const int res = poll( fds, 1, _getTimeOut( ));
+        if( res < 0 && errno == EINTR )
+            continue;
+
+        lunchbox::ScopedMutex<> mutex( _zeroCopyLock );
+        if( res <= 0 || !_readZeroCopyCompletions( ) ||
+            ( done == int32_t( _zeroCopyDone ) &&
+              ( fds[0].revents & POLLERR )))
+        {
+            LBWARN << "Zero-copy send did not complete, closing "
+                   << getDescription() << std::endl;
+            close();
+            return;
+        }
+    }
+#endif
+}
+
+bool SocketConnection::handleNotifications()
+{
+#ifdef CO_USE_ZEROCOPY
+    if( !_zeroCopy || _isSent( _zeroCopySent ))
+        return false;
+
+    lunchbox::ScopedMutex<> mutex( _zeroCopyLock );
+    while( true )
+    {
+        const int32_t done = _zeroCopyDone;
+        if( !_readZeroCopyCompletions( ))
+            return false;
+
+        struct pollfd fds[1];
+        fds[0].fd = _writeFD;
+        fds[0].events = 0;
+        fds[0].revents = 0;
+        if( poll( fds, 1, 0 ) <= 0 || !( fds[0].revents & POLLERR ))
+            return true; // only completions were pending
+
+        if( done == int32_t( _zeroCopyDone )) // nothing drained, socket error
+            return false;
+    }
+#else
+    return false;
+#endif
+}
+
+bool SocketConnection::_readZeroCopyCompletions()
+{
+#ifdef CO_USE_ZEROCOPY
+    while( true )
+    {
+        char control[ 128 ];
+        msghdr message;
+        ::memset( &message, 0, sizeof( message ));
+        message.msg_control = control;
+        message.msg_controllen = sizeof( control );
+
+        if( ::recvmsg( _writeFD, &message, MSG_ERRQUEUE ) < 0 )
+        {
+            if( errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR )
+                return true; // error queue drained
+            LBWARN << "Error reading zero-copy completions: "
+                   << lunchbox::sysError << std::endl;
+            return false;
+        }
+
+        for( cmsghdr* cmsg = CMSG_FIRSTHDR( &message ); cmsg;
+             cmsg = CMSG_NXTHDR( &message, cmsg ))
+        {
+            if( cmsg->cmsg_level != SOL_IP || cmsg->cmsg_type != IP_RECVERR )
+                continue;
+
+            const sock_extended_err* error =
+                reinterpret_cast< const sock_extended_err* >(
+                    CMSG_DATA( cmsg ));
+            if( error->ee_origin != SO_EE_ORIGIN_ZEROCOPY ||
+                error->ee_errno != 0 )
+            {
+                LBWARN << "Socket error during zero-copy send: "
+                       << strerror( error->ee_errno ) << std::endl;
+                return false;
+            }
+
+            // [ee_info, ee_data] is the range of completed sends
+            _zeroCopyDone += error->ee_data - error->ee_info + 1;
+            if( error->ee_code & SO_EE_CODE_ZEROCOPY_COPIED )
+                _zeroCopyCopied = true;
+        }
+    }
+#endif
+    return true;
+}
+
 #endif // !_WIN32
 
 
@@ -602,6 +792,9 @@ bool SocketConnection::_createSocket()
     }
 
     _tuneSocket( fd );
+#ifndef _WIN32
+    _zeroCopy = _enableZeroCopy( fd );
+#endif
 
     _readFD  = fd;
     _writeFD = fd; // TCP/IP sockets are bidirectional
@@ -627,6 +820,26 @@ void SocketConnection::_tuneSocket( const Socket fd )
     if ( snd != 0 )
         setsockopt( fd, SOL_SOCKET, SO_SNDBUF,
                 reinterpret_cast<const char*>( &snd ), sizeof( snd ));
+
+#ifdef SO_BUSY_POLL
+    // low-latency mode: poll the device queue instead of waiting for the IRQ
+    const int busyPoll = Global::getIAttribute(Global::IATTR_TCP_BUSY_POLL_US);
+    if( busyPoll > 0 )
+    {
+#  ifndef SO_PREFER_BUSY_POLL
+#    define SO_PREFER_BUSY_POLL 69 // Linux 5.11
+#  endif
+        if( setsockopt( fd, SOL_SOCKET, SO_BUSY_POLL,
+                        reinterpret_cast<const char*>( &busyPoll ),
+                        sizeof( busyPoll )) != 0 )
+        {
+            LBINFO << "Can't enable busy polling: " << lunchbox::sysError
+                   << std::endl;
+        }
+        setsockopt( fd, SOL_SOCKET, SO_PREFER_BUSY_POLL,
+                    reinterpret_cast<const char*>( &on ), sizeof( on ));
+    }
+#endif
 }
 
 //----------------------------------------------------------------------
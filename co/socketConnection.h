@@ -22,7 +22,9 @@
 
 #include <co/connectionType.h> // enum
 #include <lunchbox/api.h>
+#include <lunchbox/atomic.h> // member
 #include <lunchbox/buffer.h> // member
+#include <lunchbox/lock.h> // member
 #include <lunchbox/os.h>
 #include <lunchbox/thread.h> // for LB_TS_VAR
 
@@ -60,6 +62,12 @@ namespace co
         virtual ConnectionPtr acceptSync();
         virtual void close() { _close(); }
 
+#ifndef WIN32
+        virtual uint32_t getSendMark() const { return _zeroCopySent; }
+        virtual void waitSent( const uint32_t mark );
+        virtual void finish() { waitSent( _zeroCopySent ); }
+        virtual bool handleNotifications();
+#endif
 
 #ifdef WIN32
         /** @sa Connection::getNotifier */
@@ -77,6 +85,9 @@ namespace co
 
         typedef UINT_PTR Socket;
 #else
+        virtual int64_t writeZeroCopy( const void* buffer,
+                                       const uint64_t bytes );
+
         //! @cond IGNORE
         typedef int    Socket;
         enum
@@ -111,6 +122,16 @@ namespace co
         DWORD      _overlappedDone;
 
         LB_TS_VAR( _recvThread );
+#else
+        bool _zeroCopy; //!< MSG_ZEROCOPY enabled on the socket
+        lunchbox::a_int32_t _zeroCopySent; //!< zero-copy sends issued
+        lunchbox::a_int32_t _zeroCopyDone; //!< sends completed by the kernel
+        bool _zeroCopyCopied; //!< kernel copied the data nevertheless
+        lunchbox::Lock _zeroCopyLock; //!< serializes error queue readers
+
+        bool _isSent( const uint32_t mark ) const
+            { return int32_t( uint32_t( _zeroCopyDone ) - mark ) >= 0; }
+        bool _readZeroCopyCompletions();
 #endif
 
         void _close();
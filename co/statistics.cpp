@@ -0,0 +1,311 @@
+
+/* Copyright (c) 2013, Stefan Eilemann <eile@equalizergraphics.com>
+ *
+ * This file is part of Collage <https://github.com/Eyescale/Collage>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 2.1 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "statistics.h"
+
+#include "commands.h"
+
+#ifdef _MSC_VER
+#  define CO_THREAD_LOCAL __declspec( thread )
+#else
+#  define CO_THREAD_LOCAL __thread
+#endif
+
+namespace co
+{
+namespace
+{
+/** The slot of the calling thread plus one, 0 if not yet assigned */
+CO_THREAD_LOCAL size_t _threadSlot = 0;
+lunchbox::a_int32_t _nextSlot( 0 );
+
+enum
+{
+    NUM_TYPES = 3, // node, object, other
+    NUM_COMMANDS = 64
+};
+
+/** Per-thread command counters, indexed by slot, direction, type and cmd */
+struct CommandCounters
+{
+    lunchbox::Atomic< int64_t > count[ NUM_TYPES ][ NUM_COMMANDS ];
+    lunchbox::Atomic< int64_t > bytes[ NUM_TYPES ][ NUM_COMMANDS ];
+};
+
+Counter _counters[ Statistics::COUNTER_ALL ];
+Histogram _histograms[ Statistics::HISTOGRAM_ALL ];
+CommandCounters _commands[ Counter::NUM_SLOTS ][ 2 ];
+
+size_t _getBucket( uint64_t value )
+{
+    size_t bucket = 0;
+    for( size_t shift = 32; shift > 0; shift >>= 1 )
+    {
+        if( value >= ( 1ull << shift ))
+        {
+            value >>= shift;
+            bucket += shift;
+        }
+    }
+    return value == 0 ? 0 : bucket + 1;
+}
+
+size_t _getTypeIndex( const uint32_t type )
+{
+    switch( type )
+    {
+      case COMMANDTYPE_NODE:   return 0;
+      case COMMANDTYPE_OBJECT: return 1;
+      default:                 return 2;
+    }
+}
+
+size_t _getCommandIndex( const uint32_t cmd )
+{
+    return cmd < NUM_COMMANDS ? cmd : NUM_COMMANDS - 1;
+}
+
+const char* _getTypeName( const size_t index )
+{
+    static const char* names[ NUM_TYPES ] = { "node", "object", "other" };
+    return names[ index ];
+}
+
+const char* _getCounterName( const Statistics::CounterType type )
+{
+    static const char* names[ Statistics::COUNTER_ALL ] =
+    {
+        "bytesSent", "bytesReceived", "commandsSent", "commandsReceived",
+        "compressionIn", "compressionOut", "mapCacheHit", "mapCacheMiss",
+        "instanceCacheRead", "instanceCacheHit"
+    };
+    return names[ type ];
+}
+
+const char* _getHistogramName( const Statistics::HistogramType type )
+{
+    static const char* names[ Statistics::HISTOGRAM_ALL ] =
+        { "sendSize", "queueDepth" };
+    return names[ type ];
+}
+
+void _toJSON( std::ostream& os, const Histogram& histogram )
+{
+    os << "{ \"count\": " << histogram.getCount() << ", \"sum\": "
+       << histogram.getSum() << ", \"buckets\": [";
+    bool first = true;
+    for( size_t i = 0; i < Histogram::NUM_BUCKETS; ++i )
+    {
+        const int64_t count = histogram.get( i );
+        if( count == 0 )
+            continue;
+        os << ( first ? " " : ", " ) << "{ \"min\": "
+           << Histogram::getBucketMin( i ) << ", \"count\": " << count << " }";
+        first = false;
+    }
+    os << " ] }";
+}
+}
+
+//----------------------------------------------------------------------
+// Counter
+//----------------------------------------------------------------------
+size_t Counter::getThreadSlot()
+{
+    if( _threadSlot == 0 )
+        _threadSlot = size_t( ++_nextSlot - 1 ) % NUM_SLOTS + 1;
+    return _threadSlot - 1;
+}
+
+int64_t Counter::get() const
+{
+    int64_t sum = 0;
+    for( size_t i = 0; i < NUM_SLOTS; ++i )
+        sum += _slots[ i ].value;
+    return sum;
+}
+
+void Counter::reset()
+{
+    for( size_t i = 0; i < NUM_SLOTS; ++i )
+        _slots[ i ].value = 0;
+}
+
+//----------------------------------------------------------------------
+// Histogram
+//----------------------------------------------------------------------
+void Histogram::add( const uint64_t value )
+{
+    ++_buckets[ Counter::getThreadSlot() ][ _getBucket( value )];
+    _sum.add( int64_t( value ));
+}
+
+int64_t Histogram::get( const size_t bucket ) const
+{
+    int64_t count = 0;
+    for( size_t i = 0; i < Counter::NUM_SLOTS; ++i )
+        count += _buckets[ i ][ bucket ];
+    return count;
+}
+
+int64_t Histogram::getCount() const
+{
+    int64_t count = 0;
+    for( size_t i = 0; i < NUM_BUCKETS; ++i )
+        count += get( i );
+    return count;
+}
+
+void Histogram::reset()
+{
+    for( size_t i = 0; i < Counter::NUM_SLOTS; ++i )
+        for( size_t j = 0; j < NUM_BUCKETS; ++j )
+            _buckets[ i ][ j ] = 0;
+    _sum.reset();
+}
+
+void ConnectionStatistics::reset()
+{
+    bytesSent.reset();
+    bytesReceived.reset();
+    commandsSent.reset();
+    commandsReceived.reset();
+}
+
+//----------------------------------------------------------------------
+// Statistics
+//----------------------------------------------------------------------
+Counter& Statistics::getCounter( const CounterType type )
+{
+    return _counters[ type ];
+}
+
+Histogram& Statistics::getHistogram( const HistogramType type )
+{
+    return _histograms[ type ];
+}
+
+void Statistics::addCommand( const Direction direction, const uint32_t type,
+                             const uint32_t cmd, const uint64_t size )
+{
+    CommandCounters& counters =
+        _commands[ Counter::getThreadSlot() ][ direction ];
+    const size_t typeIndex = _getTypeIndex( type );
+    const size_t cmdIndex = _getCommandIndex( cmd );
+
+    ++counters.count[ typeIndex ][ cmdIndex ];
+    counters.bytes[ typeIndex ][ cmdIndex ] += int64_t( size );
+}
+
+int64_t Statistics::getCommands( const Direction direction,
+                                 const uint32_t type, const uint32_t cmd )
+{
+    const size_t typeIndex = _getTypeIndex( type );
+    const size_t cmdIndex = _getCommandIndex( cmd );
+    int64_t count = 0;
+    for( size_t i = 0; i < Counter::NUM_SLOTS; ++i )
+        count += _commands[ i ][ direction ].count[ typeIndex ][ cmdIndex ];
+    return count;
+}
+
+int64_t Statistics::getCommandBytes( const Direction direction,
+                                     const uint32_t type, const uint32_t cmd )
+{
+    const size_t typeIndex = _getTypeIndex( type );
+    const size_t cmdIndex = _getCommandIndex( cmd );
+    int64_t bytes = 0;
+    for( size_t i = 0; i < Counter::NUM_SLOTS; ++i )
+        bytes += _commands[ i ][ direction ].bytes[ typeIndex ][ cmdIndex ];
+    return bytes;
+}
+
+void Statistics::reset()
+{
+    for( size_t i = 0; i < COUNTER_ALL; ++i )
+        _counters[ i ].reset();
+    for( size_t i = 0; i < HISTOGRAM_ALL; ++i )
+        _histograms[ i ].reset();
+
+    for( size_t i = 0; i < Counter::NUM_SLOTS; ++i )
+        for( size_t j = 0; j < 2; ++j )
+            for( size_t k = 0; k < NUM_TYPES; ++k )
+                for( size_t l = 0; l < NUM_COMMANDS; ++l )
+                {
+                    _commands[ i ][ j ].count[ k ][ l ] = 0;
+                    _commands[ i ][ j ].bytes[ k ][ l ] = 0;
+                }
+}
+
+void Statistics::toJSON( std::ostream& os )
+{
+    os << "{ \"counters\": {";
+    for( size_t i = 0; i < COUNTER_ALL; ++i )
+        os << ( i == 0 ? " \"" : ", \"" )
+           << _getCounterName( CounterType( i )) << "\": "
+           << _counters[ i ].get();
+
+    os << " }, \"histograms\": {";
+    for( size_t i = 0; i < HISTOGRAM_ALL; ++i )
+    {
+        os << ( i == 0 ? " \"" : ", \"" )
+           << _getHistogramName( HistogramType( i )) << "\": ";
+        _toJSON( os, _histograms[ i ] );
+    }
+
+    os << " }, \"commands\": [";
+    bool first = true;
+    for( size_t i = 0; i < 2; ++i )
+    {
+        for( size_t j = 0; j < NUM_TYPES; ++j )
+        {
+            for( size_t k = 0; k < NUM_COMMANDS; ++k )
+            {
+                int64_t count = 0;
+                int64_t bytes = 0;
+                for( size_t l = 0; l < Counter::NUM_SLOTS; ++l )
+                {
+                    count += _commands[ l ][ i ].count[ j ][ k ];
+                    bytes += _commands[ l ][ i ].bytes[ j ][ k ];
+                }
+                if( count == 0 )
+                    continue;
+
+                os << ( first ? " " : ", " ) << "{ \"direction\": \""
+                   << ( i == SENT ? "sent" : "received" ) << "\", \"type\": \""
+                   << _getTypeName( j ) << "\", \"command\": " << k
+                   << ", \"count\": " << count << ", \"bytes\": " << bytes
+                   << " }";
+                first = false;
+            }
+        }
+    }
+    os << " ] }";
+}
+
+void Statistics::toJSON( std::ostream& os,
+                         const ConnectionStatistics& statistics )
+{
+    os << "{ \"bytesSent\": " << statistics.bytesSent.get()
+       << ", \"bytesReceived\": " << statistics.bytesReceived.get()
+       << ", \"commandsSent\": " << statistics.commandsSent.get()
+       << ", \"commandsReceived\": " << statistics.commandsReceived.get()
+       << " }";
+}
+
+}
@@ -0,0 +1,203 @@
+
+/* Copyright (c) 2013, Stefan Eilemann <eile@equalizergraphics.com>
+ *
+ * This file is part of Collage <https://github.com/Eyescale/Collage>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 2.1 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef CO_STATISTICS_H
+#define CO_STATISTICS_H
+
+#include <co/api.h>
+#include <co/types.h>
+#include <lunchbox/atomic.h> // member
+
+#include <iostream>
+
+namespace co
+{
+/**
+ * A 64 bit event counter.
+ *
+ * Each thread adds to one of a few cache-line sized slots, which keeps
+ * concurrent updates from different threads from contending. Reading sums all
+ * slots without locking.
+ */
+class Counter
+{
+public:
+    /** @internal The number of per-thread slots. */
+    enum { NUM_SLOTS = 8 };
+
+    /** Construct a new, zero counter. @version 1.0 */
+    Counter() {}
+
+    /** Add the given value. @version 1.0 */
+    void add( const int64_t value )
+        { _slots[ getThreadSlot() ].value += value; }
+
+    /** Increment the counter by one. @version 1.0 */
+    Counter& operator ++ () { add( 1 ); return *this; }
+
+    /** @return the sum of all values added. @version 1.0 */
+    CO_API int64_t get() const;
+
+    /** Reset the counter to zero. @version 1.0 */
+    CO_API void reset();
+
+    /** @internal @return the slot used by the calling thread. */
+    CO_API static size_t getThreadSlot();
+
+private:
+    struct Slot
+    {
+        lunchbox::Atomic< int64_t > value;
+        char padding[ 64 - sizeof( lunchbox::Atomic< int64_t >) ];
+    };
+    Slot _slots[ NUM_SLOTS ];
+};
+
+/**
+ * A histogram of values with power-of-two sized buckets.
+ *
+ * Bucket 0 counts zero values, bucket n values in [2^(n-1), 2^n). Like the
+ * Counter, each thread accumulates into its own slot.
+ */
+class Histogram
+{
+public:
+    /** The number of buckets. @version 1.0 */
+    enum { NUM_BUCKETS = 65 };
+
+    /** Construct a new, empty histogram. @version 1.0 */
+    Histogram() {}
+
+    /** Add a value. @version 1.0 */
+    CO_API void add( const uint64_t value );
+
+    /** @return the number of values in the given bucket. @version 1.0 */
+    CO_API int64_t get( const size_t bucket ) const;
+
+    /** @return the number of values added. @version 1.0 */
+    CO_API int64_t getCount() const;
+
+    /** @return the sum of all values added. @version 1.0 */
+    int64_t getSum() const { return _sum.get(); }
+
+    /** @return the smallest value counted in the given bucket. @version 1.0 */
+    static uint64_t getBucketMin( const size_t bucket )
+        { return bucket == 0 ? 0 : 1ull << ( bucket - 1 ); }
+
+    /** Reset the histogram. @version 1.0 */
+    CO_API void reset();
+
+private:
+    lunchbox::Atomic< int64_t > _buckets[ Counter::NUM_SLOTS ][ NUM_BUCKETS ];
+    Counter _sum;
+};
+
+/** Traffic counters of a single Connection. */
+struct ConnectionStatistics
+{
+    Counter bytesSent; //!< Bytes written to the connection
+    Counter bytesReceived; //!< Bytes of the commands received
+    Counter commandsSent; //!< Commands written to the connection
+    Counter commandsReceived; //!< Commands received from the connection
+
+    CO_API void reset(); //!< Reset all counters
+};
+
+/**
+ * Process-wide statistics of Collage.
+ *
+ * The counters are always updated, but at a cost of a thread-local lookup and
+ * an uncontended atomic add per event. Counters of each Connection are
+ * available through Connection::getStatistics(), and
+ * LocalNode::printStatistics() dumps all statistics in JSON format.
+ */
+class Statistics
+{
+public:
+    /** The process-wide counters. */
+    enum CounterType
+    {
+        BYTES_SENT,          //!< Bytes written to all non-buffer connections
+        BYTES_RECEIVED,      //!< Bytes of all commands received
+        COMMANDS_SENT,       //!< Commands written to all connections
+        COMMANDS_RECEIVED,   //!< Commands received from all connections
+        COMPRESSION_IN,      //!< Object data bytes given to the compressor
+        COMPRESSION_OUT,     //!< Resulting compressed object data bytes
+        MAP_CACHE_HIT,       //!< Mapped versions served from a slave cache
+        MAP_CACHE_MISS,      //!< Mapped versions sent to the slave
+        INSTANCE_CACHE_READ, //!< Instance cache lookups during mapping
+        INSTANCE_CACHE_HIT,  //!< Successful instance cache lookups
+        COUNTER_ALL
+    };
+
+    /** The process-wide histograms. */
+    enum HistogramType
+    {
+        SEND_SIZE,   //!< Size of each non-buffered Connection::send()
+        QUEUE_DEPTH, //!< Size of a CommandQueue after each push
+        HISTOGRAM_ALL
+    };
+
+    /** The direction of a command. */
+    enum Direction
+    {
+        SENT,
+        RECEIVED
+    };
+
+    /** @return the given process-wide counter. @version 1.0 */
+    CO_API static Counter& getCounter( const CounterType type );
+
+    /** @return the given process-wide histogram. @version 1.0 */
+    CO_API static Histogram& getHistogram( const HistogramType type );
+
+    /**
+     * @return the number of commands of the given type and command.
+     *
+     * Node and object commands are counted separately, all other types
+     * together. Commands of 63 and above share a counter.
+     * @version 1.0
+     */
+    CO_API static int64_t getCommands( const Direction direction,
+                                       const uint32_t type,
+                                       const uint32_t cmd );
+
+    /** @return the bytes of the given command type and command. @version 1.0*/
+    CO_API static int64_t getCommandBytes( const Direction direction,
+                                           const uint32_t type,
+                                           const uint32_t cmd );
+
+    /** @internal Count a command sent or received. */
+    CO_API static void addCommand( const Direction direction,
+                                   const uint32_t type, const uint32_t cmd,
+                                   const uint64_t size );
+
+    /** Reset all process-wide statistics. @version 1.0 */
+    CO_API static void reset();
+
+    /** Write the process-wide statistics as a JSON object. @version 1.0 */
+    CO_API static void toJSON( std::ostream& os );
+
+    /** Write the given connection counters as a JSON object. @version 1.0 */
+    CO_API static void toJSON( std::ostream& os,
+                               const ConnectionStatistics& statistics );
+};
+}
+
+#endif // CO_STATISTICS_H
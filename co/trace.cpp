@@ -0,0 +1,210 @@
+
+/* Copyright (c) 2013, Stefan Eilemann <eile@equalizergraphics.com>
+ *
+ * This file is part of Collage <https://github.com/Eyescale/Collage>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 2.1 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "trace.h"
+
+#include <lunchbox/clock.h>
+#include <lunchbox/debug.h>
+#include <lunchbox/os.h>
+
+#include <ittnotify.h> // dummy header installed by FindVTune if not found
+#include <algorithm>
+#include <vector>
+
+#ifdef _WIN32
+#  define CO_THREAD_LOCAL __declspec( thread )
+#else
+#  include <sys/time.h>
+#  include <unistd.h>
+#  define CO_THREAD_LOCAL __thread
+#endif
+
+namespace co
+{
+namespace
+{
+struct Event
+{
+    Event()
+        : stage( Trace::STAGE_ALL ), thread( 0 ), start( 0 ), duration( 0 )
+    {}
+
+    Trace::Stage stage;
+    uint32_t thread;
+    int64_t start;
+    int64_t duration;
+};
+
+int64_t _getSystemTime()
+{
+#ifdef _WIN32
+    FILETIME fileTime;
+    GetSystemTimeAsFileTime( &fileTime );
+    ULARGE_INTEGER time;
+    time.LowPart = fileTime.dwLowDateTime;
+    time.HighPart = fileTime.dwHighDateTime;
+    // 100ns intervals since 1601 to microseconds since 1970
+    return int64_t( time.QuadPart / 10 ) - 11644473600000000ll;
+#else
+    timeval time;
+    gettimeofday( &time, 0 );
+    return int64_t( time.tv_sec ) * 1000000 + time.tv_usec;
+#endif
+}
+
+uint32_t _getProcessID()
+{
+#ifdef _WIN32
+    return uint32_t( GetCurrentProcessId( ));
+#else
+    return uint32_t( ::getpid( ));
+#endif
+}
+
+const lunchbox::Clock _clock;
+const int64_t _epoch = _getSystemTime() - int64_t( _clock.getTimed() * 1000. );
+
+std::vector< Event > _events;
+lunchbox::Atomic< int64_t > _next( 0 );
+
+/** The trace identifier of the calling thread, 0 if not yet assigned */
+CO_THREAD_LOCAL uint32_t _threadID = 0;
+lunchbox::a_int32_t _nextThreadID( 0 );
+
+uint32_t _getThreadID()
+{
+    if( _threadID == 0 )
+        _threadID = uint32_t( ++_nextThreadID );
+    return _threadID;
+}
+
+#ifndef INTEL_NO_ITTNOTIFY_API
+struct ITT
+{
+    ITT() : domain( __itt_domain_create( "Collage" ))
+    {
+        for( size_t i = 0; i < Trace::STAGE_ALL; ++i )
+            handles[ i ] =
+                __itt_string_handle_create( Trace::getName( Trace::Stage( i )));
+    }
+
+    __itt_domain* const domain;
+    __itt_string_handle* handles[ Trace::STAGE_ALL ];
+};
+
+ITT& _getITT()
+{
+    static ITT itt;
+    return itt;
+}
+#endif
+}
+
+lunchbox::a_int32_t Trace::_enabled( 0 );
+
+void Trace::enable( const size_t capacity )
+{
+    LBASSERT( capacity > 0 );
+    if( capacity != _events.size( ))
+    {
+        _enabled = 0;
+        _events.assign( capacity, Event( ));
+        _next = 0;
+    }
+    _enabled = 1;
+}
+
+void Trace::disable()
+{
+    _enabled = 0;
+}
+
+void Trace::clear()
+{
+    _next = 0;
+}
+
+size_t Trace::getSize()
+{
+    return std::min( size_t( int64_t( _next )), _events.size( ));
+}
+
+void Trace::toChromeJSON( std::ostream& os )
+{
+    const size_t size = getSize();
+    const size_t first =
+        size < _events.size() ? 0 : size_t( int64_t( _next )) % size;
+    const uint32_t pid = _getProcessID();
+
+    os << "{ \"traceEvents\": [";
+    for( size_t i = 0; i < size; ++i )
+    {
+        const Event& event = _events[ ( first + i ) % size ];
+        os << ( i == 0 ? " " : ", " ) << "{ \"name\": \""
+           << getName( event.stage ) << "\", \"cat\": \"co\", \"ph\": \"X\", "
+           << "\"ts\": " << event.start << ", \"dur\": " << event.duration
+           << ", \"pid\": " << pid << ", \"tid\": " << event.thread << " }";
+    }
+    os << " ], \"displayTimeUnit\": \"ms\" }";
+}
+
+const char* Trace::getName( const Stage stage )
+{
+    static const char* names[ STAGE_ALL ] =
+    {
+        "readHead", "readTail", "dispatch", "queueWait", "handle", "commit",
+        "sync"
+    };
+    return names[ stage ];
+}
+
+int64_t Trace::getTime()
+{
+    return _epoch + int64_t( _clock.getTimed() * 1000. );
+}
+
+void Trace::add( const Stage stage, const int64_t start, const int64_t end )
+{
+    const size_t capacity = _events.size();
+    if( capacity == 0 )
+        return;
+
+    Event& event = _events[ size_t( ++_next - 1 ) % capacity ];
+    event.stage = stage;
+    event.thread = _getThreadID();
+    event.start = start;
+    event.duration = end - start;
+}
+
+#ifdef INTEL_NO_ITTNOTIFY_API
+void Trace::beginTask( const Stage ) {}
+void Trace::endTask() {}
+#else
+void Trace::beginTask( const Stage stage )
+{
+    ITT& itt = _getITT();
+    __itt_task_begin( itt.domain, __itt_null, __itt_null, itt.handles[stage] );
+}
+
+void Trace::endTask()
+{
+    __itt_task_end( _getITT().domain );
+}
+#endif
+}
@@ -0,0 +1,140 @@
+
+/* Copyright (c) 2013, Stefan Eilemann <eile@equalizergraphics.com>
+ *
+ * This file is part of Collage <https://github.com/Eyescale/Collage>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 2.1 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef CO_TRACE_H
+#define CO_TRACE_H
+
+#include <co/api.h>
+#include <co/types.h>
+#include <lunchbox/atomic.h>
+#include <boost/noncopyable.hpp>
+
+#include <iostream>
+
+namespace co
+{
+/**
+ * Tracing of the life of commands and of object commit and sync.
+ *
+ * Each traced stage is reported as an ITT task when Collage is built with
+ * VTune. Independently, spans are recorded into a process-wide ring buffer
+ * while tracing is enabled, which can be exported in the Chrome trace event
+ * format for chrome://tracing. Span timestamps are based on the system time,
+ * so that traces of different nodes can be merged into one timeline.
+ */
+class Trace
+{
+public:
+    /** The traced stages. */
+    enum Stage
+    {
+        READ_HEAD,  //!< Receive of a command header
+        READ_TAIL,  //!< Receive of the remainder of a command
+        DISPATCH,   //!< Dispatch of a received command
+        QUEUE_WAIT, //!< Time between push and pop of a CommandQueue
+        HANDLE,     //!< Execution of a command handler by a worker thread
+        COMMIT,     //!< Object::commit()
+        SYNC,       //!< Object::sync()
+        STAGE_ALL
+    };
+
+    /**
+     * Start recording spans into a ring buffer of the given size.
+     *
+     * Once full, the oldest spans are overwritten. Changing the capacity
+     * discards all recorded spans and must not be done while traced
+     * operations are running.
+     * @version 1.0
+     */
+    CO_API static void enable( const size_t capacity = 65536 );
+
+    /** Stop recording spans, keeping the recorded ones. @version 1.0 */
+    CO_API static void disable();
+
+    /** @return true if spans are recorded. @version 1.0 */
+    static bool isEnabled() { return _enabled != 0; }
+
+    /** Discard all recorded spans. @version 1.0 */
+    CO_API static void clear();
+
+    /** @return the number of spans in the ring buffer. @version 1.0 */
+    CO_API static size_t getSize();
+
+    /**
+     * Write the recorded spans in the Chrome trace event format.
+     *
+     * The output is only consistent while no spans are recorded concurrently.
+     * @version 1.0
+     */
+    CO_API static void toChromeJSON( std::ostream& os );
+
+    /** @return the name of the given stage. @version 1.0 */
+    CO_API static const char* getName( const Stage stage );
+
+    /** @internal @return the current trace time in microseconds. */
+    CO_API static int64_t getTime();
+
+    /** @internal Record a finished span of the calling thread. */
+    CO_API static void add( const Stage stage, const int64_t start,
+                            const int64_t end );
+
+    /** @internal Begin an ITT task for the given stage. */
+    CO_API static void beginTask( const Stage stage );
+
+    /** @internal End the current ITT task of the calling thread. */
+    CO_API static void endTask();
+
+private:
+    CO_API static lunchbox::a_int32_t _enabled;
+};
+
+/**
+ * @internal Traces the lifetime of an instance as the given stage.
+ *
+ * Without VTune and with tracing disabled, this only costs one atomic load.
+ */
+class TraceSpan : public boost::noncopyable
+{
+public:
+    explicit TraceSpan( const Trace::Stage stage )
+        : _stage( stage ), _enabled( Trace::isEnabled( ))
+        , _start( _enabled ? Trace::getTime() : 0 )
+    {
+#ifndef INTEL_NO_ITTNOTIFY_API
+        Trace::beginTask( stage );
+#endif
+    }
+
+    ~TraceSpan()
+    {
+#ifndef INTEL_NO_ITTNOTIFY_API
+        Trace::endTask();
+#endif
+        if( _enabled )
+            Trace::add( _stage, _start, Trace::getTime( ));
+    }
+
+private:
+    const Trace::Stage _stage;
+    const bool _enabled;
+    const int64_t _start;
+};
+}
+
+#endif // CO_TRACE_H
@@ -67,6 +67,7 @@ class QueueSlave;
 class Serializable;
 class Zeroconf;
 template< class Q > class WorkerThread;
+struct ConnectionStatistics;
 struct ObjectVersion;
 
 using lunchbox::UUID;
@@ -75,6 +76,7 @@ using lunchbox::Strings;
 using lunchbox::StringsCIter;
 
 typedef UUID NodeID; //!< A unique identifier for nodes.
+typedef std::vector< NodeID > NodeIDs; //!< A vector of node identifiers
 
 /** A reference pointer for Node pointers. */
 typedef lunchbox::RefPtr< Node >                  NodePtr;
@@ -56,7 +56,7 @@ uint128_t UnbufferedMasterCM::commit( const uint32_t incarnation )
         return _version;
 
     ObjectDeltaDataOStream os( this );
-    os.enableCommit( _version + 1, *_slaves );
+    os.enableCommit( _version + 1, _getCommitReceivers( _version + 1 ));
     _object->pack( os );
     os.disable();
 
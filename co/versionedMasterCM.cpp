@@ -20,10 +20,16 @@
 
 #include "versionedMasterCM.h"
 
+#include "connection.h"
+#include "global.h"
+#include "localNode.h"
 #include "log.h"
+#include "nodeCommand.h"
 #include "object.h"
 #include "objectDataICommand.h"
 #include "objectDataIStream.h"
+#include "oCommand.h"
+#include "relayTree.h"
 
 namespace co
 {
@@ -33,6 +39,9 @@ VersionedMasterCM::VersionedMasterCM( Object* object )
         : ObjectCM( object )
         , _version( VERSION_NONE )
         , _maxVersion( std::numeric_limits< uint64_t >::max( ))
+        , _relayFanout( 0 )
+        , _relayDirty( false )
+        , _relayPending( false )
 {
     LBASSERT( object );
     LBASSERT( object->getLocalNode( ));
@@ -55,6 +64,10 @@ VersionedMasterCM::VersionedMasterCM( Object* object )
 
 VersionedMasterCM::~VersionedMasterCM()
 {
+    LocalNodePtr localNode = _object->getLocalNode();
+    for( size_t i = 0; i < _relayRequests.size(); ++i )
+        if( localNode )
+            localNode->unregisterRequest( _relayRequests[ i ] );
     _slaves->clear();
 }
 
@@ -106,8 +119,8 @@ void VersionedMasterCM::addSlave( MasterCMCommand command )
     LB_TS_THREAD( _cmdThread );
     Mutex mutex( _slaves );
 
+    NodePtr node = command.getNode();
     SlaveData data;
-    data.node = command.getNode();
     data.instanceID = command.getInstanceID();
     data.maxVersion = command.getMaxVersion();
     if( data.maxVersion == 0 )
@@ -115,12 +128,20 @@ void VersionedMasterCM::addSlave( MasterCMCommand command )
     else if( data.maxVersion < std::numeric_limits< uint64_t >::max( ))
         data.maxVersion += _version.low();
 
-    _slaveData.push_back( data );
+    _slaveData[ node->getNodeID() ].push_back( data );
+    _addMaxVersion( data.maxVersion );
     _updateMaxVersion();
 
-    _slaves->push_back( data.node );
+    _slaves->push_back( node );
     stde::usort( *_slaves );
+    if( stde::find( _relayNodes, node ) == _relayNodes.end( ))
+    {
+        _relayNodes.push_back( node );
+        _relayDirty = true;
+    }
 
+    if( command.getRequestedVersion() == VERSION_NONE )
+        _notifyEmptySlave();
     ObjectCM::_addSlave( command, _version );
 }
 
@@ -133,16 +154,19 @@ void VersionedMasterCM::addPushSlaves(const Nodes& nodes)
         NodePtr node = *i;
 
         SlaveData data;
-        data.node = node;
         data.instanceID = _object->getInstanceID();
         data.maxVersion = std::numeric_limits< uint64_t >::max();
-        
-        _slaveData.push_back( data );
-        _updateMaxVersion();
 
-        _slaves->push_back( data.node );
+        _slaveData[ node->getNodeID() ].push_back( data );
+        _slaves->push_back( node );
+        if( stde::find( _relayNodes, node ) == _relayNodes.end( ))
+        {
+            _relayNodes.push_back( node );
+            _relayDirty = true;
+        }
     }
     stde::usort( *_slaves );
+    _notifyEmptySlave();
 }
 
 void VersionedMasterCM::removeSlave( NodePtr node, const uint32_t instanceID )
@@ -151,21 +175,33 @@ void VersionedMasterCM::removeSlave( NodePtr node, const uint32_t instanceID )
     Mutex mutex( _slaves );
 
     // remove from subscribers
-    SlaveData data;
-    data.node = node;
-    data.instanceID = instanceID;
-    SlaveDatasIter i = stde::find( _slaveData, data );
+    SlaveDataHashIter i = _slaveData.find( node->getNodeID( ));
     LBASSERTINFO( i != _slaveData.end(), lunchbox::className( _object ));
     if( i == _slaveData.end( ))
         return;
 
-    _slaveData.erase( i );
+    SlaveDatas& datas = i->second;
+    SlaveDatasIter j = datas.begin();
+    for( ; j != datas.end(); ++j )
+        if( j->instanceID == instanceID )
+            break;
+
+    LBASSERTINFO( j != datas.end(), lunchbox::className( _object ));
+    if( j == datas.end( ))
+        return;
+
+    _removeMaxVersion( j->maxVersion );
+    datas.erase( j );
 
     // update _slaves node vector
-    _slaves->clear();
-    for( i = _slaveData.begin(); i != _slaveData.end(); ++i )
-        _slaves->push_back( i->node );
-    stde::usort( *_slaves );
+    if( datas.empty( ))
+    {
+        _slaveData.erase( i );
+        NodesIter k = stde::find( *_slaves, node );
+        if( k != _slaves->end( ))
+            _slaves->erase( k );
+        _updateRelayNodes();
+    }
     _updateMaxVersion();
 }
 
@@ -180,32 +216,186 @@ void VersionedMasterCM::removeSlaves( NodePtr node )
         return;
     _slaves->erase( i );
 
-    for( SlaveDatasIter j = _slaveData.begin(); j != _slaveData.end(); )
+    SlaveDataHashIter j = _slaveData.find( node->getNodeID( ));
+    if( j != _slaveData.end( ))
     {
-        if( j->node == node )
-            j = _slaveData.erase( j );
-        else
-            ++j;
+        const SlaveDatas& datas = j->second;
+        for( SlaveDatasCIter k = datas.begin(); k != datas.end(); ++k )
+            _removeMaxVersion( k->maxVersion );
+        _slaveData.erase( j );
     }
     _updateMaxVersion();
+    _updateRelayNodes();
 }
 
-void VersionedMasterCM::_updateMaxVersion()
+void VersionedMasterCM::setSlaveMaxVersion( NodePtr node,
+                                            const uint32_t instanceID,
+                                            const uint64_t version )
 {
-    uint64_t maxVersion = std::numeric_limits< uint64_t >::max();
-    for( SlaveDatasCIter i = _slaveData.begin(); i != _slaveData.end(); ++i )
+    Mutex mutex( _slaves );
+
+    SlaveDataHashIter i = _slaveData.find( node->getNodeID( ));
+    if( i != _slaveData.end( ))
     {
-        if( i->maxVersion != std::numeric_limits< uint64_t >::max() &&
-            maxVersion > i->maxVersion )
+        SlaveDatas& datas = i->second;
+        for( SlaveDatasIter j = datas.begin(); j != datas.end(); ++j )
         {
-            maxVersion = i->maxVersion;
+            if( j->instanceID != instanceID )
+                continue;
+
+            _removeMaxVersion( j->maxVersion );
+            j->maxVersion = version;
+            _addMaxVersion( version );
+            _updateMaxVersion();
+            return;
         }
     }
+    LBWARN << "Got max version from unmapped slave" << std::endl;
+}
+
+void VersionedMasterCM::_addMaxVersion( const uint64_t version )
+{
+    if( version != std::numeric_limits< uint64_t >::max( ))
+        _maxVersions.insert( version );
+}
+
+void VersionedMasterCM::_removeMaxVersion( const uint64_t version )
+{
+    if( version == std::numeric_limits< uint64_t >::max( ))
+        return;
+
+    std::multiset< uint64_t >::iterator i = _maxVersions.find( version );
+    LBASSERT( i != _maxVersions.end( ));
+    if( i != _maxVersions.end( ))
+        _maxVersions.erase( i );
+}
+
+void VersionedMasterCM::_updateMaxVersion()
+{
+    const uint64_t maxVersion = _maxVersions.empty() ?
+        std::numeric_limits< uint64_t >::max() : *_maxVersions.begin();
 
     if( _maxVersion != maxVersion )
        _maxVersion = maxVersion;
 }
 
+void VersionedMasterCM::_updateRelayNodes()
+{
+    // Keep the order of the remaining nodes: their position in the relay tree
+    // only changes if one of their ancestors unsubscribed.
+    for( NodesIter i = _relayNodes.begin(); i != _relayNodes.end(); )
+    {
+        if( stde::find( *_slaves, *i ) == _slaves->end( ))
+        {
+            i = _relayNodes.erase( i );
+            _relayDirty = true;
+        }
+        else
+            ++i;
+    }
+}
+
+void VersionedMasterCM::_prepareRelayTree()
+{
+    LocalNodePtr localNode = _object->getLocalNode();
+    for( size_t i = 0; i < _relayRequests.size(); ++i )
+        localNode->unregisterRequest( _relayRequests[ i ] );
+    _relayRequests.clear();
+    _pendingRelayTree.clear();
+    _relayDirty = false;
+    _relayPending = true;
+
+    // Relay nodes forward the raw command buffers, only nodes with our byte
+    // order can be part of the tree. The local node and multicast receivers
+    // are always served directly.
+    for( NodesCIter i = _relayNodes.begin(); i != _relayNodes.end(); ++i )
+    {
+        NodePtr node = *i;
+        ConnectionPtr connection = node->getConnection( true );
+        if( node->getNodeID() != localNode->getNodeID() &&
+            node->isBigEndian() == localNode->isBigEndian() &&
+            !( connection && connection->isMulticast( )))
+        {
+            _pendingRelayTree.push_back( node->getNodeID( ));
+        }
+    }
+
+    // Inner nodes connect to their children on their command thread
+    const uint32_t fanout = uint32_t( _relayFanout );
+    for( size_t i = 0; i < _pendingRelayTree.size(); ++i )
+    {
+        const NodeIDs children = relayTree::getChildren( _pendingRelayTree, i,
+                                                         fanout );
+        if( children.empty( ))
+            break; // heap order, no later node has children
+
+        NodePtr node = localNode->getNode( _pendingRelayTree[ i ] );
+        if( !node )
+            continue;
+        const uint32_t request = localNode->registerRequest();
+        node->send( CMD_NODE_OBJECT_RELAY_CONNECT ) << request << children;
+        _relayRequests.push_back( request );
+    }
+}
+
+bool VersionedMasterCM::_isRelayTreeReady()
+{
+    if( !_relayPending )
+        return true;
+
+    LocalNodePtr localNode = _object->getLocalNode();
+    for( size_t i = 0; i < _relayRequests.size(); ++i )
+        if( !localNode->isRequestServed( _relayRequests[ i ] ))
+            return false;
+
+    for( size_t i = 0; i < _relayRequests.size(); ++i )
+        localNode->waitRequest( _relayRequests[ i ] );
+    _relayRequests.clear();
+    _relayTree.swap( _pendingRelayTree );
+    _pendingRelayTree.clear();
+    _relayPending = false;
+    return true;
+}
+
+Nodes VersionedMasterCM::_getCommitReceivers( const uint128_t& version )
+{
+    const int32_t fanout =
+        Global::getIAttribute( Global::IATTR_OBJECT_RELAY_FANOUT );
+    if( fanout <= 0 )
+        return *_slaves;
+
+    if( fanout != _relayFanout )
+    {
+        _relayFanout = fanout;
+        _relayDirty = true;
+    }
+    if( _relayDirty )
+        _prepareRelayTree();
+
+    // Versions sent directly during a tree change may overtake relayed ones,
+    // the slaves apply them in order.
+    if( !_isRelayTreeReady() || _relayTree.size() <= size_t( fanout ))
+        return *_slaves;
+
+    const std::set< NodeID > relayed( _relayTree.begin() + fanout,
+                                      _relayTree.end( ));
+    Nodes receivers;
+    for( NodesCIter i = _slaves->begin(); i != _slaves->end(); ++i )
+        if( relayed.find( (*i)->getNodeID( )) == relayed.end( ))
+            receivers.push_back( *i );
+
+    LocalNodePtr localNode = _object->getLocalNode();
+    for( size_t i = 0; i < size_t( fanout ); ++i )
+    {
+        const NodeIDs subtree = relayTree::getSubtree( _relayTree, i, fanout );
+        NodePtr child = localNode->getNode( _relayTree[ i ] );
+        if( child && !subtree.empty( ))
+            child->send( CMD_NODE_OBJECT_RELAY )
+                << _object->getID() << version << uint32_t( fanout ) << subtree;
+    }
+    return receivers;
+}
+
 //---------------------------------------------------------------------------
 // command handlers
 //---------------------------------------------------------------------------
@@ -226,21 +416,7 @@ bool VersionedMasterCM::_cmdMaxVersion( ICommand& cmd )
     const uint64_t version = command.get< uint64_t >();
     const uint32_t slaveID = command.get< uint32_t >();
 
-    Mutex mutex( _slaves );
-
-    // Update slave's max version
-    SlaveData data;
-    data.node = command.getNode();
-    data.instanceID = slaveID;
-    SlaveDatasIter i = stde::find( _slaveData, data );
-    if( i == _slaveData.end( ))
-    {
-        LBWARN << "Got max version from unmapped slave" << std::endl;
-        return true;
-    }
-    i->maxVersion = version;
-
-    _updateMaxVersion();
+    setSlaveMaxVersion( command.getNode(), slaveID, version );
     return true;
 }
 
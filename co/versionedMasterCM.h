@@ -30,6 +30,8 @@
 #include <lunchbox/stdExt.h>  // member
 #include <lunchbox/thread.h>  // thread-safety check
 
+#include <set>
+
 namespace co
 {
     /**
@@ -67,6 +69,9 @@ namespace co
         virtual const Nodes getSlaveNodes() const
             { Mutex mutex( _slaves ); return *_slaves; }
         virtual void addPushSlaves( const Nodes& nodes);
+        virtual void setSlaveMaxVersion( NodePtr node,
+                                         const uint32_t instanceID,
+                                         const uint64_t version );
 
     protected:
         /** The list of subscribed slave nodes. */
@@ -78,30 +83,72 @@ namespace co
         /** Maximum master version allowed to commit. */
         lunchbox::Monitor< uint64_t > _maxVersion;
 
+        /**
+         * Set up the relay tree for committing the given version.
+         *
+         * With Global::IATTR_OBJECT_RELAY_FANOUT set and more slave nodes than
+         * the fanout, the slaves are arranged in a k-ary tree, ordered by the
+         * time they subscribed. The tree only changes when slaves subscribe or
+         * unsubscribe. A new tree is used once all inner nodes connected to
+         * their children, until then all slaves are served directly. The
+         * relay tree is sent to the first level of the tree, which forwards
+         * the commit data to its children. Has to be called with _slaves
+         * locked, right before enableCommit().
+         *
+         * @return the nodes the commit data has to be sent to.
+         */
+        Nodes _getCommitReceivers( const uint128_t& version );
+
+        /**
+         * Called with _slaves locked when slaves were added which did not
+         * receive the instance data of the current version.
+         */
+        virtual void _notifyEmptySlave() {}
+
     private:
         struct SlaveData
         {
             SlaveData() : maxVersion( std::numeric_limits< uint64_t >::max( ))
                         , instanceID( LB_UNDEFINED_UINT32 ) {}
-            bool operator == ( const SlaveData& rhs ) const
-                { return node == rhs.node && instanceID == rhs.instanceID; }
 
-            NodePtr node;
             uint64_t maxVersion;
             uint32_t instanceID;
         };
         typedef std::vector< SlaveData > SlaveDatas;
         typedef SlaveDatas::const_iterator SlaveDatasCIter;
         typedef SlaveDatas::iterator SlaveDatasIter;
+        typedef stde::hash_map< uint128_t, SlaveDatas > SlaveDataHash;
+        typedef SlaveDataHash::iterator SlaveDataHashIter;
+
+        /** Additional slave data, indexed by the slave's node identifier. */
+        SlaveDataHash _slaveData;
+
+        /** The bounded max versions of all slaves, the first limits commit. */
+        std::multiset< uint64_t > _maxVersions;
+
+        /** The unique slave nodes in subscription order, for relaying. */
+        Nodes _relayNodes;
+
+        /** The relay tree in use, in heap order. */
+        NodeIDs _relayTree;
 
-        /** Additional slave data. */
-        SlaveDatas _slaveData;
+        /** The next relay tree, used once all _relayRequests are served. */
+        NodeIDs _pendingRelayTree;
+        std::vector< uint32_t > _relayRequests;
+        int32_t _relayFanout;
+        bool _relayDirty;
+        bool _relayPending;
 
         /** Slave commit queue. */
         DataIStreamQueue _slaveCommits;
 
         uint128_t _apply( ObjectDataIStream* is );
+        void _addMaxVersion( const uint64_t version );
+        void _removeMaxVersion( const uint64_t version );
         void _updateMaxVersion();
+        void _updateRelayNodes();
+        void _prepareRelayTree();
+        bool _isRelayTreeReady();
 
         /* The command handlers. */
         bool _cmdSlaveDelta( ICommand& command );
@@ -35,7 +35,7 @@ typedef CommandFunc< VersionedSlaveCM > CmdFunc;
 VersionedSlaveCM::VersionedSlaveCM( Object* object, uint32_t masterInstanceID )
         : ObjectCM( object )
         , _version( VERSION_NONE )
-        , _currentIStream( 0 )
+        , _lastQueued( VERSION_NONE )
         , _masterInstanceID( masterInstanceID )
 #pragma warning(push)
 #pragma warning(disable: 4355)
@@ -55,9 +55,19 @@ VersionedSlaveCM::~VersionedSlaveCM()
     while( !_queuedVersions.isEmpty( ))
         delete _queuedVersions.pop();
 
-    LBASSERT( !_currentIStream );
-    delete _currentIStream;
-    _currentIStream = 0;
+    LBASSERT( _currentIStreams.empty( ));
+    for( IStreamMap::const_iterator i = _currentIStreams.begin();
+         i != _currentIStreams.end(); ++i )
+    {
+        delete i->second;
+    }
+    for( IStreamMap::const_iterator i = _heldIStreams.begin();
+         i != _heldIStreams.end(); ++i )
+    {
+        delete i->second;
+    }
+    _currentIStreams.clear();
+    _heldIStreams.clear();
 
     _version = VERSION_NONE;
     _master = 0;
@@ -106,7 +116,10 @@ uint128_t VersionedSlaveCM::sync( const uint128_t& v )
 
     LocalNodePtr node = _object->getLocalNode();
     if( node.isValid( ))
+    {
+        node->flushMaxVersions();
         node->flushCommands();
+    }
 
     return _version;
 }
@@ -122,7 +135,10 @@ void VersionedSlaveCM::_syncToHead()
 
     LocalNodePtr localNode = _object->getLocalNode();
     if( localNode.isValid( ))
+    {
+        localNode->flushMaxVersions();
         localNode->flushCommands();
+    }
 }
 
 void VersionedSlaveCM::_releaseStream( ObjectDataIStream* stream )
@@ -153,11 +169,7 @@ void VersionedSlaveCM::_unpackOneVersion( ObjectDataIStream* is )
                   "Expected version " << _version + 1 << " or 0, got " 
                   << is->getVersion() << " for " << *_object );
 
-    if( is->hasInstanceData( ))
-        _object->applyInstanceData( *is );
-    else
-        _object->unpack( *is );
-
+    _apply( is );
     _version = is->getVersion();
     _sendAck();
 
@@ -175,14 +187,28 @@ void VersionedSlaveCM::_unpackOneVersion( ObjectDataIStream* is )
     _releaseStream( is );
 }
 
+void VersionedSlaveCM::_apply( ObjectDataIStream* is )
+{
+    if( is->hasInstanceData( ))
+        _object->applyInstanceData( *is );
+    else
+        _object->unpack( *is );
+}
+
 void VersionedSlaveCM::_sendAck()
 {
     const uint64_t maxVersion = _version.low() + _object->getMaxVersions();
     if( maxVersion <= _version.low( )) // overflow: default unblocking commit
         return;
 
-    _object->send( _master, CMD_OBJECT_MAX_VERSION, _masterInstanceID )
-            << maxVersion << _object->getInstanceID();
+    // Sent per version, a master limited by the max versions might wait for
+    // it to send the version this slave waits for. Acks are batched per
+    // master node until the end of the sync.
+    LocalNodePtr localNode = _object->getLocalNode();
+    if( localNode.isValid( ))
+        localNode->sendMaxVersion( _master, _object->getID(),
+                                   _masterInstanceID, maxVersion,
+                                   _object->getInstanceID( ));
 }
 
 void VersionedSlaveCM::applyMapData( const uint128_t& version )
@@ -190,12 +216,20 @@ void VersionedSlaveCM::applyMapData( const uint128_t& version )
     while( true )
     {
         ObjectDataIStream* is = _queuedVersions.pop();
+        if( is->getVersion() < version )
+        {
+            // full base version and deltas sent by a DeltaMasterCM
+            _unpackOneVersion( is );
+            continue;
+        }
+
         if( is->getVersion() == version )
         {
-            LBASSERTINFO( is->hasInstanceData(), *_object );
+            LBASSERTINFO( is->hasInstanceData() || _version + 1 == version,
+                          *_object );
 
-            if( is->hasData( )) // not VERSION_NONE
-                _object->applyInstanceData( *is );
+            if( !is->hasInstanceData() || is->hasData( )) // not VERSION_NONE
+                _apply( is );
             _version = is->getVersion();
 
             LBASSERT( _version != VERSION_INVALID );
@@ -206,6 +240,10 @@ void VersionedSlaveCM::applyMapData( const uint128_t& version )
                           is->nRemainingBuffers() << " buffer(s)" );
 
             _releaseStream( is );
+
+            LocalNodePtr localNode = _object->getLocalNode();
+            if( localNode.isValid( ))
+                localNode->flushMaxVersions(); // acks of the unpacked deltas
 #if 0
             LBLOG( LOG_OBJECTS ) << "Mapped initial data of " << _object
                                  << std::endl;
@@ -324,32 +362,56 @@ bool VersionedSlaveCM::_cmdData( ICommand& cmd )
     LB_TS_THREAD( _rcvThread );
     LBASSERT( command.getNode().isValid( ));
 
-    if( !_currentIStream )
-        _currentIStream = _iStreamCache.alloc();
+    const uint128_t version = command.getVersion();
+    ObjectDataIStream*& current = _currentIStreams[ version ];
+    if( !current )
+        current = _iStreamCache.alloc();
+
+    ObjectDataIStream* is = current;
+    is->addDataCommand( command );
+    if( !is->isReady( ))
+        return true;
+    _currentIStreams.erase( version );
 
-    _currentIStream->addDataCommand( command );
-    if( _currentIStream->isReady( ))
-    {
-        const uint128_t& version = _currentIStream->getVersion();
 #if 0
-        LBLOG( LOG_OBJECTS ) << "v" << version << ", id " << _object->getID()
-                             << "." << _object->getInstanceID() << " ready"
-                             << std::endl;
-#endif
-#ifndef NDEBUG
-        ObjectDataIStream* debugStream = 0;
-        _queuedVersions.getBack( debugStream );
-        if ( debugStream )
-        {
-            LBASSERT( debugStream->getVersion() + 1 == version ||
-                      debugStream->getVersion() == VERSION_NONE );
-        }
+    LBLOG( LOG_OBJECTS ) << "v" << version << ", id " << _object->getID()
+                         << "." << _object->getInstanceID() << " ready"
+                         << std::endl;
 #endif
-        _queuedVersions.push( _currentIStream );
-        _object->notifyNewHeadVersion( version );
-        _currentIStream = 0;
+    // A version relayed through the slaves may be overtaken by the next one,
+    // sent directly while the master changed its relay tree.
+    if( _lastQueued != VERSION_NONE && version > _lastQueued + 1 )
+    {
+        _heldIStreams[ version ] = is;
+        return true;
+    }
+
+    _queueVersion( is );
+    while( !_heldIStreams.empty() &&
+           _heldIStreams.begin()->first == _lastQueued + 1 )
+    {
+        _queueVersion( _heldIStreams.begin()->second );
+        _heldIStreams.erase( _heldIStreams.begin( ));
     }
     return true;
 }
 
+void VersionedSlaveCM::_queueVersion( ObjectDataIStream* is )
+{
+    const uint128_t& version = is->getVersion();
+#ifndef NDEBUG
+    ObjectDataIStream* debugStream = 0;
+    _queuedVersions.getBack( debugStream );
+    if ( debugStream )
+    {
+        LBASSERT( debugStream->getVersion() + 1 == version ||
+                  debugStream->getVersion() == VERSION_NONE );
+    }
+#endif
+    if( _lastQueued == VERSION_NONE || version > _lastQueued )
+        _lastQueued = version;
+    _queuedVersions.push( is );
+    _object->notifyNewHeadVersion( version );
+}
+
 }
@@ -29,6 +29,8 @@
 #include <lunchbox/pool.h>        // member
 #include <lunchbox/thread.h>      // thread-safety macro
 
+#include <map>
+
 namespace co
 {
     class Node;
@@ -68,12 +70,25 @@ namespace co
         virtual void setVersion( const uint128_t& version ){ _version = version; }
         virtual void addInstanceDatas( const ObjectDataIStreamDeque&,
                                        const uint128_t& startVersion );
+
+    protected:
+        /** Apply the instance data or delta of one version to the object. */
+        virtual void _apply( ObjectDataIStream* is );
+
     private:
         /** The current version. */
         uint128_t _version;
 
-        /** istream for receiving the current version */
-        ObjectDataIStream* _currentIStream;
+        typedef std::map< uint128_t, ObjectDataIStream* > IStreamMap;
+
+        /** istreams for receiving versions, relayed versions may interleave */
+        IStreamMap _currentIStreams;
+
+        /** Received versions waiting for an earlier, overtaken version. */
+        IStreamMap _heldIStreams;
+
+        /** The last version pushed to _queuedVersions. */
+        uint128_t _lastQueued;
 
         /** The change queue. */
         lunchbox::MTQueue< ObjectDataIStream* > _queuedVersions;
@@ -93,6 +108,7 @@ namespace co
         void _syncToHead();
         void _releaseStream( ObjectDataIStream* stream );
         void _sendAck();
+        void _queueVersion( ObjectDataIStream* is );
 
         /** Apply the data in the input stream to the object */
         virtual void _unpackOneVersion( ObjectDataIStream* is );
@@ -19,6 +19,7 @@
 #include "worker.h"
 
 #include "iCommand.h"
+#include "trace.h"
 
 namespace co
 {
@@ -50,9 +51,12 @@ bool WorkerThread< Q >::handleCommands( bool blocking )
     {
         // We want to avoid a non-const copy of commands, hence the cast...
         ICommand& command = const_cast< ICommand& >( *i );
-        if( !command( ))
         {
-            LBABORT( "Error handling " << command );
+            const TraceSpan span( Trace::HANDLE );
+            if( !command( ))
+            {
+                LBABORT( "Error handling " << command );
+            }
         }
         if( stopRunning( ))
             return false;
@@ -0,0 +1,167 @@
+
+/* Copyright (c) 2013, Stefan Eilemann <eile@equalizergraphics.com>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 2.1 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+// Tests the binary diff round trip and its rejection of mismatching bases
+
+#include <test.h>
+
+#include <co/bufferConnection.h>
+#include <co/dataIStream.h>
+#include <co/dataOStream.h>
+#include <co/init.h>
+#include <lunchbox/plugins/compressor.h>
+#include <lunchbox/rng.h>
+
+#include <co/binaryDiff.h> // private header
+
+#include <cstring>
+
+namespace
+{
+/** Collects the serialized data in memory. */
+class OStream : public co::DataOStream
+{
+public:
+    OStream()
+    {
+        _setupConnection( new co::BufferConnection );
+        _enable();
+    }
+
+    lunchbox::Bufferb data;
+
+protected:
+    virtual void sendData( const void* buffer, const uint64_t size,
+                           const bool )
+    {
+        data.append( static_cast< const uint8_t* >( buffer ), size );
+    }
+};
+
+/** Reads serialized data from memory. */
+class IStream : public co::DataIStream
+{
+public:
+    explicit IStream( const lunchbox::Bufferb& data )
+        : co::DataIStream( false /*swap*/ ), _data( data ), _read( false ) {}
+
+    virtual size_t nRemainingBuffers() const { return _read ? 0 : 1; }
+    virtual lunchbox::uint128_t getVersion() const { return co::VERSION_NONE;}
+    virtual co::NodePtr getMaster() { return 0; }
+
+protected:
+    virtual bool getNextBuffer( uint32_t& compressor, uint32_t& nChunks,
+                                const void** chunkData, uint64_t& size )
+    {
+        if( _read )
+            return false;
+
+        _read = true;
+        compressor = EQ_COMPRESSOR_NONE;
+        nChunks = 1;
+        *chunkData = _data.getData();
+        size = _data.getSize();
+        return true;
+    }
+
+private:
+    const lunchbox::Bufferb& _data;
+    bool _read;
+};
+
+/** Serialize the diff from previous to current into diff. */
+void _diff( const lunchbox::Bufferb& previous,
+            const lunchbox::Bufferb& current, lunchbox::Bufferb& diff )
+{
+    co::binaryDiff::Ops ops;
+    const uint64_t size = co::binaryDiff::compute( previous, current, ops );
+
+    OStream os;
+    co::binaryDiff::write( os, ops, previous, current );
+    os.disable();
+    TESTINFO( os.data.getSize() == size, os.data.getSize() << " != " << size );
+    diff.swap( os.data );
+}
+
+bool _apply( const lunchbox::Bufferb& diff, const lunchbox::Bufferb& previous,
+             lunchbox::Bufferb& result )
+{
+    IStream is( diff );
+    return co::binaryDiff::apply( is, previous, result );
+}
+
+bool _equal( const lunchbox::Bufferb& a, const lunchbox::Bufferb& b )
+{
+    return a.getSize() == b.getSize() &&
+           ::memcmp( a.getData(), b.getData(), a.getSize( )) == 0;
+}
+}
+
+int main( int argc, char **argv )
+{
+    TEST( co::init( argc, argv ));
+
+    lunchbox::RNG rng;
+    lunchbox::Bufferb previous;
+    previous.resize( LB_64KB );
+    for( size_t i = 0; i < previous.getSize(); ++i )
+        previous[ i ] = rng.get< uint8_t >();
+
+    // changed bytes, a moved block and inserted data
+    lunchbox::Bufferb current( previous );
+    for( size_t i = 0; i < current.getSize(); i += 4096 )
+        current[ i ] = ~current[ i ];
+    ::memcpy( current.getData() + 1024, previous.getData() + 32768, 2048 );
+    const uint8_t inserted[] = "So long, and thanks for all the fish";
+    current.append( inserted, sizeof( inserted ));
+
+    lunchbox::Bufferb diff;
+    _diff( previous, current, diff );
+    TESTINFO( diff.getSize() < current.getSize() / 4, diff.getSize( ));
+
+    lunchbox::Bufferb result;
+    TEST( _apply( diff, previous, result ));
+    TEST( _equal( result, current ));
+
+    // identical and empty data
+    _diff( current, current, diff );
+    TEST( _apply( diff, current, result ));
+    TEST( _equal( result, current ));
+
+    const lunchbox::Bufferb empty;
+    _diff( empty, current, diff );
+    TEST( _apply( diff, empty, result ));
+    TEST( _equal( result, current ));
+
+    _diff( current, empty, diff );
+    TEST( _apply( diff, current, result ));
+    TEST( result.isEmpty( ));
+
+    // diffs only apply to the data they are based on
+    _diff( previous, current, diff );
+    lunchbox::Bufferb other( previous );
+    other[ 4711 ] = ~other[ 4711 ];
+    TEST( !_apply( diff, other, result ));
+
+    lunchbox::Bufferb truncated;
+    truncated.append( previous.getData(), previous.getSize() / 2 );
+    TEST( !_apply( diff, truncated, result ));
+    TEST( !_apply( diff, current, result ));
+
+    TEST( co::exit( ));
+    return EXIT_SUCCESS;
+}
@@ -40,6 +40,9 @@ static co::ConnectionType types[] =
 #endif
 #ifdef EQ_INFINIBAND
     co::CONNECTIONTYPE_IB,
+#endif
+#ifdef CO_USE_SHM
+    co::CONNECTIONTYPE_SHM,
 #endif
     co::CONNECTIONTYPE_NONE // must be last
 };
@@ -56,6 +59,8 @@ int main( int argc, char **argv )
 
         if( desc->type >= co::CONNECTIONTYPE_MULTICAST )
             desc->setHostname( "239.255.12.34" );
+        else if( desc->type == co::CONNECTIONTYPE_SHM )
+            desc->setFilename( "default" ); // listen() picks a unique name
         else
             desc->setHostname( "127.0.0.1" );
 
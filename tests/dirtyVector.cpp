@@ -0,0 +1,198 @@
+
+/* Copyright (c) 2013, Stefan Eilemann <eile@equalizergraphics.com>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 2.1 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+// Tests co::DirtyBitSet and co::DirtyVector within a co::Serializable
+
+#include <test.h>
+
+#include <co/co.h>
+
+namespace
+{
+static const size_t _nFields = 200;
+static const size_t _nElems = 100000;
+
+class TestSerializable : public co::Serializable
+{
+public:
+    TestSerializable() : fields( _nFields, 0 ), dirtyFields( _nFields ) {}
+
+    void setField( const size_t index, const uint32_t value )
+    {
+        fields[ index ] = value;
+        dirtyFields.set( index );
+        setDirty( DIRTY_FIELDS );
+    }
+
+    void setElement( const size_t index, const float value )
+    {
+        elements.set( index, value );
+        setDirty( DIRTY_ELEMENTS );
+    }
+
+    void resize( const size_t size )
+    {
+        elements.resize( size );
+        setDirty( DIRTY_ELEMENTS );
+    }
+
+    std::vector< uint32_t > fields;
+    co::DirtyBitSet dirtyFields;
+    co::DirtyVector< float > elements;
+
+protected:
+    enum DirtyBits
+    {
+        DIRTY_FIELDS = co::Serializable::DIRTY_CUSTOM << 0,
+        DIRTY_ELEMENTS = co::Serializable::DIRTY_CUSTOM << 1
+    };
+
+    virtual void serialize( co::DataOStream& os, const uint64_t dirtyBits )
+    {
+        if( dirtyBits == DIRTY_ALL ) // instance data
+        {
+            os << fields;
+            elements.serializeAll( os );
+            return;
+        }
+
+        if( dirtyBits & DIRTY_FIELDS )
+        {
+            os << dirtyFields;
+            for( size_t i = dirtyFields.findNext( 0 ); i < _nFields;
+                 i = dirtyFields.findNext( i + 1 ))
+            {
+                os << fields[ i ];
+            }
+            dirtyFields.clear();
+        }
+        if( dirtyBits & DIRTY_ELEMENTS )
+            elements.serialize( os );
+    }
+
+    virtual void deserialize( co::DataIStream& is, const uint64_t dirtyBits )
+    {
+        if( dirtyBits == DIRTY_ALL )
+        {
+            is >> fields;
+            elements.deserializeAll( is );
+            return;
+        }
+
+        if( dirtyBits & DIRTY_FIELDS )
+        {
+            is >> dirtyFields;
+            for( size_t i = dirtyFields.findNext( 0 ); i < _nFields;
+                 i = dirtyFields.findNext( i + 1 ))
+            {
+                is >> fields[ i ];
+            }
+        }
+        if( dirtyBits & DIRTY_ELEMENTS )
+            elements.deserialize( is );
+    }
+};
+
+void _testBitSet()
+{
+    co::DirtyBitSet bits( 130 );
+    TEST( bits.isEmpty( ));
+    TEST( bits.findNext( 0 ) == 130 );
+
+    bits.set( 3 );
+    bits.set( 64 );
+    bits.set( 129 );
+    TEST( !bits.isEmpty( ));
+    TEST( bits.test( 3 ) && bits.test( 64 ) && bits.test( 129 ));
+    TEST( !bits.test( 4 ));
+    TEST( bits.findNext( 0 ) == 3 );
+    TEST( bits.findNext( 4 ) == 64 );
+    TEST( bits.findNext( 65 ) == 129 );
+    TEST( bits.findNextClean( 3 ) == 4 );
+
+    bits.unset( 64 );
+    TEST( bits.findNext( 4 ) == 129 );
+
+    bits.setAll();
+    TEST( bits.findNextClean( 0 ) == 130 );
+    bits.resize( 100 );
+    bits.resize( 130 );
+    TEST( bits.test( 99 ));
+    TEST( !bits.test( 100 ));
+
+    bits.clear();
+    TEST( bits.isEmpty( ));
+}
+
+void _compare( const TestSerializable& master, const TestSerializable& slave )
+{
+    TEST( slave.fields == master.fields );
+    TESTINFO( slave.elements.size() == master.elements.size(),
+              slave.elements.size() << " != " << master.elements.size( ));
+    TEST( slave.elements.getData() == master.elements.getData( ));
+}
+}
+
+int main( int argc, char **argv )
+{
+    TEST( co::init( argc, argv ));
+    _testBitSet();
+
+    co::LocalNodePtr node = new co::LocalNode;
+    TEST( node->initLocal( argc, argv ));
+
+    TestSerializable master;
+    master.resize( _nElems );
+    for( size_t i = 0; i < _nElems; ++i )
+        master.setElement( i, float( i ));
+    for( size_t i = 0; i < _nFields; ++i )
+        master.setField( i, uint32_t( i ));
+
+    TEST( node->registerObject( &master ));
+    TestSerializable slave;
+    TEST( node->mapObject( &slave, master.getID(), co::VERSION_FIRST ));
+    _compare( master, slave );
+
+    for( size_t i = 0; i < 100; ++i )
+    {
+        // sparse changes, including fields above the first 64
+        master.setField( ( i * 7 ) % _nFields, uint32_t( i + 1000 ));
+        master.setField( _nFields - 1, uint32_t( i ));
+        master.setElement( ( i * 997 ) % _nElems, float( -i ));
+        master.setElement( ( i * 997 + 1 ) % _nElems, float( i ));
+        TEST( master.isDirty( ));
+
+        slave.sync( master.commit( ));
+        TEST( !master.isDirty( ));
+        _compare( master, slave );
+    }
+
+    master.resize( _nElems + 17 );
+    slave.sync( master.commit( ));
+    _compare( master, slave );
+
+    master.resize( _nElems / 2 );
+    slave.sync( master.commit( ));
+    _compare( master, slave );
+
+    node->unmapObject( &slave );
+    node->deregisterObject( &master );
+
+    TEST( node->exitLocal( ));
+    TEST( co::exit( ));
+    return EXIT_SUCCESS;
+}
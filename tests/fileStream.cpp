@@ -0,0 +1,128 @@
+
+/* Copyright (c) 2013, Stefan Eilemann <eile@equalizergraphics.com>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 2.1 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+// Tests DataOStream::writeFile and writeRegion with the static (direct send)
+// and instance (saved, copied) instance data paths
+
+#include <test.h>
+
+#include <co/co.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+
+namespace
+{
+static const std::string _source( "fileStream.in" );
+static const std::string _destination( "fileStream.out" );
+static const uint64_t _offset = 4096;
+static const uint64_t _fileSize = 1024 * 1024;
+static const uint64_t _regionSize = 512 * 1024;
+static const uint32_t _magic = 0xC0FFEE;
+
+std::vector< char > _readFile( const std::string& filename )
+{
+    std::ifstream file( filename.c_str(), std::ios::binary );
+    return std::vector< char >( std::istreambuf_iterator< char >( file ),
+                                std::istreambuf_iterator< char >( ));
+}
+
+class FileObject : public co::Object
+{
+public:
+    FileObject( const ChangeType type )
+        : region( _regionSize ), magic( 0 ), _type( type ) {}
+
+    virtual ChangeType getChangeType() const { return _type; }
+
+    std::vector< uint8_t > region;
+    uint32_t magic;
+
+protected:
+    virtual void getInstanceData( co::DataOStream& os )
+    {
+        os << _magic;
+        TEST( os.writeFile( _source, _offset, _fileSize - _offset ));
+        os.writeRegion( &region.front(), region.size( ));
+        os << _magic;
+    }
+
+    virtual void applyInstanceData( co::DataIStream& is )
+    {
+        ::remove( _destination.c_str( ));
+
+        is >> magic;
+        TEST( magic == _magic );
+        TEST( is.readFile( _destination ));
+        TEST( is.readRegion( &region.front(), region.size( )) == _regionSize );
+        is >> magic;
+    }
+
+private:
+    const ChangeType _type;
+};
+
+void _test( co::LocalNodePtr node, const co::Object::ChangeType type )
+{
+    FileObject master( type );
+    for( size_t i = 0; i < _regionSize; ++i )
+        master.region[ i ] = uint8_t( i * 7 );
+    TEST( node->registerObject( &master ));
+
+    FileObject slave( type );
+    TEST( node->mapObject( &slave, master.getID(), co::VERSION_FIRST ));
+    TEST( slave.magic == _magic );
+    TEST( slave.region == master.region );
+
+    const std::vector< char > source = _readFile( _source );
+    const std::vector< char > destination = _readFile( _destination );
+    TEST( destination.size() == _fileSize - _offset );
+    TEST( std::equal( destination.begin(), destination.end(),
+                      source.begin() + _offset ));
+
+    node->unmapObject( &slave );
+    node->deregisterObject( &master );
+}
+}
+
+int main( int argc, char **argv )
+{
+    TEST( co::init( argc, argv ));
+
+    std::vector< char > data( _fileSize );
+    for( size_t i = 0; i < _fileSize; ++i )
+        data[ i ] = char( i % 251 );
+    {
+        std::ofstream file( _source.c_str(), std::ios::binary );
+        file.write( &data.front(), data.size( ));
+    }
+
+    co::LocalNodePtr node = new co::LocalNode;
+    TEST( node->initLocal( argc, argv ));
+
+    _test( node, co::Object::STATIC );
+    _test( node, co::Object::INSTANCE );
+
+    TEST( node->exitLocal( ));
+    TEST( co::exit( ));
+
+    ::remove( _source.c_str( ));
+    ::remove( _destination.c_str( ));
+    return EXIT_SUCCESS;
+}
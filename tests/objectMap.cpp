@@ -40,13 +40,48 @@ protected:
     virtual ChangeType getChangeType() const { return INSTANCE; }
 };
 
+class TestSerializable : public co::Serializable
+{
+public:
+    TestSerializable() : value( 0 ) { enableDirtyTracking(); }
+
+    void setValue( const uint32_t value_ )
+    {
+        value = value_;
+        setDirty( DIRTY_VALUE );
+    }
+
+    uint32_t value;
+
+protected:
+    enum DirtyBits
+    {
+        DIRTY_VALUE = co::Serializable::DIRTY_CUSTOM << 0
+    };
+
+    virtual void serialize( co::DataOStream& os, const uint64_t dirtyBits )
+    {
+        if( dirtyBits & DIRTY_VALUE )
+            os << value;
+    }
+
+    virtual void deserialize( co::DataIStream& is, const uint64_t dirtyBits )
+    {
+        if( dirtyBits & DIRTY_VALUE )
+            is >> value;
+    }
+};
+
 typedef TestObject Foo;
 typedef TestObject Bar;
+typedef TestSerializable Baz;
 
 enum ObjectType
 {
     TYPE_FOO = co::OBJECTTYPE_CUSTOM,
-    TYPE_BAR
+    TYPE_BAR,
+    TYPE_BAZ,
+    TYPE_MAP
 };
 
 static Foo* clientFoo = 0;
@@ -150,6 +185,53 @@ int main( int argc, char **argv )
         client->objectMap.sync( server->objectMap.commit( ));
         TEST( clientBar.message == "hello again" );
 
+        // Test commit of dirty Serializable masters
+        Baz masterBaz;
+        TEST( server->objectMap.register_( &masterBaz, TYPE_BAZ ));
+        client->objectMap.sync( server->objectMap.commit( ));
+
+        Baz clientBaz;
+        TEST( client->objectMap.map( masterBaz.getID(),
+                                     &clientBaz ) == &clientBaz );
+        masterBaz.setValue( 42 );
+        TEST( server->objectMap.isDirty( ));
+        client->objectMap.sync( server->objectMap.commit( ));
+        TEST( clientBaz.value == 42 );
+        TEST( clientBaz.getVersion() == masterBaz.getVersion( ));
+
+        TEST( server->objectMap.deregister( &masterBaz ));
+        client->objectMap.sync( server->objectMap.commit( ));
+        TEST( !clientBaz.isAttached( ));
+
+        // Test commit of dirty masters of a nested map
+        co::ObjectMap masterMap( *server, server->factory );
+        TEST( server->objectMap.register_( &masterMap, TYPE_MAP ));
+        Baz masterChild;
+        TEST( masterMap.register_( &masterChild, TYPE_BAZ ));
+        client->objectMap.sync( server->objectMap.commit( ));
+
+        co::ObjectMap clientMap( *client, client->factory );
+        TEST( client->objectMap.map( masterMap.getID(),
+                                     &clientMap ) == &clientMap );
+        Baz clientChild;
+        TEST( clientMap.map( masterChild.getID(),
+                             &clientChild ) == &clientChild );
+
+        masterChild.setValue( 17 );
+        TEST( masterMap.isDirty( ));
+        TEST( server->objectMap.isDirty( ));
+        client->objectMap.sync( server->objectMap.commit( ));
+        TEST( clientChild.value == 17 );
+        TEST( clientChild.getVersion() == masterChild.getVersion( ));
+        TEST( !masterMap.isDirty( ));
+
+        clientMap.clear();
+        TEST( !clientChild.isAttached( ));
+        TEST( client->objectMap.unmap( &clientMap ));
+        TEST( masterMap.deregister( &masterChild ));
+        TEST( server->objectMap.deregister( &masterMap ));
+        client->objectMap.sync( server->objectMap.commit( ));
+
         // Test deregister()
         TEST( server->objectMap.deregister( &masterBar ));
         masterBar.message = "still there?";
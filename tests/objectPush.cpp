@@ -130,7 +130,7 @@ int main( int argc, char **argv )
     nodes.push_back( serverProxy );
 
     lunchbox::Clock clock;
-    for( unsigned i = co::Object::NONE+1; i <= co::Object::UNBUFFERED; ++i )
+    for( unsigned i = co::Object::NONE+1; i <= co::Object::DIFF; ++i )
     {
         const co::Object::ChangeType type = co::Object::ChangeType( i );
         Object object( type );
@@ -149,7 +149,7 @@ int main( int argc, char **argv )
     const float time = clock.getTimef();
     nodes.clear();
 
-    std::cout << time << "ms for " << int( co::Object::UNBUFFERED )
+    std::cout << time << "ms for " << int( co::Object::DIFF )
               << " object types" << std::endl;
 
     TEST( client->disconnect( serverProxy ));
@@ -148,7 +148,7 @@ int main( int argc, char **argv )
 
     Object *masterObj;
 
-    for( unsigned i = co::Object::NONE+1; i <= co::Object::UNBUFFERED; ++i )
+    for( unsigned i = co::Object::NONE+1; i <= co::Object::DIFF; ++i )
     {
 
         const co::Object::ChangeType type = co::Object::ChangeType( i );
@@ -193,7 +193,7 @@ int main( int argc, char **argv )
     const float time = clock.getTimef();
     nodes.clear();
 
-    std::cout << time << "ms for " << int( co::Object::UNBUFFERED )
+    std::cout << time << "ms for " << int( co::Object::DIFF )
               << " object types" << std::endl;
 
     TEST( client->disconnect( serverProxy ));
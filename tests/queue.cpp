@@ -46,6 +46,7 @@ int main( int argc, char **argv )
     qm->push() << 42u;
     qm->push() << std::string( "hallo" );
     qm->push() << 1.5f << false << co::VERSION_FIRST;
+    qm->push() << std::vector< uint32_t >( 4096, 17u ); // sent without copy
 
     {
         co::ObjectICommand c1 = qs->pop();
@@ -53,6 +54,7 @@ int main( int argc, char **argv )
         co::ObjectICommand c3 = qs->pop();
         co::ObjectICommand c4 = qs->pop();
         co::ObjectICommand c5 = qs->pop();
+        co::ObjectICommand c6 = qs->pop();
 
         TEST( c1.isValid( ));
         TEST( c2.isValid( ));
@@ -63,7 +65,10 @@ int main( int argc, char **argv )
         TEST( c4.get< float >() == 1.5f )
         TEST( c4.get< bool >() == false )
         TEST( c4.get< co::uint128_t >() == co::VERSION_FIRST )
-        TEST( !c5.isValid( ));
+        TEST( c5.isValid( ));
+        TEST( c5.get< std::vector< uint32_t > >() ==
+              std::vector< uint32_t >( 4096, 17u ));
+        TEST( !c6.isValid( ));
     }
 
     node->unmapObject( qs );
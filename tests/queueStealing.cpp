@@ -0,0 +1,137 @@
+
+/* Copyright (c) 2013, Stefan Eilemann <eile@equalizergraphics.com>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 2.1 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+// Tests that work stealing between queue slaves neither loses nor duplicates
+// items.
+
+#include <test.h>
+
+#include <co/init.h>
+#include <co/node.h>
+#include <co/objectICommand.h>
+#include <co/queueItem.h>
+#include <co/queueMaster.h>
+#include <co/queueSlave.h>
+
+#include <set>
+
+static const uint32_t _nItems = 64;
+
+static size_t _drain( co::QueueSlave& slave, std::multiset< uint32_t >& items )
+{
+    size_t nItems = 0;
+    while( true )
+    {
+        co::ObjectICommand command = slave.pop();
+        if( !command.isValid( ))
+            return nItems;
+
+        items.insert( command.get< uint32_t >( ));
+        ++nItems;
+    }
+}
+
+static void _run( co::LocalNodePtr node, const bool stealing )
+{
+    co::QueueMaster master;
+    master.setWorkStealing( stealing );
+    TEST( master.isWorkStealing() == stealing );
+
+    co::QueueSlave greedy( 8, 16 );
+    co::QueueSlave slave;
+
+    TEST( node->registerObject( &master ));
+    TEST( node->mapObject( &greedy, master.getID(), co::VERSION_FIRST ));
+    TEST( node->mapObject( &slave, master.getID(), co::VERSION_FIRST ));
+
+    for( uint32_t i = 0; i < _nItems; ++i )
+        master.push() << i;
+
+    std::multiset< uint32_t > items;
+
+    // prefetches 16 items, of which 15 stay unconsumed
+    co::ObjectICommand first = greedy.pop();
+    TEST( first.isValid( ));
+    items.insert( first.get< uint32_t >( ));
+
+    const size_t nSlaveItems = _drain( slave, items );
+    const size_t nGreedyItems = _drain( greedy, items ) + 1;
+
+    TESTINFO( items.size() == _nItems, items.size( ));
+    for( uint32_t i = 0; i < _nItems; ++i )
+        TESTINFO( items.count( i ) == 1, i << ": " << items.count( i ));
+
+    TEST( nSlaveItems + nGreedyItems == _nItems );
+    if( stealing )
+        TESTINFO( nGreedyItems < 16, nGreedyItems );
+    else
+        TESTINFO( nGreedyItems >= 16, nGreedyItems );
+
+    node->unmapObject( &slave );
+    node->unmapObject( &greedy );
+    node->deregisterObject( &master );
+}
+
+// an unmapped slave is not asked to return its items
+static void _runUnmapped( co::LocalNodePtr node )
+{
+    co::QueueMaster master;
+    master.setWorkStealing( true );
+
+    co::QueueSlave idle( 8, 16 );
+    co::QueueSlave slave;
+
+    TEST( node->registerObject( &master ));
+    TEST( node->mapObject( &idle, master.getID(), co::VERSION_FIRST ));
+    TEST( node->mapObject( &slave, master.getID(), co::VERSION_FIRST ));
+
+    for( uint32_t i = 0; i < _nItems; ++i )
+        master.push() << i;
+
+    std::multiset< uint32_t > items;
+    co::ObjectICommand first = idle.pop();
+    TEST( first.isValid( ));
+    node->unmapObject( &idle );
+
+    const size_t nSlaveItems = _drain( slave, items );
+    TESTINFO( nSlaveItems < _nItems, nSlaveItems );
+    for( uint32_t i = 0; i < _nItems; ++i )
+        TESTINFO( items.count( i ) <= 1, i << ": " << items.count( i ));
+
+    // the queue stays usable, no steal round is pending
+    master.push() << _nItems;
+    TEST( _drain( slave, items ) == 1 );
+
+    node->unmapObject( &slave );
+    node->deregisterObject( &master );
+}
+
+int main( int argc, char **argv )
+{
+    TEST( co::init( argc, argv ));
+
+    co::LocalNodePtr node = new co::LocalNode;
+    TEST( node->initLocal( argc, argv ));
+
+    _run( node, false );
+    _run( node, true );
+    _runUnmapped( node );
+
+    node->close();
+    co::exit();
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,157 @@
+
+/* Copyright (c) 2013, Stefan Eilemann <eile@equalizergraphics.com>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 2.1 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+// Tests co::Counter, co::Histogram and the connection and command statistics
+
+#include <test.h>
+
+#include <co/co.h>
+#include <co/nodeCommand.h>
+
+#include <boost/bind.hpp>
+#include <sstream>
+
+#define N_THREADS 13
+#define N_ADDS 100000
+
+namespace
+{
+const co::uint128_t cmdID( lunchbox::make_uint128( "statistics" ));
+lunchbox::Monitor< bool > gotCommand;
+
+co::Counter counter;
+co::Histogram histogram;
+
+class Adder : public lunchbox::Thread
+{
+protected:
+    virtual void run()
+    {
+        for( size_t i = 0; i < N_ADDS; ++i )
+        {
+            ++counter;
+            histogram.add( i );
+        }
+    }
+};
+
+class MyLocalNode : public co::LocalNode
+{
+public:
+    bool cmdCustom( co::CustomICommand& )
+    {
+        gotCommand = true;
+        return true;
+    }
+};
+
+typedef lunchbox::RefPtr< MyLocalNode > MyLocalNodePtr;
+
+void _testCounters()
+{
+    Adder adders[ N_THREADS ];
+    for( size_t i = 0; i < N_THREADS; ++i )
+        TEST( adders[i].start( ));
+    for( size_t i = 0; i < N_THREADS; ++i )
+        TEST( adders[i].join( ));
+
+    TESTINFO( counter.get() == N_THREADS * N_ADDS, counter.get( ));
+    TEST( histogram.getCount() == N_THREADS * N_ADDS );
+    TEST( histogram.getSum() ==
+          N_THREADS * int64_t( N_ADDS - 1 ) * N_ADDS / 2 );
+    TEST( histogram.get( 0 ) == N_THREADS );     // 0
+    TEST( histogram.get( 1 ) == N_THREADS );     // 1
+    TEST( histogram.get( 2 ) == N_THREADS * 2 ); // 2, 3
+    TEST( co::Histogram::getBucketMin( 3 ) == 4 );
+
+    counter.reset();
+    histogram.reset();
+    TEST( counter.get() == 0 );
+    TEST( histogram.getCount() == 0 );
+}
+}
+
+int main( int argc, char **argv )
+{
+    TEST( co::init( argc, argv ));
+    _testCounters();
+
+    co::ConnectionDescriptionPtr connDesc = new co::ConnectionDescription;
+    lunchbox::RNG rng;
+    connDesc->type = co::CONNECTIONTYPE_TCPIP;
+    connDesc->port = (rng.get<uint16_t>() % 60000) + 1024;
+    connDesc->setHostname( "localhost" );
+
+    MyLocalNodePtr server = new MyLocalNode;
+    server->addConnectionDescription( connDesc );
+    TEST( server->listen( ));
+
+    co::NodePtr serverProxy = new co::Node;
+    serverProxy->addConnectionDescription( connDesc );
+
+    connDesc = new co::ConnectionDescription;
+    connDesc->type = co::CONNECTIONTYPE_TCPIP;
+    connDesc->setHostname( "localhost" );
+
+    co::LocalNodePtr client = new co::LocalNode;
+    client->addConnectionDescription( connDesc );
+    TEST( client->listen( ));
+    TEST( client->connect( serverProxy ));
+
+    server->registerCommandHandler( cmdID,
+                                    boost::bind( &MyLocalNode::cmdCustom,
+                                                 server.get(), _1 ), 0 );
+
+    co::Statistics::reset();
+    co::ConnectionPtr connection = serverProxy->getConnection();
+    const int64_t sent = connection->getStatistics().commandsSent.get();
+    const int64_t bytes = connection->getStatistics().bytesSent.get();
+
+    serverProxy->send( cmdID );
+    TEST( gotCommand.timedWaitEQ( true, 1000 ));
+
+    TEST( connection->getStatistics().commandsSent.get() >= sent + 1 );
+    TEST( connection->getStatistics().bytesSent.get() > bytes );
+    TEST( co::Statistics::getCounter( co::Statistics::COMMANDS_SENT ).get() >=
+          1 );
+    TEST( co::Statistics::getCounter( co::Statistics::COMMANDS_RECEIVED ).get()
+          >= 1 );
+    TEST( co::Statistics::getCommands( co::Statistics::RECEIVED,
+                                       co::COMMANDTYPE_NODE,
+                                       co::CMD_NODE_COMMAND ) >= 1 );
+    TEST( co::Statistics::getHistogram( co::Statistics::SEND_SIZE ).getCount()
+          > 0 );
+
+    std::ostringstream json;
+    client->printStatistics( json );
+    TESTINFO( json.str().find( "\"connections\": [ {" ) != std::string::npos,
+              json.str( ));
+    TESTINFO( json.str().find( "\"commandsReceived\": " ) !=
+              std::string::npos, json.str( ));
+
+    connection = 0;
+    TEST( client->disconnect( serverProxy ));
+    TEST( client->close( ));
+    TEST( server->close( ));
+
+    serverProxy = 0;
+    client      = 0;
+    server      = 0;
+
+    TEST( co::exit( ));
+    return EXIT_SUCCESS;
+}
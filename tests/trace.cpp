@@ -0,0 +1,109 @@
+
+/* Copyright (c) 2013, Stefan Eilemann <eile@equalizergraphics.com>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 2.1 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+// Tests co::Trace recording and the Chrome trace export
+
+#include <test.h>
+
+#include <co/co.h>
+
+#include <sstream>
+
+namespace
+{
+class TestObject : public co::Object
+{
+public:
+    TestObject() : value( 0 ) {}
+
+    uint32_t value;
+
+protected:
+    virtual ChangeType getChangeType() const { return INSTANCE; }
+    virtual void getInstanceData( co::DataOStream& os ) { os << value; }
+    virtual void applyInstanceData( co::DataIStream& is ) { is >> value; }
+};
+
+bool _contains( const std::string& json, const co::Trace::Stage stage )
+{
+    const std::string name = std::string( "\"name\": \"" ) +
+                             co::Trace::getName( stage ) + "\"";
+    return json.find( name ) != std::string::npos;
+}
+}
+
+int main( int argc, char **argv )
+{
+    TEST( co::init( argc, argv ));
+
+    {
+        const co::TraceSpan span( co::Trace::COMMIT );
+    }
+    TEST( co::Trace::getSize() == 0 );
+
+    co::Trace::enable( 16 );
+    TEST( co::Trace::isEnabled( ));
+    for( size_t i = 0; i < 20; ++i )
+        co::Trace::add( co::Trace::HANDLE, 1000 * i, 1000 * i + 10 );
+    TEST( co::Trace::getSize() == 16 );
+
+    std::ostringstream ring;
+    co::Trace::toChromeJSON( ring );
+    TESTINFO( ring.str().find( "\"ts\": 4000, \"dur\": 10" ) !=
+              std::string::npos, ring.str( ));
+    TESTINFO( ring.str().find( "\"ts\": 3000," ) == std::string::npos,
+              ring.str( ));
+
+    co::Trace::clear();
+    TEST( co::Trace::getSize() == 0 );
+    co::Trace::enable( 4096 );
+
+    co::LocalNodePtr node = new co::LocalNode;
+    TEST( node->initLocal( argc, argv ));
+
+    TestObject master;
+    TEST( node->registerObject( &master ));
+    TestObject slave;
+    TEST( node->mapObject( &slave, master.getID(), co::VERSION_FIRST ));
+
+    master.value = 42;
+    slave.sync( master.commit( ));
+    TEST( slave.value == 42 );
+
+    node->unmapObject( &slave );
+    node->deregisterObject( &master );
+    TEST( node->exitLocal( ));
+
+    co::Trace::disable();
+    TEST( !co::Trace::isEnabled( ));
+    const size_t size = co::Trace::getSize();
+    {
+        const co::TraceSpan span( co::Trace::COMMIT );
+    }
+    TEST( co::Trace::getSize() == size );
+
+    std::ostringstream json;
+    co::Trace::toChromeJSON( json );
+    TESTINFO( json.str().find( "{ \"traceEvents\": [ {" ) == 0, json.str( ));
+    TESTINFO( _contains( json.str(), co::Trace::COMMIT ), json.str( ));
+    TESTINFO( _contains( json.str(), co::Trace::SYNC ), json.str( ));
+    TESTINFO( _contains( json.str(), co::Trace::DISPATCH ), json.str( ));
+    TESTINFO( _contains( json.str(), co::Trace::QUEUE_WAIT ), json.str( ));
+
+    TEST( co::exit( ));
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,206 @@
+
+/* Copyright (c) 2013, Stefan.Eilemann@epfl.ch
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 2.1 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+// Tests co::Barrier latency between processes on the local host
+// Usage: see 'coBarrierperf -h'
+
+#include <co/co.h>
+#include <tclap/CmdLine.h>
+#include <iostream>
+
+#ifndef _WIN32
+#  include <sys/types.h>
+#  include <sys/wait.h>
+#  include <unistd.h>
+#endif
+
+namespace
+{
+static co::uint128_t _barrierID( 0x7A3C91E24B05D86Full, 0x1D84F6B9C3E2A057ull );
+
+co::Barrier::Algorithm _algorithm = co::Barrier::CENTRAL;
+uint32_t _nIterations = 1000;
+uint16_t _port = 4242;
+
+co::ConnectionDescriptionPtr _getDescription( const uint16_t port )
+{
+    co::ConnectionDescriptionPtr description = new co::ConnectionDescription;
+    description->type = co::CONNECTIONTYPE_TCPIP;
+    description->setHostname( "127.0.0.1" );
+    description->port = port;
+    return description;
+}
+
+/** Enter the barrier, the master prints the average latency. */
+int _run( const uint32_t rank, const uint32_t nNodes )
+{
+    co::init( 0, 0 );
+    co::LocalNodePtr localNode = new co::LocalNode;
+    localNode->addConnectionDescription( _getDescription( rank == 0 ? _port :
+                                                                      0 ));
+    if( !localNode->listen( ))
+    {
+        LBERROR << "Can't start node " << rank << std::endl;
+        co::exit();
+        return EXIT_FAILURE;
+    }
+
+    co::Barrier barrier( 0, nNodes );
+    if( rank == 0 )
+    {
+        barrier.setID( _barrierID );
+        barrier.setAlgorithm( _algorithm );
+        LBCHECK( localNode->registerObject( &barrier ));
+    }
+    else
+    {
+        co::NodePtr master = new co::Node;
+        master->addConnectionDescription( _getDescription( _port ));
+
+        while( !localNode->connect( master ))
+            lunchbox::sleep( 10 );
+        while( !localNode->mapObject( &barrier, _barrierID ))
+            lunchbox::sleep( 10 );
+    }
+
+    barrier.enter(); // all connected, also enters through the master once
+    barrier.enter();
+    barrier.resetStatistics();
+
+    lunchbox::Clock clock;
+    for( uint32_t i = 0; i < _nIterations; ++i )
+        barrier.enter();
+    const float time = clock.getTimef();
+
+    if( rank == 0 )
+    {
+        std::cout << nNodes << " nodes: " << time * 1000.f / _nIterations
+                  << " us per barrier, histogram [us:count]";
+        const std::vector< uint64_t > histogram =
+            barrier.getLatencyHistogram();
+        for( size_t i = 0; i < histogram.size(); ++i )
+            if( histogram[ i ] > 0 )
+                std::cout << " " << ( 1u << i ) << ":" << histogram[ i ];
+
+        const co::Barrier::Participants participants =
+            barrier.getParticipants();
+        if( !participants.empty( ))
+            std::cout << ", slowest " << participants.front().id << " last "
+                      << participants.front().nLast << " times";
+        std::cout << std::endl;
+    }
+
+    barrier.enter(); // don't unmap while others are still inside
+    if( rank == 0 )
+        localNode->deregisterObject( &barrier );
+    else
+        localNode->unmapObject( &barrier );
+
+    localNode->close();
+    localNode = 0;
+    co::exit();
+    return EXIT_SUCCESS;
+}
+}
+
+int main( int argc, char **argv )
+{
+    uint32_t minNodes = 2;
+    uint32_t maxNodes = 256;
+
+    try // command line parsing
+    {
+        TCLAP::CmdLine command(
+            "barrierperf - Collage barrier latency benchmark tool", ' ',
+            co::Version::getString( ));
+        TCLAP::ValueArg< std::string > algorithmArg( "a", "algorithm",
+                       "barrier algorithm: central, tree, dissemination or "
+                       "multicast", false, "central", "string", command );
+        TCLAP::ValueArg< uint32_t > minArg( "m", "minNodes",
+                                            "minimum number of processes",
+                                            false, minNodes, "unsigned",
+                                            command );
+        TCLAP::ValueArg< uint32_t > maxArg( "n", "maxNodes",
+                 "maximum number of processes, doubled starting at minimum",
+                                            false, maxNodes, "unsigned",
+                                            command );
+        TCLAP::ValueArg< uint32_t > iterationsArg( "i", "iterations",
+                                                   "barrier entries per run",
+                                                   false, _nIterations,
+                                                   "unsigned", command );
+        TCLAP::ValueArg< uint16_t > portArg( "p", "port",
+                                             "master listening port", false,
+                                             _port, "unsigned short",
+                                             command );
+        command.parse( argc, argv );
+
+        const std::string& algorithm = algorithmArg.getValue();
+        if( algorithm == "tree" )
+            _algorithm = co::Barrier::TREE;
+        else if( algorithm == "dissemination" )
+            _algorithm = co::Barrier::DISSEMINATION;
+        else if( algorithm == "multicast" )
+            _algorithm = co::Barrier::MULTICAST;
+        else if( algorithm != "central" )
+            throw TCLAP::ArgException( "unknown algorithm", "algorithm" );
+
+        minNodes = LB_MAX( minArg.getValue(), 2u );
+        maxNodes = LB_MAX( maxArg.getValue(), minNodes );
+        _nIterations = iterationsArg.getValue();
+        _port = portArg.getValue();
+    }
+    catch( TCLAP::ArgException& exception )
+    {
+        LBERROR << "Command line parse error: " << exception.error()
+                << " for argument " << exception.argId() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+#ifdef _WIN32
+    LBERROR << "coBarrierperf uses fork() to start processes" << std::endl;
+    return EXIT_FAILURE;
+#else
+    // Fork all processes of a run from this thread-free parent
+    for( uint32_t nNodes = minNodes; nNodes <= maxNodes; nNodes <<= 1 )
+    {
+        for( uint32_t i = 0; i < nNodes; ++i )
+        {
+            const pid_t pid = ::fork();
+            if( pid == 0 )
+                ::_exit( _run( i, nNodes ));
+            if( pid < 0 )
+            {
+                LBERROR << "fork failed: " << lunchbox::sysError << std::endl;
+                return EXIT_FAILURE;
+            }
+        }
+
+        int result = EXIT_SUCCESS;
+        for( uint32_t i = 0; i < nNodes; ++i )
+        {
+            int status = 0;
+            ::wait( &status );
+            if( !WIFEXITED( status ) || WEXITSTATUS( status ) != EXIT_SUCCESS )
+                result = EXIT_FAILURE;
+        }
+        if( result != EXIT_SUCCESS )
+            return result;
+        ++_port; // avoid sockets lingering from the last run
+    }
+    return EXIT_SUCCESS;
+#endif
+}
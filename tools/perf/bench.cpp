@@ -0,0 +1,836 @@
+
+/* Copyright (c) 2013, Stefan.Eilemann@epfl.ch
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 2.1 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+// Micro and macro benchmarks of Collage with a common harness
+// Usage: see 'coBench -h'
+
+#include <co/co.h>
+#include <co/bufferCache.h> // private header
+#include <lunchbox/monitor.h>
+#include <tclap/CmdLine.h>
+
+#include <boost/bind.hpp>
+#include <boost/function.hpp>
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+#ifndef _WIN32
+#  include <signal.h>
+#  include <sys/types.h>
+#  include <sys/wait.h>
+#  include <unistd.h>
+#endif
+
+namespace
+{
+typedef boost::function< void() > Function;
+
+/** The timings of all samples of one benchmark. */
+struct Result
+{
+    std::string name;
+    size_t ops; //!< operations per sample
+    uint64_t bytes; //!< bytes per sample, 0 if not a throughput benchmark
+    std::vector< float > times; //!< ms per sample, sorted
+};
+typedef std::vector< Result > Results;
+
+Results _results;
+size_t _nWarmups = 10;
+size_t _nSamples = 1000;
+std::string _filter;
+
+static const uint64_t _packetSize = LB_64KB;
+static const size_t _nPackets = 16;
+static const size_t _itemSize = 4096;
+static const size_t _nItems = 16;
+
+static co::uint128_t _mapID( 0x3C8E21F5A9D6074Bull, 0xB1F47E2D95C03A68ull );
+static co::uint128_t _syncID( 0xE6A90D3B47F1825Cull, 0x2D5C8B1E73A4F906ull );
+static co::uint128_t _barrierID( 0x91D74A6E0C3F58B2ull, 0x7A0E5F29C6B84D13ull );
+static co::uint128_t _queueID( 0x4F2B96C1E8A7D035ull, 0xC83D0A7F51E69B24ull );
+
+enum Commands
+{
+    CMD_NODE_QUEUED = co::CMD_NODE_CUSTOM,
+    CMD_NODE_DIRECT,
+    CMD_NODE_REPLY,
+    CMD_NODE_RUN
+};
+
+/** The workloads run by the peer process on request of the benchmark. */
+enum Workload
+{
+    WORKLOAD_SYNC, //!< map, sync n versions, unmap
+    WORKLOAD_BARRIER, //!< map, enter n times, unmap
+    WORKLOAD_QUEUE_MAP,
+    WORKLOAD_QUEUE_POP, //!< pop n items
+    WORKLOAD_QUEUE_UNMAP,
+    WORKLOAD_TRANSPORT, //!< connect to the port and send n packets
+    WORKLOAD_EXIT
+};
+
+/** @return true if the name starts with the filter, or vice versa. */
+bool _isSelected( const std::string& name )
+{
+    return name.compare( 0, _filter.size(), _filter ) == 0 ||
+           _filter.compare( 0, name.size(), name ) == 0;
+}
+
+float _getPercentile( const std::vector< float >& sorted, const float p )
+{
+    return sorted[ size_t( p * float( sorted.size() - 1 ) + .5f ) ];
+}
+
+/**
+ * Run warm-ups and timed samples of the function and print a summary. Each
+ * call of the function is one sample of a small batch of operations.
+ */
+void _measure( const std::string& name, const size_t ops,
+               const uint64_t bytes, const Function& function )
+{
+    if( !_isSelected( name ))
+        return;
+
+    for( size_t i = 0; i < _nWarmups; ++i )
+        function();
+
+    Result result;
+    result.name = name;
+    result.ops = ops;
+    result.bytes = bytes;
+    result.times.reserve( _nSamples );
+    for( size_t i = 0; i < _nSamples; ++i )
+    {
+        lunchbox::Clock clock;
+        function();
+        result.times.push_back( clock.getTimef( ));
+    }
+    std::sort( result.times.begin(), result.times.end( ));
+
+    const float usPerOp = 1000.f / float( ops );
+    const float median = _getPercentile( result.times, .5f );
+    std::cout << std::left << std::setw( 24 ) << name << std::right
+              << std::setw( 12 ) << median * usPerOp << " us/op, p90 "
+              << _getPercentile( result.times, .9f ) * usPerOp << ", p99 "
+              << _getPercentile( result.times, .99f ) * usPerOp;
+    if( bytes > 0 )
+        std::cout << ", " << float( bytes ) / 1024.f / 1024.f / median *
+                             1000.f << " MB/s";
+    std::cout << std::endl;
+
+    _results.push_back( result );
+}
+
+void _writeJSON( std::ostream& os )
+{
+    os << "{ \"version\": \"" << co::Version::getString()
+       << "\", \"warmups\": " << _nWarmups << ", \"samples\": "
+       << _nSamples << ", \"benchmarks\": [";
+
+    for( Results::const_iterator i = _results.begin(); i != _results.end();
+         ++i )
+    {
+        const Result& result = *i;
+        const float usPerOp = 1000.f / float( result.ops );
+        const float median = _getPercentile( result.times, .5f );
+
+        os << ( i == _results.begin() ? "\n  " : ",\n  " ) << "{ \"name\": \""
+           << result.name << "\", \"ops\": " << result.ops << ", \"bytes\": "
+           << result.bytes << ", \"usPerOp\": { \"min\": "
+           << result.times.front() * usPerOp << ", \"p50\": "
+           << median * usPerOp << ", \"p90\": "
+           << _getPercentile( result.times, .9f ) * usPerOp << ", \"p99\": "
+           << _getPercentile( result.times, .99f ) * usPerOp << ", \"max\": "
+           << result.times.back() * usPerOp << " }";
+        if( result.bytes > 0 )
+            os << ", \"MBps\": "
+               << float( result.bytes ) / 1024.f / 1024.f / median * 1000.f;
+        os << " }";
+    }
+    os << "\n] }" << std::endl;
+}
+
+co::ConnectionDescriptionPtr _getDescription( const uint16_t port )
+{
+    co::ConnectionDescriptionPtr description = new co::ConnectionDescription;
+    description->type = co::CONNECTIONTYPE_TCPIP;
+    description->setHostname( "127.0.0.1" );
+    description->port = port;
+    return description;
+}
+
+/** Object serializing each value separately. */
+template< class T > class StreamObject : public co::Object
+{
+public:
+    std::vector< T > values;
+
+protected:
+    virtual ChangeType getChangeType() const { return INSTANCE; }
+
+    virtual void getInstanceData( co::DataOStream& os )
+    {
+        os << uint64_t( values.size( ));
+        for( typename std::vector< T >::const_iterator i = values.begin();
+             i != values.end(); ++i )
+        {
+            os << *i;
+        }
+    }
+
+    virtual void applyInstanceData( co::DataIStream& is )
+    {
+        uint64_t size = 0;
+        is >> size;
+        values.resize( size );
+        for( typename std::vector< T >::iterator i = values.begin();
+             i != values.end(); ++i )
+        {
+            is >> *i;
+        }
+    }
+};
+
+/** Object serializing its values at once. */
+template< class T > class VectorObject : public co::Object
+{
+public:
+    std::vector< T > values;
+
+protected:
+    virtual ChangeType getChangeType() const { return INSTANCE; }
+    virtual void getInstanceData( co::DataOStream& os ) { os << values; }
+    virtual void applyInstanceData( co::DataIStream& is ) { is >> values; }
+};
+
+/** Sends packets over a connection as fast as possible. */
+bool _sendPackets( co::ConnectionPtr connection, const size_t nPackets )
+{
+    const std::vector< uint8_t > data( _packetSize );
+    for( size_t i = 0; i < nPackets; ++i )
+    {
+        if( !connection->send( &data.front(), _packetSize ))
+        {
+            LBERROR << "Send failed" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Local node of the benchmark and of its peer process. The peer counts the
+ * benchmark commands and runs the requested workloads from its main thread,
+ * the benchmark waits for the replies of the peer.
+ */
+class BenchNode : public co::LocalNode
+{
+public:
+    BenchNode() : replies( 0 ), nWaited( 0 ), running( true )
+    {
+        registerCommand( CMD_NODE_QUEUED,
+                         co::CommandFunc< BenchNode >( this,
+                                                       &BenchNode::_cmdCount ),
+                         getCommandThreadQueue( ));
+        registerCommand( CMD_NODE_DIRECT,
+                         co::CommandFunc< BenchNode >( this,
+                                                       &BenchNode::_cmdCount ),
+                         0 );
+        registerCommand( CMD_NODE_REPLY,
+                         co::CommandFunc< BenchNode >( this,
+                                                       &BenchNode::_cmdReply ),
+                         0 );
+        registerCommand( CMD_NODE_RUN,
+                         co::CommandFunc< BenchNode >( this,
+                                                       &BenchNode::_cmdRun ),
+                         &requests );
+    }
+
+    lunchbox::Monitor< size_t > replies;
+    size_t nWaited; //!< replies consumed by waitReply()
+    co::NodePtr peer; //!< the sender of the first reply
+    co::CommandQueue requests; //!< workloads to run from the main thread
+    bool running;
+
+    void waitReply() { replies.waitGE( ++nWaited ); }
+
+private:
+    co::QueueSlave _queue;
+
+    bool _cmdCount( co::ICommand& command )
+    {
+        if( command.get< bool >( )) // last of a batch
+            command.getNode()->send( CMD_NODE_REPLY );
+        return true;
+    }
+
+    bool _cmdReply( co::ICommand& command )
+    {
+        if( !peer )
+            peer = command.getNode();
+        ++replies;
+        return true;
+    }
+
+    bool _cmdRun( co::ICommand& command )
+    {
+        co::NodePtr node = command.getNode();
+        const uint32_t workload = command.get< uint32_t >();
+        const uint64_t n = command.get< uint64_t >();
+
+        switch( workload )
+        {
+          case WORKLOAD_SYNC:
+          {
+              const bool reply = command.get< bool >();
+              VectorObject< uint8_t > slave;
+              if( !mapObject( &slave, _syncID ))
+                  return false;
+              node->send( CMD_NODE_REPLY );
+              for( uint64_t i = 0; i < n; ++i )
+              {
+                  slave.sync( co::VERSION_NEXT );
+                  if( reply )
+                      node->send( CMD_NODE_REPLY );
+              }
+              unmapObject( &slave );
+              break;
+          }
+
+          case WORKLOAD_BARRIER:
+          {
+              co::Barrier barrier;
+              if( !mapObject( &barrier, _barrierID ))
+                  return false;
+              for( uint64_t i = 0; i < n; ++i )
+                  barrier.enter();
+              unmapObject( &barrier );
+              break;
+          }
+
+          case WORKLOAD_QUEUE_MAP:
+              if( !mapObject( &_queue, _queueID ))
+                  return false;
+              break;
+
+          case WORKLOAD_QUEUE_POP:
+              // the items have been pushed, an invalid command is only the
+              // reply to a prefetch request of the last batch
+              for( uint64_t i = 0; i < n; )
+                  if( _queue.pop().isValid( ))
+                      ++i;
+              break;
+
+          case WORKLOAD_QUEUE_UNMAP:
+              unmapObject( &_queue );
+              break;
+
+          case WORKLOAD_TRANSPORT:
+          {
+              const uint16_t port = command.get< uint16_t >();
+              co::ConnectionPtr connection =
+                  co::Connection::create( _getDescription( port ));
+              if( !connection->connect() || !_sendPackets( connection, n ))
+                  return false;
+              connection->close();
+              return true; // the benchmark waits for the data
+          }
+
+          case WORKLOAD_EXIT:
+              running = false;
+              return true;
+
+          default:
+              LBUNREACHABLE;
+              return false;
+        }
+
+        node->send( CMD_NODE_REPLY );
+        return true;
+    }
+};
+typedef lunchbox::RefPtr< BenchNode > BenchNodePtr;
+
+/** Sends packets over a connection from a second thread. */
+class Sender : public lunchbox::Thread
+{
+public:
+    Sender( co::ConnectionPtr connection, const size_t nPackets )
+        : _connection( connection ), _nPackets( nPackets ) {}
+
+protected:
+    virtual void run() { _sendPackets( _connection, _nPackets ); }
+
+private:
+    co::ConnectionPtr _connection;
+    const size_t _nPackets;
+};
+
+/** Serve the remote side of the benchmarks until asked to exit. */
+int _runPeer( const uint16_t port, const uint64_t size )
+{
+    co::init( 0, 0 );
+    BenchNodePtr node = new BenchNode;
+    node->addConnectionDescription( _getDescription( 0 ));
+    if( !node->listen( ))
+    {
+        LBERROR << "Can't start peer node" << std::endl;
+        co::exit();
+        return EXIT_FAILURE;
+    }
+
+    co::NodePtr benchmark = new co::Node;
+    benchmark->addConnectionDescription( _getDescription( port ));
+    while( !node->connect( benchmark ))
+        lunchbox::sleep( 10 );
+
+    VectorObject< uint8_t > master; // mapped by object/map
+    master.values.resize( size );
+    master.setID( _mapID );
+    LBCHECK( node->registerObject( &master ));
+    benchmark->send( CMD_NODE_REPLY ); // ready
+
+    int result = EXIT_SUCCESS;
+    while( node->running )
+    {
+        co::ICommand command = node->requests.pop();
+        if( !command( ))
+        {
+            LBERROR << "Peer workload failed" << std::endl;
+            result = EXIT_FAILURE;
+            break;
+        }
+    }
+
+    node->deregisterObject( &master );
+    node->close();
+    benchmark = 0;
+    node = 0;
+    co::exit();
+    return result;
+}
+
+//----- benchmark functions
+void _alloc( co::BufferCache& cache, const uint64_t size, const size_t n )
+{
+    for( size_t i = 0; i < n; ++i )
+        cache.alloc( size );
+}
+
+template< class O > void _commitSync( O& master, O& slave )
+{
+    slave.sync( master.commit( ));
+}
+
+void _sendCommands( BenchNodePtr node, co::NodePtr peer, const uint32_t cmd,
+                    const size_t n )
+{
+    for( size_t i = 0; i < n; ++i )
+        peer->send( cmd ) << ( i == n - 1 );
+    node->waitReply();
+}
+
+void _pushPop( co::CommandQueue& queue, const size_t n )
+{
+    const co::ICommand command;
+    for( size_t i = 0; i < n; ++i )
+    {
+        queue.push( command );
+        queue.pop();
+    }
+}
+
+void _pushPopAll( co::CommandQueue& queue, const size_t n )
+{
+    const co::ICommand command;
+    for( size_t i = 0; i < n; ++i )
+        queue.push( command );
+    queue.popAll();
+}
+
+void _commit( co::Object& object )
+{
+    object.commit();
+}
+
+/** Commit and wait for the peer to sync the new version. */
+void _commitReply( co::Object& object, BenchNodePtr node )
+{
+    object.commit();
+    node->waitReply();
+}
+
+template< class O > void _map( co::LocalNodePtr node, const co::uint128_t& id )
+{
+    O object;
+    LBCHECK( node->mapObject( &object, id ));
+    node->unmapObject( &object );
+}
+
+void _enter( co::Barrier& barrier, const size_t n )
+{
+    for( size_t i = 0; i < n; ++i )
+        barrier.enter();
+}
+
+void _queue( co::QueueMaster& master, BenchNodePtr node, co::NodePtr peer,
+             const std::vector< uint8_t >& item, const size_t n )
+{
+    for( size_t i = 0; i < n; ++i )
+        master.push() << item;
+
+    peer->send( CMD_NODE_RUN ) << uint32_t( WORKLOAD_QUEUE_POP )
+                               << uint64_t( n );
+    node->waitReply();
+}
+
+void _receive( co::ConnectionPtr connection, const size_t n )
+{
+    co::Buffer buffer;
+    co::BufferPtr syncBuffer;
+    for( size_t i = 0; i < n; ++i )
+    {
+        buffer.setSize( 0 );
+        connection->recvNB( &buffer, _packetSize );
+        if( !connection->recvSync( syncBuffer ))
+        {
+            LBERROR << "Receive failed" << std::endl;
+            return;
+        }
+    }
+}
+
+//----- benchmark groups
+void _benchBufferCache( const uint64_t size )
+{
+    if( !_isSelected( "bufferCache/" ))
+        return;
+
+    co::BufferCache cache( 200 );
+    _measure( "bufferCache/small", 100, 0,
+              boost::bind( &_alloc, boost::ref( cache ),
+                           co::COMMAND_ALLOCSIZE, 100 ));
+    _measure( "bufferCache/big", 10, 0,
+              boost::bind( &_alloc, boost::ref( cache ), size, 10 ));
+}
+
+template< class O >
+void _benchStream( co::LocalNodePtr node, const std::string& name, O& master,
+                   const uint64_t bytes )
+{
+    if( !_isSelected( name ))
+        return;
+
+    O slave;
+    LBCHECK( node->registerObject( &master ));
+    LBCHECK( node->mapObject( &slave, master.getID( )));
+
+    _measure( name, master.values.size(), bytes,
+              boost::bind( &_commitSync< O >, boost::ref( master ),
+                           boost::ref( slave )));
+
+    node->unmapObject( &slave );
+    node->deregisterObject( &master );
+}
+
+void _benchStreams( co::LocalNodePtr node, const uint64_t size )
+{
+    StreamObject< uint8_t > bytes;
+    bytes.values.resize( size );
+    _benchStream( node, "stream/uint8", bytes, size );
+
+    StreamObject< uint32_t > ints;
+    ints.values.resize( size / sizeof( uint32_t ));
+    _benchStream( node, "stream/uint32", ints, size );
+
+    StreamObject< double > doubles;
+    doubles.values.resize( size / sizeof( double ));
+    _benchStream( node, "stream/double", doubles, size );
+
+    const std::string string( 56, 'x' ); // serialized with 8 byte size
+    StreamObject< std::string > strings;
+    strings.values.resize( size / 64, string );
+    _benchStream( node, "stream/string", strings, size );
+
+    VectorObject< double > vector;
+    vector.values.resize( size / sizeof( double ));
+    _benchStream( node, "stream/vector", vector, size );
+}
+
+void _benchCommands( BenchNodePtr node, co::NodePtr peer )
+{
+    _measure( "command/direct", 100, 0,
+              boost::bind( &_sendCommands, node, peer, CMD_NODE_DIRECT, 100 ));
+    _measure( "command/queued", 100, 0,
+              boost::bind( &_sendCommands, node, peer, CMD_NODE_QUEUED, 100 ));
+
+    co::CommandQueue queue;
+    _measure( "commandQueue/pushPop", 100, 0,
+              boost::bind( &_pushPop, boost::ref( queue ), 100 ));
+    _measure( "commandQueue/popAll", 100, 0,
+              boost::bind( &_pushPopAll, boost::ref( queue ), 100 ));
+}
+
+void _benchObjects( BenchNodePtr node, co::NodePtr peer, const uint64_t size )
+{
+    if( !_isSelected( "object/" ))
+        return;
+
+    _measure( "object/map", 1, size,
+              boost::bind( &_map< VectorObject< uint8_t > >, node, _mapID ));
+
+    VectorObject< uint8_t > master;
+    master.values.resize( size );
+    master.setID( _syncID );
+    LBCHECK( node->registerObject( &master ));
+
+    // the peer syncs each committed version, replying if it is measured
+    const uint64_t nVersions = _nWarmups + _nSamples;
+    if( _isSelected( "object/commit" ))
+    {
+        peer->send( CMD_NODE_RUN ) << uint32_t( WORKLOAD_SYNC ) << nVersions
+                                   << false;
+        node->waitReply(); // mapped
+        _measure( "object/commit", 1, size,
+                  boost::bind( &_commit, boost::ref( master )));
+        node->waitReply(); // unmapped
+    }
+    if( _isSelected( "object/sync" ))
+    {
+        peer->send( CMD_NODE_RUN ) << uint32_t( WORKLOAD_SYNC ) << nVersions
+                                   << true;
+        node->waitReply();
+        _measure( "object/sync", 1, size,
+                  boost::bind( &_commitReply, boost::ref( master ), node ));
+        node->waitReply();
+    }
+
+    node->deregisterObject( &master );
+}
+
+void _benchBarrier( BenchNodePtr node, co::NodePtr peer )
+{
+    if( !_isSelected( "barrier/enter" ))
+        return;
+
+    static const size_t nEntries = 10;
+    co::Barrier master( node, 2 );
+    master.setID( _barrierID );
+    LBCHECK( node->registerObject( &master ));
+
+    peer->send( CMD_NODE_RUN ) << uint32_t( WORKLOAD_BARRIER )
+                               << uint64_t(( _nWarmups + _nSamples ) *
+                                           nEntries );
+    _measure( "barrier/enter", nEntries, 0,
+              boost::bind( &_enter, boost::ref( master ), nEntries ));
+    node->waitReply(); // unmapped
+
+    node->deregisterObject( &master );
+}
+
+void _benchQueue( BenchNodePtr node, co::NodePtr peer )
+{
+    if( !_isSelected( "queue/item" ))
+        return;
+
+    co::QueueMaster master;
+    master.setID( _queueID );
+    LBCHECK( node->registerObject( &master ));
+    peer->send( CMD_NODE_RUN ) << uint32_t( WORKLOAD_QUEUE_MAP )
+                               << uint64_t( 0 );
+    node->waitReply();
+
+    const std::vector< uint8_t > item( _itemSize );
+    _measure( "queue/item", _nItems, _nItems * _itemSize,
+              boost::bind( &_queue, boost::ref( master ), node, peer,
+                           boost::cref( item ), _nItems ));
+
+    peer->send( CMD_NODE_RUN ) << uint32_t( WORKLOAD_QUEUE_UNMAP )
+                               << uint64_t( 0 );
+    node->waitReply();
+    node->deregisterObject( &master );
+}
+
+void _benchTransport( const std::string& name, co::ConnectionPtr sender,
+                      co::ConnectionPtr receiver )
+{
+    Sender thread( sender, ( _nWarmups + _nSamples ) * _nPackets );
+    LBCHECK( thread.start( ));
+    _measure( name, _nPackets, _nPackets * _packetSize,
+              boost::bind( &_receive, receiver, _nPackets ));
+    LBCHECK( thread.join( ));
+}
+
+void _benchTransports( co::NodePtr peer, const uint16_t port )
+{
+    if( _isSelected( "transport/pipe" ))
+    {
+        co::ConnectionDescriptionPtr description =
+            new co::ConnectionDescription;
+        description->type = co::CONNECTIONTYPE_PIPE;
+        co::ConnectionPtr connection = co::Connection::create( description );
+        LBCHECK( connection->connect( ));
+
+        _benchTransport( "transport/pipe", connection->acceptSync(),
+                         connection );
+        connection->close();
+    }
+
+    if( _isSelected( "transport/tcp" ))
+    {
+        co::ConnectionPtr listener =
+            co::Connection::create( _getDescription( port ));
+        if( !listener->listen( ))
+        {
+            LBWARN << "Can't listen on port " << port << std::endl;
+            return;
+        }
+        listener->acceptNB();
+
+        // the peer process connects and sends all packets
+        peer->send( CMD_NODE_RUN ) << uint32_t( WORKLOAD_TRANSPORT )
+                                   << uint64_t(( _nWarmups + _nSamples ) *
+                                               _nPackets ) << port;
+        co::ConnectionPtr accepted = listener->acceptSync();
+        if( accepted )
+        {
+            _measure( "transport/tcp", _nPackets, _nPackets * _packetSize,
+                      boost::bind( &_receive, accepted, _nPackets ));
+            accepted->close();
+        }
+        listener->close();
+    }
+}
+}
+
+int main( int argc, char **argv )
+{
+    uint64_t size = LB_1MB;
+    std::string jsonFile;
+
+    try // command line parsing
+    {
+        TCLAP::CmdLine command(
+            "coBench - Collage micro and macro benchmark suite",
+            ' ', co::Version::getString( ));
+        TCLAP::ValueArg< size_t > warmupsArg( "w", "warmups",
+                                              "untimed samples per benchmark",
+                                              false, _nWarmups, "unsigned",
+                                              command );
+        TCLAP::ValueArg< size_t > samplesArg( "n", "samples",
+                                              "timed samples per benchmark",
+                                              false, _nSamples, "unsigned",
+                                              command );
+        TCLAP::ValueArg< uint64_t > sizeArg( "s", "size",
+                                       "data size of stream and object "
+                                       "benchmarks in bytes", false, size,
+                                       "unsigned", command );
+        TCLAP::ValueArg< std::string > filterArg( "f", "filter",
+                     "run only benchmarks with the given name prefix, e.g., "
+                     "'object/' or 'stream/double'", false, _filter,
+                                                  "string", command );
+        TCLAP::ValueArg< std::string > jsonArg( "j", "json",
+                                                "write results to JSON file",
+                                                false, jsonFile, "filename",
+                                                command );
+        command.parse( argc, argv );
+
+        _nWarmups = warmupsArg.getValue();
+        _nSamples = LB_MAX( samplesArg.getValue(), size_t( 1 ));
+        size = LB_MAX( sizeArg.getValue(), uint64_t( 64 ));
+        _filter = filterArg.getValue();
+        jsonFile = jsonArg.getValue();
+    }
+    catch( TCLAP::ArgException& exception )
+    {
+        LBERROR << "Command line parse error: " << exception.error()
+                << " for argument " << exception.argId() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+#ifdef _WIN32
+    LBERROR << "coBench uses fork() to start its peer process" << std::endl;
+    return EXIT_FAILURE;
+#else
+    const uint16_t port = uint16_t( ::getpid() % 60000 ) + 1024;
+
+    // Fork the peer from the thread-free parent
+    const pid_t pid = ::fork();
+    if( pid == 0 )
+        ::_exit( _runPeer( port, size ));
+    if( pid < 0 )
+    {
+        LBERROR << "fork failed: " << lunchbox::sysError << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if( !co::init( argc, argv ))
+        return EXIT_FAILURE;
+
+    BenchNodePtr node = new BenchNode;
+    node->addConnectionDescription( _getDescription( port ));
+    if( !node->listen( ))
+    {
+        LBERROR << "Can't start local node" << std::endl;
+        ::kill( pid, SIGTERM );
+        co::exit();
+        return EXIT_FAILURE;
+    }
+
+    node->waitReply(); // peer connected and its master registered
+    co::NodePtr peer = node->peer;
+
+    _benchBufferCache( size );
+    _benchStreams( node, size );
+    _benchCommands( node, peer );
+    _benchObjects( node, peer, size );
+    _benchBarrier( node, peer );
+    _benchQueue( node, peer );
+    _benchTransports( peer, port + 1 );
+
+    peer->send( CMD_NODE_RUN ) << uint32_t( WORKLOAD_EXIT ) << uint64_t( 0 );
+    int status = 0;
+    ::waitpid( pid, &status, 0 );
+
+    LBCHECK( node->close( ));
+    peer = 0;
+    node->peer = 0;
+    node = 0;
+    LBCHECK( co::exit( ));
+
+    if( !WIFEXITED( status ) || WEXITSTATUS( status ) != EXIT_SUCCESS )
+    {
+        LBERROR << "Peer process failed" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if( !jsonFile.empty( ))
+    {
+        std::ofstream file( jsonFile.c_str( ));
+        _writeJSON( file );
+        if( !file )
+        {
+            LBERROR << "Can't write " << jsonFile << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    return EXIT_SUCCESS;
+#endif
+}
@@ -0,0 +1,380 @@
+
+/* Copyright (c) 2013, Stefan.Eilemann@epfl.ch
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 2.1 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+// Simulates a cluster of many nodes with processes on the local host, running
+// object distribution, barrier and queue workloads over emulated links
+// Usage: see 'coClustersim -h'
+
+#include <co/co.h>
+#include <tclap/CmdLine.h>
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+
+#ifndef _WIN32
+#  include <sys/types.h>
+#  include <sys/wait.h>
+#  include <unistd.h>
+#endif
+
+namespace
+{
+static co::uint128_t _barrierID( 0x2F6A0C8E3B19D457ull, 0x9C41E7B2085D3FA6ull );
+static co::uint128_t _objectID( 0x5D2B8E17C9F3A640ull, 0x71A9C3E50B4D82F1ull );
+static co::uint128_t _queueID( 0xA83E5C1F6B2097D4ull, 0x4E7F0A9D21C6B358ull );
+
+/** The emulated properties of the links of one process. */
+struct Link
+{
+    Link() : latency( 0 ), bandwidth( 0 ), loss( 0 ) {}
+
+    int32_t latency; //!< us per send
+    int32_t bandwidth; //!< KB/s
+    int32_t loss; //!< percent of sends
+};
+typedef std::map< uint32_t, Link > Links;
+
+Link _link;
+Links _links; //!< per-rank overrides of _link
+bool _useShm = true;
+/** Upper bound of /dev/shm used by all shm rings of one simulated cluster. */
+const int32_t _shmBudgetMB = 256;
+uint32_t _nIterations = 100;
+uint64_t _objectSize = LB_1MB;
+uint32_t _nItems = 100;
+uint16_t _port = 4243;
+std::string _report;
+
+class DataObject : public co::Object
+{
+public:
+    std::vector< uint8_t > data;
+
+protected:
+    virtual ChangeType getChangeType() const { return INSTANCE; }
+    virtual void getInstanceData( co::DataOStream& os ) { os << data; }
+    virtual void applyInstanceData( co::DataIStream& is ) { is >> data; }
+};
+
+co::ConnectionDescriptionPtr _getDescription( const uint16_t port )
+{
+    co::ConnectionDescriptionPtr description = new co::ConnectionDescription;
+    description->type = co::CONNECTIONTYPE_TCPIP;
+    description->setHostname( "127.0.0.1" );
+    description->port = port;
+    return description;
+}
+
+std::string _getFilename( const uint32_t rank )
+{
+    std::ostringstream filename;
+    filename << _report << "." << rank;
+    return filename.str();
+}
+
+/** Parse a 'rank:latency:bandwidth:loss' link override. */
+Link _parseLink( const std::string& string, uint32_t& rank )
+{
+    Link link;
+    char separator[3] = { 0, 0, 0 };
+    std::istringstream is( string );
+    is >> rank >> separator[0] >> link.latency >> separator[1]
+       >> link.bandwidth >> separator[2] >> link.loss;
+    if( is.fail() || separator[0] != ':' || separator[1] != ':' ||
+        separator[2] != ':' )
+    {
+        throw TCLAP::ArgException( "expected rank:latency:bandwidth:loss",
+                                   "link" );
+    }
+    return link;
+}
+
+/** Run all workloads as the given rank and write its report entry. */
+int _run( const uint32_t rank, const uint32_t nNodes )
+{
+    const Links::const_iterator i = _links.find( rank );
+    const Link& link = i == _links.end() ? _link : i->second;
+    co::Global::setIAttribute( co::Global::IATTR_LINK_LATENCY_US,
+                               link.latency );
+    co::Global::setIAttribute( co::Global::IATTR_LINK_BANDWIDTH_KBS,
+                               link.bandwidth );
+    co::Global::setIAttribute( co::Global::IATTR_LINK_LOSS_PERCENT,
+                               link.loss );
+    // Each slave connects to the master with two rings; shrink them so the
+    // whole cluster stays within _shmBudgetMB of /dev/shm.
+    const int32_t ringSizeMB = _shmBudgetMB / int32_t( 2 * ( nNodes - 1 ));
+    co::Global::setIAttribute( co::Global::IATTR_SHM_RING_BUFFER_SIZE_MB,
+                               _useShm ? LB_MAX( LB_MIN( ringSizeMB, 4 ), 1 ) :
+                                         0 );
+
+    co::init( 0, 0 );
+    co::LocalNodePtr localNode = new co::LocalNode;
+    localNode->addConnectionDescription( _getDescription( rank == 0 ? _port :
+                                                                      0 ));
+    if( !localNode->listen( ))
+    {
+        LBERROR << "Can't start node " << rank << std::endl;
+        co::exit();
+        return EXIT_FAILURE;
+    }
+
+    co::Barrier barrier( 0, nNodes );
+    DataObject object;
+    co::QueueMaster queueMaster;
+    co::QueueSlave queueSlave;
+    if( rank == 0 )
+    {
+        object.data.resize( _objectSize );
+        barrier.setID( _barrierID );
+        object.setID( _objectID );
+        queueMaster.setID( _queueID );
+        LBCHECK( localNode->registerObject( &object ));
+        LBCHECK( localNode->registerObject( &queueMaster ));
+        LBCHECK( localNode->registerObject( &barrier ));
+    }
+    else
+    {
+        co::NodePtr master = new co::Node;
+        master->addConnectionDescription( _getDescription( _port ));
+
+        while( !localNode->connect( master ))
+            lunchbox::sleep( 10 );
+        while( !localNode->mapObject( &barrier, _barrierID ))
+            lunchbox::sleep( 10 );
+        LBCHECK( localNode->mapObject( &object, _objectID ));
+        LBCHECK( localNode->mapObject( &queueSlave, _queueID ));
+    }
+    barrier.enter(); // all connected and mapped
+
+    // object distribution, in lock-step to measure each version
+    lunchbox::Clock clock;
+    for( uint32_t j = 0; j < _nIterations; ++j )
+    {
+        if( rank == 0 )
+        {
+            object.data[ j % _objectSize ] = uint8_t( j );
+            object.commit();
+        }
+        else
+            object.sync( co::VERSION_NEXT );
+        barrier.enter();
+    }
+    const float objectTime = clock.getTimef() / float( _nIterations );
+
+    clock.reset();
+    for( uint32_t j = 0; j < _nIterations; ++j )
+        barrier.enter();
+    const float barrierTime = clock.getTimef() / float( _nIterations );
+
+    // queue: fill, then drain concurrently from all slaves
+    if( rank == 0 )
+    {
+        const std::vector< uint8_t > item( 4096 );
+        for( uint32_t j = 0; j < _nItems * ( nNodes - 1 ); ++j )
+            queueMaster.push() << item;
+    }
+    barrier.enter();
+    clock.reset();
+    size_t nItems = 0;
+    if( rank != 0 )
+        while( queueSlave.pop().isValid( ))
+            ++nItems;
+    barrier.enter();
+    const float queueTime = clock.getTimef();
+
+    std::ofstream file( _getFilename( rank ).c_str( ));
+    file << "{ \"rank\": " << rank << ", \"syncTime\": " << objectTime
+         << ", \"barrierTime\": " << barrierTime << ", \"queueItems\": "
+         << nItems << ", \"queueTime\": " << queueTime
+         << ", \"link\": { \"latency\": " << link.latency
+         << ", \"bandwidth\": " << link.bandwidth << ", \"loss\": "
+         << link.loss << " }, \"node\": ";
+    localNode->printStatistics( file );
+    file << " }";
+    file.close();
+
+    barrier.enter(); // don't unmap while others are still inside
+    if( rank == 0 )
+    {
+        localNode->deregisterObject( &barrier );
+        localNode->deregisterObject( &queueMaster );
+        localNode->deregisterObject( &object );
+    }
+    else
+    {
+        localNode->unmapObject( &barrier );
+        localNode->unmapObject( &queueSlave );
+        localNode->unmapObject( &object );
+    }
+
+    localNode->close();
+    localNode = 0;
+    co::exit();
+    return file ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/** Append the entries of all processes of one run to the report. */
+void _collect( std::ostream& os, const uint32_t nNodes, const bool first )
+{
+    os << ( first ? "\n  " : ",\n  " ) << "{ \"nodes\": " << nNodes
+       << ", \"processes\": [";
+    for( uint32_t i = 0; i < nNodes; ++i )
+    {
+        const std::string& filename = _getFilename( i );
+        std::ifstream file( filename.c_str( ));
+        os << ( i == 0 ? "\n    " : ",\n    " ) << file.rdbuf();
+        file.close();
+        ::remove( filename.c_str( ));
+    }
+    os << " ] }";
+}
+}
+
+int main( int argc, char **argv )
+{
+    uint32_t minNodes = 2;
+    uint32_t maxNodes = 64;
+    _report = "clustersim.json";
+
+    try // command line parsing
+    {
+        TCLAP::CmdLine command(
+            "clustersim - Collage cluster simulation with local processes",
+            ' ', co::Version::getString( ));
+        TCLAP::ValueArg< uint32_t > minArg( "m", "minNodes",
+                                            "minimum number of processes",
+                                            false, minNodes, "unsigned",
+                                            command );
+        TCLAP::ValueArg< uint32_t > maxArg( "n", "maxNodes",
+                 "maximum number of processes, doubled starting at minimum",
+                                            false, maxNodes, "unsigned",
+                                            command );
+        TCLAP::ValueArg< uint32_t > iterationsArg( "i", "iterations",
+                                       "object versions and barrier entries",
+                                                   false, _nIterations,
+                                                   "unsigned", command );
+        TCLAP::ValueArg< uint64_t > sizeArg( "s", "size",
+                                             "object size in bytes", false,
+                                             _objectSize, "unsigned",
+                                             command );
+        TCLAP::ValueArg< uint32_t > itemsArg( "q", "queueItems",
+                                              "queue items per slave", false,
+                                              _nItems, "unsigned", command );
+        TCLAP::ValueArg< int32_t > latencyArg( "l", "latency",
+                                        "emulated latency per send in us",
+                                               false, 0, "unsigned",
+                                               command );
+        TCLAP::ValueArg< int32_t > bandwidthArg( "b", "bandwidth",
+                                                 "emulated bandwidth in KB/s",
+                                                 false, 0, "unsigned",
+                                                 command );
+        TCLAP::ValueArg< int32_t > lossArg( "x", "loss",
+                        "percentage of sends delayed by a retransmission",
+                                            false, 0, "unsigned", command );
+        TCLAP::MultiArg< std::string > linkArg( "k", "link",
+                      "link emulation of the given rank, overrides defaults",
+                                     false, "rank:latency:bandwidth:loss",
+                                                command );
+        TCLAP::SwitchArg tcpArg( "t", "tcp",
+                                 "use TCP also between local processes, "
+                                 "instead of shared memory", command, false );
+        TCLAP::ValueArg< uint16_t > portArg( "p", "port",
+                                             "master listening port", false,
+                                             _port, "unsigned short",
+                                             command );
+        TCLAP::ValueArg< std::string > reportArg( "r", "report",
+                                                  "JSON report file", false,
+                                                  _report, "filename",
+                                                  command );
+        command.parse( argc, argv );
+
+        minNodes = LB_MAX( minArg.getValue(), 2u );
+        maxNodes = LB_MAX( maxArg.getValue(), minNodes );
+        _nIterations = LB_MAX( iterationsArg.getValue(), 1u );
+        _objectSize = LB_MAX( sizeArg.getValue(), uint64_t( 1 ));
+        _nItems = itemsArg.getValue();
+        _link.latency = latencyArg.getValue();
+        _link.bandwidth = bandwidthArg.getValue();
+        _link.loss = lossArg.getValue();
+        _useShm = !tcpArg.isSet();
+        _port = portArg.getValue();
+        _report = reportArg.getValue();
+
+        const std::vector< std::string >& links = linkArg.getValue();
+        for( size_t i = 0; i < links.size(); ++i )
+        {
+            uint32_t rank = 0;
+            const Link link = _parseLink( links[i], rank );
+            _links[ rank ] = link;
+        }
+    }
+    catch( TCLAP::ArgException& exception )
+    {
+        LBERROR << "Command line parse error: " << exception.error()
+                << " for argument " << exception.argId() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+#ifdef _WIN32
+    LBERROR << "coClustersim uses fork() to start processes" << std::endl;
+    return EXIT_FAILURE;
+#else
+    std::ofstream report( _report.c_str( ));
+    report << "{ \"iterations\": " << _nIterations << ", \"objectSize\": "
+           << _objectSize << ", \"queueItems\": " << _nItems
+           << ", \"shm\": " << ( _useShm ? "true" : "false" )
+           << ", \"runs\": [";
+
+    // Fork all processes of a run from this thread-free parent
+    for( uint32_t nNodes = minNodes; nNodes <= maxNodes; nNodes <<= 1 )
+    {
+        for( uint32_t i = 0; i < nNodes; ++i )
+        {
+            const pid_t pid = ::fork();
+            if( pid == 0 )
+                ::_exit( _run( i, nNodes ));
+            if( pid < 0 )
+            {
+                LBERROR << "fork failed: " << lunchbox::sysError << std::endl;
+                return EXIT_FAILURE;
+            }
+        }
+
+        int result = EXIT_SUCCESS;
+        for( uint32_t i = 0; i < nNodes; ++i )
+        {
+            int status = 0;
+            ::wait( &status );
+            if( !WIFEXITED( status ) || WEXITSTATUS( status ) != EXIT_SUCCESS )
+                result = EXIT_FAILURE;
+        }
+        if( result != EXIT_SUCCESS )
+            return result;
+
+        _collect( report, nNodes, nNodes == minNodes );
+        std::cout << nNodes << " nodes done" << std::endl;
+        ++_port; // avoid sockets lingering from the last run
+    }
+
+    report << "\n] }" << std::endl;
+    std::cout << "Report written to " << _report << std::endl;
+    return report ? EXIT_SUCCESS : EXIT_FAILURE;
+#endif
+}
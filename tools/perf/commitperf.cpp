@@ -0,0 +1,190 @@
+
+/* Copyright (c) 2013, Stefan.Eilemann@epfl.ch
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 2.1 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+// Compares sequential and parallel commits of many independent objects
+// Usage: see 'coCommitperf -h'
+
+#include <co/co.h>
+#include <lunchbox/rng.h>
+#include <tclap/CmdLine.h>
+#include <iostream>
+
+namespace
+{
+typedef lunchbox::Buffer< uint64_t > Buffer;
+
+class PerfObject : public co::Object
+{
+public:
+    Buffer data;
+
+protected:
+    virtual ChangeType getChangeType() const { return INSTANCE; }
+    virtual void getInstanceData( co::DataOStream& os ) { os << data; }
+    virtual void applyInstanceData( co::DataIStream& is ) { is >> data; }
+};
+
+typedef std::vector< PerfObject* > PerfObjects;
+
+co::ConnectionDescriptionPtr _getDescription( const uint16_t port )
+{
+    co::ConnectionDescriptionPtr description = new co::ConnectionDescription;
+    description->type = co::CONNECTIONTYPE_TCPIP;
+    description->setHostname( "127.0.0.1" );
+    description->port = port;
+    return description;
+}
+
+void _modify( PerfObjects& objects, const uint64_t value )
+{
+    for( PerfObjects::iterator i = objects.begin(); i != objects.end(); ++i )
+    {
+        Buffer& data = (*i)->data;
+        data[ value % data.getSize() ] = value;
+    }
+}
+
+void _sync( PerfObjects& slaves )
+{
+    for( PerfObjects::iterator i = slaves.begin(); i != slaves.end(); ++i )
+        (*i)->sync( co::VERSION_HEAD );
+}
+}
+
+int main( int argc, char **argv )
+{
+    size_t nObjects = 1000;
+    size_t objectSize = 65536;
+    size_t nIterations = 10;
+    int32_t nThreads = 8;
+
+    try // command line parsing
+    {
+        TCLAP::CmdLine command(
+            "commitperf - Collage sequential vs. parallel commit benchmark",
+            ' ', co::Version::getString( ));
+        TCLAP::ValueArg< size_t > objectsArg( "n", "numObjects",
+                                              "number of objects", false,
+                                              nObjects, "unsigned", command );
+        TCLAP::ValueArg< size_t > sizeArg( "s", "size", "object size in bytes",
+                                           false, objectSize, "unsigned",
+                                           command );
+        TCLAP::ValueArg< size_t > iterationsArg( "i", "iterations",
+                                                 "commits of all objects", false,
+                                                 nIterations, "unsigned",
+                                                 command );
+        TCLAP::ValueArg< int32_t > threadsArg( "t", "threads",
+                                               "number of commit threads",
+                                               false, nThreads, "unsigned",
+                                               command );
+        command.parse( argc, argv );
+
+        nObjects = LB_MAX( objectsArg.getValue(), size_t( 2 ));
+        objectSize = LB_MAX( sizeArg.getValue(), sizeof( uint64_t ));
+        nIterations = LB_MAX( iterationsArg.getValue(), size_t( 1 ));
+        nThreads = LB_MAX( threadsArg.getValue(), 1 );
+    }
+    catch( TCLAP::ArgException& exception )
+    {
+        LBERROR << "Command line parse error: " << exception.error()
+                << " for argument " << exception.argId() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if( !co::init( argc, argv ))
+        return EXIT_FAILURE;
+    co::Global::setIAttribute( co::Global::IATTR_COMMIT_THREAD_COUNT,
+                               nThreads );
+
+    lunchbox::RNG rng;
+    const uint16_t port = (rng.get< uint16_t >() % 60000) + 1024;
+
+    co::LocalNodePtr server = new co::LocalNode;
+    server->addConnectionDescription( _getDescription( port ));
+    co::LocalNodePtr client = new co::LocalNode;
+    client->addConnectionDescription( _getDescription( 0 ));
+    if( !server->listen() || !client->listen( ))
+    {
+        LBERROR << "Can't start local nodes" << std::endl;
+        co::exit();
+        return EXIT_FAILURE;
+    }
+
+    co::NodePtr serverProxy = new co::Node;
+    serverProxy->addConnectionDescription( _getDescription( port ));
+    LBCHECK( client->connect( serverProxy ));
+
+    PerfObjects masters( nObjects );
+    PerfObjects slaves( nObjects );
+    co::Objects objects( nObjects );
+    const size_t nElems = objectSize / sizeof( uint64_t );
+    for( size_t i = 0; i < nObjects; ++i )
+    {
+        masters[i] = new PerfObject;
+        masters[i]->data.resize( nElems );
+        for( size_t j = 0; j < nElems; ++j )
+            masters[i]->data[j] = rng.get< uint64_t >();
+        LBCHECK( server->registerObject( masters[i] ));
+        objects[i] = masters[i];
+
+        slaves[i] = new PerfObject;
+        LBCHECK( client->mapObject( slaves[i], masters[i]->getID( )));
+    }
+
+    const float mBytes = float( nObjects * objectSize ) / 1024.f / 1024.f;
+    float times[2] = { 0.f, 0.f };
+    for( size_t parallel = 0; parallel < 2; ++parallel )
+    {
+        for( size_t i = 0; i < nIterations; ++i )
+        {
+            _modify( masters, i );
+
+            lunchbox::Clock clock;
+            if( parallel )
+                server->commitObjects( objects );
+            else for( size_t j = 0; j < nObjects; ++j )
+                masters[j]->commit();
+            times[ parallel ] += clock.getTimef();
+
+            _sync( slaves );
+        }
+        times[ parallel ] /= nIterations;
+        std::cout << ( parallel ? "Parallel" : "Sequential" ) << " commit of "
+                  << nObjects << " objects: " << times[ parallel ] << " ms, "
+                  << mBytes / times[ parallel ] * 1000.f << " MB/s"
+                  << std::endl;
+    }
+    std::cout << "Speedup with " << nThreads << " threads: "
+              << times[0] / times[1] << std::endl;
+
+    for( size_t i = 0; i < nObjects; ++i )
+    {
+        client->unmapObject( slaves[i] );
+        server->deregisterObject( masters[i] );
+        delete slaves[i];
+        delete masters[i];
+    }
+
+    LBCHECK( client->disconnect( serverProxy ));
+    LBCHECK( client->close( ));
+    LBCHECK( server->close( ));
+    serverProxy = 0;
+    client = 0;
+    server = 0;
+    LBCHECK( co::exit( ));
+    return EXIT_SUCCESS;
+}
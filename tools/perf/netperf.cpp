@@ -35,6 +35,7 @@ co::ConnectionSet   _connectionSet;
 lunchbox::a_int32_t _nClients;
 lunchbox::Lock      _mutexPrint;
 uint32_t _delay = 0;
+bool _latency = false;
 enum
 {
     SEQUENCE,
@@ -67,6 +68,9 @@ public:
                           static_cast< int >( _lastPacket ) << ", " <<
                           static_cast< int >( _buffer[ SEQUENCE ] ));
             _lastPacket = _buffer[SEQUENCE];
+            if( _latency ) // echo to sender
+                LBCHECK( _connection->send( _buffer.getData(),
+                                            _buffer.getSize( )));
 
             _buffer.setSize( 0 );
             _connection->recvNB( &_buffer, _buffer.getMaxSize( ));
@@ -333,6 +337,9 @@ int main( int argc, char **argv )
         TCLAP::ValueArg<uint32_t> delayArg( "d", "delay",
                                 "wait time (ms) between receives (server only)",
                                             false, 0, "unsigned", command );
+        TCLAP::SwitchArg latencyArg( "l", "latency",
+                  "Measure round-trip latency, the server echoes each packet",
+                                     command, false );
 
         command.xorAdd( clientArg, serverArg );
         command.parse( argc, argv );
@@ -355,6 +362,7 @@ int main( int argc, char **argv )
             waitTime = waitArg.getValue();
         if( delayArg.isSet( ))
             _delay = delayArg.getValue();
+        _latency = latencyArg.isSet();
     }
     catch( TCLAP::ArgException& exception )
     {
@@ -393,20 +401,32 @@ int main( int argc, char **argv )
         const float mBytesSec = buffer.getSize() / 1024.0f / 1024.0f * 1000.0f;
         lunchbox::Clock clock;
         size_t lastOutput = nPackets;
+        co::Buffer reply;
 
         clock.reset();
         while( nPackets-- )
         {
             buffer[SEQUENCE] = uint8_t( nPackets );
             LBCHECK( connection->send( buffer.getData(), buffer.getSize() ));
+            if( _latency )
+            {
+                co::BufferPtr echo;
+                connection->recvNB( &reply, buffer.getSize( ));
+                LBCHECK( connection->recvSync( echo ));
+                reply.setSize( 0 );
+            }
+
             const float time = clock.getTimef();
             if( time > 1000.f )
             {
                 const lunchbox::ScopedMutex<> mutex( _mutexPrint );
                 const size_t nSamples = lastOutput - nPackets;
                 std::cerr << "Send perf: " << mBytesSec / time * nSamples
-                          << "MB/s (" << nSamples / time * 1000.f  << "pps)"
-                          << std::endl;
+                          << "MB/s (" << nSamples / time * 1000.f  << "pps)";
+                if( _latency )
+                    std::cerr << ", " << time * 1000.f / nSamples
+                              << "us round-trip";
+                std::cerr << std::endl;
 
                 lastOutput = nPackets;
                 clock.reset();
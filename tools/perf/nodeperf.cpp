@@ -19,8 +19,15 @@
 // Usage: see 'nodePerf -h'
 
 #include <co/co.h>
+#include <co/queueItem.h>
+#include <co/queueMaster.h>
+#include <co/queueSlave.h>
+#include <lunchbox/atomic.h>
+#include <lunchbox/monitor.h>
+#include <lunchbox/plugins/compressor.h>
 #include <tclap/CmdLine.h>
 #include <boost/foreach.hpp>
+#include <algorithm>
 #include <iostream>
 
 namespace
@@ -31,10 +38,53 @@ typedef lunchbox::Buffer< uint64_t > Buffer;
 
 ConnectedNodes nodes_;
 lunchbox::Lock print_;
+lunchbox::a_int32_t received_;
+const lunchbox::Clock syncClock_; //!< time base of the sync acknowledgements
 static co::uint128_t _objectID( 0x25625429A197D730ull, 0x79F60861189007D5ull );
+static co::uint128_t _commitID( 0x4C2A1E6B0D9F3785ull, 0x9E3B52C07A1D64F1ull );
+static co::uint128_t _queueID( 0x6B1F0E93D25A4C87ull, 0x3E8D7C615B0A92F4ull );
+static co::uint128_t _syncID( 0x1D7E4A90C38B52F6ull, 0xA5620F7B9E14C3D8ull );
 template< class C >
 bool commandHandler( C command, Buffer& buffer, const uint64_t seed );
 
+typedef std::vector< float > Latencies;
+
+/**
+ * Print the distribution of the given latencies in milliseconds. Percentiles
+ * which would only repeat the maximum are omitted for few samples.
+ */
+void _printLatencies( std::ostream& os, Latencies& latencies )
+{
+    if( latencies.empty( ))
+        return;
+
+    std::sort( latencies.begin(), latencies.end( ));
+    const size_t last = latencies.size() - 1;
+    os << latencies[ last / 2 ] * 1000.f << "us p50, ";
+    if( latencies.size() >= 100 )
+        os << latencies[ last * 99 / 100 ] * 1000.f << "us p99, ";
+    if( latencies.size() >= 1000 )
+        os << latencies[ last * 999 / 1000 ] * 1000.f << "us p99.9, ";
+    os << latencies[ last ] * 1000.f << "us max, " << latencies.size()
+       << " samples";
+}
+
+enum Commands
+{
+    CMD_NODE_PING = co::CMD_NODE_CUSTOM + 1,
+    CMD_NODE_PONG,
+    CMD_NODE_SYNC_STAGE,
+    CMD_NODE_SYNC_ACK
+};
+
+/** The progress of a node in the sync latency benchmark. */
+enum SyncStage
+{
+    STAGE_NONE,
+    STAGE_REGISTERED, //!< all sync masters have been registered
+    STAGE_MAPPED //!< the sync slaves of all peers have been mapped
+};
+
 class Object : public co::Serializable
 {
 private:
@@ -56,15 +106,89 @@ private:
     }
 };
 
+/** Versioned object distributing its buffer on each commit. */
+class CommitObject : public co::Object
+{
+public:
+    CommitObject() : changeType( INSTANCE ), compress( true ) {}
+
+    Buffer data;
+    ChangeType changeType;
+    bool compress;
+
+protected:
+    virtual ChangeType getChangeType() const { return changeType; }
+    virtual void getInstanceData( co::DataOStream& os ) { os << data; }
+    virtual void applyInstanceData( co::DataIStream& is ) { is >> data; }
+    virtual uint32_t chooseCompressor() const
+    {
+        return compress ? co::Object::chooseCompressor() : EQ_COMPRESSOR_NONE;
+    }
+};
+typedef std::vector< CommitObject* > CommitObjects;
+
+/** One combination measured by the commit-to-sync latency benchmark. */
+struct SyncConfig
+{
+    SyncConfig( const co::Object::ChangeType type_, const size_t size_,
+                const bool compress_ )
+        : type( type_ ), size( size_ ), compress( compress_ ) {}
+
+    co::Object::ChangeType type;
+    size_t size;
+    bool compress;
+};
+typedef std::vector< SyncConfig > SyncConfigs;
+
+/** @return all change types, object sizes up to maxSize and compressions. */
+SyncConfigs _getSyncConfigs( const size_t maxSize )
+{
+    static const co::Object::ChangeType types[] =
+        { co::Object::STATIC, co::Object::INSTANCE, co::Object::DELTA,
+          co::Object::UNBUFFERED };
+
+    SyncConfigs configs;
+    for( size_t i = 0; i < sizeof( types ) / sizeof( types[0] ); ++i )
+        for( size_t size = 64; size <= std::max( maxSize, size_t( 64 ));
+             size <<= 1 )
+        {
+            configs.push_back( SyncConfig( types[i], size, false ));
+            configs.push_back( SyncConfig( types[i], size, true ));
+        }
+    return configs;
+}
+
+const char* _getName( const co::Object::ChangeType type )
+{
+    switch( type )
+    {
+    case co::Object::STATIC:     return "STATIC";
+    case co::Object::INSTANCE:   return "INSTANCE";
+    case co::Object::DELTA:      return "DELTA";
+    case co::Object::UNBUFFERED: return "UNBUFFERED";
+    default:                     return "UNKNOWN";
+    }
+}
+
 class PerfNodeProxy : public co::Node
 {
 public:
-    PerfNodeProxy() : co::Node( 0xC0FFEEu ), nPackets( 0 ) {}
+    PerfNodeProxy() : co::Node( 0xC0FFEEu ), nPackets( 0 ), nItems( 0 ),
+                      syncStage( STAGE_NONE ), syncAcks( 0 ), syncAckTime( 0. )
+    {}
 
     uint32_t nPackets;
+    size_t nItems;
+    lunchbox::Monitor< uint32_t > syncStage;
+    lunchbox::Monitor< uint32_t > syncAcks; //!< our commits synced by the peer
+    double syncAckTime; //!< syncClock_ time of the last acknowledgement
     Object object;
+    CommitObject commitObject;
+    CommitObjects syncObjects;
+    co::QueueSlave queueSlave;
 };
 typedef lunchbox::RefPtr< PerfNodeProxy > PerfNodeProxyPtr;
+typedef std::vector< PerfNodeProxyPtr > PerfNodeProxies;
 
 class PerfNode : public co::LocalNode
 {
@@ -75,6 +199,21 @@ public:
                          co::CommandFunc< PerfNode >( this,
                                                       &PerfNode::_cmdCustom ),
                          getCommandThreadQueue( ));
+        // handled directly by the receiver to measure the transport latency
+        registerCommand( CMD_NODE_PING,
+                         co::CommandFunc< PerfNode >( this,
+                                                      &PerfNode::_cmdPing ), 0 );
+        registerCommand( CMD_NODE_PONG,
+                         co::CommandFunc< PerfNode >( this,
+                                                      &PerfNode::_cmdPong ), 0 );
+        registerCommand( CMD_NODE_SYNC_STAGE,
+                         co::CommandFunc< PerfNode >( this,
+                                                   &PerfNode::_cmdSyncStage ),
+                         0 );
+        registerCommand( CMD_NODE_SYNC_ACK,
+                         co::CommandFunc< PerfNode >( this,
+                                                      &PerfNode::_cmdSyncAck ),
+                         0 );
     }
 
 private:
@@ -103,6 +242,42 @@ private:
     {
         return commandHandler( command, buffer_, getNodeID().low( ));
     }
+
+    bool _cmdPing( co::ICommand& command )
+    {
+        command.getNode()->send( CMD_NODE_PONG ) << command.get< uint32_t >();
+        return true;
+    }
+
+    bool _cmdPong( co::ICommand& command )
+    {
+        serveRequest( command.get< uint32_t >( ));
+        return true;
+    }
+
+    bool _cmdSyncStage( co::ICommand& command )
+    {
+        co::NodePtr node = command.getNode();
+        if( node->getType() != 0xC0FFEEu )
+            return false;
+
+        static_cast< PerfNodeProxy* >( node.get( ))->syncStage =
+            command.get< uint32_t >();
+        return true;
+    }
+
+    bool _cmdSyncAck( co::ICommand& command )
+    {
+        co::NodePtr node = command.getNode();
+        if( node->getType() != 0xC0FFEEu )
+            return false;
+
+        // timestamped on arrival, the waiting thread may be delayed
+        PerfNodeProxy* peer = static_cast< PerfNodeProxy* >( node.get( ));
+        peer->syncAckTime = syncClock_.getTimed();
+        peer->syncAcks = command.get< uint32_t >();
+        return true;
+    }
 };
 
 template< class C >
@@ -132,8 +307,156 @@ bool commandHandler( C command, Buffer& buffer, const uint64_t seed )
                 << std::endl;
         return false;
     }
+    ++received_;
     return true;
 }
+
+/** Signal the stage to all peers and wait for them to reach it. */
+void _enterSyncStage( const PerfNodeProxies& peers, const SyncStage stage )
+{
+    BOOST_FOREACH( PerfNodeProxyPtr peer, peers )
+        peer->send( CMD_NODE_SYNC_STAGE ) << uint32_t( stage );
+    BOOST_FOREACH( PerfNodeProxyPtr peer, peers )
+        peer->syncStage.waitGE( stage );
+}
+
+/** Unmap and delete the sync slaves of all peers. */
+void _unmapSyncObjects( co::LocalNodePtr localNode,
+                        const PerfNodeProxies& peers )
+{
+    BOOST_FOREACH( PerfNodeProxyPtr peer, peers )
+    {
+        BOOST_FOREACH( CommitObject* object, peer->syncObjects )
+        {
+            if( object->isAttached( ))
+                localNode->unmapObject( object );
+            delete object;
+        }
+        peer->syncObjects.clear();
+    }
+}
+
+/**
+ * Measure the latency from commit to the synced slave for each configuration.
+ *
+ * All nodes commit the same version of their master and then sync the slaves
+ * of all peers to this version. Each slave acknowledges its sync to the
+ * master, which takes one sample per slave from the start of its commit to
+ * the arrival of the acknowledgement, i.e., including one transport latency.
+ * STATIC objects are never committed, for them the latency to map and unmap
+ * the object from each peer is measured instead.
+ */
+void _benchSync( co::LocalNodePtr localNode, const SyncConfigs& configs,
+                 CommitObjects& masters, const size_t nSlaves,
+                 const size_t nIterations, const bool multicast )
+{
+    PerfNodeProxies peers;
+    while( peers.size() < nSlaves )
+    {
+        lunchbox::Thread::yield();
+
+        lunchbox::ScopedFastRead _mutex( nodes_ );
+        peers.clear();
+        BOOST_FOREACH( co::NodePtr node, *nodes_ )
+            if( node->getType() == 0xC0FFEEu )
+                peers.push_back( static_cast< PerfNodeProxy* >( node.get( )));
+    }
+
+    // The masters of a peer may not be registered when it connects
+    _enterSyncStage( peers, STAGE_REGISTERED );
+    BOOST_FOREACH( PerfNodeProxyPtr peer, peers )
+    {
+        for( size_t i = 0; i < configs.size(); ++i )
+        {
+            CommitObject* object = new CommitObject;
+            object->changeType = configs[i].type;
+            peer->syncObjects.push_back( object );
+            if( object->changeType == co::Object::STATIC )
+                continue;
+
+            if( !localNode->mapObject( object, _syncID + peer->getNodeID() +
+                                               co::uint128_t( 0, i )))
+            {
+                LBERROR << "Can't map sync object " << i << " of " << peer
+                        << std::endl;
+                _unmapSyncObjects( localNode, peers );
+                return;
+            }
+        }
+    }
+    // don't commit before all peers mapped the first version
+    _enterSyncStage( peers, STAGE_MAPPED );
+
+    uint32_t nCommits = 0;
+    for( size_t i = 0; i < configs.size(); ++i )
+    {
+        const SyncConfig& config = configs[i];
+        CommitObject* master = masters[i];
+        Latencies commits;
+        Latencies latencies;
+
+        for( size_t j = 0; j < nIterations; ++j )
+        {
+            if( config.type == co::Object::STATIC )
+            {
+                BOOST_FOREACH( PerfNodeProxyPtr peer, peers )
+                {
+                    lunchbox::Clock clock;
+                    CommitObject object;
+                    object.changeType = co::Object::STATIC;
+                    if( !localNode->mapObject( &object, _syncID +
+                                   peer->getNodeID() + co::uint128_t( 0, i )))
+                    {
+                        LBERROR << "Can't map static object " << i << " of "
+                                << peer << std::endl;
+                        continue;
+                    }
+                    localNode->unmapObject( &object );
+                    latencies.push_back( clock.getTimef( ));
+                }
+                continue;
+            }
+
+            const double start = syncClock_.getTimed();
+            master->data[ j % master->data.getSize( )] = j;
+            master->commit();
+            commits.push_back( float( syncClock_.getTimed() - start ));
+            ++nCommits;
+
+            const co::uint128_t version( 0, j + 2 );
+            BOOST_FOREACH( PerfNodeProxyPtr peer, peers )
+            {
+                peer->syncObjects[i]->sync( version );
+                peer->send( CMD_NODE_SYNC_ACK ) << nCommits;
+            }
+
+            // a peer acknowledges the next commit only after we received all
+            // acknowledgements of this one, so syncAckTime belongs to it
+            BOOST_FOREACH( PerfNodeProxyPtr peer, peers )
+            {
+                peer->syncAcks.waitGE( nCommits );
+                latencies.push_back( float( peer->syncAckTime - start ));
+            }
+        }
+
+        const lunchbox::ScopedMutex<> mutex( print_ );
+        std::cerr << ( config.type == co::Object::STATIC ? "Map" : "Sync" )
+                  << " latency " << _getName( config.type ) << " "
+                  << config.size << " bytes"
+                  << ( config.compress ? " compressed" : "" ) << ", "
+                  << peers.size() << " slaves"
+                  << ( multicast ? ", multicast" : "" ) << ": ";
+        _printLatencies( std::cerr, latencies );
+        if( !commits.empty( ))
+        {
+            std::cerr << "; commit ";
+            _printLatencies( std::cerr, commits );
+        }
+        std::cerr << std::endl;
+    }
+
+    _unmapSyncObjects( localNode, peers );
+}
 }
 
 int main( int argc, char **argv )
@@ -142,11 +465,19 @@ int main( int argc, char **argv )
         return EXIT_FAILURE;
 
     co::ConnectionDescriptionPtr remote;
+    co::ConnectionDescriptionPtr multicast;
     size_t packetSize = 1048576u; // needs to be modulo 8
     uint32_t nPackets = 0xFFFFFFFFu;
     uint32_t waitTime = 0;
     bool useZeroconf = true;
     bool useObjects = false;
+    bool useCommits = false;
+    bool useDiffs = false;
+    bool useQueue = false;
+    bool useLatency = false;
+    bool useSync = false;
+    size_t nSlaves = 1;
+    int32_t affinity = lunchbox::Thread::NONE;
 
     try // command line parsing
     {
@@ -164,6 +495,35 @@ int main( int argc, char **argv )
         TCLAP::SwitchArg objectsArg( "o", "object",
                    "Benchmark object-object instead of node-node communication",
                                      command, false );
+        TCLAP::SwitchArg commitArg( "m", "commit",
+                  "Benchmark object commits to all connected nodes instead of "
+                                    "node-node communication", command, false );
+        TCLAP::ValueArg<int32_t> relayArg( "r", "relay",
+                          "relay commits through a tree of the given fanout",
+                                           false, 0, "unsigned", command );
+        TCLAP::SwitchArg diffArg( "f", "diff",
+                                  "commit binary diffs of the object data",
+                                  command, false );
+        TCLAP::SwitchArg queueArg( "q", "queue",
+                       "Benchmark distributed queue throughput per slave",
+                                   command, false );
+        TCLAP::SwitchArg latencyArg( "l", "latency",
+                     "Benchmark request/reply round-trip latency to each node",
+                                     command, false );
+        TCLAP::SwitchArg syncArg( "t", "syncLatency",
+                 "Benchmark commit-to-sync latencies of all change types and "
+                         "object sizes up to packetSize, with and without "
+                                  "compression", command, false );
+        TCLAP::ValueArg<size_t> slavesArg( "e", "slaves",
+                        "number of slave nodes to wait for with --syncLatency",
+                                           false, nSlaves, "unsigned",
+                                           command );
+        TCLAP::ValueArg< std::string > multicastArg( "u", "multicast",
+                                "distribute object data using the given "
+                                "multicast group, e.g., 239.255.42.43:4243:RSP",
+                                                     false, "",
+                                                     "IP[:port][:protocol]",
+                                                     command );
         TCLAP::ValueArg<size_t> sizeArg( "p", "packetSize", "packet size",
                                          false, packetSize, "unsigned",
                                          command );
@@ -174,6 +534,21 @@ int main( int argc, char **argv )
         TCLAP::ValueArg<uint32_t> waitArg( "w", "wait",
                                            "wait time (ms) between sends",
                                            false, 0, "unsigned", command );
+        TCLAP::ValueArg<int32_t> busyPollArg( "b", "busyPoll",
+                            "socket busy poll time (us) for low latency mode",
+                                              false, 0, "unsigned", command );
+        TCLAP::ValueArg<int32_t> spinArg( "s", "spin",
+                                 "busy wait (us) for data before blocking",
+                                          false, 0, "unsigned", command );
+        TCLAP::ValueArg<int32_t> zeroCopyArg( "z", "zeroCopy",
+                           "minimum size of zero-copy socket sends, 0 disables",
+                                              false, 0, "unsigned", command );
+        TCLAP::ValueArg<int32_t> affinityArg( "", "affinity",
+                                   "lunchbox::Thread affinity of all threads",
+                                              false, 0, "int", command );
+        TCLAP::ValueArg<int32_t> readAheadArg( "a", "readAhead",
+                        "receive read-ahead buffer size in bytes, 0 disables",
+                                               false, 0, "unsigned", command );
         command.parse( argc, argv );
 
         if( remoteArg.isSet( ))
@@ -184,13 +559,44 @@ int main( int argc, char **argv )
         }
         useZeroconf = !zcArg.isSet();
         useObjects = objectsArg.isSet();
+        useCommits = commitArg.isSet();
+        useDiffs = diffArg.isSet();
+        useQueue = queueArg.isSet();
+        useLatency = latencyArg.isSet();
+        useSync = syncArg.isSet();
+        if( slavesArg.isSet( ))
+            nSlaves = slavesArg.getValue();
+        if( multicastArg.isSet( ))
+        {
+            multicast = new co::ConnectionDescription;
+            multicast->fromString( multicastArg.getValue( ));
+        }
+        if( relayArg.isSet( ))
+            co::Global::setIAttribute( co::Global::IATTR_OBJECT_RELAY_FANOUT,
+                                       relayArg.getValue( ));
 
         if( sizeArg.isSet( ))
             packetSize = sizeArg.getValue();
         if( packetsArg.isSet( ))
             nPackets = uint32_t( packetsArg.getValue( ));
+        else if( useSync )
+            nPackets = 1000; // iterations per configuration
         if( waitArg.isSet( ))
             waitTime = waitArg.getValue();
+        if( busyPollArg.isSet( ))
+            co::Global::setIAttribute( co::Global::IATTR_TCP_BUSY_POLL_US,
+                                       busyPollArg.getValue( ));
+        if( spinArg.isSet( ))
+            co::Global::setIAttribute( co::Global::IATTR_RECV_SPIN_TIME_US,
+                                       spinArg.getValue( ));
+        if( zeroCopyArg.isSet( ))
+            co::Global::setIAttribute( co::Global::IATTR_TCP_ZEROCOPY_SIZE,
+                                       zeroCopyArg.getValue( ));
+        if( affinityArg.isSet( ))
+            affinity = affinityArg.getValue();
+        if( readAheadArg.isSet( ))
+            co::Global::setIAttribute( co::Global::IATTR_READ_AHEAD_SIZE,
+                                       readAheadArg.getValue( ));
     }
     catch( TCLAP::ArgException& exception )
     {
@@ -203,17 +609,57 @@ int main( int argc, char **argv )
 
     // Set up local node
     co::LocalNodePtr localNode = new PerfNode;
+    if( multicast )
+        localNode->addConnectionDescription( multicast );
     if( !localNode->initLocal( argc, argv ))
     {
         co::exit();
         return EXIT_FAILURE;
     }
     localNode->getZeroconf().set( "coNodeperf", co::Version::getString( ));
+    if( affinity != lunchbox::Thread::NONE )
+        localNode->setAffinity( affinity );
 
     Object object;
     object.setID( _objectID + localNode->getNodeID( ));
     LBCHECK( localNode->registerObject( &object ));
 
+    CommitObject commitObject;
+    if( useCommits )
+    {
+        if( useDiffs )
+            commitObject.changeType = co::Object::DIFF;
+        commitObject.setID( _commitID + localNode->getNodeID( ));
+        LBCHECK( localNode->registerObject( &commitObject ));
+    }
+
+    const SyncConfigs syncConfigs = useSync ? _getSyncConfigs( packetSize ) :
+                                              SyncConfigs();
+    CommitObjects syncObjects;
+    for( size_t i = 0; i < syncConfigs.size(); ++i )
+    {
+        const SyncConfig& config = syncConfigs[i];
+        const size_t nElems = config.size / sizeof( uint64_t );
+        CommitObject* syncObject = new CommitObject;
+        syncObject->changeType = config.type;
+        syncObject->compress = config.compress;
+        syncObject->data.resize( nElems );
+        for( size_t j = 0; j < nElems; ++j )
+            syncObject->data[j] = j;
+
+        syncObject->setID( _syncID + localNode->getNodeID() +
+                           co::uint128_t( 0, i ));
+        LBCHECK( localNode->registerObject( syncObject ));
+        syncObjects.push_back( syncObject );
+    }
+
+    co::QueueMaster queueMaster;
+    if( useQueue )
+    {
+        queueMaster.setID( _queueID + localNode->getNodeID( ));
+        LBCHECK( localNode->registerObject( &queueMaster ));
+    }
+
     // run
     if( remote )
     {
@@ -254,9 +700,21 @@ int main( int argc, char **argv )
     for( size_t i = 0; i < bufferElems; ++i )
         buffer[i] = i;
 
+    if( useCommits )
+        commitObject.data = buffer;
+
     const float mBytesSec = buffer.getNumBytes() / 1024.0f / 1024.0f * 1000.0f;
     lunchbox::Clock clock;
     size_t sentPackets = 0;
+    float commitTime = 0.f;
+    Latencies latencies;
+
+    if( useSync )
+    {
+        _benchSync( localNode, syncConfigs, syncObjects, nSlaves, nPackets,
+                    multicast.isValid( ));
+        nPackets = 0;
+    }
 
     clock.reset();
     while( nPackets-- )
@@ -277,6 +735,12 @@ int main( int argc, char **argv )
                                     static_cast< PerfNodeProxy* >( node.get( ));
                         LBCHECK( localNode->mapObject( &peer->object,
                                                _objectID + peer->getNodeID( )));
+                        if( useCommits )
+                            LBCHECK( localNode->mapObject( &peer->commitObject,
+                                               _commitID + peer->getNodeID( )));
+                        if( useQueue )
+                            LBCHECK( localNode->mapObject( &peer->queueSlave,
+                                                _queueID + peer->getNodeID( )));
                     }
                 }
                 nodes = *nodes_;
@@ -285,7 +749,65 @@ int main( int argc, char **argv )
         if( nodes.empty( ))
             break;
 
-        for( co::NodesCIter i = nodes.begin(); i != nodes.end(); ++i )
+        if( useCommits )
+        {
+            const size_t j = nPackets % bufferElems;
+            commitObject.data[ j ] = nPackets;
+
+            lunchbox::Clock commitClock;
+            commitObject.commit();
+            commitTime += commitClock.getTimef();
+            ++sentPackets;
+
+            for( co::NodesCIter i = nodes.begin(); i != nodes.end(); ++i )
+            {
+                co::NodePtr node = *i;
+                if( node->getType() != 0xC0FFEEu )
+                    continue;
+                PerfNodeProxyPtr peer = static_cast<PerfNodeProxy*>(node.get());
+                peer->commitObject.sync( co::VERSION_HEAD );
+            }
+            if( waitTime > 0 )
+                lunchbox::sleep( waitTime );
+        }
+        else if( useQueue )
+        {
+            // produce one item per consumer, then consume from each peer
+            for( size_t i = 0; i < nodes.size(); ++i )
+                queueMaster.push() << nPackets << buffer;
+            sentPackets += nodes.size();
+
+            for( co::NodesCIter i = nodes.begin(); i != nodes.end(); ++i )
+            {
+                co::NodePtr node = *i;
+                if( node->getType() != 0xC0FFEEu )
+                    continue;
+                PerfNodeProxyPtr peer = static_cast<PerfNodeProxy*>(node.get());
+                if( peer->queueSlave.pop().isValid( ))
+                    ++peer->nItems;
+            }
+            if( waitTime > 0 )
+                lunchbox::sleep( waitTime );
+        }
+        else if( useLatency )
+        {
+            for( co::NodesCIter i = nodes.begin(); i != nodes.end(); ++i )
+            {
+                co::NodePtr node = *i;
+                if( node->getType() != 0xC0FFEEu )
+                    continue;
+
+                lunchbox::Clock pingClock;
+                const uint32_t request = localNode->registerRequest();
+                node->send( CMD_NODE_PING ) << request;
+                localNode->waitRequest( request );
+                latencies.push_back( pingClock.getTimef( ));
+                ++sentPackets;
+            }
+            if( waitTime > 0 )
+                lunchbox::sleep( waitTime );
+        }
+        else for( co::NodesCIter i = nodes.begin(); i != nodes.end(); ++i )
         {
             co::NodePtr node = *i;
             if( node->getType() != 0xC0FFEEu )
@@ -317,10 +839,55 @@ int main( int argc, char **argv )
         if( time > 1000.f )
         {
             const lunchbox::ScopedMutex<> mutex( print_ );
-            std::cerr << "Send perf: " << mBytesSec / time * sentPackets
-                      << "MB/s (" << sentPackets / time * 1000.f  << "pps)"
-                      << std::endl;
+            if( useCommits )
+            {
+                std::cerr << "Commit perf: " << nodes.size() << " slaves, "
+                          << commitTime / sentPackets << "ms/commit, "
+                          << mBytesSec / time * sentPackets << "MB/s ("
+                          << sentPackets / time * 1000.f  << " commits/s)"
+                          << std::endl;
+                if( useDiffs )
+                {
+                    std::cerr << "  ";
+                    commitObject.printMemoryUsage( std::cerr );
+                    std::cerr << std::endl;
+                }
+            }
+            else if( useQueue )
+            {
+                for( co::NodesCIter i = nodes.begin(); i != nodes.end(); ++i )
+                {
+                    co::NodePtr node = *i;
+                    if( node->getType() != 0xC0FFEEu )
+                        continue;
+                    PerfNodeProxyPtr peer =
+                        static_cast< PerfNodeProxy* >( node.get( ));
+                    std::cerr << "Queue perf: slave of " << node->getNodeID()
+                              << " " << peer->nItems / time * 1000.f
+                              << " items/s, "
+                              << mBytesSec / time * peer->nItems << "MB/s"
+                              << std::endl;
+                    peer->nItems = 0;
+                }
+            }
+            else if( useLatency )
+            {
+                std::cerr << "Round-trip latency: ";
+                _printLatencies( std::cerr, latencies );
+                std::cerr << " (" << sentPackets / time * 1000.f
+                          << " requests/s)" << std::endl;
+                latencies.clear();
+            }
+            else
+            {
+                std::cerr << "Send perf: " << mBytesSec / time * sentPackets
+                          << "MB/s (" << sentPackets / time * 1000.f  << "pps)"
+                          << ", receive " << received_ / time * 1000.f
+                          << " commands/s" << std::endl;
+                received_ = 0;
+            }
             sentPackets = 0;
+            commitTime = 0.f;
             clock.reset();
         }
     }
@@ -336,6 +903,35 @@ int main( int argc, char **argv )
         clock.reset();
     }
 
+    if( useCommits )
+    {
+        for( co::NodesCIter i = nodes.begin(); i != nodes.end(); ++i )
+        {
+            co::NodePtr node = *i;
+            if( node->getType() != 0xC0FFEEu )
+                continue;
+            PerfNodeProxyPtr peer = static_cast< PerfNodeProxy* >( node.get( ));
+            localNode->unmapObject( &peer->commitObject );
+        }
+        localNode->deregisterObject( &commitObject );
+    }
+    if( useQueue )
+    {
+        for( co::NodesCIter i = nodes.begin(); i != nodes.end(); ++i )
+        {
+            co::NodePtr node = *i;
+            if( node->getType() != 0xC0FFEEu )
+                continue;
+            PerfNodeProxyPtr peer = static_cast< PerfNodeProxy* >( node.get( ));
+            localNode->unmapObject( &peer->queueSlave );
+        }
+        localNode->deregisterObject( &queueMaster );
+    }
+    BOOST_FOREACH( CommitObject* syncObject, syncObjects )
+    {
+        localNode->deregisterObject( syncObject );
+        delete syncObject;
+    }
     localNode->deregisterObject( &object );
     LBCHECK( localNode->exitLocal( ));
     LBCHECK( co::exit( ));
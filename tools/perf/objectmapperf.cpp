@@ -0,0 +1,194 @@
+
+/* Copyright (c) 2013, Stefan.Eilemann@epfl.ch
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 2.1 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+// Tests co::ObjectMap performance with many entries and few changes
+// Usage: see 'coObjectMapperf -h'
+
+#include <co/co.h>
+#include <lunchbox/rng.h>
+#include <tclap/CmdLine.h>
+#include <iostream>
+
+namespace
+{
+static const uint32_t _type = co::OBJECTTYPE_CUSTOM;
+
+class PerfObject : public co::Serializable
+{
+public:
+    PerfObject() : value( 0 ) { enableDirtyTracking(); }
+
+    void setValue( const uint64_t value_ )
+    {
+        value = value_;
+        setDirty( DIRTY_VALUE );
+    }
+
+    uint64_t value;
+
+protected:
+    enum DirtyBits
+    {
+        DIRTY_VALUE = co::Serializable::DIRTY_CUSTOM << 0
+    };
+
+    virtual void serialize( co::DataOStream& os, const uint64_t dirtyBits )
+    {
+        if( dirtyBits & DIRTY_VALUE )
+            os << value;
+    }
+
+    virtual void deserialize( co::DataIStream& is, const uint64_t dirtyBits )
+    {
+        if( dirtyBits & DIRTY_VALUE )
+            is >> value;
+    }
+};
+
+class ObjectFactory : public co::ObjectFactory
+{
+public:
+    virtual co::Object* createObject( const uint32_t type )
+        { return type == _type ? new PerfObject : 0; }
+
+    virtual void destroyObject( co::Object* object, const uint32_t )
+        { delete object; }
+};
+
+typedef std::vector< PerfObject* > PerfObjects;
+
+void _run( co::LocalNodePtr node, const size_t nObjects,
+           const size_t nIterations, const size_t nDirty )
+{
+    ObjectFactory factory;
+    co::ObjectMap master( *node, factory );
+    co::ObjectMap slave( *node, factory );
+    LBCHECK( node->registerObject( &master ));
+    LBCHECK( node->mapObject( &slave, &master ));
+
+    PerfObjects objects( nObjects );
+    for( size_t i = 0; i < nObjects; ++i )
+        objects[i] = new PerfObject;
+
+    lunchbox::Clock clock;
+    for( size_t i = 0; i < nObjects; ++i )
+        LBCHECK( master.register_( objects[i], _type ));
+    const float registerTime = clock.resetTimef();
+
+    slave.sync( master.commit( ));
+    const float initTime = clock.resetTimef();
+
+    lunchbox::RNG rng;
+    for( size_t i = 0; i < nIterations; ++i )
+    {
+        for( size_t j = 0; j < nDirty; ++j )
+            objects[ rng.get< uint32_t >() % nObjects ]->setValue( i );
+        slave.sync( master.commit( ));
+    }
+    const float commitTime = clock.resetTimef();
+
+    const size_t nMapped = LB_MIN( nObjects, size_t( 1000 ));
+    for( size_t i = 0; i < nMapped; ++i )
+        LBCHECK( slave.map( objects[i]->getID( )));
+    const float mapTime = clock.resetTimef();
+
+    const size_t nLookups = nMapped * 100;
+    for( size_t i = 0; i < nLookups; ++i )
+        LBCHECK( slave.map( objects[ i % nMapped ]->getID( )));
+    const float lookupTime = clock.resetTimef();
+
+    for( size_t i = 0; i < nObjects; ++i )
+        LBCHECK( master.deregister( objects[i] ));
+    const float deregisterTime = clock.resetTimef();
+
+    std::cout << nObjects << " entries: register "
+              << registerTime * 1000.f / nObjects << " us, initial sync "
+              << initTime << " ms, commit+sync of " << nDirty << " dirty "
+              << commitTime / nIterations << " ms, map "
+              << mapTime * 1000.f / nMapped << " us, lookup "
+              << lookupTime * 1000.f / nLookups << " us, deregister "
+              << deregisterTime * 1000.f / nObjects << " us" << std::endl;
+
+    slave.sync( master.commit( ));
+    slave.clear();
+    node->unmapObject( &slave );
+    node->deregisterObject( &master );
+
+    for( size_t i = 0; i < nObjects; ++i )
+        delete objects[i];
+}
+}
+
+int main( int argc, char **argv )
+{
+    size_t minObjects = 10000;
+    size_t maxObjects = 1000000;
+    size_t nIterations = 100;
+    size_t nDirty = 10;
+
+    try // command line parsing
+    {
+        TCLAP::CmdLine command(
+            "objectmapperf - Collage object map benchmark tool", ' ',
+            co::Version::getString( ));
+        TCLAP::ValueArg< size_t > minArg( "m", "minObjects",
+                                          "minimum number of map entries",
+                                          false, minObjects, "unsigned",
+                                          command );
+        TCLAP::ValueArg< size_t > maxArg( "n", "maxObjects",
+              "maximum number of map entries, multiplied by ten from minimum",
+                                          false, maxObjects, "unsigned",
+                                          command );
+        TCLAP::ValueArg< size_t > iterationsArg( "i", "iterations",
+                                                 "commits per run", false,
+                                                 nIterations, "unsigned",
+                                                 command );
+        TCLAP::ValueArg< size_t > dirtyArg( "d", "dirty",
+                                            "changed entries per commit",
+                                            false, nDirty, "unsigned",
+                                            command );
+        command.parse( argc, argv );
+
+        minObjects = LB_MAX( minArg.getValue(), size_t( 1 ));
+        maxObjects = LB_MAX( maxArg.getValue(), minObjects );
+        nIterations = LB_MAX( iterationsArg.getValue(), size_t( 1 ));
+        nDirty = dirtyArg.getValue();
+    }
+    catch( TCLAP::ArgException& exception )
+    {
+        LBERROR << "Command line parse error: " << exception.error()
+                << " for argument " << exception.argId() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if( !co::init( argc, argv ))
+        return EXIT_FAILURE;
+
+    co::LocalNodePtr node = new co::LocalNode;
+    if( !node->initLocal( argc, argv ))
+    {
+        co::exit();
+        return EXIT_FAILURE;
+    }
+
+    for( size_t nObjects = minObjects; nObjects <= maxObjects; nObjects *= 10 )
+        _run( node, nObjects, nIterations, nDirty );
+
+    LBCHECK( node->exitLocal( ));
+    LBCHECK( co::exit( ));
+    return EXIT_SUCCESS;
+}